@@ -0,0 +1,1214 @@
+//-----------------------------------------------------------------------------
+//
+//	Benchmarks.cpp
+//
+//	Reproducible throughput benchmarks for OpenZWave.
+//
+//	Runs a set of workloads against simulated controllers, so that no
+//	hardware is needed and every run sees the same traffic, and writes
+//	the results as JSON so that they can be compared between releases.
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <set>
+#include <vector>
+#include <string>
+#include "Options.h"
+#include "Manager.h"
+#include "Driver.h"
+#include "Notification.h"
+#include "value_classes/ValueID.h"
+#include "platform/Log.h"
+#include "platform/SerialController.h"
+#include "platform/HidController.h"
+#include "Defs.h"
+
+using namespace OpenZWave;
+
+extern char ozw_version_string[];
+
+#ifndef BENCH_CONFIG_PATH
+#define BENCH_CONFIG_PATH "config/"
+#endif
+
+// Settings, from the command line
+static uint32	g_numNodes = 50;
+static uint32	g_traceLoops = 20;
+static uint32	g_duration = 2000;				// Milliseconds for each timed loop
+static bool		g_parallelNotifications = false;
+static bool		g_logging = false;
+static string	g_configPath = BENCH_CONFIG_PATH;
+static string	g_tracePath;					// Recorded trace, instead of the synthetic one
+
+static string	g_userPath;
+static string	g_syntheticTrace;
+static bool		g_hid = false;					// Measure a HID controller plugged into this machine
+static string	g_serialPort;					// Measure a serial controller plugged into this machine
+
+// State gathered from notifications
+static pthread_mutex_t	g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	g_cond = PTHREAD_COND_INITIALIZER;
+static set<uint32>		g_queried;				// Home IDs whose nodes have all been queried
+static set<uint32>		g_failed;				// Home IDs whose driver failed
+static vector<ValueID>	g_values;
+static uint32 volatile	g_notifications = 0;	// Notifications delivered to the counting watchers
+
+struct Result
+{
+	string	m_name;
+	string	m_unit;
+	double	m_count;
+	double	m_seconds;
+	string	m_extra;						// Additional JSON members
+};
+
+static vector<Result>	g_results;
+
+//-----------------------------------------------------------------------------
+// <Now>
+// Monotonic time in seconds
+//-----------------------------------------------------------------------------
+static double Now
+(
+)
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//-----------------------------------------------------------------------------
+// <AddResult>
+// Record the outcome of one benchmark
+//-----------------------------------------------------------------------------
+static void AddResult
+(
+	string const& _name,
+	string const& _unit,
+	double _count,
+	double _seconds,
+	string const& _extra = ""
+)
+{
+	Result result;
+	result.m_name = _name;
+	result.m_unit = _unit;
+	result.m_count = _count;
+	result.m_seconds = _seconds;
+	result.m_extra = _extra;
+	g_results.push_back( result );
+
+	fprintf( stderr, "%-32s %12.0f %-14s %8.3fs %14.1f/s\n", _name.c_str(), _count, _unit.c_str(), _seconds,
+			_seconds > 0 ? _count / _seconds : 0.0 );
+}
+
+//-----------------------------------------------------------------------------
+// <OnNotification>
+// Tracks the state of the simulated networks
+//-----------------------------------------------------------------------------
+static void OnNotification
+(
+	Notification const* _notification,
+	void* _context
+)
+{
+	pthread_mutex_lock( &g_mutex );
+	switch( _notification->GetType() )
+	{
+		case Notification::Type_ValueAdded:
+		{
+			g_values.push_back( _notification->GetValueID() );
+			break;
+		}
+		case Notification::Type_AllNodesQueried:
+		case Notification::Type_AllNodesQueriedSomeDead:
+		case Notification::Type_AwakeNodesQueried:
+		{
+			g_queried.insert( _notification->GetHomeId() );
+			pthread_cond_broadcast( &g_cond );
+			break;
+		}
+		case Notification::Type_DriverFailed:
+		{
+			g_failed.insert( _notification->GetHomeId() );
+			pthread_cond_broadcast( &g_cond );
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock( &g_mutex );
+}
+
+//-----------------------------------------------------------------------------
+// <OnCountNotification>
+// Watcher that does nothing but count, for the fan-out benchmarks
+//-----------------------------------------------------------------------------
+static void OnCountNotification
+(
+	Notification const* _notification,
+	void* _context
+)
+{
+	__sync_fetch_and_add( &g_notifications, 1 );
+}
+
+//-----------------------------------------------------------------------------
+// <ControllerPath>
+// Settings string for a simulated controller
+//-----------------------------------------------------------------------------
+static string ControllerPath
+(
+	uint32 const _homeId,
+	uint32 const _nodes,
+	string const& _trace = "",
+	uint32 const _traceLoops = 0
+)
+{
+	char path[512];
+	snprintf( path, sizeof(path), "homeid=0x%.8x,nodes=%d,latency=0", _homeId, _nodes );
+	string result = path;
+	if( !_trace.empty() )
+	{
+		snprintf( path, sizeof(path), ",trace=%s,traceloops=%d,traceidle=2000", _trace.c_str(), _traceLoops );
+		result += path;
+	}
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// <StartNetwork>
+// Add a simulated controller and wait until all of its nodes have been
+// queried.  Returns the time taken, or a negative value on failure.
+//-----------------------------------------------------------------------------
+static double StartNetwork
+(
+	string const& _path,
+	uint32 const _homeId
+)
+{
+	pthread_mutex_lock( &g_mutex );
+	g_queried.erase( _homeId );
+	g_failed.erase( _homeId );
+	pthread_mutex_unlock( &g_mutex );
+
+	double start = Now();
+	Manager::Get()->AddDriver( _path, Driver::ControllerInterface_Simulated );
+
+	bool ok = false;
+	pthread_mutex_lock( &g_mutex );
+	while( true )
+	{
+		if( g_queried.count( _homeId ) )
+		{
+			ok = true;
+			break;
+		}
+		if( g_failed.count( _homeId ) )
+		{
+			break;
+		}
+
+		struct timespec ts;
+		clock_gettime( CLOCK_REALTIME, &ts );
+		ts.tv_sec += 1;
+		pthread_cond_timedwait( &g_cond, &g_mutex, &ts );
+		if( Now() - start > 300 )
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock( &g_mutex );
+
+	if( !ok )
+	{
+		fprintf( stderr, "Network 0x%.8x did not start\n", _homeId );
+		return -1;
+	}
+	return Now() - start;
+}
+
+//-----------------------------------------------------------------------------
+// <ReadCounter>
+// Reads one of the driver statistics
+//-----------------------------------------------------------------------------
+static uint32 ReadCounter
+(
+	uint32 const _homeId,
+	bool const _writes
+)
+{
+	Driver::DriverData data;
+	memset( &data, 0, sizeof(data) );
+	Manager::Get()->GetDriverStatistics( _homeId, &data );
+	return _writes ? data.m_writeCnt : data.m_readCnt;
+}
+
+//-----------------------------------------------------------------------------
+// <WaitForQuiet>
+// Wait until the read or write counters of the drivers stop moving.
+// Returns the number of messages counted since _base, and the time from
+// the first to the last change in _seconds.
+//-----------------------------------------------------------------------------
+static uint32 WaitForQuiet
+(
+	vector<uint32> const& _homeIds,
+	vector<uint32> const& _base,
+	bool const _writes,
+	double* _seconds
+)
+{
+	double first = 0;
+	double last = 0;
+	uint32 previous = 0;
+	double idleSince = Now();
+
+	while( true )
+	{
+		uint32 total = 0;
+		for( size_t i=0; i<_homeIds.size(); ++i )
+		{
+			total += ReadCounter( _homeIds[i], _writes ) - _base[i];
+		}
+
+		double now = Now();
+		if( total != previous )
+		{
+			if( previous == 0 )
+			{
+				first = now;
+			}
+			previous = total;
+			last = now;
+			idleSince = now;
+		}
+		else if( now - idleSince > ( previous ? 1.0 : 30.0 ) )
+		{
+			break;
+		}
+		usleep( 500 );
+	}
+
+	*_seconds = last - first;
+	return previous;
+}
+
+//-----------------------------------------------------------------------------
+// <WriteSyntheticTrace>
+// Create a trace of sensor and switch reports from every node, in the same
+// format as the "Received:" lines of the log
+//-----------------------------------------------------------------------------
+static string WriteSyntheticTrace
+(
+	uint32 const _nodes
+)
+{
+	string filename = g_userPath + "trace.txt";
+	FILE* file = fopen( filename.c_str(), "w" );
+	if( !file )
+	{
+		return "";
+	}
+
+	for( uint32 round=0; round<10; ++round )
+	{
+		for( uint32 nodeId=2; nodeId<_nodes+2; ++nodeId )
+		{
+			uint8 frame[32];
+			uint32 length;
+			int16 temperature = (int16)( 200 + ( ( nodeId * 7 + round * 3 ) % 50 ) );
+			if( round & 1 )
+			{
+				uint8 const report[] = { 0x01, 0x0b, 0x00, 0x04, 0x00, (uint8)nodeId, 0x03, 0x25, 0x03, (uint8)( ( round & 2 ) ? 0xff : 0x00 ) };
+				length = sizeof(report);
+				memcpy( frame, report, length );
+			}
+			else
+			{
+				uint8 const report[] = { 0x01, 0x0e, 0x00, 0x04, 0x00, (uint8)nodeId, 0x06, 0x31, 0x05, 0x01, 0x22, (uint8)( temperature >> 8 ), (uint8)temperature };
+				length = sizeof(report);
+				memcpy( frame, report, length );
+			}
+			frame[1] = (uint8)( length - 1 );
+
+			uint8 checksum = 0xff;
+			for( uint32 i=1; i<length; ++i )
+			{
+				checksum ^= frame[i];
+			}
+			frame[length++] = checksum;
+
+			fprintf( file, "Received: " );
+			for( uint32 i=0; i<length; ++i )
+			{
+				fprintf( file, "%s0x%.2x", i ? ", " : "", frame[i] );
+			}
+			fprintf( file, "\n" );
+		}
+	}
+
+	fclose( file );
+	return filename;
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkInterview>
+// Startup of a new network: init sequence and node interviews
+//-----------------------------------------------------------------------------
+static bool BenchmarkInterview
+(
+	uint32 const _homeId
+)
+{
+	double seconds = StartNetwork( ControllerPath( _homeId, g_numNodes ), _homeId );
+	if( seconds < 0 )
+	{
+		return false;
+	}
+	AddResult( "interview", "nodes", g_numNodes, seconds );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkSendQueue>
+// SendMsg and WriteNextMsg with a deep send queue
+//-----------------------------------------------------------------------------
+static void BenchmarkSendQueue
+(
+	uint32 const _homeId
+)
+{
+	vector<ValueID> switches;
+	pthread_mutex_lock( &g_mutex );
+	for( size_t i=0; i<g_values.size(); ++i )
+	{
+		ValueID const& id = g_values[i];
+		if( id.GetHomeId() == _homeId && id.GetCommandClassId() == 0x25 && id.GetType() == ValueID::ValueType_Bool )
+		{
+			switches.push_back( id );
+		}
+	}
+	pthread_mutex_unlock( &g_mutex );
+
+	if( switches.empty() )
+	{
+		return;
+	}
+
+	vector<uint32> homeIds( 1, _homeId );
+	vector<uint32> base( 1, ReadCounter( _homeId, true ) );
+
+	uint32 const count = (uint32)switches.size() * 20;
+	double start = Now();
+	for( uint32 i=0; i<count; ++i )
+	{
+		Manager::Get()->SetValue( switches[i % switches.size()], ( ( i / switches.size() ) & 1 ) != 0 );
+	}
+	double queued = Now() - start;
+	int32 depth = Manager::Get()->GetSendQueueCount( _homeId );
+
+	double seconds;
+	uint32 writes = WaitForQuiet( homeIds, base, true, &seconds );
+
+	char extra[64];
+	snprintf( extra, sizeof(extra), "\"queue_depth\": %d", depth );
+	AddResult( "send_queue_enqueue", "setvalues", count, queued );
+	AddResult( "send_queue_drain", "messages", writes, seconds, extra );
+}
+
+//-----------------------------------------------------------------------------
+// <ContentionThread>
+// Reads every value in turn until told to stop
+//-----------------------------------------------------------------------------
+struct ContentionContext
+{
+	vector<ValueID> const*	m_values;
+	bool volatile*			m_stop;
+	uint32					m_reads;
+};
+
+static void* ContentionThread
+(
+	void* _context
+)
+{
+	ContentionContext* context = (ContentionContext*)_context;
+	vector<ValueID> const& values = *context->m_values;
+	uint32 reads = 0;
+	while( !*context->m_stop )
+	{
+		for( size_t i=0; i<values.size(); ++i )
+		{
+			ValueID const& id = values[i];
+			if( id.GetType() == ValueID::ValueType_Bool )
+			{
+				bool value;
+				Manager::Get()->GetValueAsBool( id, &value );
+			}
+			else if( id.GetType() == ValueID::ValueType_Decimal )
+			{
+				float value;
+				Manager::Get()->GetValueAsFloat( id, &value );
+			}
+			else
+			{
+				string value;
+				Manager::Get()->GetValueAsString( id, &value );
+			}
+			++reads;
+		}
+	}
+	context->m_reads = reads;
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkGetValueContention>
+// Manager::GetValueAs* from several threads at once
+//-----------------------------------------------------------------------------
+static void BenchmarkGetValueContention
+(
+	uint32 const _homeId
+)
+{
+	vector<ValueID> values;
+	pthread_mutex_lock( &g_mutex );
+	for( size_t i=0; i<g_values.size(); ++i )
+	{
+		if( g_values[i].GetHomeId() == _homeId )
+		{
+			values.push_back( g_values[i] );
+		}
+	}
+	pthread_mutex_unlock( &g_mutex );
+
+	uint32 const threadCounts[] = { 1, 4, 16 };
+	for( size_t t=0; t<sizeof(threadCounts)/sizeof(threadCounts[0]); ++t )
+	{
+		uint32 numThreads = threadCounts[t];
+		bool volatile stop = false;
+		vector<pthread_t> threads( numThreads );
+		vector<ContentionContext> contexts( numThreads );
+
+		double start = Now();
+		for( uint32 i=0; i<numThreads; ++i )
+		{
+			contexts[i].m_values = &values;
+			contexts[i].m_stop = &stop;
+			contexts[i].m_reads = 0;
+			pthread_create( &threads[i], NULL, ContentionThread, &contexts[i] );
+		}
+
+		usleep( g_duration * 1000 );
+		stop = true;
+
+		uint32 reads = 0;
+		for( uint32 i=0; i<numThreads; ++i )
+		{
+			pthread_join( threads[i], NULL );
+			reads += contexts[i].m_reads;
+		}
+
+		char name[64];
+		snprintf( name, sizeof(name), "getvalue_contention_t%d", numThreads );
+		char extra[64];
+		snprintf( extra, sizeof(extra), "\"threads\": %d", numThreads );
+		AddResult( name, "reads", reads, Now() - start, extra );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkConfig>
+// WriteConfig, then ReadConfig through a restart of the driver
+//-----------------------------------------------------------------------------
+static void BenchmarkConfig
+(
+	uint32 const _homeId
+)
+{
+	uint32 const iterations = 20;
+	double start = Now();
+	for( uint32 i=0; i<iterations; ++i )
+	{
+		Manager::Get()->WriteConfig( _homeId );
+	}
+	double seconds = Now() - start;
+
+	char filename[64];
+	snprintf( filename, sizeof(filename), "zwcfg_0x%.8x.xml", _homeId );
+	struct stat st;
+	long size = ( stat( ( g_userPath + filename ).c_str(), &st ) == 0 ) ? (long)st.st_size : 0;
+
+	char extra[64];
+	snprintf( extra, sizeof(extra), "\"nodes\": %d, \"bytes\": %ld", g_numNodes, size );
+	AddResult( "config_write", "writes", iterations, seconds, extra );
+
+	// Restarting the driver reads the configuration back in, and the nodes
+	// then only need their dynamic values refreshed.
+	string path = ControllerPath( _homeId, g_numNodes );
+	Manager::Get()->RemoveDriver( path );
+	seconds = StartNetwork( path, _homeId );
+	if( seconds >= 0 )
+	{
+		AddResult( "config_load_startup", "nodes", g_numNodes, seconds, extra );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkTrace>
+// Replay the trace to one or more networks, with the specified number of
+// extra watchers, and measure ReadMsg/ProcessMsg and notification throughput
+//-----------------------------------------------------------------------------
+static void BenchmarkTrace
+(
+	string const& _name,
+	uint32 const _firstHomeId,
+	uint32 const _numDrivers,
+	uint32 const _numWatchers
+)
+{
+	string trace = g_tracePath.empty() ? g_syntheticTrace : g_tracePath;
+	vector<uint32> homeIds;
+	vector<string> paths;
+	for( uint32 i=0; i<_numDrivers; ++i )
+	{
+		homeIds.push_back( _firstHomeId + i );
+		paths.push_back( ControllerPath( _firstHomeId + i, g_numNodes, trace, g_traceLoops ) );
+	}
+
+	vector<int> contexts( _numWatchers );
+	for( uint32 i=0; i<_numWatchers; ++i )
+	{
+		Manager::Get()->AddWatcher( OnCountNotification, &contexts[i] );
+	}
+
+	// The simulated controllers wait for the driver to go quiet before replaying
+	bool ok = true;
+	for( uint32 i=0; i<_numDrivers; ++i )
+	{
+		pthread_mutex_lock( &g_mutex );
+		g_queried.erase( homeIds[i] );
+		pthread_mutex_unlock( &g_mutex );
+		Manager::Get()->AddDriver( paths[i], Driver::ControllerInterface_Simulated );
+	}
+	for( uint32 i=0; i<_numDrivers && ok; ++i )
+	{
+		pthread_mutex_lock( &g_mutex );
+		double start = Now();
+		while( !g_queried.count( homeIds[i] ) && Now() - start < 300 )
+		{
+			struct timespec ts;
+			clock_gettime( CLOCK_REALTIME, &ts );
+			ts.tv_sec += 1;
+			pthread_cond_timedwait( &g_cond, &g_mutex, &ts );
+		}
+		ok = ( g_queried.count( homeIds[i] ) != 0 );
+		pthread_mutex_unlock( &g_mutex );
+	}
+
+	if( ok )
+	{
+		vector<uint32> base;
+		for( uint32 i=0; i<_numDrivers; ++i )
+		{
+			base.push_back( ReadCounter( homeIds[i], false ) );
+		}
+		uint32 notifications = g_notifications;
+
+		double seconds;
+		uint32 frames = WaitForQuiet( homeIds, base, false, &seconds );
+		notifications = g_notifications - notifications;
+
+		char extra[128];
+		snprintf( extra, sizeof(extra), "\"drivers\": %d, \"watchers\": %d, \"notifications\": %d",
+				_numDrivers, _numWatchers, notifications );
+		AddResult( _name, "frames", frames, seconds, extra );
+	}
+	else
+	{
+		fprintf( stderr, "%s: networks did not start\n", _name.c_str() );
+	}
+
+	for( uint32 i=0; i<_numWatchers; ++i )
+	{
+		Manager::Get()->RemoveWatcher( OnCountNotification, &contexts[i] );
+	}
+	for( uint32 i=0; i<_numDrivers; ++i )
+	{
+		Manager::Get()->RemoveDriver( paths[i] );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <RoutingThread>
+// Looks up one home ID until told to stop
+//-----------------------------------------------------------------------------
+struct RoutingContext
+{
+	uint32					m_homeId;
+	bool volatile*			m_stop;
+	uint32					m_lookups;
+};
+
+static void* RoutingThread
+(
+	void* _context
+)
+{
+	RoutingContext* context = (RoutingContext*)_context;
+	uint32 lookups = 0;
+	while( !*context->m_stop )
+	{
+		Manager::Get()->GetControllerNodeId( context->m_homeId );
+		++lookups;
+	}
+	context->m_lookups = lookups;
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkRouting>
+// Home ID lookups from one thread per driver, to show how routing scales
+// with the number of drivers
+//-----------------------------------------------------------------------------
+static void BenchmarkRouting
+(
+	uint32 const _firstHomeId,
+	uint32 const _numDrivers
+)
+{
+	vector<string> paths;
+	bool ok = true;
+	for( uint32 i=0; i<_numDrivers && ok; ++i )
+	{
+		paths.push_back( ControllerPath( _firstHomeId + i, 2 ) );
+		ok = ( StartNetwork( paths.back(), _firstHomeId + i ) >= 0 );
+	}
+
+	if( ok )
+	{
+		bool volatile stop = false;
+		vector<pthread_t> threads( _numDrivers );
+		vector<RoutingContext> contexts( _numDrivers );
+
+		double start = Now();
+		for( uint32 i=0; i<_numDrivers; ++i )
+		{
+			contexts[i].m_homeId = _firstHomeId + i;
+			contexts[i].m_stop = &stop;
+			contexts[i].m_lookups = 0;
+			pthread_create( &threads[i], NULL, RoutingThread, &contexts[i] );
+		}
+
+		usleep( g_duration * 1000 );
+		stop = true;
+
+		uint32 lookups = 0;
+		for( uint32 i=0; i<_numDrivers; ++i )
+		{
+			pthread_join( threads[i], NULL );
+			lookups += contexts[i].m_lookups;
+		}
+
+		char name[64];
+		snprintf( name, sizeof(name), "routing_d%d", _numDrivers );
+		char extra[64];
+		snprintf( extra, sizeof(extra), "\"drivers\": %d, \"threads\": %d", _numDrivers, _numDrivers );
+		AddResult( name, "lookups", lookups, Now() - start, extra );
+	}
+	else
+	{
+		fprintf( stderr, "routing_d%d: networks did not start\n", _numDrivers );
+	}
+
+	for( size_t i=0; i<paths.size(); ++i )
+	{
+		Manager::Get()->RemoveDriver( paths[i] );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <CreateOptions>
+// Create and lock the options used by every benchmark
+//-----------------------------------------------------------------------------
+static void CreateOptions
+(
+	bool const _reportThread
+)
+{
+	Options::Create( g_configPath, g_userPath, "" );
+	Options::Get()->AddOptionBool( "Logging", g_logging );
+	Options::Get()->AddOptionBool( "ConsoleOutput", false );
+	Options::Get()->AddOptionInt( "SaveLogLevel", LogLevel_Warning );
+	Options::Get()->AddOptionBool( "SaveConfiguration", false );
+	Options::Get()->AddOptionBool( "ParallelNotifications", g_parallelNotifications );
+	Options::Get()->AddOptionBool( "ReportThread", _reportThread );
+	Options::Get()->Lock();
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkReportThread>
+// The trace benchmarks again, with reports decoded on the report thread
+// instead of the driver thread.  Compare with process_msg_trace and
+// multi_driver_d4.
+//-----------------------------------------------------------------------------
+static void BenchmarkReportThread
+(
+)
+{
+	CreateOptions( true );
+	Manager::Create();
+	Manager::Get()->AddWatcher( OnNotification, NULL );
+
+	BenchmarkTrace( "process_msg_trace_report_thread", 0xb0000c00, 1, 0 );
+	BenchmarkTrace( "multi_driver_d4_report_thread", 0xb0000c10, 4, 4 );
+
+	Manager::Get()->RemoveWatcher( OnNotification, NULL );
+	Manager::Destroy();
+	Options::Destroy();
+}
+
+//-----------------------------------------------------------------------------
+// <CpuSeconds>
+// User and system time used by the process
+//-----------------------------------------------------------------------------
+static double CpuSeconds
+(
+)
+{
+	struct rusage usage;
+	getrusage( RUSAGE_SELF, &usage );
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+//-----------------------------------------------------------------------------
+// <ReadBytes>
+// Read exactly the requested number of bytes from a controller
+//-----------------------------------------------------------------------------
+static bool ReadBytes
+(
+	Controller* _controller,
+	uint8* _buffer,
+	uint32 _length
+)
+{
+	uint32 got = 0;
+	while( got < _length )
+	{
+		if( _controller->WaitForData( 1000 ) < 0 )
+		{
+			return false;
+		}
+		got += _controller->Read( _buffer + got, _length - got );
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <AddLatencyResult>
+// Record per-frame latencies, and the CPU used while the controller is idle
+//-----------------------------------------------------------------------------
+static void AddLatencyResult
+(
+	string const& _name,
+	Controller* _controller,
+	vector<double> const& _latencies,
+	double _seconds
+)
+{
+	if( _latencies.empty() )
+	{
+		fprintf( stderr, "%-32s no frames received\n", _name.c_str() );
+		return;
+	}
+
+	double total = 0;
+	double worst = 0;
+	for( size_t i=0; i<_latencies.size(); ++i )
+	{
+		total += _latencies[i];
+		if( _latencies[i] > worst )
+		{
+			worst = _latencies[i];
+		}
+	}
+
+	// Nothing else runs while the controllers are measured, so the process's
+	// CPU time is the cost of the controller's read path waiting for data.
+	double idleStart = Now();
+	double cpuStart = CpuSeconds();
+	_controller->WaitForData( 1000 );
+	double idleCpu = ( CpuSeconds() - cpuStart ) / ( Now() - idleStart );
+
+	char extra[128];
+	snprintf( extra, sizeof(extra), "\"avg_latency_us\": %.1f, \"max_latency_us\": %.1f, \"idle_cpu_percent\": %.2f",
+			total * 1e6 / _latencies.size(), worst * 1e6, idleCpu * 100 );
+	AddResult( _name, "frames", (double)_latencies.size(), _seconds, extra );
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkPtyLatency>
+// Time from a frame arriving at a serial port until the driver can read it,
+// through a pseudo terminal standing in for the controller
+//-----------------------------------------------------------------------------
+static void BenchmarkPtyLatency
+(
+	string const& _name,
+	bool const _directRead
+)
+{
+	int master = posix_openpt( O_RDWR | O_NOCTTY );
+	if( master < 0 || grantpt( master ) < 0 || unlockpt( master ) < 0 )
+	{
+		fprintf( stderr, "%-32s unable to create a pseudo terminal\n", _name.c_str() );
+		if( master >= 0 )
+		{
+			close( master );
+		}
+		return;
+	}
+
+	SerialController* controller = new SerialController();
+	controller->SetDirectRead( _directRead );
+	if( !controller->Open( ptsname( master ) ) )
+	{
+		fprintf( stderr, "%-32s unable to open %s\n", _name.c_str(), ptsname( master ) );
+		controller->Release();
+		close( master );
+		return;
+	}
+
+	// A FUNC_ID_ZW_GET_VERSION response, as a controller would send it
+	uint8 frame[] = { SOF, 0x10, RESPONSE, FUNC_ID_ZW_GET_VERSION, 'Z', '-', 'W', 'a', 'v', 'e', ' ', '4', '.', '5', '4', 0x00, 0x01, 0x00 };
+	uint8 received[sizeof(frame)];
+
+	vector<double> latencies;
+	double start = Now();
+	while( Now() - start < g_duration / 1000.0 )
+	{
+		double sent = Now();
+		if( write( master, frame, sizeof(frame) ) != (ssize_t)sizeof(frame) || !ReadBytes( controller, received, sizeof(frame) ) )
+		{
+			break;
+		}
+		latencies.push_back( Now() - sent );
+	}
+	double seconds = Now() - start;
+
+	AddLatencyResult( _name, controller, latencies, seconds );
+	controller->Close();
+	controller->Release();
+	close( master );
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkDeviceLatency>
+// Round trip of FUNC_ID_ZW_GET_VERSION through a real controller: the time
+// from sending the request until the response has been read
+//-----------------------------------------------------------------------------
+static void BenchmarkDeviceLatency
+(
+	string const& _name,
+	Controller* _controller
+)
+{
+	uint8 request[] = { SOF, 0x03, REQUEST, FUNC_ID_ZW_GET_VERSION, 0x00 };
+	request[4] = 0xff ^ request[1] ^ request[2] ^ request[3];
+	uint8 ack = ACK;
+	uint8 buffer[256];
+
+	vector<double> latencies;
+	double start = Now();
+	while( Now() - start < g_duration / 1000.0 )
+	{
+		double sent = Now();
+		if( _controller->Write( request, sizeof(request) ) != sizeof(request) )
+		{
+			break;
+		}
+
+		// ACK, then SOF and length, then the rest of the response
+		if( !ReadBytes( _controller, buffer, 3 ) || buffer[0] != ACK || buffer[1] != SOF
+			|| !ReadBytes( _controller, &buffer[3], buffer[2] ) )
+		{
+			break;
+		}
+		latencies.push_back( Now() - sent );
+		_controller->Write( &ack, 1 );
+	}
+	double seconds = Now() - start;
+
+	AddLatencyResult( _name, _controller, latencies, seconds );
+}
+
+//-----------------------------------------------------------------------------
+// <BenchmarkControllers>
+// Per-frame latency and idle CPU of the controller read paths
+//-----------------------------------------------------------------------------
+static void BenchmarkControllers
+(
+)
+{
+	BenchmarkPtyLatency( "serial_frame_latency", false );
+	BenchmarkPtyLatency( "serial_direct_frame_latency", true );
+
+	// The hardware is not needed for the runs above, but nothing can stand in
+	// for a HID controller, so those are only measured when one is present.
+	if( !g_serialPort.empty() )
+	{
+		SerialController* controller = new SerialController();
+		if( controller->Open( g_serialPort ) )
+		{
+			BenchmarkDeviceLatency( "serial_device_round_trip", controller );
+			controller->Close();
+		}
+		else
+		{
+			fprintf( stderr, "Unable to open serial controller %s\n", g_serialPort.c_str() );
+		}
+		controller->Release();
+	}
+
+	if( g_hid )
+	{
+		HidController* controller = new HidController();
+		if( controller->Open( "HID Controller" ) )
+		{
+			BenchmarkDeviceLatency( "hid_device_round_trip", controller );
+			controller->Close();
+		}
+		else
+		{
+			fprintf( stderr, "Unable to open a HID controller\n" );
+		}
+		controller->Release();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <WriteResults>
+// Emit the results as JSON
+//-----------------------------------------------------------------------------
+static void WriteResults
+(
+	FILE* _file
+)
+{
+	fprintf( _file, "{\n" );
+	fprintf( _file, "  \"version\": \"%s\",\n", ozw_version_string );
+	fprintf( _file, "  \"settings\": { \"nodes\": %d, \"trace_loops\": %d, \"duration_ms\": %d, \"parallel_notifications\": %s, \"logging\": %s, \"trace\": \"%s\" },\n",
+			g_numNodes, g_traceLoops, g_duration, g_parallelNotifications ? "true" : "false", g_logging ? "true" : "false",
+			g_tracePath.empty() ? "synthetic" : g_tracePath.c_str() );
+	fprintf( _file, "  \"results\": [\n" );
+	for( size_t i=0; i<g_results.size(); ++i )
+	{
+		Result const& result = g_results[i];
+		fprintf( _file, "    { \"name\": \"%s\", \"unit\": \"%s\", \"count\": %.0f, \"seconds\": %.6f, \"rate\": %.3f%s%s }%s\n",
+				result.m_name.c_str(), result.m_unit.c_str(), result.m_count, result.m_seconds,
+				result.m_seconds > 0 ? result.m_count / result.m_seconds : 0.0,
+				result.m_extra.empty() ? "" : ", ", result.m_extra.c_str(),
+				( i + 1 < g_results.size() ) ? "," : "" );
+	}
+	fprintf( _file, "  ]\n" );
+	fprintf( _file, "}\n" );
+}
+
+//-----------------------------------------------------------------------------
+// <RemoveUserPath>
+// Delete the scratch directory used for configuration and trace files
+//-----------------------------------------------------------------------------
+static void RemoveUserPath
+(
+)
+{
+	if( DIR* dir = opendir( g_userPath.c_str() ) )
+	{
+		while( struct dirent* entry = readdir( dir ) )
+		{
+			if( entry->d_name[0] != '.' )
+			{
+				unlink( ( g_userPath + entry->d_name ).c_str() );
+			}
+		}
+		closedir( dir );
+	}
+	rmdir( g_userPath.c_str() );
+}
+
+//-----------------------------------------------------------------------------
+// <Usage>
+//-----------------------------------------------------------------------------
+static void Usage
+(
+	char const* _program
+)
+{
+	fprintf( stderr, "Usage: %s [options]\n", _program );
+	fprintf( stderr, "  --output <file>           write the JSON results to a file rather than stdout\n" );
+	fprintf( stderr, "  --nodes <n>               nodes in each simulated network (default %d)\n", g_numNodes );
+	fprintf( stderr, "  --trace <file>            replay a recorded trace instead of the synthetic one\n" );
+	fprintf( stderr, "  --trace-loops <n>         times each trace is replayed (default %d)\n", g_traceLoops );
+	fprintf( stderr, "  --duration <ms>           length of each timed loop (default %d)\n", g_duration );
+	fprintf( stderr, "  --config <dir>            OpenZWave config directory (default %s)\n", BENCH_CONFIG_PATH );
+	fprintf( stderr, "  --parallel-notifications  dispatch notifications per driver\n" );
+	fprintf( stderr, "  --logging                 keep logging enabled while benchmarking\n" );
+	fprintf( stderr, "  --serial <port>           also measure a serial controller on this port\n" );
+	fprintf( stderr, "  --hid                     also measure a HID controller\n" );
+}
+
+//-----------------------------------------------------------------------------
+// <main>
+//-----------------------------------------------------------------------------
+int main
+(
+	int argc,
+	char* argv[]
+)
+{
+	char const* output = NULL;
+	for( int i=1; i<argc; ++i )
+	{
+		string arg = argv[i];
+		bool hasValue = ( i + 1 < argc );
+		if( arg == "--output" && hasValue )
+		{
+			output = argv[++i];
+		}
+		else if( arg == "--nodes" && hasValue )
+		{
+			g_numNodes = (uint32)atoi( argv[++i] );
+			if( g_numNodes < 1 || g_numNodes > 231 )
+			{
+				g_numNodes = 50;
+			}
+		}
+		else if( arg == "--trace" && hasValue )
+		{
+			g_tracePath = argv[++i];
+		}
+		else if( arg == "--trace-loops" && hasValue )
+		{
+			g_traceLoops = (uint32)atoi( argv[++i] );
+		}
+		else if( arg == "--duration" && hasValue )
+		{
+			g_duration = (uint32)atoi( argv[++i] );
+		}
+		else if( arg == "--config" && hasValue )
+		{
+			g_configPath = argv[++i];
+		}
+		else if( arg == "--parallel-notifications" )
+		{
+			g_parallelNotifications = true;
+		}
+		else if( arg == "--logging" )
+		{
+			g_logging = true;
+		}
+		else if( arg == "--serial" && hasValue )
+		{
+			g_serialPort = argv[++i];
+		}
+		else if( arg == "--hid" )
+		{
+			g_hid = true;
+		}
+		else
+		{
+			Usage( argv[0] );
+			return 1;
+		}
+	}
+
+	char userPath[] = "/tmp/ozwbenchXXXXXX";
+	if( !mkdtemp( userPath ) )
+	{
+		fprintf( stderr, "Unable to create a scratch directory\n" );
+		return 1;
+	}
+	g_userPath = string( userPath ) + "/";
+	g_syntheticTrace = WriteSyntheticTrace( g_numNodes );
+
+	CreateOptions( false );
+
+	BenchmarkControllers();
+
+	Manager::Create();
+	Manager::Get()->AddWatcher( OnNotification, NULL );
+
+	uint32 const homeId = 0xb0000001;
+	if( BenchmarkInterview( homeId ) )
+	{
+		BenchmarkSendQueue( homeId );
+		BenchmarkGetValueContention( homeId );
+		BenchmarkConfig( homeId );
+		Manager::Get()->RemoveDriver( ControllerPath( homeId, g_numNodes ) );
+	}
+
+	BenchmarkTrace( "process_msg_trace", 0xb0000100, 1, 0 );
+	BenchmarkTrace( "notification_fanout_w16", 0xb0000200, 1, 16 );
+	BenchmarkTrace( "notification_fanout_w64", 0xb0000300, 1, 64 );
+
+	// Drivers on separate home IDs should scale with the number of drivers
+	uint32 const driverCounts[] = { 1, 2, 4, 8 };
+	for( size_t i=0; i<sizeof(driverCounts)/sizeof(driverCounts[0]); ++i )
+	{
+		uint32 const numDrivers = driverCounts[i];
+		char name[64];
+		snprintf( name, sizeof(name), "multi_driver_d%d", numDrivers );
+		BenchmarkTrace( name, 0xb0000400 + numDrivers * 0x10, numDrivers, 4 );
+		BenchmarkRouting( 0xb0000800 + numDrivers * 0x10, numDrivers );
+	}
+
+	Manager::Get()->RemoveWatcher( OnNotification, NULL );
+	Manager::Destroy();
+	Options::Destroy();
+
+	BenchmarkReportThread();
+	RemoveUserPath();
+
+	FILE* file = output ? fopen( output, "w" ) : stdout;
+	if( !file )
+	{
+		fprintf( stderr, "Unable to write %s\n", output );
+		return 1;
+	}
+	WriteResults( file );
+	if( output )
+	{
+		fclose( file );
+	}
+	return 0;
+}
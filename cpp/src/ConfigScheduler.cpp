@@ -0,0 +1,541 @@
+//-----------------------------------------------------------------------------
+//
+//	ConfigScheduler.cpp
+//
+//	Reads and writes batches of configuration parameters across many nodes
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <string.h>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "Node.h"
+#include "Options.h"
+#include "Notification.h"
+#include "Utils.h"
+#include "ConfigScheduler.h"
+#include "command_classes/Configuration.h"
+#include "platform/Mutex.h"
+#include "platform/Log.h"
+#include "value_classes/Value.h"
+#include "value_classes/ValueList.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::ConfigScheduler>
+//	Constructor
+//-----------------------------------------------------------------------------
+ConfigScheduler::ConfigScheduler
+(
+	Driver* _driver
+):
+	m_driver( _driver ),
+	m_mutex( new Mutex() ),
+	m_lastBatchId( 0 ),
+	m_timeout( 30000 )
+{
+	for( int32 i=0; i<256; ++i )
+	{
+		NodeWork& work = m_nodes[i];
+		work.m_owner = this;
+		work.m_nodeId = (uint8)i;
+		work.m_busy = false;
+	}
+
+	Options::Get()->GetOptionAsInt( "ConfigBatchTimeout", &m_timeout );
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::~ConfigScheduler>
+//	Destructor.  The driver thread must have stopped.
+//-----------------------------------------------------------------------------
+ConfigScheduler::~ConfigScheduler
+(
+)
+{
+	for( int32 i=0; i<256; ++i )
+	{
+		m_driver->m_timers->Cancel( &m_nodes[i].m_timer );
+	}
+	m_driver->m_timers->Cancel( &m_notifyTimer );
+
+	for( map<uint8,Batch*>::iterator it = m_batches.begin(); it != m_batches.end(); ++it )
+	{
+		delete it->second;
+	}
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::Submit>
+//	Start a batch of parameter reads and writes
+//-----------------------------------------------------------------------------
+uint8 ConfigScheduler::Submit
+(
+	vector<Driver::ConfigParamItem> const& _items
+)
+{
+	if( _items.empty() )
+	{
+		return 0;
+	}
+
+	LockGuard LG( m_driver->m_nodeMutex );
+	m_mutex->Lock();
+
+	// Find an unused batch ID.  A finished batch whose results were never
+	// collected gives its ID up.
+	uint8 batchId = 0;
+	for( int32 i=0; i<255 && batchId == 0; ++i )
+	{
+		m_lastBatchId = (uint8)( m_lastBatchId % 255 + 1 );
+		map<uint8,Batch*>::iterator it = m_batches.find( m_lastBatchId );
+		if( it == m_batches.end() )
+		{
+			batchId = m_lastBatchId;
+		}
+		else if( it->second->m_remaining == 0 )
+		{
+			delete it->second;
+			m_batches.erase( it );
+			batchId = m_lastBatchId;
+		}
+	}
+	if( batchId == 0 )
+	{
+		m_mutex->Unlock();
+		Log::Write( LogLevel_Warning, "Config batch: too many batches in progress" );
+		return 0;
+	}
+
+	Batch* batch = new Batch();
+	batch->m_id = batchId;
+	batch->m_items = _items;
+	batch->m_remaining = (uint32)_items.size();
+	m_batches[batchId] = batch;
+
+	// Sort the items out by node
+	vector<uint32> writes[256];
+	vector<uint32> reads[256];
+	for( uint32 i=0; i<batch->m_items.size(); ++i )
+	{
+		Driver::ConfigParamItem& item = batch->m_items[i];
+		item.m_result = Driver::ConfigParamResult_Pending;
+
+		Configuration* cc = GetConfiguration( item.m_nodeId );
+		if( cc == NULL )
+		{
+			Resolve( batch, i, Driver::ConfigParamResult_Unsupported );
+			continue;
+		}
+
+		if( !item.m_write )
+		{
+			reads[item.m_nodeId].push_back( i );
+			continue;
+		}
+
+		if( item.m_size == 0 )
+		{
+			// Use the size of the value that represents the parameter, as Node::SetConfigParam does
+			item.m_size = 2;
+			if( Value* value = cc->GetValue( 1, item.m_param ) )
+			{
+				switch( value->GetID().GetType() )
+				{
+					case ValueID::ValueType_Bool:
+					case ValueID::ValueType_Byte:
+					case ValueID::ValueType_Button:
+					{
+						item.m_size = 1;
+						break;
+					}
+					case ValueID::ValueType_Int:
+					{
+						item.m_size = 4;
+						break;
+					}
+					case ValueID::ValueType_List:
+					{
+						item.m_size = static_cast<ValueList*>( value )->GetSize();
+						break;
+					}
+					default:
+					{
+						break;
+					}
+				}
+				value->Release();
+			}
+		}
+		if( item.m_size != 1 && item.m_size != 2 && item.m_size != 4 )
+		{
+			Resolve( batch, i, Driver::ConfigParamResult_Unsupported );
+			continue;
+		}
+		writes[item.m_nodeId].push_back( i );
+	}
+
+	uint32 numNodes = 0;
+	for( int32 nodeId=0; nodeId<256; ++nodeId )
+	{
+		if( writes[nodeId].empty() && reads[nodeId].empty() )
+		{
+			continue;
+		}
+
+		bool bulk = ( GetConfiguration( (uint8)nodeId )->GetVersion() >= 2 );
+		Plan( batch, (uint8)nodeId, true, writes[nodeId], bulk );
+		Plan( batch, (uint8)nodeId, false, reads[nodeId], bulk );
+		StartNext( &m_nodes[nodeId] );
+		++numNodes;
+	}
+
+	Log::Write( LogLevel_Info, "Config batch %d: %d items for %d nodes", batchId, _items.size(), numNodes );
+	m_mutex->Unlock();
+	return batchId;
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::GetResults>
+//	Collect the results of a finished batch
+//-----------------------------------------------------------------------------
+bool ConfigScheduler::GetResults
+(
+	uint8 const _batchId,
+	vector<Driver::ConfigParamItem>* _items
+)
+{
+	bool res = false;
+	m_mutex->Lock();
+	map<uint8,Batch*>::iterator it = m_batches.find( _batchId );
+	if( it != m_batches.end() && it->second->m_remaining == 0 )
+	{
+		_items->swap( it->second->m_items );
+		delete it->second;
+		m_batches.erase( it );
+		res = true;
+	}
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::OnReport>
+//	A device has reported the value of a parameter
+//-----------------------------------------------------------------------------
+void ConfigScheduler::OnReport
+(
+	uint8 const _nodeId,
+	uint8 const _param,
+	int32 const _value,
+	uint8 const _size
+)
+{
+	m_mutex->Lock();
+	NodeWork* work = &m_nodes[_nodeId];
+	if( !work->m_busy )
+	{
+		m_mutex->Unlock();
+		return;
+	}
+
+	Op& op = work->m_ops.front();
+	int32 bit = (int32)_param - (int32)op.m_first;
+	if( bit < 0 || bit >= op.m_count || ( op.m_pending & ( 1u << bit ) ) == 0 )
+	{
+		m_mutex->Unlock();
+		return;
+	}
+	op.m_pending &= ~( 1u << bit );
+
+	// Compare only the bytes written, as reported values are not sign extended
+	uint32 mask = ( op.m_size >= 4 ) ? 0xffffffff : ( ( 1u << ( op.m_size * 8 ) ) - 1 );
+	for( vector<uint32>::iterator it = op.m_items.begin(); it != op.m_items.end(); ++it )
+	{
+		Driver::ConfigParamItem& item = op.m_batch->m_items[*it];
+		if( item.m_param != _param || item.m_result != Driver::ConfigParamResult_Pending )
+		{
+			continue;
+		}
+
+		Driver::ConfigParamResult result = Driver::ConfigParamResult_Success;
+		if( op.m_write && ( _size != op.m_size || ( ( (uint32)_value ^ (uint32)op.m_values[bit] ) & mask ) != 0 ) )
+		{
+			Log::Write( LogLevel_Warning, _nodeId, "Config batch %d: parameter %d was set to %d, but reads back as %d", op.m_batch->m_id, _param, op.m_values[bit], _value );
+			result = Driver::ConfigParamResult_Rejected;
+		}
+		item.m_value = _value;
+		item.m_size = _size;
+		Resolve( op.m_batch, *it, result );
+	}
+
+	if( op.m_pending == 0 )
+	{
+		FinishOp( work, Driver::ConfigParamResult_Success );
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::Plan>
+//	Split a node's reads or writes into operations.  The caller must hold the
+//	lock.
+//-----------------------------------------------------------------------------
+void ConfigScheduler::Plan
+(
+	Batch* _batch,
+	uint8 const _nodeId,
+	bool const _write,
+	vector<uint32>& _items,
+	bool const _bulk
+)
+{
+	// Order by parameter.  Items for the same parameter stay in the order given,
+	// so that the last value written to a parameter is the one that is sent.
+	vector< pair<uint8,uint32> > byParam;
+	for( vector<uint32>::iterator it = _items.begin(); it != _items.end(); ++it )
+	{
+		byParam.push_back( pair<uint8,uint32>( _batch->m_items[*it].m_param, *it ) );
+	}
+	sort( byParam.begin(), byParam.end() );
+
+	uint32 i = 0;
+	while( i < byParam.size() )
+	{
+		Op op;
+		op.m_batch = _batch;
+		op.m_write = _write;
+		op.m_bulk = _bulk;
+		op.m_first = byParam[i].first;
+		op.m_count = 0;
+		op.m_size = _batch->m_items[byParam[i].second].m_size;
+		op.m_pending = 0;
+		memset( op.m_values, 0, sizeof(op.m_values) );
+
+		while( i < byParam.size() )
+		{
+			uint8 param = byParam[i].first;
+			Driver::ConfigParamItem const& item = _batch->m_items[byParam[i].second];
+			bool repeat = ( op.m_count > 0 && (int32)param == (int32)op.m_first + op.m_count - 1 );
+			if( op.m_count > 0 )
+			{
+				if( _write && item.m_size != op.m_size )
+				{
+					break;
+				}
+				if( !repeat )
+				{
+					// Extend the run only with the next parameter, and only while it fits
+					if( !_bulk || (int32)param != (int32)op.m_first + op.m_count || op.m_count >= c_maxBulkParams )
+					{
+						break;
+					}
+					if( _write && ( op.m_count + 1 ) * op.m_size > c_maxBulkBytes )
+					{
+						break;
+					}
+				}
+			}
+
+			if( repeat )
+			{
+				op.m_values[op.m_count-1] = item.m_value;
+			}
+			else
+			{
+				op.m_values[op.m_count] = item.m_value;
+				op.m_pending |= ( 1u << op.m_count );
+				++op.m_count;
+			}
+			op.m_items.push_back( byParam[i].second );
+			++i;
+		}
+
+		m_nodes[_nodeId].m_ops.push_back( op );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::StartNext>
+//	Queue a node's next operation.  The caller must hold the lock.
+//-----------------------------------------------------------------------------
+void ConfigScheduler::StartNext
+(
+	NodeWork* _work
+)
+{
+	while( !_work->m_busy && !_work->m_ops.empty() )
+	{
+		Op& op = _work->m_ops.front();
+		Configuration* cc = GetConfiguration( _work->m_nodeId );
+		Driver::ConfigParamResult result = Driver::ConfigParamResult_Unsupported;
+		bool sent = false;
+		if( cc != NULL )
+		{
+			if( !op.m_write )
+			{
+				sent = ( op.m_bulk && op.m_count > 1 ) ? cc->BulkGet( op.m_first, op.m_count ) : cc->RequestValue( 0, op.m_first, 1, Driver::MsgQueue_Send );
+			}
+			else if( op.m_bulk )
+			{
+				sent = cc->BulkSet( op.m_first, op.m_count, op.m_size, op.m_values );
+			}
+			else
+			{
+				// Read the value back, to learn whether the device accepted it
+				cc->Set( op.m_first, op.m_values[0], op.m_size );
+				sent = cc->RequestValue( 0, op.m_first, 1, Driver::MsgQueue_Send );
+				result = Driver::ConfigParamResult_Unverified;
+			}
+		}
+
+		if( sent )
+		{
+			_work->m_busy = true;
+			m_driver->m_timers->Arm( &_work->m_timer, m_timeout, NodeTimerCallback, _work );
+			return;
+		}
+
+		// Nothing to wait for
+		for( vector<uint32>::iterator it = op.m_items.begin(); it != op.m_items.end(); ++it )
+		{
+			Resolve( op.m_batch, *it, result );
+		}
+		_work->m_ops.pop_front();
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::FinishOp>
+//	A node's operation is over.  Give any items still waiting the result, and
+//	move on to the next operation.  The caller must hold the lock.
+//-----------------------------------------------------------------------------
+void ConfigScheduler::FinishOp
+(
+	NodeWork* _work,
+	Driver::ConfigParamResult const _result
+)
+{
+	m_driver->m_timers->Cancel( &_work->m_timer );
+
+	Op& op = _work->m_ops.front();
+	for( vector<uint32>::iterator it = op.m_items.begin(); it != op.m_items.end(); ++it )
+	{
+		if( op.m_batch->m_items[*it].m_result == Driver::ConfigParamResult_Pending )
+		{
+			Resolve( op.m_batch, *it, _result );
+		}
+	}
+	_work->m_ops.pop_front();
+	_work->m_busy = false;
+
+	StartNext( _work );
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::Resolve>
+//	Record the result of an item.  The caller must hold the lock.
+//-----------------------------------------------------------------------------
+void ConfigScheduler::Resolve
+(
+	Batch* _batch,
+	uint32 const _index,
+	Driver::ConfigParamResult const _result
+)
+{
+	_batch->m_items[_index].m_result = _result;
+	if( --_batch->m_remaining == 0 )
+	{
+		m_completed.push_back( _batch->m_id );
+		if( !m_notifyTimer.IsArmed() )
+		{
+			m_driver->m_timers->Arm( &m_notifyTimer, 0, NotifyTimerCallback, this );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::GetConfiguration>
+//	The Configuration command class of a node, if it has one
+//-----------------------------------------------------------------------------
+Configuration* ConfigScheduler::GetConfiguration
+(
+	uint8 const _nodeId
+)
+{
+	if( Node* node = m_driver->GetNodeUnsafe( _nodeId ) )
+	{
+		return static_cast<Configuration*>( node->GetCommandClass( Configuration::StaticGetCommandClassId() ) );
+	}
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::NodeTimerCallback>
+//	A node has not answered its operation in time
+//-----------------------------------------------------------------------------
+void ConfigScheduler::NodeTimerCallback
+(
+	void* _context
+)
+{
+	NodeWork* work = (NodeWork*)_context;
+	ConfigScheduler* cs = work->m_owner;
+
+	LockGuard LG( cs->m_driver->m_nodeMutex );
+	cs->m_mutex->Lock();
+	if( work->m_busy )
+	{
+		Log::Write( LogLevel_Warning, work->m_nodeId, "Config batch %d: no report of parameters %d-%d", work->m_ops.front().m_batch->m_id, work->m_ops.front().m_first, work->m_ops.front().m_first + work->m_ops.front().m_count - 1 );
+		cs->FinishOp( work, Driver::ConfigParamResult_TimedOut );
+	}
+	cs->m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigScheduler::NotifyTimerCallback>
+//	Tell the driver's watchers which batches have finished
+//-----------------------------------------------------------------------------
+void ConfigScheduler::NotifyTimerCallback
+(
+	void* _context
+)
+{
+	ConfigScheduler* cs = (ConfigScheduler*)_context;
+	cs->m_mutex->Lock();
+	vector<uint8> completed;
+	completed.swap( cs->m_completed );
+	cs->m_mutex->Unlock();
+
+	for( vector<uint8>::iterator it = completed.begin(); it != completed.end(); ++it )
+	{
+		Log::Write( LogLevel_Info, "Config batch %d: finished", *it );
+		Notification* notification = new Notification( Notification::Type_ConfigBatchComplete );
+		notification->SetHomeAndNodeIds( cs->m_driver->GetHomeId(), 0 );
+		notification->SetBatchId( *it );
+		cs->m_driver->QueueNotification( notification );
+	}
+}
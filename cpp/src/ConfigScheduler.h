@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+//
+//	ConfigScheduler.h
+//
+//	Reads and writes batches of configuration parameters across many nodes
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ConfigScheduler_H
+#define _ConfigScheduler_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "platform/TimerWheel.h"
+
+namespace OpenZWave
+{
+	class Configuration;
+	class Mutex;
+
+	/** \brief Carries out batches of configuration parameter reads and writes.
+	 *
+	 * The items of a batch are grouped by node, and each node's are split into
+	 * operations of one or two messages:
+	 * - on devices with version 2 of the Configuration command class, a run of
+	 *   consecutive parameters is written with a single Bulk Set, whose handshake
+	 *   report confirms the values stored, or read with a single Bulk Get;
+	 * - on other devices, each parameter written is set and then read back, and each
+	 *   parameter read is requested on its own.
+	 * A node's writes go before its reads, so that a parameter that is both written and
+	 * read is read back with its new value.
+	 *
+	 * Each node has one operation on the send queue at a time, and its next is queued
+	 * when the first is answered or times out.  The nodes therefore proceed side by side,
+	 * and waiting for one node's reports does not hold up the others.  A batch finishes
+	 * once every item has a result, and is then reported with a
+	 * Notification::Type_ConfigBatchComplete notification.
+	 *
+	 * Locks are taken in the order: node mutex, scheduler mutex, send mutex.
+	 */
+	class ConfigScheduler
+	{
+	public:
+		ConfigScheduler( Driver* _driver );
+		~ConfigScheduler();
+
+		/**
+		 * Start a batch.
+		 * @param _items The reads and writes.
+		 * @return The ID of the batch, or 0 if it could not be started.
+		 */
+		uint8 Submit( vector<Driver::ConfigParamItem> const& _items );
+
+		/**
+		 * Collect the results of a finished batch, and forget it.
+		 * @return False if there is no such batch, or it has not finished.
+		 */
+		bool GetResults( uint8 const _batchId, vector<Driver::ConfigParamItem>* _items );
+
+		/**
+		 * Called by the Configuration command class for each parameter a device reports.
+		 */
+		void OnReport( uint8 const _nodeId, uint8 const _param, int32 const _value, uint8 const _size );
+
+	private:
+		ConfigScheduler( ConfigScheduler const& );					// prevent copy
+		ConfigScheduler& operator = ( ConfigScheduler const& );	// prevent assignment
+
+		enum
+		{
+			c_maxBulkParams = 16,									// Parameters in a bulk operation
+			c_maxBulkBytes = 32										// Bytes of values in a bulk set
+		};
+
+		struct Batch
+		{
+			uint8							m_id;
+			uint32							m_remaining;			// Items without a result
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			vector<Driver::ConfigParamItem>	m_items;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		};
+
+		struct Op
+		{
+			Batch*				m_batch;
+			bool				m_write;
+			bool				m_bulk;
+			uint8				m_first;
+			uint8				m_count;
+			uint8				m_size;								// Bytes in each value written
+			int32				m_values[c_maxBulkParams];			// Values written
+			uint32				m_pending;							// Bit n set while parameter m_first+n is awaited
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			vector<uint32>		m_items;							// Indices of the batch items served
+OPENZWAVE_EXPORT_WARNINGS_ON
+		};
+
+		struct NodeWork
+		{
+			ConfigScheduler*	m_owner;
+			uint8				m_nodeId;
+			bool				m_busy;								// The first operation is on the send queue
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			list<Op>			m_ops;
+OPENZWAVE_EXPORT_WARNINGS_ON
+			TimerWheel::Timer	m_timer;
+		};
+
+		void Plan( Batch* _batch, uint8 const _nodeId, bool const _write, vector<uint32>& _items, bool const _bulk );
+		void StartNext( NodeWork* _work );
+		void FinishOp( NodeWork* _work, Driver::ConfigParamResult const _result );
+		void Resolve( Batch* _batch, uint32 const _index, Driver::ConfigParamResult const _result );
+		Configuration* GetConfiguration( uint8 const _nodeId );
+
+		static void NodeTimerCallback( void* _context );
+		static void NotifyTimerCallback( void* _context );
+
+		Driver*				m_driver;
+		Mutex*				m_mutex;
+		NodeWork			m_nodes[256];
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		map<uint8,Batch*>	m_batches;
+		vector<uint8>		m_completed;							// Finished batches waiting to be reported by the driver thread
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint8				m_lastBatchId;
+		TimerWheel::Timer	m_notifyTimer;
+
+		// Options
+		int32				m_timeout;
+	};
+
+} // namespace OpenZWave
+
+#endif //_ConfigScheduler_H
@@ -33,6 +33,13 @@
 #include "Notification.h"
 #include "Scene.h"
 #include "ZWSecurity.h"
+#include "ConfigScheduler.h"
+#include "ReportDispatcher.h"
+#include "SecurityDecryptor.h"
+#include "SetValueTracker.h"
+#include "ValueHistory.h"
+#include "HealScheduler.h"
+#include "NetworkGraph.h"
 
 #include "platform/Event.h"
 #include "platform/Mutex.h"
@@ -42,15 +49,22 @@
 #else
 #include "platform/HidController.h"
 #endif
+#include "platform/SimulatedController.h"
+#include "platform/ReplayController.h"
 #include "platform/Thread.h"
 #include "platform/Log.h"
 #include "platform/TimeStamp.h"
 
 #include "command_classes/CommandClasses.h"
+#include "command_classes/Basic.h"
+#include "command_classes/CentralScene.h"
 #include "command_classes/ApplicationStatus.h"
 #include "command_classes/ControllerReplication.h"
+#include "command_classes/SceneActivation.h"
 #include "command_classes/Security.h"
 #include "command_classes/WakeUp.h"
+#include "command_classes/MultiInstance.h"
+#include "command_classes/MultiCmd.h"
 #include "command_classes/SwitchAll.h"
 #include "command_classes/ManufacturerSpecific.h"
 #include "command_classes/NoOperation.h"
@@ -130,6 +144,9 @@ static char const* c_sendQueueNames[] =
 		"Poll"
 };
 
+// Largest command a MultiCmd frame carries, from its command class ID to its last byte
+static uint32 const c_maxMultiCmdPayload = 46;
+
 
 //-----------------------------------------------------------------------------
 // <Driver::Driver>
@@ -169,17 +186,47 @@ m_expectedCallbackId( 0 ),
 m_expectedReply( 0 ),
 m_expectedCommandClassId( 0 ),
 m_expectedNodeId( 0 ),
+m_msgHandlerMutex( new Mutex() ),
+m_externalCallMutex( new Mutex() ),
 m_pollThread( new Thread( "poll" ) ),
 m_pollMutex( new Mutex() ),
 m_pollInterval( 0 ),
 m_bIntervalBetweenPolls( false ),				// if set to true (via SetPollInterval), the pollInterval will be interspersed between each poll (so a much smaller m_pollInterval like 100, 500, or 1,000 may be appropriate)
+m_adaptivePolling( false ),
+m_pollAirtimeBudget( 10 ),
+m_pollBudgetFactor( 1.0 ),
+m_warmStart( false ),
+m_warmStartInterval( 1000 ),
+m_warmStartTime( 0 ),
 m_currentControllerCommand( NULL ),
 m_SUCNodeId( 0 ),
 m_controllerResetEvent( NULL ),
 m_sendMutex( new Mutex() ),
 m_currentMsg( NULL ),
+m_currentMsgTimeout( RETRY_TIMEOUT ),
+m_retryTimeout( RETRY_TIMEOUT ),
+m_adaptiveRetryTimeout( false ),
+m_retryTimeoutMin( 1000 ),
+m_retryTimeoutMax( RETRY_TIMEOUT ),
+m_timers( new TimerWheel() ),
+m_maxPendingReports( 0 ),
+m_deadNodeProbeInterval( 10000 ),
+m_deadNodeProbeIntervalMax( 600000 ),
+m_deadNodeDropped( 0 ),
+m_deadNodeHeld( 0 ),
+m_deadNodeProbes( 0 ),
 m_virtualNeighborsReceived( false ),
+m_configScheduler( NULL ),
+m_reportDispatcher( NULL ),
+m_setValueTracker( NULL ),
+m_setValueCapture( 0 ),
+m_valueHistory( NULL ),
+m_multiCmdRequests( true ),
+m_multiCmdNodeId( 0 ),
+m_multiCmdDepth( 0 ),
+m_multiCmdQueue( MsgQueue_Send ),
 m_notificationsEvent( new Event() ),
+m_notificationsMutex( new Mutex() ),
 m_SOFCnt( 0 ),
 m_ACKWaiting( 0 ),
 m_readAborts( 0 ),
@@ -201,8 +248,12 @@ m_nondelivery( 0 ),
 m_routedbusy( 0 ),
 m_broadcastReadCnt( 0 ),
 m_broadcastWriteCnt( 0 ),
+m_duplicatesDropped( 0 ),
+m_networkGraph( NULL ),
+m_healScheduler( NULL ),
 m_nonceReportSent( 0 ),
-m_nonceReportSentAttempt( 0 )
+m_nonceReportSentAttempt( 0 ),
+m_securityDecryptor( NULL )
 {
 	// set a timestamp to indicate when this driver started
 	TimeStamp m_startTime;
@@ -215,10 +266,13 @@ m_nonceReportSentAttempt( 0 )
 
 	// Clear the nodes array
 	memset( m_nodes, 0, sizeof(Node*) * 256 );
+	memset( m_circuits, 0, sizeof(Circuit*) * 256 );
 
 	// Clear the virtual neighbors array
 	memset( m_virtualNeighbors, 0, NUM_NODE_BITFIELD_BYTES );
 
+	InitMsgHandlers();
+
 	// Initilize the Network Keys
 
 	initNetworkKeys(false);
@@ -227,15 +281,107 @@ m_nonceReportSentAttempt( 0 )
 	{
 		m_controller = new HidController();
 	}
+	else if( ControllerInterface_Simulated == _interface )
+	{
+		m_controller = new SimulatedController();
+	}
+	else if( ControllerInterface_Replay == _interface )
+	{
+		m_controller = new ReplayController();
+	}
 	else
 	{
-		m_controller = new SerialController();
+		SerialController* serialController = new SerialController();
+		bool directRead = false;
+		Options::Get()->GetOptionAsBool( "SerialDirectRead", &directRead );
+		serialController->SetDirectRead( directRead );
+		m_controller = serialController;
 	}
 	m_controller->SetSignalThreshold( 1 );
 
 	Options::Get()->GetOptionAsBool( "NotifyTransactions", &m_notifytransactions );
 	Options::Get()->GetOptionAsInt( "PollInterval", &m_pollInterval );
 	Options::Get()->GetOptionAsBool( "IntervalBetweenPolls", &m_bIntervalBetweenPolls );
+	Options::Get()->GetOptionAsBool( "AdaptivePolling", &m_adaptivePolling );
+	Options::Get()->GetOptionAsInt( "PollAirtimeBudget", &m_pollAirtimeBudget );
+	Options::Get()->GetOptionAsBool( "WarmStart", &m_warmStart );
+	Options::Get()->GetOptionAsInt( "WarmStartRefreshInterval", &m_warmStartInterval );
+	Options::Get()->GetOptionAsInt( "MaxPendingReports", &m_maxPendingReports );
+	Options::Get()->GetOptionAsInt( "RetryTimeout", &m_retryTimeout );
+	Options::Get()->GetOptionAsBool( "AdaptiveRetryTimeout", &m_adaptiveRetryTimeout );
+	Options::Get()->GetOptionAsInt( "RetryTimeoutMin", &m_retryTimeoutMin );
+	Options::Get()->GetOptionAsInt( "RetryTimeoutMax", &m_retryTimeoutMax );
+	if( m_retryTimeoutMax < m_retryTimeout )
+	{
+		// Nodes that have not been measured yet must not wait less than the RetryTimeout option
+		m_retryTimeoutMax = m_retryTimeout;
+	}
+	Options::Get()->GetOptionAsInt( "DeadNodeProbeInterval", &m_deadNodeProbeInterval );
+	Options::Get()->GetOptionAsInt( "DeadNodeProbeIntervalMax", &m_deadNodeProbeIntervalMax );
+	Options::Get()->GetOptionAsBool( "MultiCmdRequests", &m_multiCmdRequests );
+
+	// The duplicate window of each command class, with the overrides given as a
+	// comma separated list of hex command class IDs and times, such as "0x31=0,0x71=2000"
+	int32 duplicateWindow = 500;
+	Options::Get()->GetOptionAsInt( "DuplicateWindow", &duplicateWindow );
+	for( int32 i=0; i<256; ++i )
+	{
+		m_duplicateWindow[i] = duplicateWindow > 0 ? duplicateWindow : 0;
+	}
+
+	// A button pressed twice in quick succession sends the same command twice, so
+	// these command classes keep every copy unless DuplicateWindows says otherwise
+	m_duplicateWindow[Basic::StaticGetCommandClassId()] = 0;
+	m_duplicateWindow[SceneActivation::StaticGetCommandClassId()] = 0;
+	m_duplicateWindow[CentralScene::StaticGetCommandClassId()] = 0;
+
+	string windows;
+	vector<string> entries;
+	Options::Get()->GetOptionAsString( "DuplicateWindows", &windows );
+	OpenZWave::split( entries, windows, ",", true );
+	for( vector<string>::iterator it = entries.begin(); it != entries.end(); ++it )
+	{
+		unsigned int commandClassId;
+		int window;
+		char extra;
+		if( sscanf( it->c_str(), " %x = %d %c", &commandClassId, &window, &extra ) != 2 || commandClassId > 0xff || window < 0 )
+		{
+			Log::Write( LogLevel_Warning, "Ignoring the badly formed DuplicateWindows entry \"%s\"", it->c_str() );
+			continue;
+		}
+		m_duplicateWindow[commandClassId] = (uint32)window;
+	}
+
+	m_networkGraph = new NetworkGraph( this );
+	m_healScheduler = new HealScheduler( this );
+	m_configScheduler = new ConfigScheduler( this );
+	m_setValueTracker = new SetValueTracker( this );
+
+	string historySizes;
+	Options::Get()->GetOptionAsString( "ValueHistory", &historySizes );
+	if( !historySizes.empty() )
+	{
+		string historyTiers;
+		int32 historyMemory = 4096;
+		Options::Get()->GetOptionAsString( "ValueHistoryTiers", &historyTiers );
+		Options::Get()->GetOptionAsInt( "ValueHistoryMemory", &historyMemory );
+		m_valueHistory = new ValueHistory( historySizes, historyTiers, historyMemory > 0 ? historyMemory * 1024 : 0 );
+	}
+
+	bool reportThread = false;
+	Options::Get()->GetOptionAsBool( "ReportThread", &reportThread );
+	if( reportThread )
+	{
+		m_reportDispatcher = new ReportDispatcher( this );
+	}
+
+	memset( m_nonceTables, 0, sizeof(m_nonceTables) );
+	int32 securityWorkers = 0;
+	Options::Get()->GetOptionAsInt( "SecurityWorkers", &securityWorkers );
+	if( securityWorkers > 0 )
+	{
+		m_securityDecryptor = new SecurityDecryptor( this, securityWorkers );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -281,7 +427,16 @@ Driver::~Driver
 	m_driverThread->Stop();
 	m_driverThread->Release();
 
+	// With the driver thread gone no more reports are dispatched, and the workers
+	// must be stopped before the nodes they decode for are deleted.
+	delete m_reportDispatcher;
+	m_reportDispatcher = NULL;
+	delete m_securityDecryptor;
+	m_securityDecryptor = NULL;
+
 	m_sendMutex->Release();
+	m_msgHandlerMutex->Release();
+	m_externalCallMutex->Release();
 
 	m_controller->Close();
 	m_controller->Release();
@@ -293,6 +448,20 @@ Driver::~Driver
 		RemoveCurrentMsg();
 	}
 
+	// Return the outstanding report transactions to the send queues, to be cleared below.
+	// This must happen before the nodes are deleted, as they remove their own queue items.
+	while( !m_pendingReports.empty() )
+	{
+		ReleasePendingReport( m_pendingReports.front(), true );
+		m_pendingReports.pop_front();
+	}
+
+	// Likewise the messages held for dead nodes are deleted before the nodes
+	for( int32 i=0; i<256; ++i )
+	{
+		RemoveCircuit( (uint8)i );
+	}
+
 	// Clear the node data
 	{
 		LockGuard LG(m_nodeMutex);
@@ -311,6 +480,14 @@ Driver::~Driver
 	// Don't release until all nodes have removed their poll values
 	m_pollMutex->Release();
 
+	delete m_configScheduler;
+	delete m_setValueTracker;
+	delete m_valueHistory;
+	delete m_healScheduler;
+	delete m_networkGraph;
+	m_timers->Cancel( &m_retryTimer );
+	delete m_timers;
+
 	// Clear the send Queue
 	for( int32 i=0; i<MsgQueue_Count; ++i )
 	{
@@ -351,6 +528,7 @@ Driver::~Driver
 		delete m_controllerReplication;
 
 	m_notificationsEvent->Release();
+	m_notificationsMutex->Release();
 	m_nodeMutex->Release();
 
 }
@@ -399,43 +577,64 @@ void Driver::DriverThreadProc
 		if( Init( attempts ) )
 		{
 			// Driver has been initialised
-			Wait* waitObjects[11];
+			Wait* waitObjects[13];
 			waitObjects[0] = _exitEvent;				// Thread must exit.
 			waitObjects[1] = m_notificationsEvent;			// Notifications waiting to be sent.
-			waitObjects[2] = m_controller;				// Controller has received data.
-			waitObjects[3] = m_queueEvent[MsgQueue_Command];	// A controller command is in progress.
-			waitObjects[4] = m_queueEvent[MsgQueue_Security];	// Security Related Commands (As they have a timeout)
-			waitObjects[5] = m_queueEvent[MsgQueue_NoOp];		// Send device probes and diagnostics messages
-			waitObjects[6] = m_queueEvent[MsgQueue_Controller];	// A multi-part controller command is in progress
-			waitObjects[7] = m_queueEvent[MsgQueue_WakeUp];		// A node has woken. Pending messages should be sent.
-			waitObjects[8] = m_queueEvent[MsgQueue_Send];		// Ordinary requests to be sent.
-			waitObjects[9] = m_queueEvent[MsgQueue_Query];		// Node queries are pending.
-			waitObjects[10] = m_queueEvent[MsgQueue_Poll];		// Poll request is waiting.
-
-			TimeStamp retryTimeStamp;
-			int retryTimeout = RETRY_TIMEOUT;
-			Options::Get()->GetOptionAsInt( "RetryTimeout", &retryTimeout );
-			//retryTimeout = RETRY_TIMEOUT * 10;
+			waitObjects[2] = m_timers->GetEvent();			// Another thread has armed a timer.
+			waitObjects[3] = m_controller;				// Controller has received data.
+
+			// Decrypted frames may hold the reply to the current message, so they are
+			// always waited for, like received data
+			uint32 queues = 4;
+			if( m_securityDecryptor != NULL )
+			{
+				waitObjects[queues++] = m_securityDecryptor->GetResultEvent();	// Secured frames have been decrypted.
+			}
+
+			waitObjects[queues+0] = m_queueEvent[MsgQueue_Command];	// A controller command is in progress.
+			waitObjects[queues+1] = m_queueEvent[MsgQueue_Security];	// Security Related Commands (As they have a timeout)
+			waitObjects[queues+2] = m_queueEvent[MsgQueue_NoOp];		// Send device probes and diagnostics messages
+			waitObjects[queues+3] = m_queueEvent[MsgQueue_Controller];	// A multi-part controller command is in progress
+			waitObjects[queues+4] = m_queueEvent[MsgQueue_WakeUp];	// A node has woken. Pending messages should be sent.
+			waitObjects[queues+5] = m_queueEvent[MsgQueue_Send];		// Ordinary requests to be sent.
+			waitObjects[queues+6] = m_queueEvent[MsgQueue_Query];		// Node queries are pending.
+			waitObjects[queues+7] = m_queueEvent[MsgQueue_Poll];		// Poll request is waiting.
+
 			while( true )
 			{
 				Log::Write( LogLevel_StreamDetail, "      Top of DriverThreadProc loop." );
-				uint32 count = 11;
-				int32 timeout = Wait::Timeout_Infinite;
+
+				// Handle any timeouts that have expired
+				m_timers->Advance();
+
+				uint32 count = queues + 8;
+				m_timers->GetEvent()->Reset();
+				int32 timeout = m_timers->GetNextTimeout();
+				bool resend = false;
 
 				// If we're waiting for a message to complete, we can only
 				// handle incoming data, notifications and exit events.
 				if( m_waitingForAck || m_expectedCallbackId || m_expectedReply )
 				{
-					count = 3;
-					timeout = m_waitingForAck ? ACK_TIMEOUT : retryTimeStamp.TimeRemaining();
-					if( timeout < 0 )
+					count = queues;
+					if( m_waitingForAck )
+					{
+						if( timeout == Wait::Timeout_Infinite || timeout > ACK_TIMEOUT )
+						{
+							timeout = ACK_TIMEOUT;
+							resend = true;
+						}
+					}
+					else if( !m_retryTimer.IsArmed() )
 					{
+						// The retry timeout ran out while we were waiting for the ACK
 						timeout = 0;
+						resend = true;
 					}
 				}
 				else if( m_currentControllerCommand != NULL )
 				{
-					count = 7;
+					count = queues + 4;
 				}
 				else
 				{
@@ -443,23 +642,16 @@ void Driver::DriverThreadProc
 				}
 
 				// Wait for something to do
-				int32 res = Wait::Multiple( waitObjects, count, timeout );
+				int32 res = m_controller->WaitMultiple( waitObjects, count, timeout );
 
 				switch( res )
 				{
 					case -1:
 					{
-						// Wait has timed out - time to resend
-						if( m_currentMsg != NULL )
-						{
-							Notification* notification = new Notification( Notification::Type_Notification );
-							notification->SetHomeAndNodeIds( m_homeId, m_currentMsg->GetTargetNodeId() );
-							notification->SetNotification( Notification::Code_Timeout );
-							QueueNotification( notification );
-						}
-						if( WriteMsg( "Wait Timeout" ) )
+						// Wait has timed out.  Timers are handled at the top of the loop.
+						if( resend )
 						{
-							retryTimeStamp.SetTime( retryTimeout );
+							ResendCurrentMsg();
 						}
 						break;
 					}
@@ -475,6 +667,12 @@ void Driver::DriverThreadProc
 						break;
 					}
 					case 2:
+					{
+						// A timer has been armed.  The timeout is worked out again
+						// at the top of the loop.
+						break;
+					}
+					case 3:
 					{
 						// Data has been received
 						ReadMsg();
@@ -482,10 +680,17 @@ void Driver::DriverThreadProc
 					}
 					default:
 					{
+						if( res < (int32)queues )
+						{
+							// Secured frames have been decrypted
+							ProcessDecryptedMsgs();
+							break;
+						}
+
 						// All the other events are sending message queue items
-						if( WriteNextMsg( (MsgQueue)(res-3) ) )
+						if( WriteNextMsg( (MsgQueue)(res-queues) ) )
 						{
-							retryTimeStamp.SetTime( retryTimeout );
+							m_timers->Arm( &m_retryTimer, m_currentMsgTimeout, RetryTimerCallback, this );
 						}
 						break;
 					}
@@ -556,12 +761,22 @@ bool Driver::Init
 		return false;
 	}
 
+	// Record the traffic if asked to
+	string captureFile;
+	Options::Get()->GetOptionAsString( "CaptureFile", &captureFile );
+	if( !captureFile.empty() && !m_controller->IsCapturing() )
+	{
+		string userPath;
+		Options::Get()->GetOptionAsString( "UserPath", &userPath );
+		m_controller->StartCapture( userPath + GetCaptureFileName( captureFile ) );
+	}
+
 	// Controller opened successfully, so we need to start all the worker threads
 	m_pollThread->Start( Driver::PollThreadEntryPoint, this );
 
 	// Send a NAK to the ZWave device
 	uint8 nak = NAK;
-	m_controller->Write( &nak, 1 );
+	m_controller->Send( &nak, 1 );
 
 	// Get/set ZWave controller information in its preferred initialization order
 	m_controller->PlayInitSequence( this );
@@ -577,6 +792,34 @@ bool Driver::Init
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::GetCaptureFileName>
+// Add the controller name to the capture file name, so that each driver
+// writes its own file
+//-----------------------------------------------------------------------------
+string Driver::GetCaptureFileName
+(
+	string const& _captureFile
+)const
+{
+	// Use the last part of the controller path, such as ttyUSB0 for /dev/ttyUSB0
+	string name = m_controllerPath.substr( m_controllerPath.find_last_of( "/\\" ) + 1 );
+	for( size_t i=0; i<name.size(); ++i )
+	{
+		if( !isalnum( (unsigned char)name[i] ) )
+		{
+			name[i] = '_';
+		}
+	}
+
+	size_t dot = _captureFile.find_last_of( '.' );
+	if( dot == string::npos )
+	{
+		return _captureFile + "_" + name;
+	}
+	return _captureFile.substr( 0, dot ) + "_" + name + _captureFile.substr( dot );
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::RemoveQueues>
 // Clean up any messages to a node
@@ -590,6 +833,14 @@ void Driver::RemoveQueues
 	{
 		RemoveCurrentMsg();
 	}
+	RemovePendingReport( _nodeId );
+	RemoveCircuit( _nodeId );
+	memset( &m_nonceTables[_nodeId], 0, sizeof(NonceTable) );
+	m_setValueTracker->CancelNode( _nodeId );
+	if( m_valueHistory != NULL )
+	{
+		m_valueHistory->RemoveNode( _nodeId );
+	}
 
 	// Clear the send Queue
 	for( int32 i=0; i<MsgQueue_Count; ++i )
@@ -973,6 +1224,12 @@ void Driver::SendMsg
 	_msg->Finalize();
 	{
 		LockGuard LG(m_nodeMutex);
+		if( m_setValueCapture != 0 )
+		{
+			// This is the message that carries out a Manager::SetValueAsync request
+			_msg->SetSetValueRequest( m_setValueCapture );
+			m_setValueCapture = 0;
+		}
 		if( Node* node = GetNode(_msg->GetTargetNodeId()) )
 		{
 			/* if the node Supports the Security Class - check if this message is meant to be encapsulated */
@@ -986,6 +1243,17 @@ void Driver::SendMsg
 				}
 			}
 
+			if( m_multiCmdNodeId != 0 && node->GetNodeId() == m_multiCmdNodeId )
+			{
+				if( CollectMultiCmd( node, _msg, _queue ) )
+				{
+					return;
+				}
+
+				// Send what has been collected first, so that this message does not overtake it
+				FlushMultiCmd();
+			}
+
 			// If the message is for a sleeping node, we queue it in the node itself.
 			if( !node->IsListeningDevice() )
 			{
@@ -1004,7 +1272,7 @@ void Driver::SendMsg
 							item.m_msg = NULL;
 							UpdateControllerState( ControllerState_Sleeping );
 						}
-						else
+						else if( Log::IsLevelEnabled( LogLevel_Detail ) )
 						{
 							Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[MsgQueue_WakeUp], _msg->GetAsString().c_str() );
 						}
@@ -1015,13 +1283,211 @@ void Driver::SendMsg
 			}
 		}
 	}
-	Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[_queue], _msg->GetAsString().c_str() );
+	if( Log::IsLevelEnabled( LogLevel_Detail ) )
+	{
+		Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[_queue], _msg->GetAsString().c_str() );
+	}
 	m_sendMutex->Lock();
-	m_msgQueue[_queue].push_back( item );
-	m_queueEvent[_queue]->Set();
+	if( !DivertForDeadNode( _queue, item ) )
+	{
+		m_msgQueue[_queue].push_back( item );
+		m_queueEvent[_queue]->Set();
+	}
 	m_sendMutex->Unlock();
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::BeginMultiCmd>
+// Start collecting a node's requests, to be sent together
+//-----------------------------------------------------------------------------
+void Driver::BeginMultiCmd
+(
+		uint8 const _nodeId
+)
+{
+	m_nodeMutex->Lock();
+	if( m_multiCmdDepth++ > 0 || !m_multiCmdRequests )
+	{
+		// Nested requests are collected for the outermost caller's node
+		return;
+	}
+
+	if( Node* node = GetNode( _nodeId ) )
+	{
+		// A secured MultiCmd class would need the frame encrypted, so the requests are sent as they are
+		CommandClass* cc = node->GetCommandClass( MultiCmd::StaticGetCommandClassId() );
+		if( cc != NULL && !cc->IsAfterMark() && !cc->IsSecured() )
+		{
+			m_multiCmdNodeId = _nodeId;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::EndMultiCmd>
+// Send the requests collected since BeginMultiCmd
+//-----------------------------------------------------------------------------
+void Driver::EndMultiCmd
+(
+)
+{
+	if( --m_multiCmdDepth == 0 && m_multiCmdNodeId != 0 )
+	{
+		FlushMultiCmd();
+		m_multiCmdNodeId = 0;
+	}
+	m_nodeMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::FlushMultiCmd>
+// Send the requests collected so far
+//-----------------------------------------------------------------------------
+void Driver::FlushMultiCmd
+(
+)
+{
+	vector<Msg*> msgs;
+	msgs.swap( m_multiCmdMsgs );
+
+	// Stop collecting while the frames are queued, or SendMsg would collect them again
+	uint8 nodeId = m_multiCmdNodeId;
+	m_multiCmdNodeId = 0;
+
+	// Fill each frame with as many requests as fit, in the order they were made
+	uint32 first = 0;
+	uint32 size = 3;
+	for( uint32 i=0; i<msgs.size(); ++i )
+	{
+		uint32 length = msgs[i]->GetBuffer()[5] + 1;
+		if( i > first && size + length > c_maxMultiCmdPayload )
+		{
+			SendMultiCmd( msgs, first, i - first );
+			first = i;
+			size = 3;
+		}
+		size += length;
+	}
+	if( first < msgs.size() )
+	{
+		SendMultiCmd( msgs, first, (uint32)msgs.size() - first );
+	}
+
+	m_multiCmdNodeId = nodeId;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CollectMultiCmd>
+// Hold back a request to be sent in a MultiCmd frame
+//-----------------------------------------------------------------------------
+bool Driver::CollectMultiCmd
+(
+		Node* _node,
+		Msg* _msg,
+		MsgQueue const _queue
+)
+{
+	if( _node->GetNodeId() != m_multiCmdNodeId || _msg->isEncrypted() || _msg->GetSetValueRequest() != 0 )
+	{
+		return false;
+	}
+
+	// Requests for a single report and commands that are only acknowledged are combined,
+	// as the node handles each in turn.  Commands for an endpoint or instance keep their
+	// own MultiChannel encapsulation, but the MultiChannel requests themselves are not combined.
+	uint8* buffer = _msg->GetBuffer();
+	if( buffer[3] != FUNC_ID_ZW_SEND_DATA || buffer[5] + 4u > c_maxMultiCmdPayload )
+	{
+		return false;
+	}
+	if( buffer[6] == MultiInstance::StaticGetCommandClassId()
+			&& buffer[7] != MultiInstance::MultiChannelCmd_Encap && buffer[7] != MultiInstance::MultiInstanceCmd_Encap )
+	{
+		return false;
+	}
+	if( _msg->GetExpectedReply() == FUNC_ID_APPLICATION_COMMAND_HANDLER )
+	{
+		if( _msg->GetExpectedCommandClassId() != buffer[6] )
+		{
+			return false;
+		}
+	}
+	else if( _msg->GetExpectedReply() != FUNC_ID_ZW_SEND_DATA )
+	{
+		return false;
+	}
+
+	if( m_multiCmdMsgs.empty() )
+	{
+		m_multiCmdQueue = _queue;
+	}
+	else if( _queue != m_multiCmdQueue )
+	{
+		return false;
+	}
+
+	if( Log::IsLevelEnabled( LogLevel_Detail ) )
+	{
+		Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Collecting %s for a MultiCmd frame", _msg->GetAsString().c_str() );
+	}
+	m_multiCmdMsgs.push_back( _msg );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SendMultiCmd>
+// Queue a MultiCmd frame carrying some of the collected requests
+//-----------------------------------------------------------------------------
+void Driver::SendMultiCmd
+(
+		vector<Msg*> const& _msgs,
+		uint32 const _first,
+		uint32 const _count
+)
+{
+	if( _count == 1 )
+	{
+		SendMsg( _msgs[_first], m_multiCmdQueue );
+		return;
+	}
+
+	uint8 nodeId = _msgs[_first]->GetTargetNodeId();
+	uint32 size = 3;
+	bool reports = false;
+	for( uint32 i=_first; i<_first+_count; ++i )
+	{
+		size += _msgs[i]->GetBuffer()[5] + 1;
+		if( _msgs[i]->GetExpectedReply() == FUNC_ID_APPLICATION_COMMAND_HANDLER )
+		{
+			reports = true;
+		}
+	}
+
+	// Any report from the node completes the transaction, as it may answer with
+	// a MultiCmd frame of its own or with a report for each request.  A frame of
+	// commands that are not answered is done once the node acknowledges it.
+	Msg* msg = new Msg( "MultiCmd_Encap", nodeId, REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, reports ? FUNC_ID_APPLICATION_COMMAND_HANDLER : 0 );
+	msg->Append( nodeId );
+	msg->Append( (uint8)size );
+	msg->Append( MultiCmd::StaticGetCommandClassId() );
+	msg->Append( MultiCmd::MultiCmdCmd_Encap );
+	msg->Append( (uint8)_count );
+	for( uint32 i=_first; i<_first+_count; ++i )
+	{
+		uint8* buffer = _msgs[i]->GetBuffer();
+		msg->Append( buffer[5] );
+		for( uint8 j=0; j<buffer[5]; ++j )
+		{
+			msg->Append( buffer[6+j] );
+		}
+		delete _msgs[i];
+	}
+	msg->Append( GetTransmitOptions() );
+
+	Log::Write( LogLevel_Detail, nodeId, "Combining %d requests in a MultiCmd frame", _count );
+	SendMsg( msg, m_multiCmdQueue );
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::WriteNextMsg>
 // Transmit a queued message to the Z-Wave controller
@@ -1036,6 +1502,33 @@ bool Driver::WriteNextMsg
 	m_sendMutex->Lock();
 	MsgQueueItem item = m_msgQueue[_queue].front();
 
+	// Hold back anything for a node that has yet to send us a report, so that it is not
+	// sent ahead of the report or its retry.
+	uint8 heldNodeId = 0;
+	if( MsgQueueCmd_SendMsg == item.m_command )
+	{
+		heldNodeId = item.m_msg->GetTargetNodeId();
+	}
+	else if( MsgQueueCmd_QueryStageComplete == item.m_command )
+	{
+		heldNodeId = item.m_nodeId;
+	}
+	if( PendingReport* pending = FindPendingReport( heldNodeId ) )
+	{
+		HeldItem held;
+		held.m_queue = _queue;
+		held.m_item = item;
+		pending->m_held.push_back( held );
+		m_msgQueue[_queue].pop_front();
+		if( m_msgQueue[_queue].empty() )
+		{
+			m_queueEvent[_queue]->Reset();
+		}
+		m_sendMutex->Unlock();
+		Log::Write( LogLevel_Detail, heldNodeId, "Holding (%s) queue item until the pending report has been received", c_sendQueueNames[_queue] );
+		return false;
+	}
+
 	if( MsgQueueCmd_SendMsg == item.m_command )
 	{
 		// Send a message
@@ -1187,6 +1680,10 @@ bool Driver::WriteMsg
 
 		}
 
+		if( m_currentMsg->GetSetValueRequest() != 0 )
+		{
+			m_setValueTracker->OnTransmitted( m_currentMsg->GetSetValueRequest(), false );
+		}
 		RemoveCurrentMsg();
 		m_dropped++;
 		return false;
@@ -1214,6 +1711,7 @@ bool Driver::WriteMsg
 		m_expectedNodeId = m_currentMsg->GetTargetNodeId();
 		m_expectedReply = m_currentMsg->GetExpectedReply();
 		m_waitingForAck = true;
+		m_currentMsgTimeout = GetRetryTimeout( nodeId );
 	}
 	string attemptsstr = "";
 	if( attempts > 1 )
@@ -1232,18 +1730,24 @@ bool Driver::WriteMsg
 
 	if (m_nonceReportSent > 0) {
 		/* send a new NONCE report */
-		SendNonceKey(m_nonceReportSent, node->GenerateNonceKey());
+		SendNonceKey(m_nonceReportSent, GenerateNonceKey(m_nonceReportSent));
 	} else if (m_currentMsg->isEncrypted()) {
 		if (m_currentMsg->isNonceRecieved()) {
-			Log::Write( LogLevel_Info, nodeId, "Processing (%s) Encrypted message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+			if( Log::IsLevelEnabled( LogLevel_Info ) )
+			{
+				Log::Write( LogLevel_Info, nodeId, "Processing (%s) Encrypted message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+			}
 			SendEncryptedMessage();
 		} else {
 			Log::Write( LogLevel_Info, nodeId, "Processing (%s) Nonce Request message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x)", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply);
 			SendNonceRequest(m_currentMsg->GetLogText());
 		}
 	} else {
-		Log::Write( LogLevel_Info, nodeId, "Sending (%s) message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
-		uint32 bytesWritten = m_controller->Write(m_currentMsg->GetBuffer(), m_currentMsg->GetLength());
+		if( Log::IsLevelEnabled( LogLevel_Info ) )
+		{
+			Log::Write( LogLevel_Info, nodeId, "Sending (%s) message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+		}
+		uint32 bytesWritten = m_controller->Send(m_currentMsg->GetBuffer(), m_currentMsg->GetLength());
 
 		if (bytesWritten == 0)
 		{
@@ -1270,6 +1774,7 @@ bool Driver::WriteMsg
 		{
 			node->m_sentCnt++;
 			node->m_sentTS.SetTime();
+			m_networkGraph->RecordTraffic( nodeId );
 			if( m_expectedReply == FUNC_ID_APPLICATION_COMMAND_HANDLER )
 			{
 				CommandClass *cc = node->GetCommandClass(m_expectedCommandClassId);
@@ -1283,6 +1788,53 @@ bool Driver::WriteMsg
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::RetryTimerCallback>
+// The current message has waited too long for its transaction to complete
+//-----------------------------------------------------------------------------
+void Driver::RetryTimerCallback
+(
+		void* _context
+)
+{
+	Driver* driver = (Driver*)_context;
+
+	// The ACK has its own timeout, and if the transaction has completed in the
+	// meantime there is nothing to resend.
+	if( !driver->m_waitingForAck && ( driver->m_expectedCallbackId || driver->m_expectedReply ) )
+	{
+		driver->ResendCurrentMsg();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ResendCurrentMsg>
+// Resend the current message after its timeout, or drop it if it has run
+// out of attempts
+//-----------------------------------------------------------------------------
+void Driver::ResendCurrentMsg
+(
+)
+{
+	if( m_currentMsg != NULL )
+	{
+		Notification* notification = new Notification( Notification::Type_Notification );
+		notification->SetHomeAndNodeIds( m_homeId, m_currentMsg->GetTargetNodeId() );
+		notification->SetNotification( Notification::Code_Timeout );
+		QueueNotification( notification );
+
+		if( !m_waitingForAck )
+		{
+			// The node, rather than the controller, failed to answer in time
+			BackoffRetryTimeout( m_currentMsg->GetTargetNodeId() );
+		}
+	}
+	if( WriteMsg( "Wait Timeout" ) )
+	{
+		m_timers->Arm( &m_retryTimer, m_currentMsgTimeout, RetryTimerCallback, this );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::RemoveCurrentMsg>
 // Delete the current message
@@ -1308,36 +1860,694 @@ void Driver::RemoveCurrentMsg
 }
 
 //-----------------------------------------------------------------------------
-// <Driver::MoveMessagesToWakeUpQueue>
-// Move messages for a sleeping device to its wake-up queue
+// <Driver::GetRetryTimeout>
+// How long to wait for a node to complete a transaction
 //-----------------------------------------------------------------------------
-bool Driver::MoveMessagesToWakeUpQueue
+int32 Driver::GetRetryTimeout
 (
-		uint8 const _targetNodeId,
-		bool const _move
+		uint8 const _nodeId
 )
 {
-	// If the target node is one that goes to sleep, transfer
-	// all messages for it to its Wake-Up queue.
-	if( Node* node = GetNodeUnsafe(_targetNodeId) )
+	if( m_adaptiveRetryTimeout )
 	{
-		if( !node->IsListeningDevice() && !node->IsFrequentListeningDevice() && _targetNodeId != m_Controller_nodeId )
+		if( Node* node = GetNodeUnsafe( _nodeId ) )
 		{
-			if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
+			if( node->m_retryTimeout )
 			{
-				// Mark the node as asleep
-				wakeUp->SetAwake( false );
-
-				// If we need to save the messages
-				if( _move )
-				{
-					// Move all messages for this node to the wake-up queue
-					m_sendMutex->Lock();
+				return node->m_retryTimeout;
+			}
+		}
+	}
+	return m_retryTimeout;
+}
 
-					// See if we are working on a controller command
-					if( m_currentControllerCommand )
-					{
-						// Don't save controller message as it will be recreated
+//-----------------------------------------------------------------------------
+// <Driver::UpdateRetryTimeout>
+// Update a node's round trip time estimates, as TCP does (RFC 6298)
+//-----------------------------------------------------------------------------
+void Driver::UpdateRetryTimeout
+(
+		Node* _node,
+		int32 const _rtt
+)
+{
+	if( !m_adaptiveRetryTimeout || _rtt < 0 )
+	{
+		return;
+	}
+
+	if( _node->m_smoothedRTT == 0 )
+	{
+		// First measurement
+		_node->m_smoothedRTT = _rtt;
+		_node->m_rttVariance = _rtt / 2;
+	}
+	else
+	{
+		int32 delta = _node->m_smoothedRTT - _rtt;
+		if( delta < 0 )
+		{
+			delta = -delta;
+		}
+		_node->m_rttVariance = ( 3 * _node->m_rttVariance + delta ) / 4;
+		_node->m_smoothedRTT = ( 7 * _node->m_smoothedRTT + _rtt ) / 8;
+	}
+
+	// A round trip has completed, so any backoff is over
+	_node->m_retryBackoff = 0;
+	CalculateRetryTimeout( _node );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::BackoffRetryTimeout>
+// Double a node's retry timeout after it has failed to respond
+//-----------------------------------------------------------------------------
+void Driver::BackoffRetryTimeout
+(
+		uint8 const _nodeId
+)
+{
+	if( !m_adaptiveRetryTimeout )
+	{
+		return;
+	}
+
+	if( Node* node = GetNodeUnsafe( _nodeId ) )
+	{
+		// Further doubling could not get past any sensible cap
+		if( node->m_retryBackoff < 8 )
+		{
+			++node->m_retryBackoff;
+		}
+		CalculateRetryTimeout( node );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CalculateRetryTimeout>
+// Work out a node's retry timeout from its round trip times and backoff
+//-----------------------------------------------------------------------------
+void Driver::CalculateRetryTimeout
+(
+		Node* _node
+)
+{
+	int32 timeout = m_retryTimeout;
+	if( _node->m_smoothedRTT )
+	{
+		timeout = _node->m_smoothedRTT + 4 * _node->m_rttVariance;
+		if( timeout < m_retryTimeoutMin )
+		{
+			timeout = m_retryTimeoutMin;
+		}
+	}
+
+	for( uint8 i=0; i<_node->m_retryBackoff && timeout < m_retryTimeoutMax; ++i )
+	{
+		timeout *= 2;
+	}
+	if( timeout > m_retryTimeoutMax )
+	{
+		timeout = m_retryTimeoutMax;
+	}
+
+	if( timeout != _node->m_retryTimeout )
+	{
+		Log::Write( LogLevel_Detail, _node->GetNodeId(), "Retry timeout %dms (SRTT %d, RTTVAR %d, backoff %d)", timeout, _node->m_smoothedRTT, _node->m_rttVariance, _node->m_retryBackoff );
+		_node->m_retryTimeout = timeout;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ParkCurrentMsg>
+// Wait for the report to the current message without holding up the
+// requests for other nodes
+//-----------------------------------------------------------------------------
+bool Driver::ParkCurrentMsg
+(
+)
+{
+	if( m_maxPendingReports <= 0 || m_currentMsg == NULL || m_currentControllerCommand != NULL )
+	{
+		return false;
+	}
+
+	// The nonce exchange of an encrypted message is tied to the current message
+	if( m_currentMsg->isEncrypted() || m_nonceReportSent > 0 )
+	{
+		return false;
+	}
+
+	uint8 nodeId = m_currentMsg->GetTargetNodeId();
+	if( nodeId == 0xff || nodeId == m_Controller_nodeId || m_expectedNodeId != nodeId || m_expectedCommandClassId == 0 )
+	{
+		return false;
+	}
+
+	m_sendMutex->Lock();
+	if( m_pendingReports.size() >= (size_t)m_maxPendingReports )
+	{
+		m_sendMutex->Unlock();
+		return false;
+	}
+
+	PendingReport* pending = new PendingReport();
+	pending->m_msg = m_currentMsg;
+	pending->m_queue = m_currentMsgQueueSource;
+	pending->m_nodeId = nodeId;
+	pending->m_commandClassId = m_expectedCommandClassId;
+	pending->m_instance = 0;
+	if( m_expectedCommandClassId == MultiInstance::StaticGetCommandClassId() )
+	{
+		// Encapsulated reports carry the endpoint or instance in the same byte
+		pending->m_instance = m_currentMsg->GetEndPoint() ? m_currentMsg->GetEndPoint() : m_currentMsg->GetExpectedInstance();
+	}
+	m_pendingReports.push_back( pending );
+	m_timers->Arm( &pending->m_timer, GetRetryTimeout( nodeId ), PendingReportTimerCallback, this );
+	Log::Write( LogLevel_Detail, nodeId, "  Waiting for report of command class 0x%.2x, releasing transmit slot (%d pending)", pending->m_commandClassId, m_pendingReports.size() );
+	m_sendMutex->Unlock();
+
+	m_currentMsg = NULL;
+	m_expectedCallbackId = 0;
+	m_expectedCommandClassId = 0;
+	m_expectedNodeId = 0;
+	m_expectedReply = 0;
+	m_waitingForAck = false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::FindPendingReport>
+// Find the outstanding report transaction for a node.  The caller must hold
+// m_sendMutex for as long as it uses the transaction.
+//-----------------------------------------------------------------------------
+Driver::PendingReport* Driver::FindPendingReport
+(
+		uint8 const _nodeId
+)
+{
+	for( list<PendingReport*>::iterator it = m_pendingReports.begin(); it != m_pendingReports.end(); ++it )
+	{
+		if( (*it)->m_nodeId == _nodeId )
+		{
+			return *it;
+		}
+	}
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetPendingReport>
+// Whether a node has an outstanding report transaction, and copies of its
+// details, as the transaction may be deleted once m_sendMutex is released
+//-----------------------------------------------------------------------------
+bool Driver::GetPendingReport
+(
+		uint8 const _nodeId,
+		uint8* o_commandClassId,
+		uint8* o_sendAttempts
+)
+{
+	LockGuard LG(m_sendMutex);
+	PendingReport* pending = FindPendingReport( _nodeId );
+	if( pending == NULL )
+	{
+		return false;
+	}
+
+	if( o_commandClassId )
+	{
+		*o_commandClassId = pending->m_commandClassId;
+	}
+	if( o_sendAttempts )
+	{
+		*o_sendAttempts = pending->m_msg->GetSendAttempts();
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CompletePendingReport>
+// Complete the outstanding report transaction answered by a received message
+//-----------------------------------------------------------------------------
+void Driver::CompletePendingReport
+(
+		uint8 const* _data
+)
+{
+	uint8 nodeId = _data[3];
+	bool completed = false;
+
+	m_sendMutex->Lock();
+	for( list<PendingReport*>::iterator it = m_pendingReports.begin(); it != m_pendingReports.end(); ++it )
+	{
+		PendingReport* pending = *it;
+		if( pending->m_nodeId != nodeId || pending->m_commandClassId != _data[5] )
+		{
+			continue;
+		}
+		if( pending->m_instance && ( _data[4] < 3 || pending->m_instance != _data[7] ) )
+		{
+			continue;
+		}
+
+		Log::Write( LogLevel_Detail, nodeId, "  Expected pending reply and command class was received" );
+		m_pendingReports.erase( it );
+		ReleasePendingReport( pending, false );
+		completed = true;
+		break;
+	}
+	m_sendMutex->Unlock();
+
+	if( completed )
+	{
+		Log::Write( LogLevel_Detail, nodeId, "  Message transaction complete" );
+		if( m_notifytransactions )
+		{
+			Notification* notification = new Notification( Notification::Type_Notification );
+			notification->SetHomeAndNodeIds( m_homeId, nodeId );
+			notification->SetNotification( Notification::Code_MsgComplete );
+			QueueNotification( notification );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::PendingReportTimerCallback>
+// A node has not sent the report we asked for
+//-----------------------------------------------------------------------------
+void Driver::PendingReportTimerCallback
+(
+		void* _context
+)
+{
+	((Driver*)_context)->ExpirePendingReports();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ExpirePendingReports>
+// Put the requests whose reports have timed out back on their queues
+//-----------------------------------------------------------------------------
+void Driver::ExpirePendingReports
+(
+)
+{
+	m_sendMutex->Lock();
+	list<PendingReport*>::iterator it = m_pendingReports.begin();
+	while( it != m_pendingReports.end() )
+	{
+		PendingReport* pending = *it;
+		if( pending->m_timer.IsArmed() )
+		{
+			++it;
+			continue;
+		}
+
+		Log::Write( LogLevel_Warning, pending->m_nodeId, "WARNING: Timeout waiting for report of command class 0x%.2x - %s", pending->m_commandClassId, pending->m_msg->GetAsString().c_str() );
+		Notification* notification = new Notification( Notification::Type_Notification );
+		notification->SetHomeAndNodeIds( m_homeId, pending->m_nodeId );
+		notification->SetNotification( Notification::Code_Timeout );
+		QueueNotification( notification );
+		BackoffRetryTimeout( pending->m_nodeId );
+
+		// WriteMsg drops the message if it has run out of attempts
+		it = m_pendingReports.erase( it );
+		ReleasePendingReport( pending, true );
+	}
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ReleasePendingReport>
+// Return the items held for a node to their queues, and delete the
+// transaction.  The caller must hold m_sendMutex.
+//-----------------------------------------------------------------------------
+void Driver::ReleasePendingReport
+(
+		PendingReport* _pending,
+		bool const _retry
+)
+{
+	m_timers->Cancel( &_pending->m_timer );
+
+	// Working backwards keeps the items in their original order
+	for( list<HeldItem>::reverse_iterator rit = _pending->m_held.rbegin(); rit != _pending->m_held.rend(); ++rit )
+	{
+		m_msgQueue[rit->m_queue].push_front( rit->m_item );
+		m_queueEvent[rit->m_queue]->Set();
+	}
+
+	if( _retry )
+	{
+		MsgQueueItem item;
+		item.m_command = MsgQueueCmd_SendMsg;
+		item.m_nodeId = _pending->m_nodeId;
+		item.m_msg = _pending->m_msg;
+		m_msgQueue[_pending->m_queue].push_front( item );
+		m_queueEvent[_pending->m_queue]->Set();
+	}
+	else
+	{
+		delete _pending->m_msg;
+	}
+	delete _pending;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::RemovePendingReport>
+// Delete the outstanding report transaction for a node
+//-----------------------------------------------------------------------------
+void Driver::RemovePendingReport
+(
+		uint8 const _nodeId
+)
+{
+	// Nodes are deleted by the destructor after m_sendMutex has been released
+	if( m_pendingReports.empty() )
+	{
+		return;
+	}
+
+	m_sendMutex->Lock();
+	for( list<PendingReport*>::iterator it = m_pendingReports.begin(); it != m_pendingReports.end(); ++it )
+	{
+		if( (*it)->m_nodeId == _nodeId )
+		{
+			// The held items go back on the queues, for the caller to clear
+			PendingReport* pending = *it;
+			m_pendingReports.erase( it );
+			ReleasePendingReport( pending, false );
+			break;
+		}
+	}
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OpenCircuit>
+// Hold or fail the messages for a node that is presumed dead, and start probing it
+//-----------------------------------------------------------------------------
+void Driver::OpenCircuit
+(
+		uint8 const _nodeId
+)
+{
+	m_sendMutex->Lock();
+	Circuit* circuit = m_circuits[_nodeId];
+	if( circuit == NULL )
+	{
+		circuit = new Circuit();
+		circuit->m_driver = this;
+		circuit->m_nodeId = _nodeId;
+		circuit->m_state = CircuitState_Closed;
+		m_circuits[_nodeId] = circuit;
+	}
+	if( circuit->m_state != CircuitState_Closed )
+	{
+		m_sendMutex->Unlock();
+		return;
+	}
+	circuit->m_state = CircuitState_Open;
+	circuit->m_probeInterval = m_deadNodeProbeInterval;
+	circuit->m_dropNotified = false;
+
+	// Give up on the current message now, rather than after its remaining attempts
+	uint32 dropped = m_deadNodeDropped;
+	if( m_currentMsg != NULL && m_currentMsg->GetTargetNodeId() == _nodeId && m_currentControllerCommand == NULL && m_nonceReportSent == 0 )
+	{
+		MsgQueueItem item;
+		item.m_command = MsgQueueCmd_SendMsg;
+		item.m_msg = m_currentMsg;
+		if( DivertForDeadNode( m_currentMsgQueueSource, item ) )
+		{
+			m_timers->Cancel( &m_retryTimer );
+			m_currentMsg = NULL;
+			m_expectedCallbackId = 0;
+			m_expectedCommandClassId = 0;
+			m_expectedNodeId = 0;
+			m_expectedReply = 0;
+			m_waitingForAck = false;
+		}
+	}
+
+	// Then the messages waiting on the queues
+	for( int32 i=0; i<MsgQueue_Count; ++i )
+	{
+		list<MsgQueueItem>::iterator it = m_msgQueue[i].begin();
+		while( it != m_msgQueue[i].end() )
+		{
+			if( MsgQueueCmd_SendMsg == it->m_command && _nodeId == it->m_msg->GetTargetNodeId() && DivertForDeadNode( (MsgQueue)i, *it ) )
+			{
+				it = m_msgQueue[i].erase( it );
+			}
+			else
+			{
+				++it;
+			}
+		}
+		if( m_msgQueue[i].empty() )
+		{
+			m_queueEvent[i]->Reset();
+		}
+	}
+
+	Log::Write( LogLevel_Warning, _nodeId, "Node presumed dead - holding %d requests and failed %d other messages until it responds", circuit->m_held.size(), m_deadNodeDropped - dropped );
+	if( circuit->m_probeInterval > 0 )
+	{
+		m_timers->Arm( &circuit->m_probeTimer, circuit->m_probeInterval, ProbeTimerCallback, circuit );
+	}
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CloseCircuit>
+// A node has answered, so send the messages held for it
+//-----------------------------------------------------------------------------
+void Driver::CloseCircuit
+(
+		uint8 const _nodeId
+)
+{
+	list<HeldItem> held;
+
+	m_sendMutex->Lock();
+	Circuit* circuit = m_circuits[_nodeId];
+	if( circuit == NULL || circuit->m_state == CircuitState_Closed )
+	{
+		m_sendMutex->Unlock();
+		return;
+	}
+	m_timers->Cancel( &circuit->m_probeTimer );
+	circuit->m_state = CircuitState_Closed;
+	held.swap( circuit->m_held );
+	m_sendMutex->Unlock();
+
+	Log::Write( LogLevel_Info, _nodeId, "Node responded - sending the %d requests held for it", held.size() );
+	for( list<HeldItem>::iterator it = held.begin(); it != held.end(); ++it )
+	{
+		SendMsg( it->m_item.m_msg, it->m_queue );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ProbeFailed>
+// A dead node did not answer its probe
+//-----------------------------------------------------------------------------
+void Driver::ProbeFailed
+(
+		uint8 const _nodeId
+)
+{
+	m_sendMutex->Lock();
+	Circuit* circuit = m_circuits[_nodeId];
+	if( circuit != NULL && circuit->m_state == CircuitState_HalfOpen )
+	{
+		Log::Write( LogLevel_Detail, _nodeId, "Node still not responding - next probe in %dms", circuit->m_probeInterval );
+		circuit->m_state = CircuitState_Open;
+	}
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::DivertForDeadNode>
+// Take a send or poll queue message for a node that is presumed dead off its
+// queue.  A request for a report, or a poll, is held until the node answers,
+// replacing any earlier copy.  Anything else fails without being sent.
+// Returns true if the message was held or failed.
+//-----------------------------------------------------------------------------
+bool Driver::DivertForDeadNode
+(
+		MsgQueue const _queue,
+		MsgQueueItem const& _item
+)
+{
+	if( MsgQueueCmd_SendMsg != _item.m_command || ( _queue != MsgQueue_Send && _queue != MsgQueue_Poll ) || _item.m_msg->IsNoOperation() )
+	{
+		return false;
+	}
+
+	Circuit* circuit = m_circuits[_item.m_msg->GetTargetNodeId()];
+	if( circuit == NULL || circuit->m_state == CircuitState_Closed )
+	{
+		return false;
+	}
+
+	if( _item.m_msg->GetSetValueRequest() == 0
+		&& ( _queue == MsgQueue_Poll || _item.m_msg->GetExpectedReply() == FUNC_ID_APPLICATION_COMMAND_HANDLER ) )
+	{
+		// Only the latest copy of a request is kept, as for sleeping nodes
+		list<HeldItem>::iterator it = circuit->m_held.begin();
+		while( it != circuit->m_held.end() )
+		{
+			if( it->m_item == _item )
+			{
+				delete it->m_item.m_msg;
+				it = circuit->m_held.erase( it );
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		if( Log::IsLevelEnabled( LogLevel_Detail ) )
+		{
+			Log::Write( LogLevel_Detail, circuit->m_nodeId, "Holding (%s) %s until the node responds", c_sendQueueNames[_queue], _item.m_msg->GetAsString().c_str() );
+		}
+		_item.m_msg->SetSendAttempts( 0 );
+
+		HeldItem held;
+		held.m_queue = _queue;
+		held.m_item = _item;
+		circuit->m_held.push_back( held );
+		++m_deadNodeHeld;
+		return true;
+	}
+
+	if( Log::IsLevelEnabled( LogLevel_Detail ) )
+	{
+		Log::Write( LogLevel_Detail, circuit->m_nodeId, "Failing (%s) %s because the node is presumed dead", c_sendQueueNames[_queue], _item.m_msg->GetAsString().c_str() );
+	}
+	if( _item.m_msg->GetSetValueRequest() != 0 )
+	{
+		m_setValueTracker->OnTransmitted( _item.m_msg->GetSetValueRequest(), false );
+	}
+	delete _item.m_msg;
+	++m_deadNodeDropped;
+	++m_dropped;
+
+	// The application hears once per outage, not once per message
+	if( !circuit->m_dropNotified )
+	{
+		circuit->m_dropNotified = true;
+		Notification* notification = new Notification( Notification::Type_Notification );
+		notification->SetHomeAndNodeIds( m_homeId, circuit->m_nodeId );
+		notification->SetNotification( Notification::Code_Dropped );
+		QueueNotification( notification );
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::RemoveCircuit>
+// Delete a node's circuit and the messages held on it
+//-----------------------------------------------------------------------------
+void Driver::RemoveCircuit
+(
+		uint8 const _nodeId
+)
+{
+	// The destructor removes the circuits after m_sendMutex has been released,
+	// so that the nodes find none left when they are deleted.
+	Circuit* circuit = m_circuits[_nodeId];
+	if( circuit == NULL )
+	{
+		return;
+	}
+
+	m_timers->Cancel( &circuit->m_probeTimer );
+	for( list<HeldItem>::iterator it = circuit->m_held.begin(); it != circuit->m_held.end(); ++it )
+	{
+		delete it->m_item.m_msg;
+	}
+	m_circuits[_nodeId] = NULL;
+	delete circuit;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ProbeTimerCallback>
+// Time to check whether a dead node has come back
+//-----------------------------------------------------------------------------
+void Driver::ProbeTimerCallback
+(
+		void* _context
+)
+{
+	Circuit* circuit = (Circuit*)_context;
+	circuit->m_driver->ProbeDeadNode( circuit );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ProbeDeadNode>
+// Send a NoOperation frame to a node that is presumed dead
+//-----------------------------------------------------------------------------
+void Driver::ProbeDeadNode
+(
+		Circuit* _circuit
+)
+{
+	LockGuard LG(m_nodeMutex);
+	Node* node = GetNode( _circuit->m_nodeId );
+	if( node == NULL || node->IsNodeAlive() )
+	{
+		return;
+	}
+
+	m_sendMutex->Lock();
+	_circuit->m_state = CircuitState_HalfOpen;
+	_circuit->m_probeInterval = ( _circuit->m_probeInterval > m_deadNodeProbeIntervalMax / 2 ) ? m_deadNodeProbeIntervalMax : _circuit->m_probeInterval * 2;
+	m_timers->Arm( &_circuit->m_probeTimer, _circuit->m_probeInterval, ProbeTimerCallback, _circuit );
+	++m_deadNodeProbes;
+	m_sendMutex->Unlock();
+
+	if( NoOperation* noop = static_cast<NoOperation*>( node->GetCommandClass( NoOperation::StaticGetCommandClassId() ) ) )
+	{
+		Log::Write( LogLevel_Info, _circuit->m_nodeId, "Probing node presumed dead" );
+		noop->Set( true );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::MoveMessagesToWakeUpQueue>
+// Move messages for a sleeping device to its wake-up queue
+//-----------------------------------------------------------------------------
+bool Driver::MoveMessagesToWakeUpQueue
+(
+		uint8 const _targetNodeId,
+		bool const _move
+)
+{
+	// If the target node is one that goes to sleep, transfer
+	// all messages for it to its Wake-Up queue.
+	if( Node* node = GetNodeUnsafe(_targetNodeId) )
+	{
+		if( !node->IsListeningDevice() && !node->IsFrequentListeningDevice() && _targetNodeId != m_Controller_nodeId )
+		{
+			if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
+			{
+				// Mark the node as asleep
+				wakeUp->SetAwake( false );
+
+				// If we need to save the messages
+				if( _move )
+				{
+					// Move all messages for this node to the wake-up queue
+					m_sendMutex->Lock();
+
+					// See if we are working on a controller command
+					if( m_currentControllerCommand )
+					{
+						// Don't save controller message as it will be recreated
 						RemoveCurrentMsg();
 					}
 
@@ -1484,11 +2694,13 @@ bool Driver::HandleErrorResponse
 	{
 		m_badroutes++;
 		Log::Write( LogLevel_Info, _nodeId, "ERROR: %s failed. No route available.", _funcStr );
+		BackoffRetryTimeout( _nodeId );
 	}
 	else if( _error == TRANSMIT_COMPLETE_NO_ACK )
 	{
 		m_noack++;
 		Log::Write( LogLevel_Info, _nodeId, "WARNING: %s failed. No ACK received - device may be asleep.",  _funcStr );
+		BackoffRetryTimeout( _nodeId );
 		if( m_currentMsg )
 		{
 			// In case the failure is due to the target being a sleeping node, we
@@ -1512,7 +2724,11 @@ bool Driver::HandleErrorResponse
 	}
 	if( Node* node = GetNodeUnsafe( _nodeId ) )
 	{
-		if( ++node->m_errors >= 3 )
+		if( !node->IsNodeAlive() )
+		{
+			ProbeFailed( _nodeId );
+		}
+		else if( ++node->m_errors >= 3 )
 		{
 			node->SetNodeAlive( false );
 		}
@@ -1668,7 +2884,7 @@ bool Driver::ReadMsg
 
 			// Read the length byte.  Keep trying until we get it.
 			m_controller->SetSignalThreshold( 1 );
-			int32 response = Wait::Single( m_controller, 50 );
+			int32 response = m_controller->WaitForData( 50 );
 			if( response < 0 )
 			{
 				Log::Write( LogLevel_Warning, "WARNING: 50ms passed without finding the length byte...aborting frame read");
@@ -1678,7 +2894,7 @@ bool Driver::ReadMsg
 
 			m_controller->Read( &buffer[1], 1 );
 			m_controller->SetSignalThreshold( buffer[1] );
-			if( Wait::Single( m_controller, 500 ) < 0 )
+			if( m_controller->WaitForData( 500 ) < 0 )
 			{
 				Log::Write( LogLevel_Warning, "WARNING: 500ms passed without reading the rest of the frame...aborting frame read" );
 				m_readAborts++;
@@ -1722,18 +2938,18 @@ bool Driver::ReadMsg
 			{
 				// Checksum correct - send ACK
 				uint8 ack = ACK;
-				m_controller->Write( &ack, 1 );
+				m_controller->Send( &ack, 1 );
 				m_readCnt++;
 
 				// Process the received message
-				ProcessMsg( &buffer[2] );
+				ProcessMsg( &buffer[2], buffer[1] - 1 );
 			}
 			else
 			{
 				Log::Write( LogLevel_Warning, nodeId, "WARNING: Checksum incorrect - sending NAK" );
 				m_badChecksum++;
 				uint8 nak = NAK;
-				m_controller->Write( &nak, 1 );
+				m_controller->Send( &nak, 1 );
 				m_controller->Purge();
 			}
 			break;
@@ -1794,7 +3010,7 @@ bool Driver::ReadMsg
 			Log::Write( LogLevel_Warning, "WARNING: Out of frame flow! (0x%.2x).  Sending NAK.", buffer[0] );
 			m_OOFCnt++;
 			uint8 nak = NAK;
-			m_controller->Write( &nak, 1 );
+			m_controller->Send( &nak, 1 );
 			m_controller->Purge();
 			break;
 		}
@@ -1809,10 +3025,10 @@ bool Driver::ReadMsg
 //-----------------------------------------------------------------------------
 void Driver::ProcessMsg
 (
-		uint8* _data
+		uint8* _data,
+		uint8 const _length
 )
 {
-	bool handleCallback = true;
 	bool wasencrypted = false;
 	//uint8 nodeId = GetNodeNumber( m_currentMsg );
 
@@ -1836,20 +3052,11 @@ void Driver::ProcessMsg
 			/* if this is a NONCE Get - Then call to the CC directly, process it, and then bail out. */
 		} else if (SecurityCmd_NonceGet == _data[6]) {
 			Log::Write(LogLevel_Info,  _data[3], "Received SecurityCmd_NonceGet from node %d", _data[3] );
-			{
-				uint8 *nonce = NULL;
-				LockGuard LG(m_nodeMutex);
-				Node* node = GetNode( _data[3] );
-				if( node ) {
-					nonce = node->GenerateNonceKey();
-				} else {
-					Log::Write(LogLevel_Warning, _data[3], "Couldn't Generate Nonce Key for Node %d", _data[3]);
-					return;
-				}
-
-				SendNonceKey(_data[3], nonce);
-
+			if( GetNodeUnsafe( _data[3] ) == NULL ) {
+				Log::Write(LogLevel_Warning, _data[3], "Couldn't Generate Nonce Key for Node %d", _data[3]);
+				return;
 			}
+			SendNonceKey(_data[3], GenerateNonceKey(_data[3]));
 			/* don't continue processing */
 			return;
 
@@ -1857,455 +3064,192 @@ void Driver::ProcessMsg
 		} else if ((SecurityCmd_MessageEncap == _data[6]) || (SecurityCmd_MessageEncapNonceGet == _data[6])) {
 			uint8 _newdata[256];
 			uint8 SecurityCmd = _data[6];
-			uint8 *_nonce;
+			uint8 _nonce[8];
 
 			/* clear out NONCE Report tracking */
 			m_nonceReportSent = 0;
 			m_nonceReportSentAttempt = 0;
 
-			/* make sure the Node Exists, and it has the Security CC */
-			{
-				LockGuard LG(m_nodeMutex);
-				Node* node = GetNode( _data[3] );
-				if( node ) {
-					_nonce = node->GetNonceKey(_data[_data[4]-4]);
-					if (!_nonce) {
-						Log::Write(LogLevel_Warning, _data[3], "Could Not Retrieve Nonce for Node %d", _data[3]);
-						return;
-					}
-				} else {
-					Log::Write(LogLevel_Warning, _data[3], "Can't Find Node %d for Encrypted Message", _data[3]);
-					return;
-				}
-			}
-			if (DecryptBuffer(&_data[5], _data[4]+1, this, _data[3], this->GetControllerNodeId(), _nonce, &_newdata[0])) {
-				/* Ok - _newdata now contains the decrypted packet */
-				/* copy it back to the _data packet for processing */
-				/* New Length - See Decrypt Packet for why these numbers*/
-				_data[4] = _data[4] - 8 - 8 - 2 - 2;
-
-				/* now copy the decrypted packet */
-				memcpy(&_data[5], &_newdata[1], _data[4]);
-				//PrintHex("Decrypted Packet", _data, _data[4]+5);
-
-				/* if the Node has something else to send, it will encrypt a message and send it as a MessageEncapNonceGet */
-				if (SecurityCmd_MessageEncapNonceGet == SecurityCmd )
-				{
-				    Log::Write(LogLevel_Info,  _data[3], "Received SecurityCmd_MessageEncapNonceGet from node %d - Sending New Nonce", _data[3] );
-				    LockGuard LG(m_nodeMutex);
-				    Node* node = GetNode( _data[3] );
-				    if( node ) {
-				        _nonce = node->GenerateNonceKey();
-				    } else {
-				        Log::Write(LogLevel_Warning, _data[3], "Couldn't Generate Nonce Key for Node %d", _data[3]);
-				        return;
-				    }
-				    SendNonceKey(_data[3], _nonce);
-				}
-
-				wasencrypted = true;
-
-			} else {
-			    /* if the Node has something else to send, it will encrypt a message and send it as a MessageEncapNonceGet */
-			    if (SecurityCmd_MessageEncapNonceGet == SecurityCmd )
-			    {
-			        Log::Write(LogLevel_Info,  _data[3], "Received SecurityCmd_MessageEncapNonceGet from node %d - Sending New Nonce", _data[3] );
-			        LockGuard LG(m_nodeMutex);
-			        Node* node = GetNode( _data[3] );
-			        if( node ) {
-			            _nonce = node->GenerateNonceKey();
-			        } else {
-			            Log::Write(LogLevel_Warning, _data[3], "Couldn't Generate Nonce Key for Node %d", _data[3]);
-			            return;
-			        }
-			        SendNonceKey(_data[3], _nonce);
-			    }
-				/* it failed for some reason, lets just move on */
-				m_expectedReply = 0;
-				m_expectedNodeId = 0;
-				RemoveCurrentMsg();
-				return;
-			}
-		}
-	}
-
-
-	if( RESPONSE == _data[0] )
-	{
-		switch( _data[1] )
-		{
-			case FUNC_ID_SERIAL_API_GET_INIT_DATA:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSerialAPIGetInitDataResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetControllerCapabilitiesResponse( _data );
-				break;
-			}
-			case FUNC_ID_SERIAL_API_GET_CAPABILITIES:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetSerialAPICapabilitiesResponse( _data );
-				break;
-			}
-			case FUNC_ID_SERIAL_API_SOFT_RESET:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSerialAPISoftResetResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_SEND_DATA:
-			{
-				HandleSendDataResponse( _data, false );
-				handleCallback = false;			// Skip the callback handling - a subsequent FUNC_ID_ZW_SEND_DATA request will deal with that
-				break;
-			}
-			case FUNC_ID_ZW_GET_VERSION:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetVersionResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_GET_RANDOM:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetRandomResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_MEMORY_GET_ID:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleMemoryGetIdResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetNodeProtocolInfoResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REPLICATION_SEND_DATA:
-			{
-				HandleSendDataResponse( _data, true );
-				handleCallback = false;			// Skip the callback handling - a subsequent FUNC_ID_ZW_REPLICATION_SEND_DATA request will deal with that
-				break;
-			}
-			case FUNC_ID_ZW_ASSIGN_RETURN_ROUTE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleAssignReturnRouteResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];		// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			case FUNC_ID_ZW_DELETE_RETURN_ROUTE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleDeleteReturnRouteResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];		// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			case FUNC_ID_ZW_ENABLE_SUC:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleEnableSUCResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REQUEST_NETWORK_UPDATE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleNetworkUpdateResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];	// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			case FUNC_ID_ZW_SET_SUC_NODE_ID:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSetSUCNodeIdResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_GET_SUC_NODE_ID:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetSUCNodeIdResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REQUEST_NODE_INFO:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( _data[2] )
-				{
-					Log::Write( LogLevel_Info, _data[3], "FUNC_ID_ZW_REQUEST_NODE_INFO Request successful." );
-				}
-				else
-				{
-					Log::Write( LogLevel_Info, _data[3], "FUNC_ID_ZW_REQUEST_NODE_INFO Request failed." );
-				}
-				break;
-			}
-			case FUNC_ID_ZW_REMOVE_FAILED_NODE_ID:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleRemoveFailedNodeResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];	// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			case FUNC_ID_ZW_IS_FAILED_NODE_ID:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleIsFailedNodeResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REPLACE_FAILED_NODE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleReplaceFailedNodeResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];	// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			case FUNC_ID_ZW_GET_ROUTING_INFO:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetRoutingInfoResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_R_F_POWER_LEVEL_SET:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleRfPowerLevelSetResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_READ_MEMORY:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleReadMemoryResponse( _data );
-				break;
-			}
-			case FUNC_ID_SERIAL_API_SET_TIMEOUTS:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSerialApiSetTimeoutsResponse( _data );
-				break;
-			}
-			case FUNC_ID_MEMORY_GET_BYTE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleMemoryGetByteResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_GET_VIRTUAL_NODES:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleGetVirtualNodesResponse( _data );
-				break;
-			}
-			case FUNC_ID_ZW_SET_SLAVE_LEARN_MODE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleSetSlaveLearnModeResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];	// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			case FUNC_ID_ZW_SEND_SLAVE_NODE_INFO:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				if( !HandleSendSlaveNodeInfoResponse( _data ) )
-				{
-					m_expectedCallbackId = _data[2];	// The callback message won't be coming, so we force the transaction to complete
-					m_expectedReply = 0;
-					m_expectedCommandClassId = 0;
-					m_expectedNodeId = 0;
-				}
-				break;
-			}
-			default:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				Log::Write( LogLevel_Info, "**TODO: handle response for 0x%.2x** Please report this message.", _data[1] );
-				break;
-			}
-		}
-	}
-	else if( REQUEST == _data[0] )
-	{
-		switch( _data[1] )
-		{
-			case FUNC_ID_APPLICATION_COMMAND_HANDLER:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleApplicationCommandHandlerRequest( _data, wasencrypted );
-				break;
-			}
-			case FUNC_ID_ZW_SEND_DATA:
-			{
-				HandleSendDataRequest( _data, false );
-				break;
-			}
-			case FUNC_ID_ZW_REPLICATION_COMMAND_COMPLETE:
-			{
-				if( m_controllerReplication )
-				{
-					Log::Write( LogLevel_Detail, "" );
-					m_controllerReplication->SendNextData();
-				}
-				break;
-			}
-			case FUNC_ID_ZW_REPLICATION_SEND_DATA:
-			{
-				HandleSendDataRequest( _data, true );
-				break;
-			}
-			case FUNC_ID_ZW_ASSIGN_RETURN_ROUTE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleAssignReturnRouteRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_DELETE_RETURN_ROUTE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleDeleteReturnRouteRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_SEND_NODE_INFORMATION:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSendNodeInformationRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE:
-			case FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE_OPTIONS:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleNodeNeighborUpdateRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_APPLICATION_UPDATE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				handleCallback = !HandleApplicationUpdateRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_ADD_NODE_TO_NETWORK:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleAddNodeToNetworkRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REMOVE_NODE_FROM_NETWORK:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleRemoveNodeFromNetworkRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_CREATE_NEW_PRIMARY:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleCreateNewPrimaryRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_CONTROLLER_CHANGE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleControllerChangeRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_SET_LEARN_MODE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSetLearnModeRequest( _data );
-				break;
-			}
-			case FUNC_ID_ZW_REQUEST_NETWORK_UPDATE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleNetworkUpdateRequest( _data );
-				break;
+			/* make sure the Node Exists.  The nonce tables are only used on this thread, so
+			 * neither this nor the nonce lookup needs the node mutex */
+			if( GetNodeUnsafe( _data[3] ) == NULL ) {
+				Log::Write(LogLevel_Warning, _data[3], "Can't Find Node %d for Encrypted Message", _data[3]);
+				return;
 			}
-			case FUNC_ID_ZW_REMOVE_FAILED_NODE_ID:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleRemoveFailedNodeRequest( _data );
-				break;
+			uint8 *nonce = GetNonceKey(_data[3], _data[_data[4]-4]);
+			if (!nonce) {
+				Log::Write(LogLevel_Warning, _data[3], "Could Not Retrieve Nonce for Node %d", _data[3]);
+				return;
 			}
-			case FUNC_ID_ZW_REPLACE_FAILED_NODE:
+			/* copy it, as a new nonce may take its place in the table */
+			memcpy(_nonce, nonce, 8);
+
+			/* if the Node has something else to send, it will encrypt a message and send it as a MessageEncapNonceGet.
+			 * The nonce does not depend on the message, so it is sent before the message is decrypted. */
+			if (SecurityCmd_MessageEncapNonceGet == SecurityCmd )
 			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleReplaceFailedNodeRequest( _data );
-				break;
+				Log::Write(LogLevel_Info,  _data[3], "Received SecurityCmd_MessageEncapNonceGet from node %d - Sending New Nonce", _data[3] );
+				SendNonceKey(_data[3], GenerateNonceKey(_data[3]));
 			}
-			case FUNC_ID_ZW_SET_SLAVE_LEARN_MODE:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSetSlaveLearnModeRequest( _data );
-				break;
+
+			/* a worker decrypts it if it can, and hands it back to ProcessDecryptedMsgs */
+			if( m_securityDecryptor != NULL ) {
+				if( m_securityDecryptor->Decrypt( _data, _length, _nonce, GetControllerNodeId(), GetEncKey(), GetAuthKey() ) ) {
+					return;
+				}
+				/* every job is taken, so the node's earlier frames are processed before this one */
+				DrainDecryptedMsgs( _data[3] );
 			}
-			case FUNC_ID_ZW_SEND_SLAVE_NODE_INFO:
-			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSendSlaveNodeInfoRequest( _data );
-				break;
+
+			if (DecryptBuffer(&_data[5], _data[4]+1, this, _data[3], this->GetControllerNodeId(), _nonce, &_newdata[0])) {
+				/* Ok - _newdata now contains the decrypted packet */
+				/* copy it back to the _data packet for processing */
+				/* New Length - See Decrypt Packet for why these numbers*/
+				_data[4] = _data[4] - 8 - 8 - 2 - 2;
+
+				/* now copy the decrypted packet */
+				memcpy(&_data[5], &_newdata[1], _data[4]);
+				//PrintHex("Decrypted Packet", _data, _data[4]+5);
+
+				wasencrypted = true;
+
+			} else {
+				/* it failed for some reason, lets just move on */
+				m_expectedReply = 0;
+				m_expectedNodeId = 0;
+				RemoveCurrentMsg();
+				return;
 			}
-			case FUNC_ID_APPLICATION_SLAVE_COMMAND_HANDLER:
+		}
+	}
+	else if( m_securityDecryptor != NULL && ( REQUEST == _data[0] ) && ( FUNC_ID_APPLICATION_COMMAND_HANDLER == _data[1] ) )
+	{
+		if( m_securityDecryptor->Forward( _data, _length ) )
+		{
+			// The node's secured frames are still being decrypted, so this one waits its turn
+			return;
+		}
+		DrainDecryptedMsgs( _data[3] );
+	}
+
+	DispatchMsg( _data, _length, wasencrypted );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ProcessDecryptedMsgs>
+// Process the frames that the security workers have finished with
+//-----------------------------------------------------------------------------
+void Driver::ProcessDecryptedMsgs
+(
+)
+{
+	uint8 data[256];
+	uint8 length;
+	SecurityDecryptor::Result result;
+	while( m_securityDecryptor->TakeResult( data, &length, &result ) )
+	{
+		if( result == SecurityDecryptor::Result_Failed )
+		{
+			// As when the driver thread fails to decrypt a frame, the request it
+			// answered is given up on, as long as it is still the current one.
+			if( m_currentMsg != NULL && m_currentMsg->GetTargetNodeId() == data[3] )
 			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleApplicationSlaveCommandRequest( _data );
-				break;
+				m_expectedReply = 0;
+				m_expectedNodeId = 0;
+				RemoveCurrentMsg();
 			}
-			case FUNC_ID_PROMISCUOUS_APPLICATION_COMMAND_HANDLER:
+			continue;
+		}
+
+		DispatchMsg( data, length, result == SecurityDecryptor::Result_Decrypted );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::DrainDecryptedMsgs>
+// Wait for the security workers to finish with a node's frames, and process
+// them, so that a frame handled on the driver thread does not overtake them
+//-----------------------------------------------------------------------------
+void Driver::DrainDecryptedMsgs
+(
+		uint8 const _nodeId
+)
+{
+	while( m_securityDecryptor->IsPending( _nodeId ) )
+	{
+		Wait::Single( m_securityDecryptor->GetResultEvent() );
+		ProcessDecryptedMsgs();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::DispatchMsg>
+// Process a received message, once any security encapsulation is removed
+//-----------------------------------------------------------------------------
+void Driver::DispatchMsg
+(
+		uint8* _data,
+		uint8 const _length,
+		bool const _encrypted
+)
+{
+	bool handleCallback = true;
+
+	if( ( REQUEST == _data[0] ) || ( RESPONSE == _data[0] ) )
+	{
+		MsgHandler& entry = m_msgHandlers[_data[0]][_data[1]];
+		if( entry.m_spacer )
+		{
+			Log::Write( LogLevel_Detail, "" );
+		}
+
+		// Take copies, as an application may change its handler at any time.  The
+		// handler is called without the lock, so that it may remove itself, but with
+		// m_externalCallMutex held, so that RemoveSerialApiHandler waits for it.
+		m_externalCallMutex->Lock();
+		m_msgHandlerMutex->Lock();
+		pfnSerialApiHandler_t external = entry.m_external;
+		void* context = entry.m_context;
+		m_msgHandlerMutex->Unlock();
+		if( external == NULL )
+		{
+			m_externalCallMutex->Unlock();
+		}
+		if( external != NULL || entry.m_handler != NULL )
+		{
+			uint64 start = TimeStamp::GetMicroseconds();
+			if( external != NULL )
 			{
-				Log::Write( LogLevel_Detail, "" );
-				HandlePromiscuousApplicationCommandHandlerRequest( _data );
-				break;
+				handleCallback = external( m_homeId, _data, _length, context );
+				m_externalCallMutex->Unlock();
 			}
-			case FUNC_ID_ZW_SET_DEFAULT:
+			else
 			{
-				Log::Write( LogLevel_Detail, "" );
-				HandleSerialAPIResetRequest( _data );
-				break;
+				handleCallback = (this->*entry.m_handler)( _data, _encrypted );
 			}
-			default:
+			uint32 elapsed = (uint32)( TimeStamp::GetMicroseconds() - start );
+
+			m_msgHandlerMutex->Lock();
+			++entry.m_calls;
+			entry.m_totalTime += elapsed;
+			if( elapsed > entry.m_maxTime )
 			{
-				Log::Write( LogLevel_Detail, "" );
-				Log::Write( LogLevel_Info, "**TODO: handle request for 0x%.2x** Please report this message.", _data[1] );
-				break;
+				entry.m_maxTime = elapsed;
 			}
+			m_msgHandlerMutex->Unlock();
+		}
+		else
+		{
+			Log::Write( LogLevel_Info, "**TODO: handle %s for 0x%.2x** Please report this message.", ( REQUEST == _data[0] ) ? "request" : "response", _data[1] );
 		}
 	}
 
+	// Reports for requests that have already released the transmit slot
+	if( ( REQUEST == _data[0] ) && ( FUNC_ID_APPLICATION_COMMAND_HANDLER == _data[1] ) )
+	{
+		CompletePendingReport( _data );
+	}
+
 	// Generic callback handling
 	if( handleCallback )
 	{
@@ -2322,6 +3266,14 @@ void Driver::ProcessMsg
 					return;
 				}
 			}
+			if( !m_expectedCallbackId && ( FUNC_ID_APPLICATION_COMMAND_HANDLER == m_expectedReply ) && ( FUNC_ID_ZW_SEND_DATA == _data[1] ) && ( TRANSMIT_COMPLETE_OK == _data[3] ) )
+			{
+				// The node has the request, so let other nodes have the transmit slot while it prepares the report
+				if( ParkCurrentMsg() )
+				{
+					return;
+				}
+			}
 			if( m_expectedReply )
 			{
 				if( m_expectedReply == _data[1] )
@@ -2341,30 +3293,395 @@ void Driver::ProcessMsg
 					{
 						if( IsExpectedReply( _data[3] ) )
 
-						{
-							Log::Write( LogLevel_Detail, _data[3], "  Expected reply was received" );
-							m_expectedReply = 0;
-							m_expectedNodeId = 0;
-						}
-					}
-				}
-			}
-			if( !( m_expectedCallbackId || m_expectedReply ) )
-			{
-				Log::Write( LogLevel_Detail, _data[3], "  Message transaction complete" );
-				Log::Write( LogLevel_Detail, "" );
+						{
+							Log::Write( LogLevel_Detail, _data[3], "  Expected reply was received" );
+							m_expectedReply = 0;
+							m_expectedNodeId = 0;
+						}
+					}
+				}
+			}
+			if( !( m_expectedCallbackId || m_expectedReply ) )
+			{
+				Log::Write( LogLevel_Detail, _data[3], "  Message transaction complete" );
+				Log::Write( LogLevel_Detail, "" );
+
+				if( m_notifytransactions )
+				{
+					Notification* notification = new Notification( Notification::Type_Notification );
+					notification->SetHomeAndNodeIds( m_homeId, _data[3] );
+					notification->SetNotification( Notification::Code_MsgComplete );
+					QueueNotification( notification );
+				}
+				RemoveCurrentMsg();
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::InitMsgHandlers>
+// Fill the dispatch table with the driver's own Serial API handlers
+//-----------------------------------------------------------------------------
+void Driver::InitMsgHandlers
+(
+)
+{
+	memset( m_msgHandlers, 0, sizeof(m_msgHandlers) );
+	for( int32 i=0; i<256; ++i )
+	{
+		m_msgHandlers[REQUEST][i].m_spacer = true;
+		m_msgHandlers[RESPONSE][i].m_spacer = true;
+	}
+
+	// Responses
+	RegisterMsgHandler( RESPONSE, FUNC_ID_SERIAL_API_GET_INIT_DATA, "FUNC_ID_SERIAL_API_GET_INIT_DATA", &Driver::CallMsgHandler<&Driver::HandleSerialAPIGetInitDataResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES, "FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES", &Driver::CallMsgHandler<&Driver::HandleGetControllerCapabilitiesResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_SERIAL_API_GET_CAPABILITIES, "FUNC_ID_SERIAL_API_GET_CAPABILITIES", &Driver::CallMsgHandler<&Driver::HandleGetSerialAPICapabilitiesResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_SERIAL_API_SOFT_RESET, "FUNC_ID_SERIAL_API_SOFT_RESET", &Driver::CallMsgHandler<&Driver::HandleSerialAPISoftResetResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_SEND_DATA, "FUNC_ID_ZW_SEND_DATA", &Driver::OnSendDataResponse, false );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_VERSION, "FUNC_ID_ZW_GET_VERSION", &Driver::CallMsgHandler<&Driver::HandleGetVersionResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_RANDOM, "FUNC_ID_ZW_GET_RANDOM", &Driver::CallMsgHandler<&Driver::HandleGetRandomResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_MEMORY_GET_ID, "FUNC_ID_ZW_MEMORY_GET_ID", &Driver::CallMsgHandler<&Driver::HandleMemoryGetIdResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO, "FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO", &Driver::CallMsgHandler<&Driver::HandleGetNodeProtocolInfoResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_REPLICATION_SEND_DATA, "FUNC_ID_ZW_REPLICATION_SEND_DATA", &Driver::OnReplicationSendDataResponse, false );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_ASSIGN_RETURN_ROUTE, "FUNC_ID_ZW_ASSIGN_RETURN_ROUTE", &Driver::CallTransactionHandler<&Driver::HandleAssignReturnRouteResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_DELETE_RETURN_ROUTE, "FUNC_ID_ZW_DELETE_RETURN_ROUTE", &Driver::CallTransactionHandler<&Driver::HandleDeleteReturnRouteResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_ENABLE_SUC, "FUNC_ID_ZW_ENABLE_SUC", &Driver::CallMsgHandler<&Driver::HandleEnableSUCResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_REQUEST_NETWORK_UPDATE, "FUNC_ID_ZW_REQUEST_NETWORK_UPDATE", &Driver::CallTransactionHandler<&Driver::HandleNetworkUpdateResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_SET_SUC_NODE_ID, "FUNC_ID_ZW_SET_SUC_NODE_ID", &Driver::CallMsgHandler<&Driver::HandleSetSUCNodeIdResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_SUC_NODE_ID, "FUNC_ID_ZW_GET_SUC_NODE_ID", &Driver::CallMsgHandler<&Driver::HandleGetSUCNodeIdResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_REQUEST_NODE_INFO, "FUNC_ID_ZW_REQUEST_NODE_INFO", &Driver::OnRequestNodeInfoResponse );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_REMOVE_FAILED_NODE_ID, "FUNC_ID_ZW_REMOVE_FAILED_NODE_ID", &Driver::CallTransactionHandler<&Driver::HandleRemoveFailedNodeResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_IS_FAILED_NODE_ID, "FUNC_ID_ZW_IS_FAILED_NODE_ID", &Driver::CallMsgHandler<&Driver::HandleIsFailedNodeResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_REPLACE_FAILED_NODE, "FUNC_ID_ZW_REPLACE_FAILED_NODE", &Driver::CallTransactionHandler<&Driver::HandleReplaceFailedNodeResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_ROUTING_INFO, "FUNC_ID_ZW_GET_ROUTING_INFO", &Driver::CallMsgHandler<&Driver::HandleGetRoutingInfoResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_R_F_POWER_LEVEL_SET, "FUNC_ID_ZW_R_F_POWER_LEVEL_SET", &Driver::CallStatusHandler<&Driver::HandleRfPowerLevelSetResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_READ_MEMORY, "FUNC_ID_ZW_READ_MEMORY", &Driver::CallStatusHandler<&Driver::HandleReadMemoryResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_SERIAL_API_SET_TIMEOUTS, "FUNC_ID_SERIAL_API_SET_TIMEOUTS", &Driver::CallStatusHandler<&Driver::HandleSerialApiSetTimeoutsResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_MEMORY_GET_BYTE, "FUNC_ID_MEMORY_GET_BYTE", &Driver::CallStatusHandler<&Driver::HandleMemoryGetByteResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_GET_VIRTUAL_NODES, "FUNC_ID_ZW_GET_VIRTUAL_NODES", &Driver::CallMsgHandler<&Driver::HandleGetVirtualNodesResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_SET_SLAVE_LEARN_MODE, "FUNC_ID_ZW_SET_SLAVE_LEARN_MODE", &Driver::CallTransactionHandler<&Driver::HandleSetSlaveLearnModeResponse> );
+	RegisterMsgHandler( RESPONSE, FUNC_ID_ZW_SEND_SLAVE_NODE_INFO, "FUNC_ID_ZW_SEND_SLAVE_NODE_INFO", &Driver::CallTransactionHandler<&Driver::HandleSendSlaveNodeInfoResponse> );
+
+	// Requests
+	RegisterMsgHandler( REQUEST, FUNC_ID_APPLICATION_COMMAND_HANDLER, "FUNC_ID_APPLICATION_COMMAND_HANDLER", &Driver::OnApplicationCommandHandlerRequest );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_SEND_DATA, "FUNC_ID_ZW_SEND_DATA", &Driver::OnSendDataRequest, false );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REPLICATION_COMMAND_COMPLETE, "FUNC_ID_ZW_REPLICATION_COMMAND_COMPLETE", &Driver::OnReplicationCommandCompleteRequest, false );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REPLICATION_SEND_DATA, "FUNC_ID_ZW_REPLICATION_SEND_DATA", &Driver::OnReplicationSendDataRequest, false );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_ASSIGN_RETURN_ROUTE, "FUNC_ID_ZW_ASSIGN_RETURN_ROUTE", &Driver::CallMsgHandler<&Driver::HandleAssignReturnRouteRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_DELETE_RETURN_ROUTE, "FUNC_ID_ZW_DELETE_RETURN_ROUTE", &Driver::CallMsgHandler<&Driver::HandleDeleteReturnRouteRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_SEND_NODE_INFORMATION, "FUNC_ID_ZW_SEND_NODE_INFORMATION", &Driver::CallMsgHandler<&Driver::HandleSendNodeInformationRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE, "FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE", &Driver::CallMsgHandler<&Driver::HandleNodeNeighborUpdateRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE_OPTIONS, "FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE_OPTIONS", &Driver::CallMsgHandler<&Driver::HandleNodeNeighborUpdateRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_APPLICATION_UPDATE, "FUNC_ID_ZW_APPLICATION_UPDATE", &Driver::OnApplicationUpdateRequest );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_ADD_NODE_TO_NETWORK, "FUNC_ID_ZW_ADD_NODE_TO_NETWORK", &Driver::CallMsgHandler<&Driver::HandleAddNodeToNetworkRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REMOVE_NODE_FROM_NETWORK, "FUNC_ID_ZW_REMOVE_NODE_FROM_NETWORK", &Driver::CallMsgHandler<&Driver::HandleRemoveNodeFromNetworkRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_CREATE_NEW_PRIMARY, "FUNC_ID_ZW_CREATE_NEW_PRIMARY", &Driver::CallMsgHandler<&Driver::HandleCreateNewPrimaryRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_CONTROLLER_CHANGE, "FUNC_ID_ZW_CONTROLLER_CHANGE", &Driver::CallMsgHandler<&Driver::HandleControllerChangeRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_SET_LEARN_MODE, "FUNC_ID_ZW_SET_LEARN_MODE", &Driver::CallMsgHandler<&Driver::HandleSetLearnModeRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REQUEST_NETWORK_UPDATE, "FUNC_ID_ZW_REQUEST_NETWORK_UPDATE", &Driver::CallMsgHandler<&Driver::HandleNetworkUpdateRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REMOVE_FAILED_NODE_ID, "FUNC_ID_ZW_REMOVE_FAILED_NODE_ID", &Driver::CallMsgHandler<&Driver::HandleRemoveFailedNodeRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_REPLACE_FAILED_NODE, "FUNC_ID_ZW_REPLACE_FAILED_NODE", &Driver::CallMsgHandler<&Driver::HandleReplaceFailedNodeRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_SET_SLAVE_LEARN_MODE, "FUNC_ID_ZW_SET_SLAVE_LEARN_MODE", &Driver::CallMsgHandler<&Driver::HandleSetSlaveLearnModeRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_SEND_SLAVE_NODE_INFO, "FUNC_ID_ZW_SEND_SLAVE_NODE_INFO", &Driver::CallMsgHandler<&Driver::HandleSendSlaveNodeInfoRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_APPLICATION_SLAVE_COMMAND_HANDLER, "FUNC_ID_APPLICATION_SLAVE_COMMAND_HANDLER", &Driver::CallMsgHandler<&Driver::HandleApplicationSlaveCommandRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_PROMISCUOUS_APPLICATION_COMMAND_HANDLER, "FUNC_ID_PROMISCUOUS_APPLICATION_COMMAND_HANDLER", &Driver::CallMsgHandler<&Driver::HandlePromiscuousApplicationCommandHandlerRequest> );
+	RegisterMsgHandler( REQUEST, FUNC_ID_ZW_SET_DEFAULT, "FUNC_ID_ZW_SET_DEFAULT", &Driver::CallMsgHandler<&Driver::HandleSerialAPIResetRequest> );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::RegisterMsgHandler>
+// Add one of the driver's own handlers to the dispatch table
+//-----------------------------------------------------------------------------
+void Driver::RegisterMsgHandler
+(
+		uint8 const _type,
+		uint8 const _function,
+		char const* _name,
+		pfnMsgHandler_t _handler,
+		bool const _spacer
+)
+{
+	MsgHandler& entry = m_msgHandlers[_type][_function];
+	entry.m_handler = _handler;
+	entry.m_name = _name;
+	entry.m_spacer = _spacer;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::AddSerialApiHandler>
+// Handle a Serial API function the driver does not handle itself
+//-----------------------------------------------------------------------------
+bool Driver::AddSerialApiHandler
+(
+		uint8 const _type,
+		uint8 const _function,
+		pfnSerialApiHandler_t _handler,
+		void* _context
+)
+{
+	if( ( _type != REQUEST && _type != RESPONSE ) || _handler == NULL )
+	{
+		return false;
+	}
+
+	LockGuard LG(m_msgHandlerMutex);
+	MsgHandler& entry = m_msgHandlers[_type][_function];
+	if( entry.m_handler != NULL || entry.m_external != NULL )
+	{
+		Log::Write( LogLevel_Warning, "Cannot add a handler for Serial API %s 0x%.2x, as it is already handled", ( REQUEST == _type ) ? "request" : "response", _function );
+		return false;
+	}
+
+	entry.m_context = _context;
+	entry.m_external = _handler;
+	entry.m_calls = 0;
+	entry.m_totalTime = 0;
+	entry.m_maxTime = 0;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::RemoveSerialApiHandler>
+// Stop handling a Serial API function with an application's handler
+//-----------------------------------------------------------------------------
+bool Driver::RemoveSerialApiHandler
+(
+		uint8 const _type,
+		uint8 const _function
+)
+{
+	if( _type != REQUEST && _type != RESPONSE )
+	{
+		return false;
+	}
+
+	{
+		LockGuard LG(m_msgHandlerMutex);
+		MsgHandler& entry = m_msgHandlers[_type][_function];
+		if( entry.m_external == NULL )
+		{
+			return false;
+		}
+
+		entry.m_external = NULL;
+		entry.m_context = NULL;
+	}
+
+	// Wait for a call that is already running to return, so that the caller may free
+	// the handler's context.  The mutex is recursive, so a handler can remove itself.
+	m_externalCallMutex->Lock();
+	m_externalCallMutex->Unlock();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetSerialApiStatistics>
+// Return the calls to, and time spent in, each Serial API handler that has run
+//-----------------------------------------------------------------------------
+void Driver::GetSerialApiStatistics
+(
+		list<SerialApiData>* _data
+)
+{
+	_data->clear();
+	LockGuard LG(m_msgHandlerMutex);
+	for( int32 type=REQUEST; type<=RESPONSE; ++type )
+	{
+		for( int32 function=0; function<256; ++function )
+		{
+			MsgHandler const& entry = m_msgHandlers[type][function];
+			if( entry.m_calls == 0 )
+			{
+				continue;
+			}
+
+			SerialApiData data;
+			data.m_type = (uint8)type;
+			data.m_function = (uint8)function;
+			data.m_name = entry.m_name ? entry.m_name : "";
+			data.m_external = ( entry.m_external != NULL );
+			data.m_calls = entry.m_calls;
+			data.m_totalTime = entry.m_totalTime;
+			data.m_maxTime = entry.m_maxTime;
+			_data->push_back( data );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CallMsgHandler>
+// Dispatch a frame to a Handle method
+//-----------------------------------------------------------------------------
+template<void (Driver::*_handler)( uint8* )>
+bool Driver::CallMsgHandler
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	(this->*_handler)( _data );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CallTransactionHandler>
+// Dispatch a response to a Handle method that returns false when the
+// controller has refused the request, and so will send no callback
+//-----------------------------------------------------------------------------
+template<bool (Driver::*_handler)( uint8* )>
+bool Driver::CallTransactionHandler
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	if( !(this->*_handler)( _data ) )
+	{
+		m_expectedCallbackId = _data[2];	// The callback message won't be coming, so we force the transaction to complete
+		m_expectedReply = 0;
+		m_expectedCommandClassId = 0;
+		m_expectedNodeId = 0;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CallStatusHandler>
+// Dispatch a response to a Handle method whose result is only logged
+//-----------------------------------------------------------------------------
+template<bool (Driver::*_handler)( uint8* )>
+bool Driver::CallStatusHandler
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	(this->*_handler)( _data );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnSendDataResponse>
+// Dispatch a FUNC_ID_ZW_SEND_DATA response
+//-----------------------------------------------------------------------------
+bool Driver::OnSendDataResponse
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	HandleSendDataResponse( _data, false );
+	return false;			// Skip the callback handling - a subsequent FUNC_ID_ZW_SEND_DATA request will deal with that
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnReplicationSendDataResponse>
+// Dispatch a FUNC_ID_ZW_REPLICATION_SEND_DATA response
+//-----------------------------------------------------------------------------
+bool Driver::OnReplicationSendDataResponse
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	HandleSendDataResponse( _data, true );
+	return false;			// Skip the callback handling - a subsequent FUNC_ID_ZW_REPLICATION_SEND_DATA request will deal with that
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnRequestNodeInfoResponse>
+// Dispatch a FUNC_ID_ZW_REQUEST_NODE_INFO response
+//-----------------------------------------------------------------------------
+bool Driver::OnRequestNodeInfoResponse
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	if( _data[2] )
+	{
+		Log::Write( LogLevel_Info, _data[3], "FUNC_ID_ZW_REQUEST_NODE_INFO Request successful." );
+	}
+	else
+	{
+		Log::Write( LogLevel_Info, _data[3], "FUNC_ID_ZW_REQUEST_NODE_INFO Request failed." );
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnApplicationCommandHandlerRequest>
+// Dispatch a FUNC_ID_APPLICATION_COMMAND_HANDLER request
+//-----------------------------------------------------------------------------
+bool Driver::OnApplicationCommandHandlerRequest
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	HandleApplicationCommandHandlerRequest( _data, _encrypted );
+	return true;
+}
 
-				if( m_notifytransactions )
-				{
-					Notification* notification = new Notification( Notification::Type_Notification );
-					notification->SetHomeAndNodeIds( m_homeId, _data[3] );
-					notification->SetNotification( Notification::Code_MsgComplete );
-					QueueNotification( notification );
-				}
-				RemoveCurrentMsg();
-			}
-		}
+//-----------------------------------------------------------------------------
+// <Driver::OnSendDataRequest>
+// Dispatch a FUNC_ID_ZW_SEND_DATA request
+//-----------------------------------------------------------------------------
+bool Driver::OnSendDataRequest
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	HandleSendDataRequest( _data, false );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnReplicationSendDataRequest>
+// Dispatch a FUNC_ID_ZW_REPLICATION_SEND_DATA request
+//-----------------------------------------------------------------------------
+bool Driver::OnReplicationSendDataRequest
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	HandleSendDataRequest( _data, true );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnReplicationCommandCompleteRequest>
+// Dispatch a FUNC_ID_ZW_REPLICATION_COMMAND_COMPLETE request
+//-----------------------------------------------------------------------------
+bool Driver::OnReplicationCommandCompleteRequest
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	if( m_controllerReplication )
+	{
+		Log::Write( LogLevel_Detail, "" );
+		m_controllerReplication->SendNextData();
 	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::OnApplicationUpdateRequest>
+// Dispatch a FUNC_ID_ZW_APPLICATION_UPDATE request
+//-----------------------------------------------------------------------------
+bool Driver::OnApplicationUpdateRequest
+(
+		uint8* _data,
+		bool _encrypted
+)
+{
+	return !HandleApplicationUpdateRequest( _data );
 }
 
 //-----------------------------------------------------------------------------
@@ -2651,6 +3968,12 @@ void Driver::HandleSerialAPIGetInitDataResponse
 		QueueNotification( notification );
 	}
 
+	list<uint8> warmStarted;
+	if( !m_init && m_warmStart )
+	{
+		m_warmStartTime = time( NULL );
+	}
+
 	Log::Write( LogLevel_Info, GetNodeNumber( m_currentMsg ), "Received reply to FUNC_ID_SERIAL_API_GET_INIT_DATA:" );
 	m_initVersion = _data[2];
 	m_initCaps = _data[3];
@@ -2677,9 +4000,18 @@ void Driver::HandleSerialAPIGetInitDataResponse
 							Log::Write( LogLevel_Info, GetNodeNumber( m_currentMsg ), "    Node %.3d - Known", nodeId );
 							if( !m_init )
 							{
-								// The node was read in from the config, so we
-								// only need to get its current state
-								node->SetQueryStage( Node::QueryStage_CacheLoad );
+								if( m_warmStart && node->WarmStart() )
+								{
+									// The node was completely queried last time, so use the cached
+									// state now and verify its values in the background
+									warmStarted.push_back( nodeId );
+								}
+								else
+								{
+									// The node was read in from the config, so we
+									// only need to get its current state
+									node->SetQueryStage( Node::QueryStage_CacheLoad );
+								}
 							}
 
 						}
@@ -2716,6 +4048,14 @@ void Driver::HandleSerialAPIGetInitDataResponse
 	}
 
 	m_init = true;
+
+	if( !warmStarted.empty() )
+	{
+		StartWarmStartRefresh( warmStarted );
+
+		// Warm started nodes are already complete, so this may be enough to report the awake nodes as queried
+		CheckCompletedNodeQueries();
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -2971,6 +4311,7 @@ void Driver::HandleGetRoutingInfoResponse
 	{
 		// copy the 29-byte bitmap received (29*8=232 possible nodes) into this node's neighbors member variable
 		memcpy( node->m_neighbors, &_data[2], 29 );
+		m_networkGraph->SetNeighbors( node->GetNodeId(), node->m_neighbors );
 		Log::Write( LogLevel_Info, GetNodeNumber( m_currentMsg ), "    Neighbors of this node are:" );
 		bool bNeighbors = false;
 		for( int by=0; by<29; by++ )
@@ -3032,10 +4373,22 @@ void Driver::HandleSendDataRequest
 					node->m_averageRequestRTT = node->m_lastRequestRTT;
 				}
 				Log::Write(LogLevel_Info, nodeId, "Request RTT %d Average Request RTT %d", node->m_lastRequestRTT, node->m_averageRequestRTT );
+
+				// The callback completes the transaction unless a report is still to come.  As in TCP,
+				// retransmitted messages are not sampled, since we cannot tell which attempt was answered.
+				if( m_expectedReply != FUNC_ID_APPLICATION_COMMAND_HANDLER && m_currentMsg && m_currentMsg->GetSendAttempts() <= 1 )
+				{
+					UpdateRetryTimeout( node, node->m_lastRequestRTT );
+				}
 			}
 		}
 
 		// We do this here since HandleErrorResponse/MoveMessagesToWakeUpQueue can delete m_currentMsg
+		uint32 setValueRequest = ( m_currentMsg != NULL ) ? m_currentMsg->GetSetValueRequest() : 0;
+		if( setValueRequest != 0 && _data[3] == 0 )
+		{
+			m_setValueTracker->OnTransmitted( setValueRequest, true );
+		}
 		if( m_currentMsg && m_currentMsg->IsNoOperation() )
 		{
 			Notification* notification = new Notification( Notification::Type_Notification );
@@ -3055,6 +4408,11 @@ void Driver::HandleSendDataRequest
 				{
 					node->QueryStageRetry( node->GetCurrentQueryStage(), 3 );
 				}
+				if( setValueRequest != 0 && m_expectedReply != FUNC_ID_APPLICATION_COMMAND_HANDLER )
+				{
+					// Unless a report is awaited the transaction ends here, so the message will not be sent again
+					m_setValueTracker->OnTransmitted( setValueRequest, false );
+				}
 			}
 		}
 		else if( node != NULL )
@@ -3507,18 +4865,12 @@ void Driver::HandleApplicationCommandHandlerRequest
 	{
 		node->m_receivedCnt++;
 		node->m_errors = 0;
-		int cmp = memcmp( _data, node->m_lastReceivedMessage, sizeof(node->m_lastReceivedMessage));
-		if( cmp == 0 && node->m_receivedTS.TimeRemaining() > -500 )
-		{
-			// if the exact same sequence of bytes are received within 500ms
-			node->m_receivedDups++;
-		}
-		else
-		{
-			memcpy( node->m_lastReceivedMessage, _data, sizeof(node->m_lastReceivedMessage) );
-		}
+		m_networkGraph->RecordTraffic( nodeId );
+		memcpy( node->m_lastReceivedMessage, _data, sizeof(node->m_lastReceivedMessage) );
 		node->m_receivedTS.SetTime();
-		if( m_expectedReply == FUNC_ID_APPLICATION_COMMAND_HANDLER && m_expectedNodeId == nodeId )
+		uint8 pendingSendAttempts = 0;
+		bool pending = GetPendingReport( nodeId, NULL, &pendingSendAttempts );
+		if( ( m_expectedReply == FUNC_ID_APPLICATION_COMMAND_HANDLER && m_expectedNodeId == nodeId ) || pending )
 		{
 			// Need to confirm this is the correct response to the last sent request.
 			// At least ignore any received messages prior to the send data request.
@@ -3535,6 +4887,16 @@ void Driver::HandleApplicationCommandHandlerRequest
 				node->m_averageResponseRTT = node->m_lastResponseRTT;
 			}
 			Log::Write(LogLevel_Info, nodeId, "Response RTT %d Average Response RTT %d", node->m_lastResponseRTT, node->m_averageResponseRTT );
+
+			uint8 sendAttempts = m_currentMsg ? m_currentMsg->GetSendAttempts() : 0xff;
+			if( pending )
+			{
+				sendAttempts = pendingSendAttempts;
+			}
+			if( sendAttempts <= 1 )
+			{
+				UpdateRetryTimeout( node, node->m_lastResponseRTT );
+			}
 		}
 		else
 		{
@@ -3560,14 +4922,68 @@ void Driver::HandleApplicationCommandHandlerRequest
 	}
 	else
 	{
-		// Allow the node to handle the message itself
-		if( node != NULL )
+		// Allow the node to handle the message itself, either here or on the report thread
+		if( node != NULL && !IsDuplicateReport( node, _data, encrypted )
+			&& ( m_reportDispatcher == NULL || !m_reportDispatcher->Dispatch( _data, encrypted ) ) )
 		{
 			node->ApplicationCommandHandler( _data, encrypted );
 		}
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::IsDuplicateReport>
+// Whether a report is a copy of one the node sent a moment ago, from a device
+// retransmitting it or the network delivering it by more than one route, and
+// should be dropped before it is decoded.
+//-----------------------------------------------------------------------------
+bool Driver::IsDuplicateReport
+(
+		Node* _node,
+		uint8 const* _data,
+		bool const _encrypted
+)
+{
+	uint8 nodeId = _data[3];
+	uint8 classId = _data[5];
+
+	// The window of an endpoint's command is that of the command class it carries
+	uint8 windowClassId = classId;
+	if( classId == MultiInstance::StaticGetCommandClassId() )
+	{
+		if( _data[6] == MultiInstance::MultiChannelCmd_Encap && _data[4] >= 5 )
+		{
+			windowClassId = _data[9];
+		}
+		else if( _data[6] == MultiInstance::MultiInstanceCmd_Encap && _data[4] >= 4 )
+		{
+			windowClassId = _data[8];
+		}
+	}
+
+	if( !_node->IsDuplicateFrame( _data, _encrypted, m_duplicateWindow[windowClassId] ) )
+	{
+		return false;
+	}
+
+	// A report we asked for is decoded even if it repeats an unsolicited one, so
+	// that the request refreshes its values
+	if( m_expectedNodeId == nodeId && m_expectedCommandClassId == classId )
+	{
+		return false;
+	}
+	uint8 pendingClassId;
+	if( GetPendingReport( nodeId, &pendingClassId ) && pendingClassId == classId )
+	{
+		return false;
+	}
+
+	_node->m_receivedDups++;
+	m_duplicatesDropped++;
+	Log::Write( LogLevel_Detail, nodeId, "Dropping a duplicate %s report", CommandClasses::GetName( classId ).c_str() );
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::HandlePromiscuousApplicationCommandHandlerRequest>
 // Process a request from the Z-Wave PC interface when in promiscuous mode.
@@ -3736,6 +5152,12 @@ bool Driver::HandleApplicationUpdateRequest
 	uint8 nodeId = _data[3];
 	Node* node = GetNodeUnsafe( nodeId );
 
+	// Finish decoding the node's reports before its node information is acted on
+	if( m_reportDispatcher != NULL )
+	{
+		m_reportDispatcher->Flush( nodeId );
+	}
+
 	// If node is not alive, mark it alive now
 	if( node != NULL && !node->IsNodeAlive() )
 	{
@@ -4023,6 +5445,11 @@ bool Driver::EnablePoll
 			PollEntry pe;
 			pe.m_id = _valueId;
 			pe.m_pollCounter = value->GetPollIntensity();
+			pe.m_scale = 100;
+			pe.m_reports = value->m_reportCount;
+			pe.m_changes = value->m_changeCount;
+			pe.m_polled = false;
+			pe.m_lastPoll = 0;
 			m_pollList.push_back( pe );
 			value->Release();
 			m_pollMutex->Unlock();
@@ -4134,76 +5561,253 @@ bool Driver::isPolled
 
 	if (value) value->Release();
 
-	/*
-	 * This code is retained for the moment as a belt-and-suspenders test to confirm that
-	 * the pollIntensity member of each value and the pollList contents do not get out
-	 * of sync.
-	 */
-	// confirm that this node exists
-	uint8 nodeId = _valueId.GetNodeId();
+	/*
+	 * This code is retained for the moment as a belt-and-suspenders test to confirm that
+	 * the pollIntensity member of each value and the pollList contents do not get out
+	 * of sync.
+	 */
+	// confirm that this node exists
+	uint8 nodeId = _valueId.GetNodeId();
+	LockGuard LG(m_nodeMutex);
+	Node* node = GetNode( nodeId );
+	if( node != NULL)
+	{
+
+		// See if the value is already in the poll list.
+		for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+		{
+			if( (*it).m_id == _valueId )
+			{
+				// Found it
+				if( bPolled )
+				{
+					m_pollMutex->Unlock();
+					return true;
+				}
+				else
+				{
+					Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
+				}
+			}
+		}
+
+		// Not in the list
+
+		if( !bPolled )
+		{
+			m_pollMutex->Unlock();
+			return false;
+		}
+		else
+		{
+			Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
+		}
+	}
+
+	// allow the poll thread to continue
+	m_pollMutex->Unlock();
+
+	Log::Write( LogLevel_Info, "isPolled failed - node %d not found (the value reported that it is%s polled)", nodeId, bPolled?"":" not" );
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SetPollIntensity>
+// Set the intensity with which this value is polled
+//-----------------------------------------------------------------------------
+void Driver::SetPollIntensity
+(
+		ValueID const &_valueId,
+		uint8 const _intensity
+)
+{
+	// make sure the polling thread doesn't lock the value while we're in this function
+	m_pollMutex->Lock();
+
+	Value* value = GetValue( _valueId );
+	if (!value)
+		return;
+	value->SetPollIntensity( _intensity );
+
+	value->Release();
+	m_pollMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetPollIntervals>
+// Get the interval a value is polled at, before and after the airtime budget
+//-----------------------------------------------------------------------------
+bool Driver::GetPollIntervals
+(
+		ValueID const& _valueId,
+		int32* o_interval,
+		int32* o_effective
+)
+{
+	LockGuard PLG(m_pollMutex);
+	LockGuard LG(m_nodeMutex);
+	for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+	{
+		if( (*it).m_id == _valueId )
+		{
+			Value* value = GetValue( _valueId );
+			if( value == NULL )
+			{
+				return false;
+			}
+
+			if( m_adaptivePolling )
+			{
+				*o_interval = GetAdaptivePollInterval( *it, value );
+				*o_effective = (int32)( *o_interval * m_pollBudgetFactor );
+			}
+			else
+			{
+				*o_interval = GetBasePollInterval( value->GetPollIntensity() );
+				*o_effective = *o_interval;
+			}
+			value->Release();
+			return true;
+		}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetBasePollInterval>
+// The interval a value's poll intensity sets, in ms
+//-----------------------------------------------------------------------------
+int32 Driver::GetBasePollInterval
+(
+		uint8 const _intensity
+)
+{
+	int32 interval = m_pollInterval;
+	if( interval < 100 )
+	{
+		// A legacy setting in seconds
+		interval *= 1000;
+	}
+	if( m_bIntervalBetweenPolls )
+	{
+		interval *= (int32)m_pollList.size();
+	}
+	return interval * ( _intensity ? _intensity : 1 );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetAdaptivePollInterval>
+// The interval a value is polled at in adaptive mode, before the airtime budget
+//-----------------------------------------------------------------------------
+int32 Driver::GetAdaptivePollInterval
+(
+		PollEntry const& _entry,
+		Value const* _value
+)
+{
+	return (int32)( (int64)GetBasePollInterval( _value->GetPollIntensity() ) * _entry.m_scale / 100 );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::TakeAdaptivePoll>
+// Choose the value that is most overdue for a poll, and adapt its interval to
+// what the device reported since its last poll.  Returns false, with the time
+// to wait before looking again, if no value is due.
+//-----------------------------------------------------------------------------
+bool Driver::TakeAdaptivePoll
+(
+		ValueID* o_valueId,
+		int32* o_wait
+)
+{
+	// The interval of a value stays between a quarter and eight times the one set by its intensity
+	static uint32 const c_minScale = 25;
+	static uint32 const c_maxScale = 800;
+
 	LockGuard LG(m_nodeMutex);
-	Node* node = GetNode( nodeId );
-	if( node != NULL)
+	uint64 now = TimeStamp::GetMicroseconds();
+
+	// Work out the share of the airtime the polls would take at their current intervals.
+	// Each poll is reckoned to keep the network busy for the node's average response time.
+	double demand = 0.0;
+	for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
 	{
+		if( Value* value = GetValue( (*it).m_id ) )
+		{
+			Node* node = m_nodes[(*it).m_id.GetNodeId()];
+			int32 cost = ( node->m_averageResponseRTT != 0 ) ? (int32)node->m_averageResponseRTT : 100;
+			int32 interval = GetAdaptivePollInterval( *it, value );
+			demand += (double)cost / ( interval > 0 ? interval : 1 );
+			value->Release();
+		}
+	}
+	double budget = ( m_pollAirtimeBudget > 0 ) ? m_pollAirtimeBudget / 100.0 : 1.0;
+	m_pollBudgetFactor = ( demand > budget ) ? demand / budget : 1.0;
 
-		// See if the value is already in the poll list.
-		for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+	// A fresh report from the device counts as a poll
+	list<PollEntry>::iterator next = m_pollList.end();
+	int64 nextLate = 0;
+	int64 wait = 1000;
+	for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+	{
+		if( Value* value = GetValue( (*it).m_id ) )
 		{
-			if( (*it).m_id == _valueId )
+			uint64 last = ( value->m_reportTime > (*it).m_lastPoll ) ? value->m_reportTime : (*it).m_lastPoll;
+			int64 interval = (int64)( GetAdaptivePollInterval( *it, value ) * m_pollBudgetFactor );
+			int64 late = (int64)( now - last ) / 1000 - interval;
+			if( late >= 0 )
 			{
-				// Found it
-				if( bPolled )
-				{
-					m_pollMutex->Unlock();
-					return true;
-				}
-				else
+				if( next == m_pollList.end() || late > nextLate )
 				{
-					Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
+					next = it;
+					nextLate = late;
 				}
 			}
+			else if( -late < wait )
+			{
+				wait = -late;
+			}
+			value->Release();
 		}
+	}
 
-		// Not in the list
+	if( next == m_pollList.end() )
+	{
+		*o_wait = (int32)( wait > 10 ? wait : 10 );
+		return false;
+	}
 
-		if( !bPolled )
+	PollEntry& pe = *next;
+	if( Value* value = GetValue( pe.m_id ) )
+	{
+		// One report answers our last poll.  Any more were sent by the device on its own.
+		uint32 reports = value->m_reportCount - pe.m_reports;
+		uint32 changes = value->m_changeCount - pe.m_changes;
+		if( reports > ( pe.m_polled ? 1u : 0u ) )
 		{
-			m_pollMutex->Unlock();
-			return false;
+			pe.m_scale = c_maxScale;
 		}
-		else
+		else if( changes != 0 )
 		{
-			Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
+			pe.m_scale = ( pe.m_scale / 2 > c_minScale ) ? pe.m_scale / 2 : c_minScale;
+		}
+		else if( pe.m_polled )
+		{
+			pe.m_scale = ( pe.m_scale * 3 / 2 < c_maxScale ) ? pe.m_scale * 3 / 2 : c_maxScale;
 		}
-	}
-
-	// allow the poll thread to continue
-	m_pollMutex->Unlock();
-
-	Log::Write( LogLevel_Info, "isPolled failed - node %d not found (the value reported that it is%s polled)", nodeId, bPolled?"":" not" );
-	return false;
-}
 
-//-----------------------------------------------------------------------------
-// <Driver::SetPollIntensity>
-// Set the intensity with which this value is polled
-//-----------------------------------------------------------------------------
-void Driver::SetPollIntensity
-(
-		ValueID const &_valueId,
-		uint8 const _intensity
-)
-{
-	// make sure the polling thread doesn't lock the value while we're in this function
-	m_pollMutex->Lock();
+		pe.m_reports = value->m_reportCount;
+		pe.m_changes = value->m_changeCount;
+		pe.m_polled = true;
+		pe.m_lastPoll = now;
 
-	Value* value = GetValue( _valueId );
-	if (!value)
-		return;
-	value->SetPollIntensity( _intensity );
+		int32 interval = GetAdaptivePollInterval( pe, value );
+		Log::Write( LogLevel_Detail, pe.m_id.GetNodeId(), "Adaptive polling: next poll of this value in %d ms (%d ms within the airtime budget)", interval, (int32)( interval * m_pollBudgetFactor ) );
+		value->Release();
+	}
 
-	value->Release();
-	m_pollMutex->Unlock();
+	*o_valueId = pe.m_id;
+	return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -4236,40 +5840,74 @@ void Driver::PollThreadProc
 	{
 		int32 pollInterval = m_pollInterval;
 
+		// Verify the values of warm started nodes, one request at a time and only while the driver is idle
+		if( m_awakeNodesQueried
+				&& m_warmStartTimeStamp.TimeRemaining() <= 0
+				&& m_msgQueue[MsgQueue_Poll].empty()
+				&& m_msgQueue[MsgQueue_Send].empty()
+				&& m_msgQueue[MsgQueue_Query].empty()
+				&& m_currentMsg == NULL )
+		{
+			if( RefreshNextWarmStartValue() )
+			{
+				m_warmStartTimeStamp.SetTime( m_warmStartInterval );
+			}
+		}
+
 		if( m_awakeNodesQueried && !m_pollList.empty() )
 		{
 			// We only bother getting the lock if the pollList is not empty
 			m_pollMutex->Lock();
+			ValueID valueId;
 
-			// Get the next value to be polled
-			PollEntry pe = m_pollList.front();
-			m_pollList.pop_front();
-			ValueID  valueId = pe.m_id;
-
-			// only execute this poll if pe.m_pollCounter == 1; otherwise decrement the counter and process the next polled value
-			if( pe.m_pollCounter != 1)
+			if( m_adaptivePolling )
 			{
-				pe.m_pollCounter--;
-				m_pollList.push_back( pe );
-				m_pollMutex->Unlock();
-				continue;
+				// Each value has an interval of its own, so poll whichever is due
+				int32 wait;
+				if( !TakeAdaptivePoll( &valueId, &wait ) )
+				{
+					m_pollMutex->Unlock();
+					if( Wait::Single( _exitEvent, wait ) == 0 )
+					{
+						// Exit has been called
+						return;
+					}
+					continue;
+				}
+				pollInterval = 0;
 			}
-
-			// reset the poll counter to the full pollIntensity value and push it at the end of the list
-			// release the value object referenced; call GetNode to ensure the node objects are locked during this period
+			else
 			{
-				LockGuard LG(m_nodeMutex);
-				(void)GetNode( valueId.GetNodeId() );
-				Value* value = GetValue( valueId );
-				if (!value)
+				// Get the next value to be polled
+				PollEntry pe = m_pollList.front();
+				m_pollList.pop_front();
+				valueId = pe.m_id;
+
+				// only execute this poll if pe.m_pollCounter == 1; otherwise decrement the counter and process the next polled value
+				if( pe.m_pollCounter != 1)
+				{
+					pe.m_pollCounter--;
+					m_pollList.push_back( pe );
+					m_pollMutex->Unlock();
 					continue;
-				pe.m_pollCounter = value->GetPollIntensity();
-				m_pollList.push_back( pe );
-				value->Release();
+				}
+
+				// reset the poll counter to the full pollIntensity value and push it at the end of the list
+				// release the value object referenced; call GetNode to ensure the node objects are locked during this period
+				{
+					LockGuard LG(m_nodeMutex);
+					(void)GetNode( valueId.GetNodeId() );
+					Value* value = GetValue( valueId );
+					if (!value)
+						continue;
+					pe.m_pollCounter = value->GetPollIntensity();
+					m_pollList.push_back( pe );
+					value->Release();
+				}
 			}
 			// If the polling interval is for the whole poll list, calculate the time before the next poll,
 			// so that all polls can take place within the user-specified interval.
-			if( !m_bIntervalBetweenPolls )
+			if( !m_bIntervalBetweenPolls && !m_adaptivePolling )
 			{
 				if( pollInterval < 100 )
 				{
@@ -4365,6 +6003,159 @@ void Driver::PollThreadProc
 	}
 }
 
+//-----------------------------------------------------------------------------
+//	Warm start
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// <Driver::StartWarmStartRefresh>
+// Add the values of the warm started nodes to the background refresh list
+//-----------------------------------------------------------------------------
+void Driver::StartWarmStartRefresh
+(
+		list<uint8> const& _nodeIds
+)
+{
+	list<ValueID> values;
+	{
+		LockGuard LG(m_nodeMutex);
+		for( list<uint8>::const_iterator nit = _nodeIds.begin(); nit != _nodeIds.end(); ++nit )
+		{
+			Node* node = m_nodes[*nit];
+			if( node == NULL || *nit == m_Controller_nodeId )
+			{
+				continue;
+			}
+
+			if( !node->IsListeningDevice() && !node->IsFrequentListeningDevice() )
+			{
+				// Sleeping devices send their reports when they wake up
+				continue;
+			}
+
+			for( ValueStore::Iterator it = node->GetValueStore()->Begin(); it != node->GetValueStore()->End(); ++it )
+			{
+				Value* value = it->second;
+				if( value->GetID().GetGenre() == ValueID::ValueGenre_User && !value->IsWriteOnly() )
+				{
+					values.push_back( value->GetID() );
+				}
+			}
+		}
+	}
+
+	Log::Write( LogLevel_Info, "Warm start - %d nodes restored from the cache, %d values queued for background refresh", (int)_nodeIds.size(), (int)values.size() );
+
+	m_pollMutex->Lock();
+	m_warmStartList.splice( m_warmStartList.end(), values );
+	{
+		// Nodes with nothing to verify are done already
+		LockGuard LG(m_nodeMutex);
+		ClearWarmStartedNodes( m_warmStartList );
+	}
+	m_pollMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::RefreshNextWarmStartValue>
+// Request the next value still to be verified after a warm start, in the
+// order the values were queued.  Returns true if a request was sent.
+//-----------------------------------------------------------------------------
+bool Driver::RefreshNextWarmStartValue
+(
+)
+{
+	bool res = false;
+
+	m_pollMutex->Lock();
+	if( m_warmStartList.empty() )
+	{
+		m_pollMutex->Unlock();
+		return false;
+	}
+
+	{
+		LockGuard LG(m_nodeMutex);
+
+		// Drop the values that have been refreshed since the warm start, and find the first
+		// of the rest whose node can be asked now
+		list<ValueID>::iterator next = m_warmStartList.end();
+		list<ValueID>::iterator it = m_warmStartList.begin();
+		while( it != m_warmStartList.end() )
+		{
+			Node* node = m_nodes[it->GetNodeId()];
+			Value* value = GetValue( *it );
+			if( value == NULL || value->m_refreshTime >= m_warmStartTime )
+			{
+				// The value has gone, or the device has already reported it
+				if( value )
+				{
+					value->Release();
+				}
+				it = m_warmStartList.erase( it );
+				continue;
+			}
+			value->Release();
+
+			if( next == m_warmStartList.end() && node->IsNodeAlive() && node->GetCurrentQueryStage() == Node::QueryStage_Complete )
+			{
+				next = it;
+			}
+			++it;
+		}
+
+		if( next != m_warmStartList.end() )
+		{
+			ValueID valueId = *next;
+			m_warmStartList.erase( next );
+
+			Node* node = m_nodes[valueId.GetNodeId()];
+			if( CommandClass* cc = node->GetCommandClass( valueId.GetCommandClassId() ) )
+			{
+				Log::Write( LogLevel_Detail, valueId.GetNodeId(), "Warm start refresh: %s index = %d instance = %d (%d values remaining)", cc->GetCommandClassName().c_str(), valueId.GetIndex(), valueId.GetInstance(), (int)m_warmStartList.size() );
+				res = cc->RequestValue( 0, valueId.GetIndex(), valueId.GetInstance(), MsgQueue_Poll );
+			}
+		}
+
+		ClearWarmStartedNodes( m_warmStartList );
+		if( m_warmStartList.empty() )
+		{
+			Log::Write( LogLevel_Info, "Warm start refresh complete" );
+		}
+	}
+	m_pollMutex->Unlock();
+
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ClearWarmStartedNodes>
+// Mark the warm started nodes that have no values left in a refresh list as
+// verified.  The caller must hold m_nodeMutex.
+//-----------------------------------------------------------------------------
+void Driver::ClearWarmStartedNodes
+(
+		list<ValueID> const& _values
+)
+{
+	bool remaining[256];
+	memset( remaining, 0, sizeof(remaining) );
+	for( list<ValueID>::const_iterator it = _values.begin(); it != _values.end(); ++it )
+	{
+		remaining[it->GetNodeId()] = true;
+	}
+
+	for( int i=0; i<256; ++i )
+	{
+		Node* node = m_nodes[i];
+		if( node != NULL && node->m_warmStarted && !remaining[i] )
+		{
+			Log::Write( LogLevel_Detail, (uint8)i, "Warm start refresh of node complete" );
+			node->m_warmStarted = false;
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	Retrieving Node information
 //-----------------------------------------------------------------------------
@@ -4418,7 +6209,8 @@ void Driver::InitNode
 			QueueNotification( notification );
 		}
 
-		// Add the new node
+		// Add the new node, which has not been sent any nonces yet
+		memset( &m_nonceTables[_nodeId], 0, sizeof(NonceTable) );
 		m_nodes[_nodeId] = new Node( m_homeId, _nodeId );
 		if (newNode == true) static_cast<Node *>(m_nodes[_nodeId])->SetAddingNode();
 	}
@@ -5645,6 +7437,46 @@ bool Driver::CancelControllerCommand
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::RemoveControllerCommands>
+// Remove the queued controller commands that report to a callback.  The
+// command that is running is left to finish.
+//-----------------------------------------------------------------------------
+uint32 Driver::RemoveControllerCommands
+(
+		pfnControllerCallback_t _callback,
+		void* _context
+)
+{
+	uint32 removed = 0;
+
+	m_sendMutex->Lock();
+	list<MsgQueueItem>::iterator it = m_msgQueue[MsgQueue_Controller].begin();
+	while( it != m_msgQueue[MsgQueue_Controller].end() )
+	{
+		ControllerCommandItem* cci = it->m_cci;
+		if( MsgQueueCmd_Controller == it->m_command && cci != m_currentControllerCommand
+			&& cci->m_controllerCallback == _callback && cci->m_controllerCallbackContext == _context )
+		{
+			Log::Write( LogLevel_Detail, cci->m_controllerCommandNode, "Removing queued %s", c_controllerCommandNames[cci->m_controllerCommand] );
+			delete cci;
+			it = m_msgQueue[MsgQueue_Controller].erase( it );
+			++removed;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	if( m_msgQueue[MsgQueue_Controller].empty() )
+	{
+		m_queueEvent[MsgQueue_Controller]->Reset();
+	}
+	m_sendMutex->Unlock();
+
+	return removed;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::AddNodeStop>
 // Stop the Add Node mode based on API of controller
@@ -5949,6 +7781,7 @@ void Driver::QueueNotification
 		Notification* _notification
 )
 {
+	LockGuard LG( m_notificationsMutex );
 	m_notifications.push_back( _notification );
 	m_notificationsEvent->Set();
 }
@@ -5961,22 +7794,31 @@ void Driver::NotifyWatchers
 (
 )
 {
-	list<Notification*>::iterator nit = m_notifications.begin();
-	while( nit != m_notifications.end() )
+	// The watchers are called without the lock, so that they may use the Manager
+	m_notificationsMutex->Lock();
+	while( !m_notifications.empty() )
 	{
 		Notification* notification = m_notifications.front();
 		m_notifications.pop_front();
+		m_notificationsMutex->Unlock();
 
 		/* check the any ValueID's sent as part of the Notification are still valid */
 		switch (notification->GetType()) {
 			case Notification::Type_ValueChanged:
 			case Notification::Type_ValueRefreshed: {
-				Value *val = GetValue(notification->GetValueID());
-				if (!val) {
+				bool exists = false;
+				{
+					// The report worker threads change the nodes under the node mutex
+					LockGuard LG(m_nodeMutex);
+					if (Value *val = GetValue(notification->GetValueID())) {
+						exists = true;
+						val->Release();
+					}
+				}
+				if (!exists) {
 					Log::Write(LogLevel_Info, notification->GetNodeId(), "Dropping Notification as ValueID does not exist");
-					nit = m_notifications.begin();
 					delete notification;
-					val->Release();
+					m_notificationsMutex->Lock();
 					continue;
 				}
 				break;
@@ -5987,12 +7829,13 @@ void Driver::NotifyWatchers
 
 		Log::Write(LogLevel_Detail, notification->GetNodeId(), "Notification: %s", notification->GetAsString().c_str());
 
-		Manager::Get()->NotifyWatchers( notification );
+		Manager::Get()->NotifyWatchers( this, notification );
 
 		delete notification;
-		nit = m_notifications.begin();
+		m_notificationsMutex->Lock();
 	}
 	m_notificationsEvent->Reset();
+	m_notificationsMutex->Unlock();
 }
 
 //-----------------------------------------------------------------------------
@@ -6157,10 +8000,8 @@ void Driver::SendVirtualNodeInfo
 		uint8 const _ToNodeId
 )
 {
-	char str[80];
-
-	snprintf( str, sizeof(str), "Send Virtual Node Info from %d to %d", _FromNodeId, _ToNodeId );
-	Msg* msg = new Msg( str, 0xff, REQUEST, FUNC_ID_ZW_SEND_SLAVE_NODE_INFO, true );
+	Log::Write( LogLevel_Info, "Send Virtual Node Info from %d to %d", _FromNodeId, _ToNodeId );
+	Msg* msg = new Msg( "Send Virtual Node Info", 0xff, REQUEST, FUNC_ID_ZW_SEND_SLAVE_NODE_INFO, true );
 	msg->Append( _FromNodeId );		// from the virtual node
 	msg->Append( _ToNodeId );		// to the handheld controller
 	msg->Append( TRANSMIT_OPTION_ACK );
@@ -6577,14 +8418,19 @@ uint8 Driver::NodeFromMessage
 }
 //-----------------------------------------------------------------------------
 // <Driver::UpdateNodeRoutes>
-// Update a node's routing information
+// Update a node's routing information.  Returns the number of controller
+// commands queued.
 //-----------------------------------------------------------------------------
-void Driver::UpdateNodeRoutes
+uint32 Driver::UpdateNodeRoutes
 (
 		uint8 const _nodeId,
-		bool _doUpdate		// = false
+		bool _doUpdate,		// = false
+		pfnControllerCallback_t _callback,		// = NULL
+		void* _context		// = NULL
 )
 {
+	uint32 commands = 0;
+
 	// Only for routing slaves
 	Node* node = GetNodeUnsafe( _nodeId );
 	if( node != NULL && node->GetBasic() == 0x04 )
@@ -6628,15 +8474,17 @@ void Driver::UpdateNodeRoutes
 		if( _doUpdate || numNodes != node->m_numRouteNodes || memcmp( nodes, node->m_routeNodes, sizeof(node->m_routeNodes) ) != 0 )
 		{
 			// Figure out what to do if one of these fail.
-			BeginControllerCommand( ControllerCommand_DeleteAllReturnRoutes, NULL, NULL, true, _nodeId, 0 );
+			BeginControllerCommand( ControllerCommand_DeleteAllReturnRoutes, _callback, _context, true, _nodeId, 0 );
 			for( i = 0; i < numNodes; i++ )
 			{
-				BeginControllerCommand( ControllerCommand_AssignReturnRoute, NULL, NULL, true, _nodeId, nodes[i] );
+				BeginControllerCommand( ControllerCommand_AssignReturnRoute, _callback, _context, true, _nodeId, nodes[i] );
 			}
+			commands = numNodes + 1;
 			node->m_numRouteNodes = numNodes;
 			memcpy( node->m_routeNodes, nodes, sizeof(nodes) );
 		}
 	}
+	return commands;
 }
 
 //-----------------------------------------------------------------------------
@@ -6669,6 +8517,26 @@ void Driver::GetDriverStatistics
 	_data->m_routedbusy = m_routedbusy;
 	_data->m_broadcastReadCnt = m_broadcastReadCnt;
 	_data->m_broadcastWriteCnt = m_broadcastWriteCnt;
+	_data->m_timersExpired = m_timers->GetExpiredCount();
+	_data->m_timerSlackAvg = m_timers->GetAverageSlack();
+	_data->m_timerSlackMax = m_timers->GetMaxSlack();
+	_data->m_deadNodeDropped = m_deadNodeDropped;
+	_data->m_deadNodeProbes = m_deadNodeProbes;
+	_data->m_deadNodeHeld = m_deadNodeHeld;
+	_data->m_workerReports = m_reportDispatcher ? m_reportDispatcher->GetDecodedCount() : 0;
+	_data->m_duplicatesDropped = m_duplicatesDropped;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetHealStatistics>
+// Return the progress and cost of the current or last network heal
+//-----------------------------------------------------------------------------
+void Driver::GetHealStatistics
+(
+		HealData* _data
+)
+{
+	m_healScheduler->GetStatistics( _data );
 }
 
 //-----------------------------------------------------------------------------
@@ -6732,6 +8600,18 @@ void Driver::LogDriverStatistics
 	Log::Write( LogLevel_Always, "Out of frame data flow errors:  . . . . . . . . . . . . . %ld", data.m_OOFCnt );
 	Log::Write( LogLevel_Always, "Messages retransmitted: . . . . . . . . . . . . . . . . . %ld", data.m_retries );
 	Log::Write( LogLevel_Always, "Messages dropped and not delivered: . . . . . . . . . . . %ld", data.m_dropped );
+	Log::Write( LogLevel_Always, "Messages dropped as their node was presumed dead: . . . . %ld", data.m_deadNodeDropped );
+	Log::Write( LogLevel_Always, "Probes sent to nodes presumed dead: . . . . . . . . . . . %ld", data.m_deadNodeProbes );
+	Log::Write( LogLevel_Always, "Requests held while their node was presumed dead: . . . . %ld", data.m_deadNodeHeld );
+	Log::Write( LogLevel_Always, "Reports decoded by the report thread: . . . . . . . . . . %ld", data.m_workerReports );
+	Log::Write( LogLevel_Always, "Duplicate reports dropped:  . . . . . . . . . . . . . . . %ld", data.m_duplicatesDropped );
+	Log::Write( LogLevel_Always, "*** Serial API handlers (calls, total ms, max us)" );
+	list<SerialApiData> handlers;
+	GetSerialApiStatistics( &handlers );
+	for( list<SerialApiData>::iterator it = handlers.begin(); it != handlers.end(); ++it )
+	{
+		Log::Write( LogLevel_Always, "%s %-48s %8d %10d %8d", ( REQUEST == it->m_type ) ? "REQ" : "RES", it->m_name.c_str(), it->m_calls, (uint32)( it->m_totalTime / 1000 ), it->m_maxTime );
+	}
 	Log::Write( LogLevel_Always, "***************************************************************************" );
 }
 
@@ -6783,14 +8663,14 @@ bool Driver::SendEncryptedMessage() {
 	m_expectedCallbackId = m_currentMsg->GetCallbackId();
 	Log::Write(LogLevel_Info, m_currentMsg->GetTargetNodeId(), "Sending (%s) message (Callback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str());
 
-	m_controller->Write( buffer, length );
+	m_controller->Send( buffer, length );
 	m_currentMsg->clearNonce();
 
 	return true;
 }
 
 
-bool Driver::SendNonceRequest(string logmsg) {
+bool Driver::SendNonceRequest(char const* logmsg) {
 
 	uint8 m_buffer[11];
 
@@ -6814,9 +8694,9 @@ bool Driver::SendNonceRequest(string logmsg) {
 	{
 		m_buffer[10] ^= m_buffer[i];
 	}
-	Log::Write(LogLevel_Info, m_currentMsg->GetTargetNodeId(), "Sending (%s) message (Callback ID=0x%.2x, Expected Reply=0x%.2x) - Nonce_Get(%s) - %s:", c_sendQueueNames[m_currentMsgQueueSource], m_expectedCallbackId, m_expectedReply, logmsg.c_str(), PktToString(m_buffer, 10).c_str());
+	Log::Write(LogLevel_Info, m_currentMsg->GetTargetNodeId(), "Sending (%s) message (Callback ID=0x%.2x, Expected Reply=0x%.2x) - Nonce_Get(%s) - %s:", c_sendQueueNames[m_currentMsgQueueSource], m_expectedCallbackId, m_expectedReply, logmsg, PktToString(m_buffer, 10).c_str());
 
-	m_controller->Write(m_buffer, 11);
+	m_controller->Send(m_buffer, 11);
 
 	return true;
 }
@@ -6912,11 +8792,80 @@ void Driver::SendNonceKey(uint8 nodeId, uint8 *nonce) {
 	}
 	Log::Write(LogLevel_Info, nodeId, "Sending (%s) message (Callback ID=0x%.2x, Expected Reply=0x%.2x) - Nonce_Report - %s:", c_sendQueueNames[m_currentMsgQueueSource], m_buffer[17], m_expectedReply, PktToString(m_buffer, 19).c_str());
 
-	m_controller->Write(m_buffer, 19);
+	m_controller->Send(m_buffer, 19);
 
 	m_nonceReportSent = nodeId;
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::GenerateNonceKey>
+// Generate a NONCE key for a node
+//-----------------------------------------------------------------------------
+uint8 *Driver::GenerateNonceKey
+(
+		uint8 const _nodeId
+)
+{
+	NonceTable& table = m_nonceTables[_nodeId];
+	uint8 idx = table.m_last;
+
+	/* The first byte must be unique and non-zero.  The others are random.
+	   Per Numerical Recipes in C its best to use the high-order byte.  The
+	   floating point calculation here doesn't assume the size of the random
+	   integer, otherwise we could just shift the high byte over.
+	*/
+	uint8 match = 0;
+	do {
+		table.m_nonces[idx][0] = 1 + (uint8) (255.0 * rand() / (RAND_MAX + 1.0));
+		match = 0;
+		for (int i = 0; i < 8; i++) {
+			if (i == idx) {
+				continue;
+			}
+			if (table.m_nonces[idx][0] == table.m_nonces[i][0]) {
+				match = 1;
+			}
+		}
+	} while (match);
+
+	/* The other bytes have no restrictions. */
+	for (int i = 1; i < 8; i++) {
+		table.m_nonces[idx][i] = (int) (256.0 * rand() / (RAND_MAX + 1.0));
+	}
+
+	table.m_last++;
+	if (table.m_last >= 8)
+		table.m_last = 0;
+	for (uint8 i = 0; i < 8; i++) {
+		PrintHex("NONCES", (const uint8_t*)table.m_nonces[i], 8);
+	}
+	return &table.m_nonces[idx][0];
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetNonceKey>
+// Get the NONCE key of a node that matches the nonceid.
+//-----------------------------------------------------------------------------
+uint8 *Driver::GetNonceKey
+(
+		uint8 const _nodeId,
+		uint32 const _nonceId
+)
+{
+	NonceTable& table = m_nonceTables[_nodeId];
+	for (uint8 i = 0; i < 8; i++) {
+		/* make sure the nonceid matches the first byte of our stored Nonce */
+		if (_nonceId == table.m_nonces[i][0]) {
+			return &table.m_nonces[i][0];
+		}
+	}
+	Log::Write(LogLevel_Warning, _nodeId, "A Nonce with id %x does not exist", _nonceId);
+	for (uint8 i = 0; i < 8; i++) {
+		PrintHex("NONCES", (const uint8_t*)table.m_nonces[i], 8);
+	}
+	return NULL;
+}
+
 aes_encrypt_ctx *Driver::GetAuthKey
 (
 )
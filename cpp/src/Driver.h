@@ -39,6 +39,7 @@
 #include "platform/Event.h"
 #include "platform/Mutex.h"
 #include "platform/TimeStamp.h"
+#include "platform/TimerWheel.h"
 #include "aes/aescpp.h"
 
 namespace OpenZWave
@@ -51,6 +52,13 @@ namespace OpenZWave
 	class Thread;
 	class ControllerReplication;
 	class Notification;
+	class ConfigScheduler;
+	class HealScheduler;
+	class NetworkGraph;
+	class ReportDispatcher;
+	class SecurityDecryptor;
+	class SetValueTracker;
+	class ValueHistory;
 
 	/** \brief The Driver class handles communication between OpenZWave
 	 *  and a device attached via a serial port (typically a controller).
@@ -61,7 +69,13 @@ namespace OpenZWave
 		friend class Node;
 		friend class Group;
 		friend class CommandClass;
+		friend class ConfigScheduler;
+		friend class Configuration;
 		friend class ControllerReplication;
+		friend class HealScheduler;
+		friend class NetworkGraph;
+		friend class ReportDispatcher;
+		friend class SetValueTracker;
 		friend class Value;
 		friend class ValueStore;
 		friend class ValueButton;
@@ -84,7 +98,9 @@ namespace OpenZWave
 		{
 			ControllerInterface_Unknown = 0,
 			ControllerInterface_Serial,
-			ControllerInterface_Hid
+			ControllerInterface_Hid,
+			ControllerInterface_Simulated,
+			ControllerInterface_Replay
 		};
 
 	//-----------------------------------------------------------------------------
@@ -143,6 +159,12 @@ namespace OpenZWave
 		 */
 		bool Init( uint32 _attempts );
 
+		/**
+		 * Name of the capture file for this controller, made by adding the
+		 * controller name to the CaptureFile option value.
+		 */
+		string GetCaptureFileName( string const& _captureFile )const;
+
 		/**
 		 * Remove any messages to a node on the queues
 		 * Used when deleting a node.
@@ -275,7 +297,10 @@ namespace OpenZWave
 	//-----------------------------------------------------------------------------
 	private:
 		bool ReadMsg();
-		void ProcessMsg( uint8* _data );
+		void ProcessMsg( uint8* _data, uint8 const _length );
+		void ProcessDecryptedMsgs();
+		void DrainDecryptedMsgs( uint8 const _nodeId );
+		void DispatchMsg( uint8* _data, uint8 const _length, bool const _encrypted );
 
 		void HandleGetVersionResponse( uint8* _data );
 		void HandleGetRandomResponse( uint8* _data );
@@ -319,6 +344,7 @@ namespace OpenZWave
 		void HandleReplaceFailedNodeRequest( uint8* _data );
 		void HandleRemoveNodeFromNetworkRequest( uint8* _data );
 		void HandleApplicationCommandHandlerRequest( uint8* _data, bool encrypted );
+		bool IsDuplicateReport( Node* _node, uint8 const* _data, bool const _encrypted );
 		void HandlePromiscuousApplicationCommandHandlerRequest( uint8* _data );
 		void HandleAssignReturnRouteRequest( uint8* _data );
 		void HandleDeleteReturnRouteRequest( uint8* _data );
@@ -344,6 +370,72 @@ namespace OpenZWave
 		uint8					m_expectedReply;							// If non-zero, we wait for a message with this function Id
 		uint8					m_expectedCommandClassId;					// If the expected reply is FUNC_ID_APPLICATION_COMMAND_HANDLER, this value stores the command class we're waiting to hear from
 		uint8					m_expectedNodeId;							// If we are waiting for a FUNC_ID_APPLICATION_COMMAND_HANDLER, make sure we only accept it from this node.
+		uint32					m_duplicateWindow[256];						// Per command class, the time in ms within which a node's repeat of a command is dropped
+
+	//-----------------------------------------------------------------------------
+	//	Serial API message dispatch
+	//-----------------------------------------------------------------------------
+	public:
+		/**
+		 * Handler for a Serial API function that the driver does not handle itself.
+		 * It is called on the driver thread with the frame from its type byte (REQUEST
+		 * or RESPONSE) up to the checksum, which is not included.
+		 * \return True to let the frame complete the transaction waiting for it, as the
+		 * driver's own handlers do.
+		 * \see Manager::AddSerialApiHandler
+		 */
+		typedef bool (*pfnSerialApiHandler_t)( uint32 const _homeId, uint8 const* _data, uint32 const _length, void* _context );
+
+		struct SerialApiData
+		{
+			uint8 m_type;				// REQUEST or RESPONSE
+			uint8 m_function;			// Serial API function ID
+			string m_name;
+			bool m_external;			// Handled by an application's handler
+			uint32 m_calls;				// Number of frames handled
+			uint64 m_totalTime;			// Time spent handling them, in microseconds
+			uint32 m_maxTime;			// Longest time spent on one frame, in microseconds
+		};
+
+	private:
+		typedef bool (Driver::*pfnMsgHandler_t)( uint8* _data, bool _encrypted );	// Returns false to skip the generic transaction handling
+
+		struct MsgHandler
+		{
+			pfnMsgHandler_t			m_handler;
+			pfnSerialApiHandler_t	m_external;
+			void*					m_context;
+			char const*				m_name;
+			bool					m_spacer;						// Separate the frame's log output with a blank line
+			uint32					m_calls;
+			uint64					m_totalTime;					// Microseconds
+			uint32					m_maxTime;						// Microseconds
+		};
+
+		void InitMsgHandlers();
+		void RegisterMsgHandler( uint8 const _type, uint8 const _function, char const* _name, pfnMsgHandler_t _handler, bool const _spacer = true );
+		bool AddSerialApiHandler( uint8 const _type, uint8 const _function, pfnSerialApiHandler_t _handler, void* _context );
+		bool RemoveSerialApiHandler( uint8 const _type, uint8 const _function );
+		void GetSerialApiStatistics( list<SerialApiData>* _data );
+
+		// Adapters from the Handle methods to the dispatch table
+		template<void (Driver::*_handler)( uint8* )> bool CallMsgHandler( uint8* _data, bool _encrypted );
+		template<bool (Driver::*_handler)( uint8* )> bool CallTransactionHandler( uint8* _data, bool _encrypted );
+		template<bool (Driver::*_handler)( uint8* )> bool CallStatusHandler( uint8* _data, bool _encrypted );
+
+		// Handlers that do more than call a Handle method
+		bool OnSendDataResponse( uint8* _data, bool _encrypted );
+		bool OnReplicationSendDataResponse( uint8* _data, bool _encrypted );
+		bool OnRequestNodeInfoResponse( uint8* _data, bool _encrypted );
+		bool OnApplicationCommandHandlerRequest( uint8* _data, bool _encrypted );
+		bool OnSendDataRequest( uint8* _data, bool _encrypted );
+		bool OnReplicationSendDataRequest( uint8* _data, bool _encrypted );
+		bool OnReplicationCommandCompleteRequest( uint8* _data, bool _encrypted );
+		bool OnApplicationUpdateRequest( uint8* _data, bool _encrypted );
+
+		MsgHandler				m_msgHandlers[2][256];						// Indexed by message type (REQUEST or RESPONSE) and function ID
+		Mutex*					m_msgHandlerMutex;							// Guards the application handlers, and the statistics of every handler
+		Mutex*					m_externalCallMutex;						// Held while an application's handler runs, so that RemoveSerialApiHandler can wait for it
 
 	//-----------------------------------------------------------------------------
 	//	Polling Z-Wave devices
@@ -355,6 +447,7 @@ namespace OpenZWave
 		bool DisablePoll( const ValueID &_valueId );
 		bool isPolled( const ValueID &_valueId );
 		void SetPollIntensity( const ValueID &_valueId, uint8 _intensity );
+		bool GetPollIntervals( ValueID const& _valueId, int32* o_interval, int32* o_effective );
 		static void PollThreadEntryPoint( Event* _exitEvent, void* _context );
 		void PollThreadProc( Event* _exitEvent );
 
@@ -363,6 +456,11 @@ namespace OpenZWave
 		{
 			ValueID	m_id;
 			uint8	m_pollCounter;
+			uint32	m_scale;			// Adaptive polling: the value's interval, as a percentage of the one set by its poll intensity
+			uint32	m_reports;			// The value's report and change counts when it was last polled
+			uint32	m_changes;
+			bool	m_polled;			// Whether the value has been polled since the counts were taken
+			uint64	m_lastPoll;			// TimeStamp::GetMicroseconds at the last poll
 		};
 OPENZWAVE_EXPORT_WARNINGS_OFF
 		list<PollEntry>			m_pollList;									// List of nodes that need to be polled
@@ -371,6 +469,33 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		int32					m_pollInterval;								// Time interval during which all nodes must be polled
 		bool					m_bIntervalBetweenPolls;					// if true, the library intersperses m_pollInterval between polls; if false, the library attempts to complete all polls within m_pollInterval
 
+		// Adaptive polling.  Each value is polled more often while polls find it changing, less
+		// often while they do not, and rarely once it reports changes itself.  The intervals are
+		// stretched together whenever the polls would take more than the airtime budget.
+		int32 GetBasePollInterval( uint8 const _intensity );
+		int32 GetAdaptivePollInterval( PollEntry const& _entry, Value const* _value );
+		bool TakeAdaptivePoll( ValueID* o_valueId, int32* o_wait );		// Caller must hold m_pollMutex
+
+		bool					m_adaptivePolling;
+		int32					m_pollAirtimeBudget;						// Percentage of the time the polls may keep the network busy
+		double					m_pollBudgetFactor;							// Stretch applied to every adaptive interval to stay within the budget
+
+	//-----------------------------------------------------------------------------
+	//	Warm start
+	//-----------------------------------------------------------------------------
+	private:
+		void StartWarmStartRefresh( list<uint8> const& _nodeIds );
+		bool RefreshNextWarmStartValue();
+		void ClearWarmStartedNodes( list<ValueID> const& _values );
+
+		bool					m_warmStart;								// if true, nodes that were completely queried last time are used straight from the cache
+		int32					m_warmStartInterval;						// Minimum time in milliseconds between background refresh requests for warm started nodes
+		time_t					m_warmStartTime;							// Time of the warm start.  Values refreshed since then no longer need verifying
+		TimeStamp				m_warmStartTimeStamp;						// Earliest time at which the next background refresh request may be sent
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		list<ValueID>			m_warmStartList;							// Values of warm started nodes still to be verified (protected by m_pollMutex)
+OPENZWAVE_EXPORT_WARNINGS_ON
+
 	//-----------------------------------------------------------------------------
 	//	Retrieving Node information
 	//-----------------------------------------------------------------------------
@@ -554,7 +679,8 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 
 		uint8					m_SUCNodeId;
 
-		void UpdateNodeRoutes( uint8 const_nodeId, bool _doUpdate = false );
+		uint32 UpdateNodeRoutes( uint8 const _nodeId, bool _doUpdate = false, pfnControllerCallback_t _callback = NULL, void* _context = NULL );
+		uint32 RemoveControllerCommands( pfnControllerCallback_t _callback, void* _context );
 
 		Event*					m_controllerResetEvent;
 
@@ -606,6 +732,10 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		bool MoveMessagesToWakeUpQueue(	uint8 const _targetNodeId, bool const _move );		// If a node does not respond, and is of a type that can sleep, this method is used to move all its pending messages to another queue ready for when it wakes up next.
 		bool HandleErrorResponse( uint8 const _error, uint8 const _nodeId, char const* _funcStr, bool _sleepCheck = false );									    // Handle data errors and process consistently. If message is moved to wake-up queue, return true.
 		bool IsExpectedReply( uint8 const _nodeId );						// Determine if reply message is the one we are expecting
+		int32 GetRetryTimeout( uint8 const _nodeId );						// How long to wait for a node to complete a transaction
+		void UpdateRetryTimeout( Node* _node, int32 const _rtt );			// Feed a measured transaction round trip time into the node's retry timeout
+		void BackoffRetryTimeout( uint8 const _nodeId );					// Double the node's retry timeout after a failed attempt
+		void CalculateRetryTimeout( Node* _node );
 		void SendQueryStageComplete( uint8 const _nodeId, Node::QueryStage const _stage );
 		void RetryQueryStageComplete( uint8 const _nodeId, Node::QueryStage const _stage );
 		void CheckCompletedNodeQueries();									// Send notifications if all awake and/or sleeping nodes have completed their queries
@@ -699,6 +829,112 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		Msg*					m_currentMsg;
 		MsgQueue				m_currentMsgQueueSource;			// identifies which queue held m_currentMsg
 		TimeStamp				m_resendTimeStamp;
+		int32					m_currentMsgTimeout;				// Retry timeout of m_currentMsg, in milliseconds
+		int32					m_retryTimeout;						// RetryTimeout option, used until a node's round trip time is known
+		bool					m_adaptiveRetryTimeout;				// Estimate each node's retry timeout from its round trip times
+		int32					m_retryTimeoutMin;
+		int32					m_retryTimeoutMax;					// Cap on the estimated and backed off retry timeouts
+
+		static void RetryTimerCallback( void* _context );
+		void ResendCurrentMsg();											// Resend the current message after its timeout, or drop it
+
+		TimerWheel*				m_timers;							// Timeouts run by the driver thread
+		TimerWheel::Timer		m_retryTimer;						// Expires when the current message has waited m_currentMsgTimeout
+
+	//-----------------------------------------------------------------------------
+	// Outstanding report transactions
+	//-----------------------------------------------------------------------------
+	private:
+		struct HeldItem
+		{
+			MsgQueue			m_queue;							// Queue the item was taken from
+			MsgQueueItem		m_item;
+		};
+
+		/**
+		 * A request whose FUNC_ID_ZW_SEND_DATA callback has been received, but whose report
+		 * has not.  While it waits, the transmit slot is released for requests to other nodes.
+		 * Later queue items for the same node are held back, so that the node still receives
+		 * them in order, and only after it has answered.
+		 */
+		struct PendingReport
+		{
+			Msg*				m_msg;
+			MsgQueue			m_queue;							// Queue the message was taken from, so that a retry goes back to it
+			uint8				m_nodeId;
+			uint8				m_commandClassId;
+			uint8				m_instance;							// Instance or endpoint of an encapsulated report, otherwise zero
+			TimerWheel::Timer	m_timer;							// Expires when the node has taken too long to answer
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			list<HeldItem>		m_held;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		};
+
+		bool ParkCurrentMsg();												// Move the current message to the pending reports and release the transmit slot
+		PendingReport* FindPendingReport( uint8 const _nodeId );			// The caller must hold m_sendMutex
+		bool GetPendingReport( uint8 const _nodeId, uint8* o_commandClassId = NULL, uint8* o_sendAttempts = NULL );	// Copies details of a node's pending report, if it has one
+		void CompletePendingReport( uint8 const* _data );					// Complete the pending report that _data answers, if any
+		static void PendingReportTimerCallback( void* _context );
+		void ExpirePendingReports();										// Requeue the requests whose report has timed out
+		void ReleasePendingReport( PendingReport* _pending, bool const _retry );
+		void RemovePendingReport( uint8 const _nodeId );
+
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		list<PendingReport*>	m_pendingReports;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		int32					m_maxPendingReports;				// Maximum number of nodes that may have a report outstanding at once
+
+	//-----------------------------------------------------------------------------
+	// Dead node circuit breaker
+	//-----------------------------------------------------------------------------
+	private:
+		/**
+		 * Each node has a circuit breaker.  The circuit is closed while the node answers.
+		 * It opens when the node is presumed dead.  The node's messages on the send and poll
+		 * queues, and any sent to them while the circuit is open, then leave the queues straight
+		 * away, rather than each using up its attempts and timeouts while the other nodes wait.
+		 * Requests for reports, and polls, are held on the circuit, keeping only the latest copy
+		 * of each, and go back on their queues when the circuit closes.  Everything else, such
+		 * as a Set, fails, so that a device is never switched long after the fact.  The failures
+		 * are counted, and reported with a single Code_Dropped notification each time the
+		 * circuit opens.  The node is probed with a NoOperation frame, at intervals that double
+		 * from DeadNodeProbeInterval up to DeadNodeProbeIntervalMax.  While a probe is outstanding
+		 * the circuit is half open.  When the node answers anything, the circuit closes.
+		 */
+		enum CircuitState
+		{
+			CircuitState_Closed = 0,
+			CircuitState_Open,
+			CircuitState_HalfOpen
+		};
+
+		struct Circuit
+		{
+			Driver*				m_driver;
+			uint8				m_nodeId;
+			CircuitState		m_state;
+			int32				m_probeInterval;					// Milliseconds until the next probe
+			TimerWheel::Timer	m_probeTimer;
+			bool				m_dropNotified;						// Code_Dropped has been sent since the circuit opened
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			list<HeldItem>		m_held;								// Requests and polls waiting for the node to answer
+OPENZWAVE_EXPORT_WARNINGS_ON
+		};
+
+		void OpenCircuit( uint8 const _nodeId );							// The node is presumed dead
+		void CloseCircuit( uint8 const _nodeId );							// The node has answered
+		void ProbeFailed( uint8 const _nodeId );
+		bool DivertForDeadNode( MsgQueue const _queue, MsgQueueItem const& _item );	// Caller must hold m_sendMutex
+		void RemoveCircuit( uint8 const _nodeId );
+		static void ProbeTimerCallback( void* _context );
+		void ProbeDeadNode( Circuit* _circuit );
+
+		Circuit*				m_circuits[256];
+		int32					m_deadNodeProbeInterval;
+		int32					m_deadNodeProbeIntervalMax;
+		uint32					m_deadNodeDropped;					// Messages failed without being sent, as their node was presumed dead
+		uint32					m_deadNodeHeld;						// Messages held until their node answered
+		uint32					m_deadNodeProbes;					// Probes sent to dead nodes
 
 	//-----------------------------------------------------------------------------
 	// Network functions
@@ -742,6 +978,141 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		bool SetConfigParam( uint8 const _nodeId, uint8 const _param, int32 _value, uint8 const _size );
 		void RequestConfigParam( uint8 const _nodeId, uint8 const _param );
 
+	public:
+		/**
+		 * Results of the items in a batch of configuration parameter reads and writes.
+		 * \see Manager::ConfigureParams
+		 */
+		enum ConfigParamResult
+		{
+			ConfigParamResult_Pending = 0,			/**< The batch has not finished with the item. */
+			ConfigParamResult_Success,				/**< The parameter was read, or was written and reads back with the value written. */
+			ConfigParamResult_Rejected,				/**< The parameter was written, but the device reports a different value. */
+			ConfigParamResult_Unverified,			/**< The parameter was written, but the device cannot report it back. */
+			ConfigParamResult_TimedOut,				/**< The device did not report the parameter in time. */
+			ConfigParamResult_Unsupported			/**< The node does not exist or does not support COMMAND_CLASS_CONFIGURATION, or the size is not 1, 2 or 4. */
+		};
+
+		struct ConfigParamItem
+		{
+			uint8 m_nodeId;
+			uint8 m_param;
+			bool m_write;				// Write m_value to the parameter, rather than reading it
+			int32 m_value;				// Value to write.  Once the item has a result, the value the device reported.
+			uint8 m_size;				// Bytes in the value written: 1, 2 or 4, or 0 for the size of the parameter's existing value.  Once the item has a result, the size the device reported.
+			ConfigParamResult m_result;
+		};
+
+	private:
+		ConfigScheduler*		m_configScheduler;
+		ReportDispatcher*		m_reportDispatcher;							// Decodes reports on the report thread, or NULL to decode them on the driver thread
+
+	//-----------------------------------------------------------------------------
+	// Asynchronous value changes
+	//-----------------------------------------------------------------------------
+	public:
+		/**
+		 * Outcomes of the value changes started by Manager::SetValueAsync.
+		 */
+		enum SetValueResult
+		{
+			SetValueResult_Confirmed = 0,			/**< The device acknowledged the message, then reported the value requested. */
+			SetValueResult_Sent,					/**< The device acknowledged the message.  The value is write-only, so it is not reported back. */
+			SetValueResult_Mismatch,				/**< The device acknowledged the message, but reported a different value until the timeout. */
+			SetValueResult_TimedOut,				/**< The message was not sent, or the value was not reported, before the timeout. */
+			SetValueResult_Failed					/**< The message was dropped, the device did not acknowledge it, or the node was removed. */
+		};
+
+		/**
+		 * The outcome of a value change, passed to its completion callback.
+		 * Times are in milliseconds from the call to Manager::SetValueAsync.
+		 */
+		struct SetValueStatus
+		{
+			SetValueStatus( ValueID const& _id ): m_requestId( 0 ), m_id( _id ), m_result( SetValueResult_Failed ), m_transmitTime( 0 ), m_completeTime( 0 ){}
+
+			uint32 m_requestId;			// ID returned by Manager::SetValueAsync
+			ValueID m_id;
+			SetValueResult m_result;
+			string m_requested;			// The value requested, as returned by Manager::GetValueAsString
+			string m_reported;			// The last value the device reported after acknowledging the message, or empty if none
+			uint32 m_transmitTime;		// Until the device acknowledged the message, or 0 if it did not
+			uint32 m_completeTime;		// Until the outcome was known
+		};
+
+		typedef void (*pfnOnSetValueComplete_t)( SetValueStatus const& _status, void* _context );
+
+	private:
+		SetValueTracker*		m_setValueTracker;
+		uint32					m_setValueCapture;							// Request whose message is being queued.  Guarded by m_nodeMutex.
+
+	//-----------------------------------------------------------------------------
+	// Value history
+	//-----------------------------------------------------------------------------
+	public:
+		/**
+		 * A report of a value, as kept by the value history.
+		 */
+		struct ValueHistorySample
+		{
+			uint32	m_time;				// Seconds since the epoch
+			double	m_value;			// Exact for every integer value
+		};
+
+		/**
+		 * The reports of a value in one period of a value history tier.
+		 */
+		struct ValueHistorySummary
+		{
+			uint32	m_time;				// Start of the period, in seconds since the epoch
+			uint32	m_count;			// Number of reports
+			double	m_min;
+			double	m_max;
+			double	m_avg;
+		};
+
+	private:
+		ValueHistory*			m_valueHistory;								// NULL unless the ValueHistory option is set
+
+	//-----------------------------------------------------------------------------
+	// Combining requests with MultiCmd
+	//-----------------------------------------------------------------------------
+	private:
+		// Between BeginMultiCmd and EndMultiCmd, the single command requests and the commands
+		// queued for a node that supports COMMAND_CLASS_MULTI_CMD are collected and sent in as
+		// few MultiCmd encapsulated frames as they fit in.  The node mutex is held in between.
+		void BeginMultiCmd( uint8 const _nodeId );
+		void EndMultiCmd();
+		bool CollectMultiCmd( Node* _node, Msg* _msg, MsgQueue const _queue );	// Caller must hold m_nodeMutex
+		void FlushMultiCmd();													// Caller must hold m_nodeMutex
+		void SendMultiCmd( vector<Msg*> const& _msgs, uint32 const _first, uint32 const _count );
+
+		bool					m_multiCmdRequests;							// Whether requests are combined at all
+		uint8					m_multiCmdNodeId;							// Node whose requests are being collected, or 0
+		uint32					m_multiCmdDepth;
+		MsgQueue				m_multiCmdQueue;
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		vector<Msg*>			m_multiCmdMsgs;
+OPENZWAVE_EXPORT_WARNINGS_ON
+
+		// Calls EndMultiCmd on leaving scope, so that an exception cannot leave the node mutex held
+		struct MultiCmdGuard
+		{
+				MultiCmdGuard( Driver* _driver, uint8 const _nodeId ) : m_driver( _driver )
+				{
+					m_driver->BeginMultiCmd( _nodeId );
+				}
+
+				~MultiCmdGuard()
+				{
+					m_driver->EndMultiCmd();
+				}
+			private:
+				MultiCmdGuard( MultiCmdGuard const& );
+				MultiCmdGuard& operator=( MultiCmdGuard const& );
+				Driver* m_driver;
+		};
+
 	//-----------------------------------------------------------------------------
 	// Groups (wrappers for the Node methods)
 	//-----------------------------------------------------------------------------
@@ -766,6 +1137,7 @@ OPENZWAVE_EXPORT_WARNINGS_OFF
 		list<Notification*>		m_notifications;
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Event*				m_notificationsEvent;
+		Mutex*				m_notificationsMutex;							// Notifications are queued by the report thread as well as the driver thread
 
 	//-----------------------------------------------------------------------------
 	//	Statistics
@@ -794,6 +1166,14 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 			uint32 m_routedbusy;		// Number of messages received with routed busy status
 			uint32 m_broadcastReadCnt;	// Number of broadcasts read
 			uint32 m_broadcastWriteCnt;	// Number of broadcasts sent
+			uint32 m_timersExpired;		// Number of driver timeouts that have expired
+			uint32 m_timerSlackAvg;		// Average delay between a timeout expiring and being handled, in microseconds
+			uint32 m_timerSlackMax;		// Longest delay between a timeout expiring and being handled, in microseconds
+			uint32 m_deadNodeDropped;	// Number of messages failed without being sent, as their node was presumed dead
+			uint32 m_deadNodeProbes;	// Number of probes sent to nodes presumed dead
+			uint32 m_deadNodeHeld;		// Number of requests and polls held until their node answered
+			uint32 m_workerReports;		// Number of reports decoded by the report thread
+			uint32 m_duplicatesDropped;	// Number of duplicate reports dropped before they were decoded
 		};
 
 		void LogDriverStatistics();
@@ -823,10 +1203,56 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		uint32 m_routedbusy;		// Number of messages received with routed busy status
 		uint32 m_broadcastReadCnt;	// Number of broadcasts read
 		uint32 m_broadcastWriteCnt;	// Number of broadcasts sent
+		uint32 m_duplicatesDropped;	// Number of duplicate reports dropped
 		//time_t m_commandStart;	// Start time of last command
 		//time_t m_timeoutLost;		// Cumulative time lost to timeouts
 
 
+	//-----------------------------------------------------------------------------
+	//	Network topology
+	//-----------------------------------------------------------------------------
+	private:
+		NetworkGraph*			m_networkGraph;				// Neighbor lists of all the nodes, and what they imply about routing
+
+	//-----------------------------------------------------------------------------
+	//	Network healing
+	//-----------------------------------------------------------------------------
+	public:
+		/**
+		 * Heal Events.
+		 * Reported in Notification::Type_HealProgress notifications.
+		 * \see Manager::HealNetwork
+		 */
+		enum HealEvent
+		{
+			HealEvent_NodeHealed = 0,				/**< The node has rediscovered its neighbors, and its return routes have been updated if requested. */
+			HealEvent_NodeFailed,					/**< A controller command to heal the node failed. */
+			HealEvent_NodeTimedOut,					/**< The node was not healed within the time allowed. */
+			HealEvent_NodeSkipped,					/**< The node sleeps, or the heal was cancelled or ran out of time before the node was healed. */
+			HealEvent_Completed						/**< The heal has finished.  The notification's node ID is zero. */
+		};
+
+		struct HealData
+		{
+			bool m_running;				// A heal is in progress
+			uint32 m_passes;			// Number of heals started
+			uint32 m_nodesPlanned;		// Number of nodes in the current or last heal
+			uint32 m_nodesHealed;		// Number of nodes healed
+			uint32 m_nodesFailed;		// Number of nodes whose controller commands failed
+			uint32 m_nodesTimedOut;		// Number of nodes given up on
+			uint32 m_nodesSkipped;		// Number of sleeping nodes, and nodes not reached
+			uint32 m_nodesRemaining;	// Number of nodes not yet started
+			uint8 m_maxHops;			// Hops from the controller to the farthest node in the heal
+			uint32 m_commandsSent;		// Number of controller commands queued by the heal
+			uint32 m_framesSent;		// Number of messages sent to the controller while the heal ran
+			uint32 m_elapsed;			// Milliseconds the heal ran for
+		};
+
+		void GetHealStatistics( HealData* _data );
+
+	private:
+		HealScheduler*			m_healScheduler;
+
 	//-----------------------------------------------------------------------------
 	//	Security Command Class Related (Version 1.1)
 	//-----------------------------------------------------------------------------
@@ -839,14 +1265,26 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		bool initNetworkKeys(bool newnode);
 		uint8 *GetNetworkKey();
 		bool SendEncryptedMessage();
-		bool SendNonceRequest(string logmsg);
+		bool SendNonceRequest(char const* logmsg);
 		void SendNonceKey(uint8 nodeId, uint8 *nonce);
+		uint8 *GenerateNonceKey(uint8 const _nodeId);
+		uint8 *GetNonceKey(uint8 const _nodeId, uint32 const _nonceId);
 		aes_encrypt_ctx *AuthKey;
 		aes_encrypt_ctx *EncryptKey;
 		uint8 m_nonceReportSent;
 		uint8 m_nonceReportSentAttempt;
 		bool m_inclusionkeySet;
 
+		// The nonces handed out to each node, kept apart from the nodes so that they can
+		// be looked up without the node mutex.  Only the driver thread uses them.
+		struct NonceTable
+		{
+			uint8 m_last;
+			uint8 m_nonces[8][8];
+		};
+		NonceTable m_nonceTables[256];
+		SecurityDecryptor* m_securityDecryptor;					// Decrypts secured frames on worker threads, or NULL to decrypt them on the driver thread
+
 	};
 
 } // namespace OpenZWave
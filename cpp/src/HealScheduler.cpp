@@ -0,0 +1,682 @@
+//-----------------------------------------------------------------------------
+//
+//	HealScheduler.cpp
+//
+//	Heals the nodes of a Z-Wave network in order of their distance from the
+//	controller
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "Node.h"
+#include "NetworkGraph.h"
+#include "Options.h"
+#include "Notification.h"
+#include "Utils.h"
+#include "HealScheduler.h"
+#include "platform/Mutex.h"
+#include "platform/Log.h"
+#include "platform/TimeStamp.h"
+
+using namespace OpenZWave;
+
+// A node's routes have degraded when this percentage of the messages sent to it
+// since it was last healed failed or needed a retry...
+static uint32 const c_degradedFailurePercent = 10;
+static uint32 const c_degradedMinMessages = 10;
+
+// ...or its average round trip time has grown by this factor
+static uint32 const c_degradedRTTFactor = 2;
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::HealScheduler>
+//	Constructor
+//-----------------------------------------------------------------------------
+HealScheduler::HealScheduler
+(
+	Driver* _driver
+):
+	m_driver( _driver ),
+	m_mutex( new Mutex() ),
+	m_next( 0 ),
+	m_active( 0 ),
+	m_running( false ),
+	m_doRR( false ),
+	m_concurrency( 1 ),
+	m_nodeTimeout( 60000 ),
+	m_timeBudget( 0 ),
+	m_passes( 0 ),
+	m_nodesHealed( 0 ),
+	m_nodesFailed( 0 ),
+	m_nodesTimedOut( 0 ),
+	m_nodesSkipped( 0 ),
+	m_maxHops( 0 ),
+	m_commandsSent( 0 ),
+	m_startWriteCnt( 0 ),
+	m_endWriteCnt( 0 ),
+	m_startTime( 0 ),
+	m_endTime( 0 )
+{
+	for( int32 i=0; i<256; ++i )
+	{
+		HealNode& healNode = m_nodes[i];
+		healNode.m_owner = this;
+		healNode.m_nodeId = (uint8)i;
+		healNode.m_hops = 0xff;
+		healNode.m_step = HealStep_Idle;
+		healNode.m_outstanding = 0;
+		healNode.m_ignore = 0;
+		healNode.m_failed = false;
+		healNode.m_started = 0;
+		healNode.m_sentCnt = 0;
+		healNode.m_sentFailed = 0;
+		healNode.m_retries = 0;
+		healNode.m_averageRTT = 0;
+	}
+
+	Options::Get()->GetOptionAsInt( "HealConcurrency", &m_concurrency );
+	Options::Get()->GetOptionAsInt( "HealNodeTimeout", &m_nodeTimeout );
+	Options::Get()->GetOptionAsInt( "HealTimeBudget", &m_timeBudget );
+	if( m_concurrency < 1 )
+	{
+		m_concurrency = 1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::~HealScheduler>
+//	Destructor.  The driver thread must have stopped.
+//-----------------------------------------------------------------------------
+HealScheduler::~HealScheduler
+(
+)
+{
+	for( int32 i=0; i<256; ++i )
+	{
+		m_driver->m_timers->Cancel( &m_nodes[i].m_timer );
+	}
+	m_driver->m_timers->Cancel( &m_budgetTimer );
+	m_driver->m_timers->Cancel( &m_notifyTimer );
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::Start>
+//	Start healing the network
+//-----------------------------------------------------------------------------
+bool HealScheduler::Start
+(
+	bool const _doRR,
+	bool const _degradedOnly
+)
+{
+	LockGuard LG( m_driver->m_nodeMutex );
+	m_mutex->Lock();
+	if( m_running )
+	{
+		m_mutex->Unlock();
+		Log::Write( LogLevel_Warning, "Heal: a heal is already in progress" );
+		return false;
+	}
+
+	m_doRR = _doRR;
+	m_nodesHealed = 0;
+	m_nodesFailed = 0;
+	m_nodesTimedOut = 0;
+	m_nodesSkipped = 0;
+	m_commandsSent = 0;
+	BuildPlan( _degradedOnly );
+	if( m_plan.empty() )
+	{
+		m_mutex->Unlock();
+		Log::Write( LogLevel_Info, "Heal: no nodes %s", _degradedOnly ? "have degraded routes" : "to heal" );
+		return false;
+	}
+
+	++m_passes;
+	m_running = true;
+	m_startTime = TimeStamp::GetMicroseconds();
+	m_endTime = 0;
+	m_startWriteCnt = m_driver->m_writeCnt;
+	Log::Write( LogLevel_Info, "Heal: healing %d nodes up to %d hops away, %d at a time", m_plan.size(), m_maxHops, m_concurrency );
+
+	if( m_timeBudget > 0 )
+	{
+		m_driver->m_timers->Arm( &m_budgetTimer, m_timeBudget, BudgetTimerCallback, this );
+	}
+
+	StartNodes();
+	CheckFinished();
+	m_mutex->Unlock();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::Cancel>
+//	Stop healing
+//-----------------------------------------------------------------------------
+bool HealScheduler::Cancel
+(
+)
+{
+	LockGuard LG( m_driver->m_nodeMutex );
+	m_mutex->Lock();
+	bool running = m_running;
+	if( running )
+	{
+		Log::Write( LogLevel_Info, "Heal: cancelled" );
+
+		// Not on the driver thread, so the running controller command cannot be touched
+		Stop( Driver::HealEvent_NodeSkipped, false );
+	}
+	m_mutex->Unlock();
+	return running;
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::GetStatistics>
+//	Report the progress and cost of the current or last heal
+//-----------------------------------------------------------------------------
+void HealScheduler::GetStatistics
+(
+	Driver::HealData* _data
+)
+{
+	m_mutex->Lock();
+	uint64 endTime = m_running ? TimeStamp::GetMicroseconds() : m_endTime;
+	uint32 endWriteCnt = m_running ? m_driver->m_writeCnt : m_endWriteCnt;
+
+	_data->m_running = m_running;
+	_data->m_passes = m_passes;
+	_data->m_nodesPlanned = (uint32)m_plan.size();
+	_data->m_nodesHealed = m_nodesHealed;
+	_data->m_nodesFailed = m_nodesFailed;
+	_data->m_nodesTimedOut = m_nodesTimedOut;
+	_data->m_nodesSkipped = m_nodesSkipped;
+	_data->m_nodesRemaining = (uint32)m_plan.size() - m_next;
+	_data->m_maxHops = m_maxHops;
+	_data->m_commandsSent = m_commandsSent;
+	_data->m_framesSent = m_passes ? endWriteCnt - m_startWriteCnt : 0;
+	_data->m_elapsed = ( m_passes && endTime > m_startTime ) ? (uint32)( ( endTime - m_startTime ) / 1000 ) : 0;
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::BuildPlan>
+//	Decide which nodes to heal, and in what order.  The caller must hold the
+//	node and heal locks.
+//-----------------------------------------------------------------------------
+void HealScheduler::BuildPlan
+(
+	bool const _degradedOnly
+)
+{
+	// Sort on hops, then routing nodes after the others, then node ID
+	vector<uint32> keys;
+	m_maxHops = 0;
+	uint8 controllerId = m_driver->GetControllerNodeId();
+	for( int32 i=1; i<256; ++i )
+	{
+		Node* node = m_driver->GetNodeUnsafe( (uint8)i );
+		if( node == NULL )
+		{
+			continue;
+		}
+
+		HealNode& healNode = m_nodes[i];
+		healNode.m_step = HealStep_Idle;
+		healNode.m_hops = m_driver->m_networkGraph->GetHopCount( (uint8)i );
+		if( i != controllerId && !node->IsListeningDevice() && !node->IsFrequentListeningDevice() )
+		{
+			// Sleeping nodes cannot look for neighbors
+			if( !_degradedOnly )
+			{
+				Log::Write( LogLevel_Info, (uint8)i, "Heal: skipping sleeping node" );
+				++m_nodesSkipped;
+				Notify( (uint8)i, Driver::HealEvent_NodeSkipped );
+			}
+			continue;
+		}
+
+		if( _degradedOnly && !IsDegraded( node, healNode ) )
+		{
+			continue;
+		}
+
+		if( healNode.m_hops != 0xff && healNode.m_hops > m_maxHops )
+		{
+			m_maxHops = healNode.m_hops;
+		}
+		uint32 routing = ( i != controllerId && node->IsRoutingDevice() ) ? 1 : 0;
+		keys.push_back( ( (uint32)healNode.m_hops << 16 ) | ( routing << 8 ) | (uint32)i );
+	}
+	sort( keys.begin(), keys.end() );
+
+	m_plan.clear();
+	for( vector<uint32>::iterator it = keys.begin(); it != keys.end(); ++it )
+	{
+		uint8 nodeId = (uint8)( *it & 0xff );
+		m_nodes[nodeId].m_step = HealStep_Waiting;
+		m_plan.push_back( nodeId );
+		Log::Write( LogLevel_Detail, nodeId, "Heal: planned at %d hops", m_nodes[nodeId].m_hops );
+	}
+	m_next = 0;
+	m_active = 0;
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::IsDegraded>
+//	Whether a node's routes have got worse since it was last healed
+//-----------------------------------------------------------------------------
+bool HealScheduler::IsDegraded
+(
+	Node* _node,
+	HealNode const& _healNode
+)
+{
+	if( m_driver->m_networkGraph->GetNeighborCount( _healNode.m_nodeId ) == 0 )
+	{
+		return true;
+	}
+
+	if( _healNode.m_nodeId == m_driver->GetControllerNodeId() )
+	{
+		// No messages are sent to the controller itself
+		return false;
+	}
+
+	if( !_node->IsNodeAlive() )
+	{
+		return true;
+	}
+
+	// The counters start again if the node has been added again since
+	bool restarted = _node->m_sentCnt < _healNode.m_sentCnt;
+	uint32 sent = _node->m_sentCnt - ( restarted ? 0 : _healNode.m_sentCnt );
+	uint32 failed = _node->m_sentFailed - ( restarted ? 0 : _healNode.m_sentFailed );
+	uint32 retries = _node->m_retries - ( restarted ? 0 : _healNode.m_retries );
+	if( sent >= c_degradedMinMessages && ( failed + retries ) * 100 >= sent * c_degradedFailurePercent )
+	{
+		Log::Write( LogLevel_Detail, _healNode.m_nodeId, "Heal: %d of %d messages failed or were retried", failed + retries, sent );
+		return true;
+	}
+
+	if( _healNode.m_averageRTT && _node->m_averageRequestRTT > _healNode.m_averageRTT * c_degradedRTTFactor )
+	{
+		Log::Write( LogLevel_Detail, _healNode.m_nodeId, "Heal: round trip time has grown from %dms to %dms", _healNode.m_averageRTT, _node->m_averageRequestRTT );
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::StartNodes>
+//	Start healing nodes until the concurrency limit is reached.  The caller
+//	must hold the node and heal locks.
+//-----------------------------------------------------------------------------
+void HealScheduler::StartNodes
+(
+)
+{
+	while( m_running && m_active < (uint32)m_concurrency && m_next < m_plan.size() )
+	{
+		HealNode* healNode = &m_nodes[m_plan[m_next++]];
+		if( m_driver->GetNodeUnsafe( healNode->m_nodeId ) == NULL )
+		{
+			// Removed from the network since the heal started
+			healNode->m_step = HealStep_Idle;
+			++m_nodesSkipped;
+			Notify( healNode->m_nodeId, Driver::HealEvent_NodeSkipped );
+			continue;
+		}
+		StartNode( healNode );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::StartNode>
+//	Ask a node to rediscover its neighbors.  The caller must hold the node and
+//	heal locks.
+//-----------------------------------------------------------------------------
+void HealScheduler::StartNode
+(
+	HealNode* _healNode
+)
+{
+	Log::Write( LogLevel_Info, _healNode->m_nodeId, "Heal: requesting neighbor update (%d of %d, %d hops)", m_next, m_plan.size(), _healNode->m_hops );
+
+	_healNode->m_step = HealStep_NeighborUpdate;
+	_healNode->m_outstanding = 1;
+	_healNode->m_failed = false;
+	_healNode->m_started = TimeStamp::GetMicroseconds();
+	++m_active;
+	++m_commandsSent;
+
+	// Arm the timer first, as queuing the command wakes the driver thread
+	if( m_nodeTimeout > 0 )
+	{
+		m_driver->m_timers->Arm( &_healNode->m_timer, m_nodeTimeout, NodeTimerCallback, _healNode );
+	}
+	m_driver->BeginControllerCommand( Driver::ControllerCommand_RequestNodeNeighborUpdate, CommandCallback, _healNode, true, _healNode->m_nodeId, 0 );
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::FinishNode>
+//	Record the outcome of healing a node, and start the next.  The caller must
+//	hold the node and heal locks.
+//-----------------------------------------------------------------------------
+void HealScheduler::FinishNode
+(
+	HealNode* _healNode,
+	Driver::HealEvent const _event
+)
+{
+	m_driver->m_timers->Cancel( &_healNode->m_timer );
+	_healNode->m_step = HealStep_Idle;
+	_healNode->m_outstanding = 0;
+	--m_active;
+
+	uint32 elapsed = (uint32)( ( TimeStamp::GetMicroseconds() - _healNode->m_started ) / 1000 );
+	switch( _event )
+	{
+		case Driver::HealEvent_NodeHealed:
+		{
+			// The baseline for deciding later whether the node's routes have degraded
+			if( Node* node = m_driver->GetNodeUnsafe( _healNode->m_nodeId ) )
+			{
+				_healNode->m_sentCnt = node->m_sentCnt;
+				_healNode->m_sentFailed = node->m_sentFailed;
+				_healNode->m_retries = node->m_retries;
+				_healNode->m_averageRTT = node->m_averageRequestRTT;
+			}
+			++m_nodesHealed;
+			Log::Write( LogLevel_Info, _healNode->m_nodeId, "Heal: node healed in %dms", elapsed );
+			break;
+		}
+		case Driver::HealEvent_NodeFailed:
+		{
+			++m_nodesFailed;
+			Log::Write( LogLevel_Warning, _healNode->m_nodeId, "Heal: node failed to heal after %dms", elapsed );
+			break;
+		}
+		case Driver::HealEvent_NodeTimedOut:
+		{
+			++m_nodesTimedOut;
+			Log::Write( LogLevel_Warning, _healNode->m_nodeId, "Heal: node not healed within %dms", elapsed );
+			break;
+		}
+		default:
+		{
+			++m_nodesSkipped;
+			break;
+		}
+	}
+	Notify( _healNode->m_nodeId, _event );
+
+	StartNodes();
+	CheckFinished();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::AbandonNode>
+//	Give up on a node's outstanding controller commands.  The caller must hold
+//	the node and heal locks.
+//-----------------------------------------------------------------------------
+void HealScheduler::AbandonNode
+(
+	HealNode* _healNode,
+	bool const _failStalled
+)
+{
+	uint32 removed = m_driver->RemoveControllerCommands( CommandCallback, _healNode );
+
+	// The command that is running still reports back, and must be ignored
+	_healNode->m_ignore += _healNode->m_outstanding - removed;
+	_healNode->m_outstanding = 0;
+
+	// A command the controller never started would block the queue forever.  Once
+	// the controller has started, it always reports back, and the command is left
+	// to finish so that its report is not taken for the next command's.
+	Driver::ControllerCommandItem* cci = m_driver->m_currentControllerCommand;
+	if( _failStalled && cci != NULL && cci->m_controllerCallback == CommandCallback && cci->m_controllerCallbackContext == _healNode
+		&& !cci->m_controllerCommandDone && cci->m_controllerState == Driver::ControllerState_Starting )
+	{
+		Log::Write( LogLevel_Warning, _healNode->m_nodeId, "Heal: the controller did not start the command, giving up on it" );
+		m_driver->UpdateControllerState( Driver::ControllerState_Failed );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::Stop>
+//	Give up on the rest of the heal.  The caller must hold the node and heal
+//	locks.
+//-----------------------------------------------------------------------------
+void HealScheduler::Stop
+(
+	Driver::HealEvent const _event,
+	bool const _failStalled
+)
+{
+	m_driver->m_timers->Cancel( &m_budgetTimer );
+
+	// Nodes that were never started
+	while( m_next < m_plan.size() )
+	{
+		HealNode* healNode = &m_nodes[m_plan[m_next++]];
+		healNode->m_step = HealStep_Idle;
+		++m_nodesSkipped;
+		Notify( healNode->m_nodeId, Driver::HealEvent_NodeSkipped );
+	}
+
+	// Nodes in progress
+	for( vector<uint8>::iterator it = m_plan.begin(); it != m_plan.end() && m_active; ++it )
+	{
+		HealNode* healNode = &m_nodes[*it];
+		if( healNode->m_step == HealStep_NeighborUpdate || healNode->m_step == HealStep_ReturnRoutes )
+		{
+			AbandonNode( healNode, _failStalled );
+			FinishNode( healNode, _event );
+		}
+	}
+
+	CheckFinished();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::CheckFinished>
+//	End the heal once every node has been dealt with.  The caller must hold
+//	the heal lock.
+//-----------------------------------------------------------------------------
+void HealScheduler::CheckFinished
+(
+)
+{
+	if( !m_running || m_active || m_next < m_plan.size() )
+	{
+		return;
+	}
+
+	m_running = false;
+	m_endTime = TimeStamp::GetMicroseconds();
+	m_endWriteCnt = m_driver->m_writeCnt;
+	m_driver->m_timers->Cancel( &m_budgetTimer );
+
+	Log::Write( LogLevel_Info, "Heal: finished in %dms with %d controller commands and %d messages: %d healed, %d failed, %d timed out, %d skipped",
+		(uint32)( ( m_endTime - m_startTime ) / 1000 ), m_commandsSent, m_endWriteCnt - m_startWriteCnt,
+		m_nodesHealed, m_nodesFailed, m_nodesTimedOut, m_nodesSkipped );
+	Notify( 0, Driver::HealEvent_Completed );
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::Notify>
+//	Report progress to the watchers.  Notifications can only be queued by the
+//	driver thread, so this is left to a timer.  The caller must hold the heal
+//	lock.
+//-----------------------------------------------------------------------------
+void HealScheduler::Notify
+(
+	uint8 const _nodeId,
+	Driver::HealEvent const _event
+)
+{
+	HealReport report;
+	report.m_nodeId = _nodeId;
+	report.m_event = (uint8)_event;
+	m_reports.push_back( report );
+	if( !m_notifyTimer.IsArmed() )
+	{
+		m_driver->m_timers->Arm( &m_notifyTimer, 0, NotifyTimerCallback, this );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::CommandCallback>
+//	Called by the driver thread as the heal's controller commands progress
+//-----------------------------------------------------------------------------
+void HealScheduler::CommandCallback
+(
+	Driver::ControllerState _state,
+	Driver::ControllerError _err,
+	void* _context
+)
+{
+	switch( _state )
+	{
+		case Driver::ControllerState_Completed:
+		case Driver::ControllerState_Failed:
+		case Driver::ControllerState_Error:
+		case Driver::ControllerState_Cancel:
+		case Driver::ControllerState_Sleeping:
+		case Driver::ControllerState_NodeOK:
+		case Driver::ControllerState_NodeFailed:
+		{
+			break;
+		}
+		default:
+		{
+			// Still in progress
+			return;
+		}
+	}
+
+	HealNode* healNode = (HealNode*)_context;
+	HealScheduler* hs = healNode->m_owner;
+	LockGuard LG( hs->m_driver->m_nodeMutex );
+	hs->m_mutex->Lock();
+	if( healNode->m_ignore )
+	{
+		--healNode->m_ignore;
+	}
+	else if( healNode->m_outstanding )
+	{
+		--healNode->m_outstanding;
+		if( _state != Driver::ControllerState_Completed )
+		{
+			healNode->m_failed = true;
+		}
+
+		if( healNode->m_step == HealStep_NeighborUpdate && !healNode->m_failed && hs->m_doRR )
+		{
+			// Now that the controller knows the node's neighbors, it can work out
+			// the routes from the node to its associations.
+			healNode->m_step = HealStep_ReturnRoutes;
+			uint32 commands = hs->m_driver->UpdateNodeRoutes( healNode->m_nodeId, true, CommandCallback, healNode );
+			healNode->m_outstanding += commands;
+			hs->m_commandsSent += commands;
+		}
+
+		if( !healNode->m_outstanding )
+		{
+			hs->FinishNode( healNode, healNode->m_failed ? Driver::HealEvent_NodeFailed : Driver::HealEvent_NodeHealed );
+		}
+	}
+	hs->m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::NodeTimerCallback>
+//	A node has taken too long to heal
+//-----------------------------------------------------------------------------
+void HealScheduler::NodeTimerCallback
+(
+	void* _context
+)
+{
+	HealNode* healNode = (HealNode*)_context;
+	HealScheduler* hs = healNode->m_owner;
+	LockGuard LG( hs->m_driver->m_nodeMutex );
+	hs->m_mutex->Lock();
+	if( healNode->m_step == HealStep_NeighborUpdate || healNode->m_step == HealStep_ReturnRoutes )
+	{
+		hs->AbandonNode( healNode, true );
+		hs->FinishNode( healNode, Driver::HealEvent_NodeTimedOut );
+	}
+	hs->m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::BudgetTimerCallback>
+//	The heal has run out of time
+//-----------------------------------------------------------------------------
+void HealScheduler::BudgetTimerCallback
+(
+	void* _context
+)
+{
+	HealScheduler* hs = (HealScheduler*)_context;
+	LockGuard LG( hs->m_driver->m_nodeMutex );
+	hs->m_mutex->Lock();
+	if( hs->m_running )
+	{
+		Log::Write( LogLevel_Warning, "Heal: time budget of %dms used up with %d nodes still to heal", hs->m_timeBudget, hs->m_active + hs->m_plan.size() - hs->m_next );
+		hs->Stop( Driver::HealEvent_NodeTimedOut, true );
+	}
+	hs->m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<HealScheduler::NotifyTimerCallback>
+//	Pass the progress reports to the driver's watchers
+//-----------------------------------------------------------------------------
+void HealScheduler::NotifyTimerCallback
+(
+	void* _context
+)
+{
+	HealScheduler* hs = (HealScheduler*)_context;
+	hs->m_mutex->Lock();
+	vector<HealReport> reports;
+	reports.swap( hs->m_reports );
+	hs->m_mutex->Unlock();
+
+	for( vector<HealReport>::iterator it = reports.begin(); it != reports.end(); ++it )
+	{
+		Notification* notification = new Notification( Notification::Type_HealProgress );
+		notification->SetHomeAndNodeIds( hs->m_driver->GetHomeId(), it->m_nodeId );
+		notification->SetEvent( it->m_event );
+		hs->m_driver->QueueNotification( notification );
+	}
+}
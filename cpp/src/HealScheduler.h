@@ -0,0 +1,176 @@
+//-----------------------------------------------------------------------------
+//
+//	HealScheduler.h
+//
+//	Heals the nodes of a Z-Wave network in order of their distance from the
+//	controller
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _HealScheduler_H
+#define _HealScheduler_H
+
+#include <vector>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "platform/TimerWheel.h"
+
+namespace OpenZWave
+{
+	class Mutex;
+	class Node;
+
+	/** \brief Heals a network a few nodes at a time, rather than queuing a neighbor
+	 * update for every node at once.
+	 *
+	 * The driver's NetworkGraph gives the number of hops from the controller to each
+	 * node.  Nodes are healed nearest first, so that the nodes further out rediscover
+	 * their neighbors after the nodes that will route for them.  Within each hop, the
+	 * routing nodes go last.  Nodes that sleep cannot search for neighbors, and are
+	 * skipped.
+	 *
+	 * No more than the HealConcurrency option's number of nodes have commands on the
+	 * controller queue at any time.  A node that has not finished within HealNodeTimeout
+	 * milliseconds is given up on, as is the rest of the heal once HealTimeBudget
+	 * milliseconds have passed.
+	 *
+	 * The failure rate and round trip time of each node are recorded when it is healed,
+	 * so that a later heal can be limited to the nodes whose routes have degraded since.
+	 *
+	 * The driver thread makes all the callbacks, from its timers and from the controller
+	 * commands.  Locks are taken in the order: node mutex, heal mutex, send mutex.
+	 */
+	class HealScheduler
+	{
+	public:
+		HealScheduler( Driver* _driver );
+		~HealScheduler();
+
+		/**
+		 * Start healing the network.
+		 * @param _doRR Whether to update the return routes of each node after its neighbors.
+		 * @param _degradedOnly Only heal the nodes whose routes have degraded since they were last healed.
+		 * @return True if the heal started, or false if a heal is already running or there is nothing to heal.
+		 */
+		bool Start( bool const _doRR, bool const _degradedOnly );
+
+		/**
+		 * Stop healing.  The controller command that is running is left to finish, but no
+		 * more are sent, and the nodes not yet healed are reported as skipped.
+		 * @return True if a heal was running.
+		 */
+		bool Cancel();
+
+		bool IsRunning()const{ return m_running; }
+		void GetStatistics( Driver::HealData* _data );
+
+	private:
+		HealScheduler( HealScheduler const& );					// prevent copy
+		HealScheduler& operator = ( HealScheduler const& );		// prevent assignment
+
+		enum HealStep
+		{
+			HealStep_Idle = 0,
+			HealStep_Waiting,									// Planned, but not started
+			HealStep_NeighborUpdate,
+			HealStep_ReturnRoutes
+		};
+
+		struct HealReport
+		{
+			uint8				m_nodeId;
+			uint8				m_event;
+		};
+
+		struct HealNode
+		{
+			HealScheduler*		m_owner;
+			uint8				m_nodeId;
+			uint8				m_hops;							// Hops from the controller, or 0xff if it cannot be reached
+			HealStep			m_step;
+			uint32				m_outstanding;					// Controller commands still to report back
+			uint32				m_ignore;						// Reports still to come from abandoned commands
+			bool				m_failed;
+			uint64				m_started;						// Microseconds
+			TimerWheel::Timer	m_timer;
+
+			// Statistics when the node was last healed
+			uint32				m_sentCnt;
+			uint32				m_sentFailed;
+			uint32				m_retries;
+			uint32				m_averageRTT;
+		};
+
+		void BuildPlan( bool const _degradedOnly );
+		bool IsDegraded( Node* _node, HealNode const& _healNode );
+		void StartNodes();
+		void StartNode( HealNode* _healNode );
+		void FinishNode( HealNode* _healNode, Driver::HealEvent const _event );
+		void AbandonNode( HealNode* _healNode, bool const _failStalled );
+		void Stop( Driver::HealEvent const _event, bool const _failStalled );
+		void CheckFinished();
+		void Notify( uint8 const _nodeId, Driver::HealEvent const _event );
+
+		static void CommandCallback( Driver::ControllerState _state, Driver::ControllerError _err, void* _context );
+		static void NodeTimerCallback( void* _context );
+		static void BudgetTimerCallback( void* _context );
+		static void NotifyTimerCallback( void* _context );
+
+		Driver*				m_driver;
+		Mutex*				m_mutex;
+		HealNode			m_nodes[256];
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		vector<uint8>		m_plan;								// Node IDs in the order they are healed
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32				m_next;								// Index into m_plan of the next node to start
+		uint32				m_active;							// Nodes with commands on the controller queue
+		bool				m_running;
+		bool				m_doRR;
+		TimerWheel::Timer	m_budgetTimer;
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		vector<HealReport>	m_reports;							// Notifications waiting to be queued by the driver thread
+OPENZWAVE_EXPORT_WARNINGS_ON
+		TimerWheel::Timer	m_notifyTimer;
+
+		// Options
+		int32				m_concurrency;
+		int32				m_nodeTimeout;
+		int32				m_timeBudget;
+
+		// Statistics of the current or last heal
+		uint32				m_passes;
+		uint32				m_nodesHealed;
+		uint32				m_nodesFailed;
+		uint32				m_nodesTimedOut;
+		uint32				m_nodesSkipped;
+		uint8				m_maxHops;
+		uint32				m_commandsSent;
+		uint32				m_startWriteCnt;
+		uint32				m_endWriteCnt;
+		uint64				m_startTime;						// Microseconds
+		uint64				m_endTime;
+	};
+
+} // namespace OpenZWave
+
+#endif //_HealScheduler_H
@@ -33,6 +33,11 @@
 #include "Defs.h"
 #include "Manager.h"
 #include "Driver.h"
+#include "ConfigScheduler.h"
+#include "SetValueTracker.h"
+#include "ValueHistory.h"
+#include "HealScheduler.h"
+#include "NetworkGraph.h"
 #include "Node.h"
 #include "Notification.h"
 #include "Options.h"
@@ -59,6 +64,10 @@
 #include "value_classes/ValueShort.h"
 #include "value_classes/ValueString.h"
 
+#ifdef _MSC_VER
+# include <windows.h>
+#endif
+
 using namespace OpenZWave;
 
 Manager* Manager::s_instance = NULL;
@@ -67,6 +76,41 @@ extern uint16_t ozw_vers_minor;
 extern uint16_t ozw_vers_revision;
 extern char ozw_version_string[];
 
+//-----------------------------------------------------------------------------
+//	Routing table access.  The slots are only written with m_driverMutex held,
+//	and read without any lock, so each field is published with a release store
+//	and read with an acquire load.
+//-----------------------------------------------------------------------------
+template<typename T>
+static inline T RoutingLoad
+(
+		T const& _field
+)
+{
+#ifdef _MSC_VER
+	T value = *(T const volatile*)&_field;
+	MemoryBarrier();
+	return value;
+#else
+	return __atomic_load_n( &_field, __ATOMIC_ACQUIRE );
+#endif
+}
+
+template<typename T>
+static inline void RoutingStore
+(
+		T& _field,
+		T const _value
+)
+{
+#ifdef _MSC_VER
+	MemoryBarrier();
+	*(T volatile*)&_field = _value;
+#else
+	__atomic_store_n( &_field, _value, __ATOMIC_RELEASE );
+#endif
+}
+
 //-----------------------------------------------------------------------------
 //	Construction
 //-----------------------------------------------------------------------------
@@ -141,11 +185,24 @@ ozwversion Manager::getVersion() {
 Manager::Manager
 (
 ):
+m_driverMutex( new Mutex() ),
+m_watchersGeneration( 1 ),
+m_parallelNotifications( false ),
 m_notificationMutex( new Mutex() )
 {
 	// Ensure the singleton instance is set
 	s_instance = this;
 
+	for( int32 i=0; i<MAX_DRIVERS; ++i )
+	{
+		m_driverSlots[i].m_driver = NULL;
+		m_driverSlots[i].m_homeId = 0;
+		m_driverSlots[i].m_dispatchMutex = new Mutex();
+		m_driverSlots[i].m_watchersGeneration = 0;
+	}
+
+	Options::Get()->GetOptionAsBool( "ParallelNotifications", &m_parallelNotifications );
+
 	// Create the log file (if enabled)
 	bool logging = false;
 	Options::Get()->GetOptionAsBool( "Logging", &logging );
@@ -213,6 +270,11 @@ Manager::~Manager
 		m_readyDrivers.erase( it );
 	}
 
+	for( int32 i=0; i<MAX_DRIVERS; ++i )
+	{
+		m_driverSlots[i].m_dispatchMutex->Release();
+	}
+	m_driverMutex->Release();
 	m_notificationMutex->Release();
 
 	// Clear the watchers list
@@ -222,6 +284,12 @@ Manager::~Manager
 		delete *it;
 		m_watchers.erase( it );
 	}
+	while( !m_retiredWatchers.empty() )
+	{
+		list<Watcher*>::iterator it = m_retiredWatchers.begin();
+		delete *it;
+		m_retiredWatchers.erase( it );
+	}
 
 	// Clear the generic device class list
 	while( !Node::s_genericDeviceClasses.empty() )
@@ -273,6 +341,8 @@ bool Manager::AddDriver
 		Driver::ControllerInterface const& _interface
 )
 {
+	LockGuard LG(m_driverMutex);
+
 	// Make sure we don't already have a driver for this controller
 
 	// Search the pending list
@@ -295,8 +365,26 @@ bool Manager::AddDriver
 		}
 	}
 
+	// Find a free routing slot for the new driver
+	DriverSlot* slot = NULL;
+	for( int32 i=0; i<MAX_DRIVERS; ++i )
+	{
+		if( m_driverSlots[i].m_driver == NULL )
+		{
+			slot = &m_driverSlots[i];
+			break;
+		}
+	}
+	if( slot == NULL )
+	{
+		Log::Write( LogLevel_Warning, "mgr,     Cannot add driver for controller %s - already running the maximum of %d drivers", _controllerPath.c_str(), MAX_DRIVERS );
+		return false;
+	}
+
 	Driver* driver = new Driver( _controllerPath, _interface );
 	m_pendingDrivers.push_back( driver );
+	RoutingStore( slot->m_homeId, (uint32)0 );
+	RoutingStore( slot->m_driver, driver );
 	driver->Start();
 
 	Log::Write( LogLevel_Info, "mgr,     Added driver for controller %s", _controllerPath.c_str() );
@@ -312,20 +400,24 @@ bool Manager::RemoveDriver
 		string const& _controllerPath
 )
 {
+	// The driver is deleted without holding m_driverMutex, as its thread may be waiting
+	// on the mutex in SetDriverReady, and the destructor waits for that thread to exit.
+	Driver* driver = NULL;
+	m_driverMutex->Lock();
+
 	// Search the pending list
 	for( list<Driver*>::iterator pit = m_pendingDrivers.begin(); pit != m_pendingDrivers.end(); ++pit )
 	{
 		if( _controllerPath == (*pit)->GetControllerPath() )
 		{
-			delete *pit;
+			driver = *pit;
 			m_pendingDrivers.erase( pit );
-			Log::Write( LogLevel_Info, "mgr,     Driver for controller %s removed", _controllerPath.c_str() );
-			return true;
+			break;
 		}
 	}
 
 	// Search the ready map
-	for( map<uint32,Driver*>::iterator rit = m_readyDrivers.begin(); rit != m_readyDrivers.end(); ++rit )
+	for( map<uint32,Driver*>::iterator rit = m_readyDrivers.begin(); driver == NULL && rit != m_readyDrivers.end(); ++rit )
 	{
 		if( _controllerPath == rit->second->GetControllerPath() )
 		{
@@ -341,14 +433,23 @@ bool Manager::RemoveDriver
 			 *
 			 * But we can't change this, as the Driver Destructor triggers internal GetDriver calls... which
 			 * will crash and burn if they can't get a valid Driver back...
+			 * GetDriver routes through m_driverSlots, so the slot is only released once the driver is gone.
 			 */
 			Log::Write( LogLevel_Info, "mgr,     Driver for controller %s pending removal", _controllerPath.c_str() );
-			delete rit->second;
+			driver = rit->second;
 			m_readyDrivers.erase( rit );
-			Log::Write( LogLevel_Info, "mgr,     Driver for controller %s removed", _controllerPath.c_str() );
-			return true;
+			break;
 		}
 	}
+	m_driverMutex->Unlock();
+
+	if( driver )
+	{
+		delete driver;
+		ReleaseDriverSlot( driver );
+		Log::Write( LogLevel_Info, "mgr,     Driver for controller %s removed", _controllerPath.c_str() );
+		return true;
+	}
 
 	Log::Write( LogLevel_Info, "mgr,     Failed to remove driver for controller %s", _controllerPath.c_str() );
 	return false;
@@ -363,10 +464,22 @@ Driver* Manager::GetDriver
 		uint32 const _homeId
 )
 {
-	map<uint32,Driver*>::iterator it = m_readyDrivers.find( _homeId );
-	if( it != m_readyDrivers.end() )
+	// No lock is taken here, so lookups never wait on each other or on a driver
+	// being added, made ready or removed.  The home ID is checked again after the
+	// driver is read, in case the slot was released and reused in between.
+	if( _homeId != 0 )
 	{
-		return it->second;
+		for( int32 i=0; i<MAX_DRIVERS; ++i )
+		{
+			if( RoutingLoad( m_driverSlots[i].m_homeId ) == _homeId )
+			{
+				Driver* driver = RoutingLoad( m_driverSlots[i].m_driver );
+				if( driver != NULL && RoutingLoad( m_driverSlots[i].m_homeId ) == _homeId )
+				{
+					return driver;
+				}
+			}
+		}
 	}
 
 	Log::Write( LogLevel_Error, "mgr,     Manager::GetDriver failed - Home ID 0x%.8x is unknown", _homeId );
@@ -385,6 +498,8 @@ void Manager::SetDriverReady
 		bool success
 )
 {
+	LockGuard LG(m_driverMutex);
+
 	// Search the pending list
 	bool found = false;
 	for( list<Driver*>::iterator it = m_pendingDrivers.begin(); it != m_pendingDrivers.end(); ++it )
@@ -405,8 +520,12 @@ void Manager::SetDriverReady
 			Log::Write( LogLevel_Info, "" );
 		}
 
-		// Add the driver to the ready map
+		// Add the driver to the ready map, and make it reachable by home ID
 		m_readyDrivers[_driver->GetHomeId()] = _driver;
+		if( DriverSlot* slot = GetDriverSlot( _driver ) )
+		{
+			RoutingStore( slot->m_homeId, _driver->GetHomeId() );
+		}
 
 		// Notify the watchers
 		Notification* notification = new Notification(success ? Notification::Type_DriverReady : Notification::Type_DriverFailed );
@@ -415,6 +534,52 @@ void Manager::SetDriverReady
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::GetDriverSlot>
+// Get the routing and dispatch slot of a driver
+//-----------------------------------------------------------------------------
+Manager::DriverSlot* Manager::GetDriverSlot
+(
+		Driver const* _driver
+)
+{
+	for( int32 i=0; i<MAX_DRIVERS; ++i )
+	{
+		if( RoutingLoad( m_driverSlots[i].m_driver ) == _driver )
+		{
+			return &m_driverSlots[i];
+		}
+	}
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::ReleaseDriverSlot>
+// Free the slot of a driver that has been deleted
+//-----------------------------------------------------------------------------
+void Manager::ReleaseDriverSlot
+(
+		Driver const* _driver
+)
+{
+	DriverSlot* slot = GetDriverSlot( _driver );
+	if( slot == NULL )
+	{
+		return;
+	}
+
+	// The driver has gone, so its copy of the watcher list is no longer in use
+	m_notificationMutex->Lock();
+	slot->m_watchers.clear();
+	slot->m_watchersGeneration = 0;
+	PurgeRetiredWatchers();
+	m_notificationMutex->Unlock();
+
+	LockGuard LG(m_driverMutex);
+	RoutingStore( slot->m_homeId, (uint32)0 );
+	RoutingStore( slot->m_driver, (Driver*)NULL );
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::GetControllerNodeId>
 //
@@ -609,6 +774,49 @@ string Manager::GetControllerPath
 	}
 	return path;
 }
+
+//-----------------------------------------------------------------------------
+// <Manager::AddSerialApiHandler>
+// Handle a Serial API function that the driver does not handle itself
+//-----------------------------------------------------------------------------
+bool Manager::AddSerialApiHandler
+(
+		uint32 const _homeId,
+		uint8 const _type,
+		uint8 const _function,
+		Driver::pfnSerialApiHandler_t _handler,
+		void* _context
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->AddSerialApiHandler( _type, _function, _handler, _context );
+	}
+
+	Log::Write( LogLevel_Warning, "mgr,     AddSerialApiHandler() failed - _homeId %d not found", _homeId );
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::RemoveSerialApiHandler>
+// Remove a handler added by AddSerialApiHandler
+//-----------------------------------------------------------------------------
+bool Manager::RemoveSerialApiHandler
+(
+		uint32 const _homeId,
+		uint8 const _type,
+		uint8 const _function
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->RemoveSerialApiHandler( _type, _function );
+	}
+
+	Log::Write( LogLevel_Warning, "mgr,     RemoveSerialApiHandler() failed - _homeId %d not found", _homeId );
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 //	Polling Z-Wave values
 //-----------------------------------------------------------------------------
@@ -621,6 +829,7 @@ int32 Manager::GetPollInterval
 (
 )
 {
+	LockGuard LG(m_driverMutex);
 	for( map<uint32,Driver*>::iterator rit = m_readyDrivers.begin(); rit != m_readyDrivers.end(); ++rit )
 	{
 		return rit->second->GetPollInterval();
@@ -643,6 +852,7 @@ void Manager::SetPollInterval
 		bool _bIntervalBetweenPolls
 )
 {
+	LockGuard LG(m_driverMutex);
 	for( list<Driver*>::iterator pit = m_pendingDrivers.begin(); pit != m_pendingDrivers.end(); ++pit )
 	{
 		(*pit)->SetPollInterval( _milliseconds, _bIntervalBetweenPolls );
@@ -752,6 +962,64 @@ uint8 Manager::GetPollIntensity
 	return intensity;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::GetValuePollInterval>
+// Get the interval a value is currently polled at
+//-----------------------------------------------------------------------------
+int32 Manager::GetValuePollInterval
+(
+		ValueID const &_valueId
+)
+{
+	int32 interval = 0;
+	if( Driver* driver = GetDriver( _valueId.GetHomeId() ) )
+	{
+		int32 effective;
+		if( !driver->GetPollIntervals( _valueId, &interval, &effective ) )
+		{
+			LockGuard LG(driver->m_nodeMutex);
+			if( Value* value = driver->GetValue( _valueId ) )
+			{
+				value->Release();
+			} else {
+				OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to GetValuePollInterval");
+			}
+			interval = 0;
+		}
+	}
+
+	return interval;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetValueEffectivePollInterval>
+// Get the interval a value is actually polled at
+//-----------------------------------------------------------------------------
+int32 Manager::GetValueEffectivePollInterval
+(
+		ValueID const &_valueId
+)
+{
+	int32 effective = 0;
+	if( Driver* driver = GetDriver( _valueId.GetHomeId() ) )
+	{
+		int32 interval;
+		if( !driver->GetPollIntervals( _valueId, &interval, &effective ) )
+		{
+			LockGuard LG(driver->m_nodeMutex);
+			if( Value* value = driver->GetValue( _valueId ) )
+			{
+				value->Release();
+			} else {
+				OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to GetValueEffectivePollInterval");
+			}
+			effective = 0;
+		}
+	}
+
+	return effective;
+}
+
 //-----------------------------------------------------------------------------
 //	Retrieving Node information
 //-----------------------------------------------------------------------------
@@ -1101,6 +1369,115 @@ uint32 Manager::GetNodeNeighbors
 	return 0;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::AreNodesNeighbors>
+// Whether two nodes are in range of each other
+//-----------------------------------------------------------------------------
+bool Manager::AreNodesNeighbors
+(
+		uint32 const _homeId,
+		uint8 const _nodeId,
+		uint8 const _otherNodeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_networkGraph->AreNeighbors( _nodeId, _otherNodeId );
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetNodeHopCount>
+// Get the number of hops from the controller to a node
+//-----------------------------------------------------------------------------
+uint8 Manager::GetNodeHopCount
+(
+		uint32 const _homeId,
+		uint8 const _nodeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_networkGraph->GetHopCount( _nodeId );
+	}
+
+	return 0xff;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetNodeUpstreamNeighbor>
+// Get the neighbor through which a node is reached
+//-----------------------------------------------------------------------------
+uint8 Manager::GetNodeUpstreamNeighbor
+(
+		uint32 const _homeId,
+		uint8 const _nodeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_networkGraph->GetUpstreamNode( _nodeId );
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::IsNodeArticulationPoint>
+// Whether other nodes depend on a node to reach the controller
+//-----------------------------------------------------------------------------
+bool Manager::IsNodeArticulationPoint
+(
+		uint32 const _homeId,
+		uint8 const _nodeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_networkGraph->IsArticulationPoint( _nodeId );
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetNodeDependentCount>
+// Get the number of nodes that depend on a node to reach the controller
+//-----------------------------------------------------------------------------
+uint8 Manager::GetNodeDependentCount
+(
+		uint32 const _homeId,
+		uint8 const _nodeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_networkGraph->GetDependentCount( _nodeId );
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetNodeRepeaterLoad>
+// Get the number of messages a node is expected to have repeated
+//-----------------------------------------------------------------------------
+uint32 Manager::GetNodeRepeaterLoad
+(
+		uint32 const _homeId,
+		uint8 const _nodeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_networkGraph->GetRepeaterLoad( _nodeId );
+	}
+
+	return 0;
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::GetNodeManufacturerName>
 // Get the manufacturer name of a node
@@ -1569,6 +1946,28 @@ bool Manager::IsNodeFailed
 	return result;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::IsNodeWarmStarted>
+// Helper method to return whether a node's cached values are still being verified
+//-----------------------------------------------------------------------------
+bool Manager::IsNodeWarmStarted
+(
+		uint32 const _homeId,
+		uint8 const _nodeId
+)
+{
+	bool result = false;
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		LockGuard LG(driver->m_nodeMutex);
+		if( Node* node = driver->GetNode( _nodeId ) )
+		{
+			result = node->IsWarmStarted();
+		}
+	}
+	return result;
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::GetNodeQueryStage>
 // Helper method to return whether a node's query stage
@@ -2906,6 +3305,134 @@ bool Manager::SetValue
 	return res;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::SetValueAsync>
+// Sets the value from a string, and reports when the device has confirmed it
+//-----------------------------------------------------------------------------
+uint32 Manager::SetValueAsync
+(
+		ValueID const& _id,
+		string const& _value,
+		Driver::pfnOnSetValueComplete_t _callback,
+		void* _context
+)
+{
+	uint32 requestId = 0;
+
+	if( ValueID::ValueType_Schedule == _id.GetType() || ValueID::ValueType_Button == _id.GetType() )
+	{
+		OZW_ERROR(OZWException::OZWEXCEPTION_CANNOT_CONVERT_VALUEID, "ValueID passed to SetValueAsync cannot be set from a string");
+		return 0;
+	}
+
+	if( Driver* driver = GetDriver( _id.GetHomeId() ) )
+	{
+		if( _id.GetNodeId() != driver->GetControllerNodeId() )
+		{
+			LockGuard LG(driver->m_nodeMutex);
+			if( Value* value = driver->GetValue( _id ) )
+			{
+				value->Release();
+
+				// The message queued for the change is tagged with the request ID
+				requestId = driver->m_setValueTracker->Begin( _id, _callback, _context );
+				bool res = SetValue( _id, _value );
+				requestId = driver->m_setValueTracker->End( requestId, res );
+			} else {
+				OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to SetValueAsync");
+			}
+		}
+	}
+	return requestId;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::SetValues>
+// Sets several values from strings, sending the changes for each node together
+//-----------------------------------------------------------------------------
+uint32 Manager::SetValues
+(
+		vector<ValueID> const& _ids,
+		vector<string> const& _values
+)
+{
+	uint32 count = 0;
+
+	if( _ids.size() != _values.size() )
+	{
+		OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "SetValues needs a value for each ValueID");
+		return 0;
+	}
+
+	// Check every ValueID before anything is sent, so that an exception cannot leave
+	// some nodes' changes sent and the rest not.  A string that cannot be converted
+	// does not throw: SetValue skips that value, and the node's other changes are sent.
+	vector<bool> done( _ids.size(), true );
+	for( uint32 i=0; i<_ids.size(); ++i )
+	{
+		ValueID const& id = _ids[i];
+		if( ValueID::ValueType_Schedule == id.GetType() || ValueID::ValueType_Button == id.GetType() )
+		{
+			OZW_ERROR(OZWException::OZWEXCEPTION_CANNOT_CONVERT_VALUEID, "ValueID passed to SetValues cannot be set from a string");
+			continue;
+		}
+
+		Driver* driver = GetDriver( id.GetHomeId() );
+		if( driver == NULL || id.GetNodeId() == driver->GetControllerNodeId() )
+		{
+			continue;
+		}
+
+		LockGuard LG(driver->m_nodeMutex);
+		if( Value* value = driver->GetValue( id ) )
+		{
+			value->Release();
+			done[i] = false;
+		} else {
+			OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to SetValues");
+		}
+	}
+
+	for( uint32 i=0; i<_ids.size(); ++i )
+	{
+		if( done[i] )
+		{
+			continue;
+		}
+
+		// Gather the values of this node, in the order they were given
+		uint32 const homeId = _ids[i].GetHomeId();
+		uint8 const nodeId = _ids[i].GetNodeId();
+		vector<uint32> node;
+		for( uint32 j=i; j<_ids.size(); ++j )
+		{
+			if( !done[j] && _ids[j].GetHomeId() == homeId && _ids[j].GetNodeId() == nodeId )
+			{
+				done[j] = true;
+				node.push_back( j );
+			}
+		}
+
+		Driver* driver = GetDriver( homeId );
+		if( driver == NULL )
+		{
+			continue;
+		}
+
+		LockGuard LG(driver->m_nodeMutex);
+		Driver::MultiCmdGuard MG( driver, nodeId );
+		for( uint32 k=0; k<node.size(); ++k )
+		{
+			if( SetValue( _ids[node[k]], _values[node[k]] ) )
+			{
+				++count;
+			}
+		}
+	}
+
+	return count;
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::RefreshValue>
 // Instruct the driver to refresh this value by sending a message to the device
@@ -3052,6 +3579,74 @@ bool Manager::ReleaseButton
 	return res;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::GetValueHistory>
+// Gets the latest reports of a value
+//-----------------------------------------------------------------------------
+uint32 Manager::GetValueHistory
+(
+		ValueID const& _id,
+		uint32 const _since,
+		Driver::ValueHistorySample** o_samples
+)
+{
+	*o_samples = NULL;
+	if( Driver* driver = GetDriver( _id.GetHomeId() ) )
+	{
+		if( driver->m_valueHistory != NULL )
+		{
+			return driver->m_valueHistory->GetSamples( _id, _since, o_samples );
+		}
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetValueHistorySummaries>
+// Gets the summaries of the reports of a value for a tier of the history
+//-----------------------------------------------------------------------------
+uint32 Manager::GetValueHistorySummaries
+(
+		ValueID const& _id,
+		uint8 const _tier,
+		uint32 const _since,
+		Driver::ValueHistorySummary** o_summaries
+)
+{
+	*o_summaries = NULL;
+	if( Driver* driver = GetDriver( _id.GetHomeId() ) )
+	{
+		if( driver->m_valueHistory != NULL )
+		{
+			return driver->m_valueHistory->GetSummaries( _id, _tier, _since, o_summaries );
+		}
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetValueHistoryTierPeriod>
+// Gets the length of the periods of a tier of the value history
+//-----------------------------------------------------------------------------
+uint32 Manager::GetValueHistoryTierPeriod
+(
+		uint32 const _homeId,
+		uint8 const _tier
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		if( driver->m_valueHistory != NULL )
+		{
+			return driver->m_valueHistory->GetTierPeriod( _tier );
+		}
+	}
+
+	return 0;
+}
+
 //-----------------------------------------------------------------------------
 // Climate Control Schedules
 //-----------------------------------------------------------------------------
@@ -3320,6 +3915,43 @@ void Manager::RequestAllConfigParams
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::ConfigureParams>
+// Read and write a batch of configuration parameters
+//-----------------------------------------------------------------------------
+uint8 Manager::ConfigureParams
+(
+		uint32 const _homeId,
+		vector<Driver::ConfigParamItem> const& _items
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_configScheduler->Submit( _items );
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetConfigParamsResults>
+// Collect the results of a batch of configuration parameter reads and writes
+//-----------------------------------------------------------------------------
+bool Manager::GetConfigParamsResults
+(
+		uint32 const _homeId,
+		uint8 const _batchId,
+		vector<Driver::ConfigParamItem>* o_items
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_configScheduler->GetResults( _batchId, o_items );
+	}
+
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 //	Groups
 //-----------------------------------------------------------------------------
@@ -3472,20 +4104,48 @@ bool Manager::AddWatcher
 		pfnOnNotification_t _watcher,
 		void* _context
 )
+{
+	return InsertWatcher( new Watcher( _watcher, _context, NULL ) );
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::AddWatcher>
+// Add a watcher to the list, to be called for the notifications a filter passes
+//-----------------------------------------------------------------------------
+bool Manager::AddWatcher
+(
+		pfnOnNotification_t _watcher,
+		void* _context,
+		WatcherFilter const& _filter
+)
+{
+	return InsertWatcher( new Watcher( _watcher, _context, new WatcherFilter( _filter ) ) );
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::InsertWatcher>
+// Add a watcher to the list, unless its callback and context are already there
+//-----------------------------------------------------------------------------
+bool Manager::InsertWatcher
+(
+		Watcher* _watcher
+)
 {
 	// Ensure this watcher is not already on the list
 	m_notificationMutex->Lock();
 	for( list<Watcher*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
 	{
-		if( ((*it)->m_callback == _watcher ) && ( (*it)->m_context == _context ) )
+		if( ((*it)->m_callback == _watcher->m_callback ) && ( (*it)->m_context == _watcher->m_context ) )
 		{
 			// Already in the list
 			m_notificationMutex->Unlock();
+			delete _watcher;
 			return false;
 		}
 	}
 
-	m_watchers.push_back( new Watcher( _watcher, _context ) );
+	m_watchers.push_back( _watcher );
+	++m_watchersGeneration;
 	m_notificationMutex->Unlock();
 	return true;
 }
@@ -3506,8 +4166,15 @@ bool Manager::RemoveWatcher
 	{
 		if( ((*it)->m_callback == _watcher ) && ( (*it)->m_context == _context ) )
 		{
-			delete (*it);
+			// Drivers may still hold this watcher in their copy of the list, so it
+			// is only flagged here, and deleted once they have all refreshed their copies.
+			Watcher* watcher = *it;
+			watcher->m_removed = true;
 			m_watchers.erase( it );
+			++m_watchersGeneration;
+			watcher->m_retiredGeneration = m_watchersGeneration;
+			m_retiredWatchers.push_back( watcher );
+			PurgeRetiredWatchers();
 			m_notificationMutex->Unlock();
 			return true;
 		}
@@ -3518,22 +4185,110 @@ bool Manager::RemoveWatcher
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::PurgeRetiredWatchers>
+// Delete the removed watchers that no driver's copy of the list refers to.
+// The caller must hold m_notificationMutex.
+//-----------------------------------------------------------------------------
+void Manager::PurgeRetiredWatchers
+(
+)
+{
+	list<Watcher*>::iterator it = m_retiredWatchers.begin();
+	while( it != m_retiredWatchers.end() )
+	{
+		// A copy made at or after the watcher's removal does not contain it
+		bool inUse = false;
+		for( int32 i=0; i<MAX_DRIVERS; ++i )
+		{
+			uint32 generation = m_driverSlots[i].m_watchersGeneration;
+			if( generation != 0 && generation < (*it)->m_retiredGeneration )
+			{
+				inUse = true;
+				break;
+			}
+		}
+
+		if( inUse )
+		{
+			++it;
+		}
+		else
+		{
+			delete *it;
+			it = m_retiredWatchers.erase( it );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetWatcherStatistics>
+// Get the number of notifications passed to a watcher, and held back from it
+//-----------------------------------------------------------------------------
+bool Manager::GetWatcherStatistics
+(
+		pfnOnNotification_t _watcher,
+		void* _context,
+		uint32* o_delivered,
+		uint32* o_filtered
+)
+{
+	LockGuard LG( m_notificationMutex );
+	for( list<Watcher*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	{
+		if( ((*it)->m_callback == _watcher ) && ( (*it)->m_context == _context ) )
+		{
+			*o_delivered = (*it)->m_delivered;
+			*o_filtered = (*it)->m_filtered;
+			return true;
+		}
+	}
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::NotifyWatchers>
 // Notify any watching objects of a value change
 //-----------------------------------------------------------------------------
 void Manager::NotifyWatchers
 (
+		Driver* _driver,
 		Notification* _notification
 )
 {
-	m_notificationMutex->Lock();
-	for( list<Watcher*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	DriverSlot* slot = GetDriverSlot( _driver );
+	if( slot == NULL || !m_parallelNotifications )
+	{
+		// Deliver one notification at a time, across all drivers
+		m_notificationMutex->Lock();
+		for( list<Watcher*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+		{
+			(*it)->Notify( _notification );
+		}
+		m_notificationMutex->Unlock();
+		return;
+	}
+
+	// Each driver delivers from its own copy of the watcher list, so drivers
+	// only contend on m_notificationMutex when the list has changed.
+	slot->m_dispatchMutex->Lock();
+	if( slot->m_watchersGeneration != m_watchersGeneration )
+	{
+		m_notificationMutex->Lock();
+		slot->m_watchers.assign( m_watchers.begin(), m_watchers.end() );
+		slot->m_watchersGeneration = m_watchersGeneration;
+		PurgeRetiredWatchers();
+		m_notificationMutex->Unlock();
+	}
+	for( vector<Watcher*>::iterator it = slot->m_watchers.begin(); it != slot->m_watchers.end(); ++it )
 	{
 		Watcher* pWatcher = *it;
-		pWatcher->m_callback( _notification, pWatcher->m_context );
+		if( !pWatcher->m_removed )
+		{
+			pWatcher->Notify( _notification );
+		}
 	}
-	m_notificationMutex->Unlock();
+	slot->m_dispatchMutex->Unlock();
 }
 
 //-----------------------------------------------------------------------------
@@ -3690,20 +4445,43 @@ void Manager::HealNetwork
 {
 	if( Driver* driver = GetDriver( _homeId ) )
 	{
-		LockGuard LG(driver->m_nodeMutex);
-		for( uint8 i=0; i<255; i++ )
-		{
-			if( driver->m_nodes[i] != NULL )
-			{
-				driver->BeginControllerCommand( Driver::ControllerCommand_RequestNodeNeighborUpdate, NULL, NULL, true, i, 0 );
-				if( _doRR )
-				{
-					driver->UpdateNodeRoutes( i, true );
-				}
-			}
-		}
+		driver->m_healScheduler->Start( _doRR, false );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::HealDegradedNodes>
+// Heal only the nodes whose routes have got worse since they were last healed
+//-----------------------------------------------------------------------------
+bool Manager::HealDegradedNodes
+(
+		uint32 const _homeId,
+		bool _doRR
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_healScheduler->Start( _doRR, true );
 	}
+	return false;
 }
+
+//-----------------------------------------------------------------------------
+// <Manager::CancelHealNetwork>
+// Stop a network heal
+//-----------------------------------------------------------------------------
+bool Manager::CancelHealNetwork
+(
+		uint32 const _homeId
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		return driver->m_healScheduler->Cancel();
+	}
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::AddNode>
 // Add a Device to the Network.
@@ -4728,6 +5506,38 @@ void Manager::GetDriverStatistics
 
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::GetHealStatistics>
+// Retrieve the progress and cost of a network heal.
+//-----------------------------------------------------------------------------
+void Manager::GetHealStatistics
+(
+		uint32 const _homeId,
+		Driver::HealData* _data
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		driver->GetHealStatistics( _data );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetSerialApiStatistics>
+// Retrieve the cost of each Serial API handler.
+//-----------------------------------------------------------------------------
+void Manager::GetSerialApiStatistics
+(
+		uint32 const _homeId,
+		list<Driver::SerialApiData>* _data
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		driver->GetSerialApiStatistics( _data );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // <Manager::GetNodeStatistics>
 // Retrieve driver based counters.
@@ -38,6 +38,7 @@
 #include "Defs.h"
 #include "Driver.h"
 #include "Group.h"
+#include "WatcherFilter.h"
 #include "value_classes/ValueID.h"
 
 namespace OpenZWave
@@ -347,16 +348,67 @@ namespace OpenZWave
 		 * \param _homeId The Home ID of the Z-Wave controller.
 		 */
 		string GetControllerPath( uint32 const _homeId );
+
+		/**
+		 * \brief Handle a Serial API function that OpenZWave does not handle itself.
+		 * The handler is called on the driver thread for each frame of that type and function
+		 * the controller sends, and its calls are counted by GetSerialApiStatistics.
+		 * \param _homeId The Home ID of the Z-Wave controller.
+		 * \param _type REQUEST or RESPONSE.
+		 * \param _function The Serial API function ID.
+		 * \param _handler The function to call.
+		 * \param _context Pointer passed to the handler.
+		 * \return True if the handler was added, or false if the function is already handled.
+		 * \see RemoveSerialApiHandler
+		 */
+		bool AddSerialApiHandler( uint32 const _homeId, uint8 const _type, uint8 const _function, Driver::pfnSerialApiHandler_t _handler, void* _context );
+
+		/**
+		 * \brief Remove a handler added by AddSerialApiHandler.
+		 * If the driver thread is in a call to an application's handler, this waits for the
+		 * call to return, so the handler's context may be freed once this returns.  It must
+		 * not be called while holding a lock that the handler takes.  A handler may remove
+		 * itself.
+		 * \param _homeId The Home ID of the Z-Wave controller.
+		 * \param _type REQUEST or RESPONSE.
+		 * \param _function The Serial API function ID.
+		 * \return True if there was a handler to remove.
+		 * \see AddSerialApiHandler
+		 */
+		bool RemoveSerialApiHandler( uint32 const _homeId, uint8 const _type, uint8 const _function );
 	/*@}*/
 
 	private:
+		struct Watcher;
+
+		/**
+		 * Per-driver routing and notification state.  A slot is claimed when the driver is added,
+		 * and its home ID is published once the driver is ready.  Slots are only changed with m_driverMutex
+		 * held, and m_driver and m_homeId are published atomically, so GetDriver scans the slots without
+		 * taking any lock and lookups on different controllers never contend.
+		 */
+		struct DriverSlot
+		{
+			Driver*				m_driver;				/**< Driver using this slot, or NULL if the slot is free */
+			uint32				m_homeId;				/**< Home ID of the driver, or zero until it is ready */
+			Mutex*				m_dispatchMutex;		/**< Serializes notification dispatch for this driver only */
+			uint32				m_watchersGeneration;	/**< Value of m_watchersGeneration when m_watchers was copied, or zero if there is no copy */
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			vector<Watcher*>	m_watchers;				/**< This driver's copy of the watcher list */
+OPENZWAVE_EXPORT_WARNINGS_ON
+		};
+
 		Driver* GetDriver( uint32 const _homeId );	/**< Get a pointer to a Driver object from the HomeID.  Only to be used by OpenZWave. */
 		void SetDriverReady( Driver* _driver, bool success );		/**< Indicate that the Driver is ready to be used, and send the notification callback. */
+		DriverSlot* GetDriverSlot( Driver const* _driver );		/**< Get the routing and dispatch slot of a driver, or NULL if it has none. */
+		void ReleaseDriverSlot( Driver const* _driver );		/**< Free the slot of a driver that has been deleted. */
 
 OPENZWAVE_EXPORT_WARNINGS_OFF
 		list<Driver*>		m_pendingDrivers;		/**< Drivers that are in the process of reading saved data and querying their Z-Wave network for basic information. */
 		map<uint32,Driver*>	m_readyDrivers;			/**< Drivers that are ready to be used by the application. */
 OPENZWAVE_EXPORT_WARNINGS_ON
+		DriverSlot			m_driverSlots[MAX_DRIVERS];	/**< Home ID routing table. */
+		Mutex*				m_driverMutex;			/**< Serializes changes to the pending list, the ready map and the routing table. */
 
 	//-----------------------------------------------------------------------------
 	//	Polling Z-Wave devices
@@ -423,6 +475,31 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		uint8 GetPollIntensity( ValueID const &_valueId );
 
+		/**
+		 * \brief Get the interval a value is currently polled at.
+		 * Without the AdaptivePolling option, this is the interval set by SetPollInterval and the value's
+		 * poll intensity.  With it, the interval follows how often the polls find the value changing, and
+		 * is longer for values that report their changes themselves.
+		 * \param _valueId The ID of the value to check polling.
+		 * \return The interval in milliseconds, or 0 if the value is not polled.
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_VALUEID if the ValueID is invalid
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
+		 * \see GetValueEffectivePollInterval
+		 */
+		int32 GetValuePollInterval( ValueID const &_valueId );
+
+		/**
+		 * \brief Get the interval a value is actually polled at.
+		 * With the AdaptivePolling option, the intervals of all the polled values are stretched when
+		 * polling them that often would use more than the PollAirtimeBudget option allows.  Otherwise
+		 * this is the same as GetValuePollInterval.
+		 * \param _valueId The ID of the value to check polling.
+		 * \return The interval in milliseconds, or 0 if the value is not polled.
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_VALUEID if the ValueID is invalid
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
+		 */
+		int32 GetValueEffectivePollInterval( ValueID const &_valueId );
+
 	/*@}*/
 
 	//-----------------------------------------------------------------------------
@@ -582,6 +659,68 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		uint32 GetNodeNeighbors( uint32 const _homeId, uint8 const _nodeId, uint8** _nodeNeighbors );
 
+		/**
+		 * \brief Whether two nodes can hear each other, according to either node's neighbor list
+		 *
+		 * Unlike GetNodeNeighbors, this does not copy the neighbor list.
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the nodes.
+		 * \param _nodeId The ID of the node to query.
+		 * \param _otherNodeId The ID of the other node.
+		 * \return True if the nodes are neighbors.
+		 */
+		bool AreNodesNeighbors( uint32 const _homeId, uint8 const _nodeId, uint8 const _otherNodeId );
+
+		/**
+		 * \brief Get the number of hops from the controller to a node, along the shortest path through the neighbor lists
+		 *
+		 * The network topology is worked out once each time a neighbor list changes, so this and
+		 * the related queries below are cheap enough to call for every node.
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
+		 * \param _nodeId The ID of the node to query.
+		 * \return The number of hops, 0 for the controller itself, or 0xff if the node cannot be reached.
+		 * \see GetNodeUpstreamNeighbor, IsNodeArticulationPoint, GetNodeRepeaterLoad
+		 */
+		uint8 GetNodeHopCount( uint32 const _homeId, uint8 const _nodeId );
+
+		/**
+		 * \brief Get the neighbor one hop nearer the controller through which a node is reached
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
+		 * \param _nodeId The ID of the node to query.
+		 * \return The node ID of the neighbor, or 0 if the node cannot be reached or is the controller.
+		 */
+		uint8 GetNodeUpstreamNeighbor( uint32 const _homeId, uint8 const _nodeId );
+
+		/**
+		 * \brief Whether a node is a single point of failure for the network
+		 *
+		 * An articulation point is a node that some other nodes have no way to reach the
+		 * controller without.  Those nodes are cut off if it fails.
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
+		 * \param _nodeId The ID of the node to query.
+		 * \return True if the node is an articulation point.
+		 * \see GetNodeDependentCount
+		 */
+		bool IsNodeArticulationPoint( uint32 const _homeId, uint8 const _nodeId );
+
+		/**
+		 * \brief Get the number of nodes that would be cut off from the controller if a node failed
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
+		 * \param _nodeId The ID of the node to query.
+		 * \return The number of nodes, which is 0 unless the node is an articulation point.
+		 */
+		uint8 GetNodeDependentCount( uint32 const _homeId, uint8 const _nodeId );
+
+		/**
+		 * \brief Get the number of messages that a node is expected to have repeated
+		 *
+		 * Counts the messages sent to and received from the nodes that reach the controller
+		 * through this node, taking each route to be the shortest path.
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
+		 * \param _nodeId The ID of the node to query.
+		 * \return The number of messages.
+		 */
+		uint32 GetNodeRepeaterLoad( uint32 const _homeId, uint8 const _nodeId );
+
 		/**
 		 * \brief Get the manufacturer name of a device
 		 * The manufacturer name would normally be handled by the Manufacturer Specific command class,
@@ -815,6 +954,15 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		bool IsNodeFailed( uint32 const _homeId, uint8 const _nodeId );
 
+		/**
+		 * \brief Get whether a warm started node's cached values are still being verified
+		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
+		 * \param _nodeId The ID of the node to query.
+		 * \return True if the node was restored from the cache by the WarmStart option, and
+		 * some of its values have yet to be requested from or reported by the device.
+		 */
+		bool IsNodeWarmStarted( uint32 const _homeId, uint8 const _nodeId );
+
 		/**
 		 * \brief Get whether the node's query stage as a string
 		 * \param _homeId The Home ID of the Z-Wave controller that manages the node.
@@ -1265,6 +1413,47 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		bool SetValueListSelection( ValueID const& _id, string const& _selectedItem );
 
+		/**
+		 * \brief Sets a value from a string, and follows the change until the device confirms it.
+		 * The value is set as by SetValue, and this method returns immediately.  The callback is
+		 * made once the device has acknowledged the message and reported the value requested, or
+		 * once the change has failed or timed out.  Write-only values are done when the device
+		 * acknowledges the message.  The callback is passed the outcome, the value the device last
+		 * reported, and how long the change took to be acknowledged and to complete, so it need not
+		 * watch for ValueChanged notifications or poll the value.
+		 * The callback is made on the driver thread, so it should return quickly.
+		 * A change is allowed the time in the SetValueTimeout option to be sent to a listening
+		 * device, and then the same time to be reported back.  Changes for sleeping devices wait
+		 * for the device to wake up before their timeout starts.
+		 * \param _id The unique identifier of the value.
+		 * \param _value The new value, as for SetValue.
+		 * \param _callback Function to call when the change is complete, or NULL.
+		 * \param _context Pointer passed to the callback.
+		 * \return An ID for the change, which is passed to the callback, or 0 if the value could not be set.
+		 * \see SetValue, Driver::SetValueStatus, Driver::SetValueResult
+		 */
+		uint32 SetValueAsync( ValueID const& _id, string const& _value, Driver::pfnOnSetValueComplete_t _callback, void* _context );
+
+		/**
+		 * \brief Sets several values from strings, as SetValue does for each in turn.
+		 * The changes for each node are sent together.  When a node supports the MultiCmd command
+		 * class, its Set commands, and the requests that follow them to refresh the values, are
+		 * combined in as few frames as they fit in, each keeping its own MultiChannel encapsulation
+		 * if the value belongs to an endpoint.  Otherwise, or when the MultiCmdRequests option is
+		 * false, each change is sent in a frame of its own.  Every ValueID is checked before any
+		 * change is sent, so that nothing is sent if one of them throws.  A value whose string
+		 * cannot be converted is skipped, as SetValue skips it, and the other changes are sent.
+		 * \param _ids The unique identifiers of the values.
+		 * \param _values The new values, as for SetValue, in the same order as _ids.
+		 * \return The number of values that were set.
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_VALUEID if a ValueID is invalid,
+		 * or if there is not a value for each ValueID
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_CANNOT_CONVERT_VALUEID if a value cannot be set from a string
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
+		 * \see SetValue
+		 */
+		uint32 SetValues( vector<ValueID> const& _ids, vector<string> const& _values );
+
 		/**
 		 * \brief Refreshes the specified value from the Z-Wave network.
 		 * A call to this function causes the library to send a message to the network to retrieve the current value
@@ -1320,6 +1509,41 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
 		 */
 		bool ReleaseButton( ValueID const& _id );
+
+		/**
+		 * \brief Gets the latest reports of a value, kept when the ValueHistory option is set.
+		 * \param _id The unique identifier of the value.
+		 * \param _since Only the reports made at or after this time, in seconds since the epoch, are returned.
+		 * \param o_samples Pointer that will be set to an array of the reports, oldest first.  The array
+		 * should be deleted with delete [] by the caller.  Set to NULL if there are no reports.
+		 * \return The number of reports in the array.
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
+		 * \see GetValueHistorySummaries
+		 */
+		uint32 GetValueHistory( ValueID const& _id, uint32 const _since, Driver::ValueHistorySample** o_samples );
+
+		/**
+		 * \brief Gets the minimum, maximum and average of the reports of a value over each period of a
+		 * tier of the value history.  The last summary is for the period in progress.
+		 * \param _id The unique identifier of the value.
+		 * \param _tier The tier, starting at 0 for the first period of the ValueHistoryTiers option.
+		 * \param _since Only the periods that end after this time, in seconds since the epoch, are returned.
+		 * \param o_summaries Pointer that will be set to an array of the summaries, oldest first.  The array
+		 * should be deleted with delete [] by the caller.  Set to NULL if there are no summaries.
+		 * \return The number of summaries in the array.
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
+		 * \see GetValueHistory, GetValueHistoryTierPeriod
+		 */
+		uint32 GetValueHistorySummaries( ValueID const& _id, uint8 const _tier, uint32 const _since, Driver::ValueHistorySummary** o_summaries );
+
+		/**
+		 * \brief Gets the length of the periods of a tier of the value history.
+		 * \param _homeId The Home ID of the Z-Wave controller.
+		 * \param _tier The tier, starting at 0.
+		 * \return The length of the periods in seconds, or 0 if there is no such tier or no value history.
+		 * \see GetValueHistorySummaries
+		 */
+		uint32 GetValueHistoryTierPeriod( uint32 const _homeId, uint8 const _tier );
 	/*@}*/
 
 	//-----------------------------------------------------------------------------
@@ -1497,6 +1721,35 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 * \see SetConfigParam, ValueID, Notification
 		 */
 		void RequestAllConfigParams( uint32 const _homeId, uint8 const _nodeId );
+
+		/**
+		 * \brief Read and write many configuration parameters, on any number of nodes, as one batch.
+		 * The nodes are worked on side by side, one message or pair of messages per node at a time.
+		 * Devices with version 2 of the Configuration command class have runs of consecutive
+		 * parameters read or written with single bulk messages.  Every parameter written is read
+		 * back, to confirm that the device accepted the value.
+		 * This method returns immediately.  When every item has a result, a
+		 * Notification::Type_ConfigBatchComplete notification is sent, and the results can be
+		 * collected with GetConfigParamsResults.  The values of the parameters are also reported
+		 * through the usual ValueChanged and ValueRefreshed notifications.
+		 * \param _homeId The Home ID of the Z-Wave controller.
+		 * \param _items The parameters to read and write.  See Driver::ConfigParamItem.
+		 * \return The ID of the batch, or 0 if it could not be started.
+		 * \see GetConfigParamsResults, SetConfigParam, RequestConfigParam
+		 */
+		uint8 ConfigureParams( uint32 const _homeId, vector<Driver::ConfigParamItem> const& _items );
+
+		/**
+		 * \brief Collect the results of a batch started by ConfigureParams.
+		 * The results of a finished batch are kept until they are collected, or until the batch
+		 * ID is needed again, 255 batches later.
+		 * \param _homeId The Home ID of the Z-Wave controller.
+		 * \param _batchId The ID returned by ConfigureParams.
+		 * \param o_items Filled with the items of the batch, in the order they were given, each with its result and the value reported by the device.
+		 * \return False if the batch does not exist or has not finished.
+		 * \see ConfigureParams
+		 */
+		bool GetConfigParamsResults( uint32 const _homeId, uint8 const _batchId, vector<Driver::ConfigParamItem>* o_items );
 	/*@}*/
 
 	//-----------------------------------------------------------------------------
@@ -1607,6 +1860,8 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 * In OpenZWave, all feedback from the Z-Wave network is sent to the application via callbacks.
 		 * This method allows the application to add a notification callback handler, known as a "watcher" to OpenZWave.
 		 * An application needs only add a single watcher - all notifications will be reported to it.
+		 * Notifications are delivered one at a time unless the ParallelNotifications option is set, in which
+		 * case each driver calls the watcher from its own thread, and the watcher must be thread safe.
 		 * \param _watcher pointer to a function that will be called by the notification system.
 		 * \param _context pointer to user defined data that will be passed to the watcher function with each notification.
 		 * \return true if the watcher was successfully added.
@@ -1614,38 +1869,100 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		bool AddWatcher( pfnOnNotification_t _watcher, void* _context );
 
+		/**
+		 * \brief Add a notification watcher that is only called for some notifications.
+		 * The filter is tested before the watcher is called, so the watcher costs little for the
+		 * notifications it does not want.
+		 * \param _watcher pointer to a function that will be called by the notification system.
+		 * \param _context pointer to user defined data that will be passed to the watcher function with each notification.
+		 * \param _filter the notifications to pass to the watcher.  It is copied, and can be discarded after the call.
+		 * \return true if the watcher was successfully added.
+		 * \see WatcherFilter, RemoveWatcher, GetWatcherStatistics
+		 */
+		bool AddWatcher( pfnOnNotification_t _watcher, void* _context, WatcherFilter const& _filter );
+
 		/**
 		 * \brief Remove a notification watcher.
+		 * The watcher will not be called again once this method returns, although with the ParallelNotifications
+		 * option set, a call already in progress on another driver's thread may still be completing.
 		 * \param _watcher pointer to a function that must match that passed to a previous call to AddWatcher
 		 * \param _context pointer to user defined data that must match the one passed in that same previous call to AddWatcher.
 		 * \return true if the watcher was successfully removed.
 		 * \see AddWatcher, Notification
 		 */
 		bool RemoveWatcher( pfnOnNotification_t _watcher, void* _context );
+
+		/**
+		 * \brief Get the number of notifications passed to a watcher, and the number its filter held back.
+		 * With the ParallelNotifications option set the counts are approximate, as drivers update them
+		 * from their own threads.
+		 * \param _watcher pointer to a function that must match that passed to a previous call to AddWatcher
+		 * \param _context pointer to user defined data that must match the one passed in that same previous call to AddWatcher.
+		 * \param o_delivered set to the number of notifications the watcher has been called for.
+		 * \param o_filtered set to the number of notifications its filter did not pass.
+		 * \return true if the watcher was found.
+		 * \see AddWatcher
+		 */
+		bool GetWatcherStatistics( pfnOnNotification_t _watcher, void* _context, uint32* o_delivered, uint32* o_filtered );
 	/*@}*/
 
 	private:
-		void NotifyWatchers( Notification* _notification );					// Passes the notifications to all the registered watcher callbacks in turn.
+		void NotifyWatchers( Driver* _driver, Notification* _notification );	// Passes the notifications to all the registered watcher callbacks in turn.
 
 		struct Watcher
 		{
 			pfnOnNotification_t	m_callback;
 			void*				m_context;
+			WatcherFilter*		m_filter;			// Notifications to pass, or NULL for all of them
+			bool volatile		m_removed;			// Set by RemoveWatcher so that drivers with an older copy of the list skip it
+			uint32				m_retiredGeneration;	// Value of m_watchersGeneration once the watcher was removed
+			uint32				m_delivered;
+			uint32				m_filtered;
 
 			Watcher
 			(
 				pfnOnNotification_t _callback,
-				void* _context
+				void* _context,
+				WatcherFilter* _filter
 			):
 				m_callback( _callback ),
-				m_context( _context )
+				m_context( _context ),
+				m_filter( _filter ),
+				m_removed( false ),
+				m_retiredGeneration( 0 ),
+				m_delivered( 0 ),
+				m_filtered( 0 )
+			{
+			}
+
+			~Watcher()
+			{
+				delete m_filter;
+			}
+
+			void Notify( Notification* _notification )
 			{
+				if( m_filter == NULL || m_filter->Matches( _notification ) )
+				{
+					++m_delivered;
+					m_callback( _notification, m_context );
+				}
+				else
+				{
+					++m_filtered;
+				}
 			}
 		};
 
+		bool InsertWatcher( Watcher* _watcher );
+		void PurgeRetiredWatchers();
+
 OPENZWAVE_EXPORT_WARNINGS_OFF
 		list<Watcher*>		m_watchers;										// List of all the registered watchers.
+		list<Watcher*>		m_retiredWatchers;								// Removed watchers, kept while drivers may still hold copies of them
 OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32 volatile		m_watchersGeneration;							// Incremented whenever m_watchers changes
+		bool				m_parallelNotifications;						// If true, drivers deliver their notifications concurrently rather than one at a time
 		Mutex*				m_notificationMutex;
 
 	//-----------------------------------------------------------------------------
@@ -1777,13 +2094,39 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 
  		/**
 		 * \brief Heal network by requesting node's rediscover their neighbors.
-		 * Sends a ControllerCommand_RequestNodeNeighborUpdate to every node.
-		 * Can take a while on larger networks.
+		 * Sends a ControllerCommand_RequestNodeNeighborUpdate to every awake node, nearest
+		 * the controller first, and only a few at a time (see the HealConcurrency,
+		 * HealNodeTimeout and HealTimeBudget options).  Progress is reported with
+		 * Notification::Type_HealProgress notifications.
+		 * Can take a while on larger networks.  Does nothing if a heal is already running.
 		 * \param _homeId The Home ID of the Z-Wave network to be healed.
 		 * \param _doRR Whether to perform return routes initialization.
+		 * \see HealDegradedNodes, CancelHealNetwork, GetHealStatistics
 		 */
 		void HealNetwork( uint32 const _homeId, bool _doRR );
 
+ 		/**
+		 * \brief Heal only the nodes whose routes have degraded since they were last healed.
+		 * A node has degraded if it has failed, lost its neighbors, or if a tenth of the
+		 * messages sent to it have failed or needed a retry, or its round trip time has
+		 * doubled.  The nodes are healed in the same order as by HealNetwork.
+		 * \param _homeId The Home ID of the Z-Wave network to be healed.
+		 * \param _doRR Whether to perform return routes initialization.
+		 * \return True if a heal was started, false if a heal is already running or no node has degraded.
+		 * \see HealNetwork
+		 */
+		bool HealDegradedNodes( uint32 const _homeId, bool _doRR );
+
+ 		/**
+		 * \brief Stop a network heal.
+		 * The controller command that is running is allowed to finish, and the nodes not yet
+		 * healed are reported as skipped.
+		 * \param _homeId The Home ID of the Z-Wave network.
+		 * \return True if a heal was running.
+		 * \see HealNetwork
+		 */
+		bool CancelHealNetwork( uint32 const _homeId );
+
 		/**
 		 * \brief Start the Inclusion Process to add a Node to the Network.
 		 * The Status of the Node Inclusion is communicated via Notifications. Specifically, you should
@@ -2368,6 +2711,20 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		void GetDriverStatistics( uint32 const _homeId, Driver::DriverData* _data );
 
+		/**
+		 * \brief Retrieve the progress and cost of the current or last network heal
+		 * \param _homeId The Home ID of the driver
+		 * \param _data Pointer to structure HealData to return values
+		 */
+		void GetHealStatistics( uint32 const _homeId, Driver::HealData* _data );
+
+		/**
+		 * \brief Retrieve the number of frames handled by each Serial API handler, and the time spent in it
+		 * \param _homeId The Home ID of the driver
+		 * \param _data List to fill with a SerialApiData entry for each handler that has been called
+		 */
+		void GetSerialApiStatistics( uint32 const _homeId, list<Driver::SerialApiData>* _data );
+
 		/**
 		 * \brief Retrieve statistics per node
 		 * \param _homeId The Home ID of the driver for the node
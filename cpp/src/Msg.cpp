@@ -32,6 +32,7 @@
 #include "Utils.h"
 #include "ZWSecurity.h"
 #include "platform/Log.h"
+#include "platform/Mutex.h"
 #include "command_classes/MultiInstance.h"
 #include "command_classes/Security.h"
 #include "aes/aescpp.h"
@@ -41,6 +42,18 @@ using namespace OpenZWave;
 /* Callback for normal messages start at 10. Special Messages using a Callback prior to 10 */
 uint8 Msg::s_nextCallbackId = 10;
 
+// Deleted messages are kept on a free list for reuse rather than being returned
+// to the heap.  The pool grows a slab at a time and is never shrunk.
+struct MsgPoolBlock
+{
+	MsgPoolBlock*	m_next;
+};
+
+static size_t const c_msgBlockSize = ( sizeof(Msg) + sizeof(MsgPoolBlock) - 1 ) / sizeof(MsgPoolBlock) * sizeof(MsgPoolBlock);
+static uint32 const c_msgSlabSize = 32;						// Messages allocated each time the pool grows
+static MsgPoolBlock* s_msgFreeList = NULL;
+static Mutex* s_msgPoolMutex = new Mutex();
+
 #define DEBUG 1
 
 //-----------------------------------------------------------------------------
@@ -49,7 +62,7 @@ uint8 Msg::s_nextCallbackId = 10;
 //-----------------------------------------------------------------------------
 Msg::Msg
 (
-	string const& _logText,
+	char const* _logText,
 	uint8 _targetNodeId,
 	uint8 const _msgType,
 	uint8 const _function,
@@ -73,7 +86,8 @@ Msg::Msg
 	m_flags( 0 ),
 	m_encrypted ( false ),
 	m_noncerecvd ( false ),
-	m_homeId ( 0 )
+	m_homeId ( 0 ),
+	m_setValueRequest( 0 )
 {
 	if( _bReplyRequired )
 	{
@@ -87,6 +101,66 @@ Msg::Msg
 	m_buffer[3] = _function;
 }
 
+//-----------------------------------------------------------------------------
+// <Msg::operator new>
+// Take a message from the pool
+//-----------------------------------------------------------------------------
+void* Msg::operator new
+(
+	size_t _size
+)
+{
+	if( _size != sizeof(Msg) )
+	{
+		return ::operator new( _size );
+	}
+
+	s_msgPoolMutex->Lock();
+	if( s_msgFreeList == NULL )
+	{
+		// Grow the pool
+		uint8* slab = (uint8*)::operator new( c_msgBlockSize * c_msgSlabSize );
+		for( uint32 i=0; i<c_msgSlabSize; ++i )
+		{
+			MsgPoolBlock* block = (MsgPoolBlock*)( slab + i * c_msgBlockSize );
+			block->m_next = s_msgFreeList;
+			s_msgFreeList = block;
+		}
+	}
+	MsgPoolBlock* block = s_msgFreeList;
+	s_msgFreeList = block->m_next;
+	s_msgPoolMutex->Unlock();
+	return block;
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::operator delete>
+// Return a message to the pool
+//-----------------------------------------------------------------------------
+void Msg::operator delete
+(
+	void* _p,
+	size_t _size
+)
+{
+	if( _p == NULL )
+	{
+		return;
+	}
+
+	if( _size != sizeof(Msg) )
+	{
+		::operator delete( _p );
+		return;
+	}
+
+	s_msgPoolMutex->Lock();
+	MsgPoolBlock* block = (MsgPoolBlock*)_p;
+	block->m_next = s_msgFreeList;
+	s_msgFreeList = block;
+	s_msgPoolMutex->Unlock();
+}
+
 //-----------------------------------------------------------------------------
 // <Msg::SetInstance>
 // Used to enable wrapping with MultiInstance/MultiChannel during finalize.
@@ -220,9 +294,20 @@ void Msg::UpdateCallbackId()
 //-----------------------------------------------------------------------------
 string Msg::GetAsString()
 {
-	string str = m_logText;
+	string str;
+	char byteStr[64];
+	if( ( m_flags & m_MultiChannel ) != 0 )
+	{
+		snprintf( byteStr, sizeof(byteStr), "MultiChannel Encapsulated (instance=%d): ", m_instance );
+		str = byteStr;
+	}
+	else if( ( m_flags & m_MultiInstance ) != 0 )
+	{
+		snprintf( byteStr, sizeof(byteStr), "MultiInstance Encapsulated (instance=%d): ", m_instance );
+		str = byteStr;
+	}
+	str += m_logText;
 
-	char byteStr[16];
 	if( m_targetNodeId != 0xff )
 	{
 		snprintf( byteStr, sizeof(byteStr), " (Node=%d)", m_targetNodeId );
@@ -253,7 +338,6 @@ void Msg::MultiEncap
 (
 )
 {
-	char str[256];
 	if( m_buffer[3]	!= FUNC_ID_ZW_SEND_DATA )
 	{
 		return;
@@ -274,9 +358,6 @@ void Msg::MultiEncap
 		m_buffer[8] = 1;
 		m_buffer[9] = m_endPoint;
 		m_length += 4;
-
-		snprintf( str, sizeof(str), "MultiChannel Encapsulated (instance=%d): %s", m_instance, m_logText.c_str() );
-		m_logText = str;
 	}
 	else
 	{
@@ -291,9 +372,6 @@ void Msg::MultiEncap
 		m_buffer[7] = MultiInstance::MultiInstanceCmd_Encap;
 		m_buffer[8] = m_instance;
 		m_length += 3;
-
-		snprintf( str, sizeof(str), "MultiInstance Encapsulated (instance=%d): %s", m_instance, m_logText.c_str() );
-		m_logText = str;
 	}
 }
 
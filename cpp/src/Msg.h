@@ -40,6 +40,11 @@ namespace OpenZWave
 	class Driver;
 
 	/** \brief Message object to be passed to and from devices on the Z-Wave network.
+	 *
+	 * Messages are allocated from a pool and recycled when deleted, so that sending
+	 * does not allocate once the pool has grown to the number of messages in flight.
+	 * The log text passed to the constructor is not copied, so it must be a string
+	 * literal or otherwise outlive the message.
 	 */
 	class OPENZWAVE_EXPORT Msg
 	{
@@ -50,9 +55,12 @@ namespace OpenZWave
 			m_MultiInstance			= 0x02,		// Indicate MultiInstance encapsulation
 		};
 
-		Msg( string const& _logtext, uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 );
+		Msg( char const* _logtext, uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 );
 		~Msg(){}
 
+		static void* operator new( size_t _size );
+		static void operator delete( void* _p, size_t _size );
+
 		void SetInstance( CommandClass* _cc, uint8 const _instance );	// Used to enable wrapping with MultiInstance/MultiChannel during finalize.
 
 		void Append( uint8 const _data );
@@ -95,6 +103,13 @@ namespace OpenZWave
 		 */
 		uint8 GetExpectedInstance()const{ return m_instance; }
 
+		/**
+		 * \brief For messages wrapped in a MultiChannel command class, identifies the endpoint the
+		 * report is expected to come from.
+		 * \return Endpoint of the message, or zero if it is not sent to an endpoint.
+		 */
+		uint8 GetEndPoint()const{ return m_endPoint; }
+
 		/**
 		 * \brief For messages that request a Report for a specified command class, identifies the expected Index
 		 * for the variable being obtained in the report.
@@ -105,10 +120,15 @@ namespace OpenZWave
 		 * \brief get the LogText Associated with this message
 		 * \return the LogText used during the constructor
 		 */
-		string GetLogText()const{ return m_logText; }
+		char const* GetLogText()const{ return m_logText; }
 
 		uint32 GetLength()const{ return m_encrypted == true ? m_length + 20 + 6 : m_length; }
 		uint8* GetBuffer();
+
+		/**
+		 * \brief Describe the message and its raw data for the log.  This formats every byte, so
+		 * callers on busy paths should check Log::IsLevelEnabled first.
+		 */
 		string GetAsString();
 
 		uint8 GetSendAttempts()const{ return m_sendAttempts; }
@@ -165,6 +185,13 @@ namespace OpenZWave
 		}
 		void SetHomeId(uint32 homeId) { m_homeId = homeId; };
 
+		/**
+		 * \brief Identifies the Manager::SetValueAsync request (if any) that this message carries out.
+		 * \return ID of the request, or zero if the message is not tracked.
+		 */
+		uint32 GetSetValueRequest()const{ return m_setValueRequest; }
+		void SetSetValueRequest( uint32 const _requestId ){ m_setValueRequest = _requestId; }
+
 		/** Returns a pointer to the driver (interface with a Z-Wave controller)
 		 *  associated with this node.
 		*/
@@ -174,7 +201,7 @@ namespace OpenZWave
 
 		void MultiEncap();						// Encapsulate the data inside a MultiInstance/Multicommand message
 
-		string			m_logText;
+		char const*		m_logText;
 		bool			m_bFinal;
 		bool			m_bCallbackRequired;
 
@@ -197,6 +224,7 @@ namespace OpenZWave
 		bool			m_noncerecvd;
 		uint8			m_nonce[8];
 		uint32			m_homeId;
+		uint32			m_setValueRequest;		// Manager::SetValueAsync request carried out by this message
 		static uint8	s_nextCallbackId;		// counter to get a unique callback id
 	};
 
@@ -0,0 +1,568 @@
+//-----------------------------------------------------------------------------
+//
+//	NetworkGraph.cpp
+//
+//	The routing topology of a Z-Wave network
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "NetworkGraph.h"
+#include "platform/Mutex.h"
+#include "platform/Log.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<PopCount64>
+//	Number of bits set in a word
+//-----------------------------------------------------------------------------
+static inline uint32 PopCount64
+(
+	uint64 _bits
+)
+{
+#if defined(__GNUC__)
+	return (uint32)__builtin_popcountll( _bits );
+#else
+	_bits = _bits - ( ( _bits >> 1 ) & 0x5555555555555555ULL );
+	_bits = ( _bits & 0x3333333333333333ULL ) + ( ( _bits >> 2 ) & 0x3333333333333333ULL );
+	_bits = ( _bits + ( _bits >> 4 ) ) & 0x0f0f0f0f0f0f0f0fULL;
+	return (uint32)( ( _bits * 0x0101010101010101ULL ) >> 56 );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//	<LowestBit64>
+//	Index of the lowest bit set in a non-zero word
+//-----------------------------------------------------------------------------
+static inline uint32 LowestBit64
+(
+	uint64 _bits
+)
+{
+#if defined(__GNUC__)
+	return (uint32)__builtin_ctzll( _bits );
+#else
+	return PopCount64( ( _bits & ( 0 - _bits ) ) - 1 );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::NetworkGraph>
+//	Constructor
+//-----------------------------------------------------------------------------
+NetworkGraph::NetworkGraph
+(
+	Driver* _driver
+):
+	m_driver( _driver ),
+	m_mutex( new Mutex() ),
+	m_dirty( true ),
+	m_root( 0 ),
+	m_maxHops( 0 )
+{
+	memset( m_reported, 0, sizeof(m_reported) );
+	memset( m_links, 0, sizeof(m_links) );
+	memset( m_traffic, 0, sizeof(m_traffic) );
+	memset( m_hops, 0xff, sizeof(m_hops) );
+	memset( m_upstream, 0, sizeof(m_upstream) );
+	memset( m_dependents, 0, sizeof(m_dependents) );
+	memset( m_load, 0, sizeof(m_load) );
+	memset( &m_articulationPoints, 0, sizeof(m_articulationPoints) );
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::~NetworkGraph>
+//	Destructor
+//-----------------------------------------------------------------------------
+NetworkGraph::~NetworkGraph
+(
+)
+{
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::SetNeighbors>
+//	Store the neighbor list of a node
+//-----------------------------------------------------------------------------
+void NetworkGraph::SetNeighbors
+(
+	uint8 const _nodeId,
+	uint8 const* _neighbors
+)
+{
+	// The controller's bitmap has bit n-1 for node n
+	Row row;
+	memset( &row, 0, sizeof(row) );
+	for( uint32 i=0; i<NUM_NODE_BITFIELD_BYTES; ++i )
+	{
+		uint32 bit = i * 8 + 1;
+		row.m_bits[bit>>6] |= (uint64)_neighbors[i] << ( bit & 63 );
+		if( ( bit & 63 ) > 56 )
+		{
+			row.m_bits[(bit>>6)+1] |= (uint64)_neighbors[i] >> ( 64 - ( bit & 63 ) );
+		}
+	}
+	ClearBit( row, _nodeId );
+
+	m_mutex->Lock();
+	if( memcmp( &row, &m_reported[_nodeId], sizeof(row) ) )
+	{
+		m_reported[_nodeId] = row;
+		m_dirty = true;
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::RemoveNode>
+//	Forget a node that has left the network
+//-----------------------------------------------------------------------------
+void NetworkGraph::RemoveNode
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	memset( &m_reported[_nodeId], 0, sizeof(Row) );
+	for( uint32 i=0; i<256; ++i )
+	{
+		ClearBit( m_reported[i], _nodeId );
+	}
+	m_traffic[_nodeId] = 0;
+	m_dirty = true;
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::RecordTraffic>
+//	Count a message to or from a node against the repeaters that route for it
+//-----------------------------------------------------------------------------
+void NetworkGraph::RecordTraffic
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	++m_traffic[_nodeId];
+	if( !m_dirty && m_hops[_nodeId] != 0xff )
+	{
+		// The loads are worked out from scratch by the next analysis otherwise
+		for( uint8 repeater = m_upstream[_nodeId]; repeater != 0 && repeater != m_root; repeater = m_upstream[repeater] )
+		{
+			++m_load[repeater];
+		}
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::AreNeighbors>
+//	Whether either node lists the other as a neighbor
+//-----------------------------------------------------------------------------
+bool NetworkGraph::AreNeighbors
+(
+	uint8 const _nodeId,
+	uint8 const _otherNodeId
+)
+{
+	m_mutex->Lock();
+	bool res = TestBit( m_reported[_nodeId], _otherNodeId ) || TestBit( m_reported[_otherNodeId], _nodeId );
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetNeighborCount>
+//	Number of nodes linked to a node
+//-----------------------------------------------------------------------------
+uint8 NetworkGraph::GetNeighborCount
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint8 res = (uint8)Count( m_links[_nodeId] );
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetHopCount>
+//	Number of hops from the controller to a node
+//-----------------------------------------------------------------------------
+uint8 NetworkGraph::GetHopCount
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint8 res = m_hops[_nodeId];
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetUpstreamNode>
+//	Neighbor one hop nearer the controller
+//-----------------------------------------------------------------------------
+uint8 NetworkGraph::GetUpstreamNode
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint8 res = m_upstream[_nodeId];
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::IsArticulationPoint>
+//	Whether other nodes depend on a node to reach the controller
+//-----------------------------------------------------------------------------
+bool NetworkGraph::IsArticulationPoint
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	bool res = TestBit( m_articulationPoints, _nodeId );
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetDependentCount>
+//	Number of nodes that depend on a node to reach the controller
+//-----------------------------------------------------------------------------
+uint8 NetworkGraph::GetDependentCount
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint8 res = m_dependents[_nodeId];
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetRepeaterLoad>
+//	Messages expected to have been routed through a node
+//-----------------------------------------------------------------------------
+uint32 NetworkGraph::GetRepeaterLoad
+(
+	uint8 const _nodeId
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint32 res = m_load[_nodeId];
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetMaxHopCount>
+//	Hops to the farthest node
+//-----------------------------------------------------------------------------
+uint8 NetworkGraph::GetMaxHopCount
+(
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint8 res = m_maxHops;
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::GetArticulationPointCount>
+//	Number of nodes that others depend on
+//-----------------------------------------------------------------------------
+uint8 NetworkGraph::GetArticulationPointCount
+(
+)
+{
+	m_mutex->Lock();
+	Analyse();
+	uint8 res = (uint8)Count( m_articulationPoints );
+	m_mutex->Unlock();
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::Analyse>
+//	Work out the hops, articulation points and loads again if the neighbor
+//	lists have changed
+//-----------------------------------------------------------------------------
+void NetworkGraph::Analyse
+(
+)
+{
+	uint8 root = m_driver->GetControllerNodeId();
+	if( !m_dirty && root == m_root )
+	{
+		return;
+	}
+	m_dirty = false;
+	m_root = root;
+
+	// Make the links symmetric
+	memcpy( m_links, m_reported, sizeof(m_links) );
+	for( uint32 nodeId=1; nodeId<256; ++nodeId )
+	{
+		Row row = m_reported[nodeId];
+		int32 neighbor;
+		while( ( neighbor = PopLowest( row ) ) >= 0 )
+		{
+			SetBit( m_links[neighbor], nodeId );
+		}
+	}
+
+	memset( m_hops, 0xff, sizeof(m_hops) );
+	memset( m_upstream, 0, sizeof(m_upstream) );
+	memset( m_dependents, 0, sizeof(m_dependents) );
+	memset( m_load, 0, sizeof(m_load) );
+	memset( &m_articulationPoints, 0, sizeof(m_articulationPoints) );
+	m_maxHops = 0;
+
+	if( root == 0 || root == 0xff )
+	{
+		// The controller's node ID is not known yet
+		return;
+	}
+
+	FindHops( root );
+	FindArticulationPoints( root );
+	FindRepeaterLoads( root );
+
+	Log::Write( LogLevel_Detail, "Network graph: %d hops to the farthest node, %d articulation points", m_maxHops, Count( m_articulationPoints ) );
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::FindHops>
+//	Breadth first search out from the controller, a whole frontier at a time
+//-----------------------------------------------------------------------------
+void NetworkGraph::FindHops
+(
+	uint8 const _root
+)
+{
+	Row visited;
+	Row frontier;
+	memset( &visited, 0, sizeof(visited) );
+	memset( &frontier, 0, sizeof(frontier) );
+	SetBit( visited, _root );
+	SetBit( frontier, _root );
+	m_hops[_root] = 0;
+
+	for( uint8 hops=1; !IsEmpty( frontier ); ++hops )
+	{
+		// Everything linked to the frontier that has not already been reached
+		Row next;
+		memset( &next, 0, sizeof(next) );
+		Row members = frontier;
+		int32 nodeId;
+		while( ( nodeId = PopLowest( members ) ) >= 0 )
+		{
+			for( uint32 w=0; w<c_words; ++w )
+			{
+				next.m_bits[w] |= m_links[nodeId].m_bits[w];
+			}
+		}
+		for( uint32 w=0; w<c_words; ++w )
+		{
+			next.m_bits[w] &= ~visited.m_bits[w];
+			visited.m_bits[w] |= next.m_bits[w];
+		}
+
+		// Each new node is reached through its lowest numbered neighbor in the frontier
+		members = next;
+		while( ( nodeId = PopLowest( members ) ) >= 0 )
+		{
+			Row upstream;
+			for( uint32 w=0; w<c_words; ++w )
+			{
+				upstream.m_bits[w] = m_links[nodeId].m_bits[w] & frontier.m_bits[w];
+			}
+			m_hops[nodeId] = hops;
+			m_upstream[nodeId] = (uint8)PopLowest( upstream );
+			m_maxHops = hops;
+		}
+
+		frontier = next;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::FindArticulationPoints>
+//	Depth first search from the controller, recording for each node the
+//	earliest visited node that its subtree links back to.  A node is an
+//	articulation point if one of its subtrees cannot link back past it.
+//-----------------------------------------------------------------------------
+void NetworkGraph::FindArticulationPoints
+(
+	uint8 const _root
+)
+{
+	uint8 order[256];			// Order of discovery, or 0 if not yet visited
+	uint8 low[256];				// Earliest discovered node reachable from the subtree
+	uint8 parent[256];
+	uint8 size[256];			// Nodes in the subtree
+	Row pending[256];			// Links not yet followed
+	uint8 stack[256];
+	uint32 depth = 0;
+	uint8 visits = 0;
+
+	memset( order, 0, sizeof(order) );
+	memcpy( pending, m_links, sizeof(pending) );
+
+	order[_root] = low[_root] = ++visits;
+	parent[_root] = 0;
+	size[_root] = 1;
+	stack[depth++] = _root;
+
+	while( depth )
+	{
+		uint8 nodeId = stack[depth-1];
+		int32 neighbor = PopLowest( pending[nodeId] );
+		if( neighbor >= 0 )
+		{
+			if( order[neighbor] == 0 )
+			{
+				order[neighbor] = low[neighbor] = ++visits;
+				parent[neighbor] = nodeId;
+				size[neighbor] = 1;
+				stack[depth++] = (uint8)neighbor;
+			}
+			else if( neighbor != parent[nodeId] && order[neighbor] < low[nodeId] )
+			{
+				low[nodeId] = order[neighbor];
+			}
+			continue;
+		}
+
+		// Every link of this node has been followed
+		--depth;
+		uint8 up = parent[nodeId];
+		if( up == 0 )
+		{
+			continue;
+		}
+
+		size[up] += size[nodeId];
+		if( low[nodeId] < low[up] )
+		{
+			low[up] = low[nodeId];
+		}
+
+		// The controller itself is not counted as a repeater
+		if( up != _root && low[nodeId] >= order[up] )
+		{
+			SetBit( m_articulationPoints, up );
+			m_dependents[up] += size[nodeId];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::FindRepeaterLoads>
+//	Add up the traffic of each node's descendants in the shortest path tree
+//-----------------------------------------------------------------------------
+void NetworkGraph::FindRepeaterLoads
+(
+	uint8 const _root
+)
+{
+	uint32 subtotal[256];
+	memcpy( subtotal, m_traffic, sizeof(subtotal) );
+
+	// Farthest first, so that each subtotal is complete before it is passed on
+	for( uint32 hops=m_maxHops; hops>1; --hops )
+	{
+		for( uint32 nodeId=1; nodeId<256; ++nodeId )
+		{
+			if( m_hops[nodeId] == hops )
+			{
+				subtotal[m_upstream[nodeId]] += subtotal[nodeId];
+			}
+		}
+	}
+
+	for( uint32 nodeId=1; nodeId<256; ++nodeId )
+	{
+		if( m_hops[nodeId] != 0xff && nodeId != _root )
+		{
+			m_load[nodeId] = subtotal[nodeId] - m_traffic[nodeId];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::Count>
+//	Number of bits set in a row
+//-----------------------------------------------------------------------------
+uint32 NetworkGraph::Count
+(
+	Row const& _row
+)
+{
+	uint32 count = 0;
+	for( uint32 w=0; w<c_words; ++w )
+	{
+		count += PopCount64( _row.m_bits[w] );
+	}
+	return count;
+}
+
+//-----------------------------------------------------------------------------
+//	<NetworkGraph::PopLowest>
+//	Clear and return the lowest bit set in a row
+//-----------------------------------------------------------------------------
+int32 NetworkGraph::PopLowest
+(
+	Row& _row
+)
+{
+	for( uint32 w=0; w<c_words; ++w )
+	{
+		if( uint64 bits = _row.m_bits[w] )
+		{
+			_row.m_bits[w] = bits & ( bits - 1 );
+			return (int32)( w * 64 + LowestBit64( bits ) );
+		}
+	}
+	return -1;
+}
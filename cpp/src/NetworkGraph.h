@@ -0,0 +1,168 @@
+//-----------------------------------------------------------------------------
+//
+//	NetworkGraph.h
+//
+//	The routing topology of a Z-Wave network
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _NetworkGraph_H
+#define _NetworkGraph_H
+
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Mutex;
+
+	/** \brief The neighbor lists of every node, held as bitsets, and what can be worked
+	 * out from them.
+	 *
+	 * Each node's row is 256 bits, stored as four 64 bit words, so that unions,
+	 * intersections and counts over a whole row take a handful of instructions.  Two
+	 * nodes are linked if either lists the other, since a neighbor list read from the
+	 * controller is not always symmetric.
+	 *
+	 * Whenever a neighbor list changes, the graph is analysed again the next time it is
+	 * queried.  The analysis finds:
+	 * - the number of hops from the controller to each node, with a breadth first search
+	 *   that moves a whole frontier at a time;
+	 * - the articulation points: nodes whose failure would cut others off from the
+	 *   controller, and how many nodes they would cut off;
+	 * - the load on each repeater: the messages sent to or received from the nodes that
+	 *   reach the controller through it.  Routes are taken to follow the shortest path
+	 *   tree, as the controller's actual choice of route is not reported.
+	 *
+	 * The answers are cached, so each query after that is a lookup.  The driver thread
+	 * updates the graph; any thread may query it.
+	 */
+	class NetworkGraph
+	{
+	public:
+		NetworkGraph( Driver* _driver );
+		~NetworkGraph();
+
+		/**
+		 * Store the neighbor list of a node, as read from the controller.
+		 * @param _nodeId The node.
+		 * @param _neighbors Bitmap of NUM_NODE_BITFIELD_BYTES bytes, with the bit for node n at (n-1).
+		 */
+		void SetNeighbors( uint8 const _nodeId, uint8 const* _neighbors );
+
+		/**
+		 * Forget a node that has left the network.
+		 */
+		void RemoveNode( uint8 const _nodeId );
+
+		/**
+		 * Count a message sent to or received from a node, towards the load on the repeaters
+		 * that route for it.
+		 */
+		void RecordTraffic( uint8 const _nodeId );
+
+		bool AreNeighbors( uint8 const _nodeId, uint8 const _otherNodeId );
+		uint8 GetNeighborCount( uint8 const _nodeId );
+
+		/**
+		 * @return The number of hops from the controller to the node, or 0xff if the node cannot be reached.
+		 */
+		uint8 GetHopCount( uint8 const _nodeId );
+
+		/**
+		 * @return The neighbor one hop nearer the controller through which the node is reached, or 0 if there is none.
+		 */
+		uint8 GetUpstreamNode( uint8 const _nodeId );
+
+		/**
+		 * @return True if the failure of this node would leave other nodes unable to reach the controller.
+		 */
+		bool IsArticulationPoint( uint8 const _nodeId );
+
+		/**
+		 * @return The number of nodes that would be cut off from the controller if this node failed.
+		 */
+		uint8 GetDependentCount( uint8 const _nodeId );
+
+		/**
+		 * @return The messages to and from other nodes that are expected to have been routed through this node.
+		 */
+		uint32 GetRepeaterLoad( uint8 const _nodeId );
+
+		/**
+		 * @return The number of hops from the controller to the farthest node it can reach.
+		 */
+		uint8 GetMaxHopCount();
+
+		/**
+		 * @return The number of articulation points in the network.
+		 */
+		uint8 GetArticulationPointCount();
+
+	private:
+		NetworkGraph( NetworkGraph const& );					// prevent copy
+		NetworkGraph& operator = ( NetworkGraph const& );		// prevent assignment
+
+		enum
+		{
+			c_words = 4											// 64 bit words in a row
+		};
+
+		struct Row
+		{
+			uint64	m_bits[c_words];
+		};
+
+		void Analyse();											// Caller must hold the lock
+		void FindHops( uint8 const _root );
+		void FindArticulationPoints( uint8 const _root );
+		void FindRepeaterLoads( uint8 const _root );
+
+		static bool TestBit( Row const& _row, uint32 const _bit ){ return ( _row.m_bits[_bit>>6] & ( (uint64)1 << ( _bit & 63 ) ) ) != 0; }
+		static void SetBit( Row& _row, uint32 const _bit ){ _row.m_bits[_bit>>6] |= ( (uint64)1 << ( _bit & 63 ) ); }
+		static void ClearBit( Row& _row, uint32 const _bit ){ _row.m_bits[_bit>>6] &= ~( (uint64)1 << ( _bit & 63 ) ); }
+		static bool IsEmpty( Row const& _row ){ return ( _row.m_bits[0] | _row.m_bits[1] | _row.m_bits[2] | _row.m_bits[3] ) == 0; }
+		static uint32 Count( Row const& _row );
+		static int32 PopLowest( Row& _row );					// Clear and return the lowest set bit, or -1
+
+		Driver*		m_driver;
+		Mutex*		m_mutex;
+		bool		m_dirty;									// The neighbor lists have changed since the last analysis
+		uint8		m_root;										// Controller node ID used by the last analysis
+
+		// Bit n of a row stands for node ID n
+		Row			m_reported[256];							// Neighbor lists as read from the controller
+		Row			m_links[256];								// Links in either direction
+		uint32		m_traffic[256];								// Messages to and from each node
+
+		// Results of the last analysis
+		uint8		m_hops[256];
+		uint8		m_upstream[256];
+		uint8		m_dependents[256];
+		uint32		m_load[256];
+		Row			m_articulationPoints;
+		uint8		m_maxHops;
+	};
+
+} // namespace OpenZWave
+
+#endif //_NetworkGraph_H
@@ -34,6 +34,7 @@
 #include "Options.h"
 #include "Manager.h"
 #include "Driver.h"
+#include "NetworkGraph.h"
 #include "Notification.h"
 #include "Msg.h"
 #include "ZWSecurity.h"
@@ -125,6 +126,8 @@ m_queryStage( QueryStage_None ),
 m_queryPending( false ),
 m_queryConfiguration( false ),
 m_queryRetries( 0 ),
+m_queryCompleteCached( false ),
+m_warmStarted( false ),
 m_protocolInfoReceived( false ),
 m_basicprotocolInfoReceived( false ),
 m_nodeInfoReceived( false ),
@@ -170,14 +173,18 @@ m_lastRequestRTT( 0 ),
 m_lastResponseRTT( 0 ),
 m_averageRequestRTT( 0 ),
 m_averageResponseRTT( 0 ),
+m_smoothedRTT( 0 ),
+m_rttVariance( 0 ),
+m_retryTimeout( 0 ),
+m_retryBackoff( 0 ),
 m_quality( 0 ),
 m_lastReceivedMessage(),
 m_errors( 0 ),
-m_lastnonce ( 0 )
+m_nextRecentFrame( 0 )
 {
 	memset( m_neighbors, 0, sizeof(m_neighbors) );
+	memset( m_recentFrames, 0, sizeof(m_recentFrames) );
 	memset( m_routeNodes, 0, sizeof(m_routeNodes) );
-	memset( m_nonces, 0, sizeof(m_nonces) );
 	AddCommandClass( 0 );
 }
 
@@ -191,6 +198,7 @@ Node::~Node
 {
 	// Remove any messages from queues
 	GetDriver()->RemoveQueues( m_nodeId );
+	GetDriver()->m_networkGraph->RemoveNode( m_nodeId );
 
 	// Remove the values from the poll list
 	for( ValueStore::Iterator it = m_values->Begin(); it != m_values->End(); ++it )
@@ -630,6 +638,7 @@ void Node::AdvanceQueries
 				// Request the session values from the command classes in turn
 				// examples of Session information are: current thermostat setpoints, node names and climate control schedules
 				Log::Write( LogLevel_Detail, m_nodeId, "QueryStage_Session" );
+				GetDriver()->BeginMultiCmd( m_nodeId );
 				for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
 				{
 					if( !it->second->IsAfterMark() )
@@ -637,6 +646,7 @@ void Node::AdvanceQueries
 						m_queryPending |= it->second->RequestStateForAllInstances( CommandClass::RequestFlag_Session, Driver::MsgQueue_Query );
 					}
 				}
+				GetDriver()->EndMultiCmd();
 				addQSC = m_queryPending;
 				if( !m_queryPending )
 				{
@@ -801,6 +811,33 @@ void Node::SetQueryStage
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Node::WarmStart>
+// Use the cached state of a completely queried node without re-querying it
+//-----------------------------------------------------------------------------
+bool Node::WarmStart
+(
+)
+{
+	if( !m_queryCompleteCached || m_queryStage < QueryStage_CacheLoad )
+	{
+		// The node was not fully queried last time, so it still needs the full interview
+		return false;
+	}
+
+	Log::Write( LogLevel_Info, m_nodeId, "Warm start - using cached state, values will be refreshed in the background" );
+	m_queryStage = QueryStage_Complete;
+	m_queryPending = false;
+	m_queryRetries = 0;
+	m_queryCompleteCached = false;
+	m_warmStarted = true;
+
+	Notification* notification = new Notification( Notification::Type_NodeQueriesComplete );
+	notification->SetHomeAndNodeIds( m_homeId, m_nodeId );
+	GetDriver()->QueueNotification( notification );
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // <Node::GetQueryStageName>
 // Gets the query stage name
@@ -875,6 +912,9 @@ void Node::ReadXML
 	str = _node->Attribute( "query_stage" );
 	if( str )
 	{
+		// Remember whether the node had been completely queried, so that it can be warm started.
+		m_queryCompleteCached = !strcmp( str, c_queryStageNames[QueryStage_Complete] );
+
 		// After restoring state from a file, we need to at least refresh the association, session and dynamic values.
 		QueryStage queryStage = QueryStage_Associations;
 		for( uint32 i=0; i<(uint32)QueryStage_Associations; ++i )
@@ -1734,6 +1774,7 @@ void Node::SetNodeAlive
 		Log::Write( LogLevel_Error, m_nodeId, "WARNING: node revived" );
 		m_nodeAlive = true;
 		m_errors = 0;
+		GetDriver()->CloseCircuit( m_nodeId );
 		if( m_queryStage != Node::QueryStage_Complete )
 		{
 			m_queryRetries = 0; // restart at last stage
@@ -1747,6 +1788,7 @@ void Node::SetNodeAlive
 	{
 		Log::Write( LogLevel_Error, m_nodeId, "ERROR: node presumed dead" );
 		m_nodeAlive = false;
+		GetDriver()->OpenCircuit( m_nodeId );
 		if( m_queryStage != Node::QueryStage_Complete )
 		{
 			// Check whether all nodes are now complete
@@ -1881,6 +1923,51 @@ void Node::ApplicationCommandHandler
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Node::IsDuplicateFrame>
+// Whether the same command was received from the node within the last _window
+// milliseconds.  The frame is remembered, so that its own copies are caught.
+//-----------------------------------------------------------------------------
+bool Node::IsDuplicateFrame
+(
+		uint8 const* _data,
+		bool const _encrypted,
+		uint32 const _window
+)
+{
+	if( _window == 0 )
+	{
+		return false;
+	}
+
+	// FNV-1a over the command class, command and payload.  Any sequence number
+	// or session ID the command carries is part of the payload.
+	uint32 hash = 2166136261u;
+	hash = ( hash ^ ( _encrypted ? 1 : 0 ) ) * 16777619u;
+	for( uint32 i=4; i<5u+_data[4]; ++i )
+	{
+		hash = ( hash ^ _data[i] ) * 16777619u;
+	}
+
+	uint64 now = TimeStamp::GetMicroseconds();
+	uint64 window = (uint64)_window * 1000;
+	for( uint32 i=0; i<c_numRecentFrames; ++i )
+	{
+		RecentFrame const& frame = m_recentFrames[i];
+		if( frame.m_time != 0 && frame.m_hash == hash && now - frame.m_time <= window )
+		{
+			// The window runs from the first copy, so a command a device repeats
+			// for as long as it is held is still passed on now and then
+			return true;
+		}
+	}
+
+	m_recentFrames[m_nextRecentFrame].m_hash = hash;
+	m_recentFrames[m_nextRecentFrame].m_time = now;
+	m_nextRecentFrame = ( m_nextRecentFrame + 1 ) % c_numRecentFrames;
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // <Node::GetCommandClass>
 // Get the specified command class object if supported, otherwise NULL
@@ -2051,7 +2138,9 @@ bool Node::RequestAllConfigParams
 	bool res = false;
 	if( Configuration* cc = static_cast<Configuration*>( GetCommandClass( Configuration::StaticGetCommandClassId() ) ) )
 	{
-		// Go through all the values in the value store, and request all those which are in the Configuration command class
+		// Go through all the values in the value store, and request all those which are in the Configuration command class.
+		// Nodes that support MultiCmd are sent the requests together.
+		GetDriver()->BeginMultiCmd( m_nodeId );
 		for( ValueStore::Iterator it = m_values->Begin(); it != m_values->End(); ++it )
 		{
 			Value* value = it->second;
@@ -2064,6 +2153,7 @@ bool Node::RequestAllConfigParams
 				res |= cc->RequestValue( _requestFlags, value->GetID().GetIndex(), 1, Driver::MsgQueue_Query );
 			}
 		}
+		GetDriver()->EndMultiCmd();
 	}
 
 	return res;
@@ -2077,7 +2167,10 @@ bool Node::RequestDynamicValues
 (
 )
 {
+	// Nodes that support MultiCmd are sent the requests together, rather than one
+	// frame for each sensor type, meter scale, setpoint or color channel
 	bool res = false;
+	GetDriver()->BeginMultiCmd( m_nodeId );
 	for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
 	{
 		if( !it->second->IsAfterMark() )
@@ -2085,6 +2178,7 @@ bool Node::RequestDynamicValues
 			res |= it->second->RequestStateForAllInstances( CommandClass::RequestFlag_Dynamic, Driver::MsgQueue_Send );
 		}
 	}
+	GetDriver()->EndMultiCmd();
 
 	return res;
 }
@@ -3292,6 +3386,9 @@ void Node::GetNodeStatistics
 	_data->m_receivedTS = m_receivedTS.GetAsString();
 	_data->m_averageRequestRTT = m_averageRequestRTT;
 	_data->m_averageResponseRTT = m_averageResponseRTT;
+	_data->m_smoothedRTT = m_smoothedRTT;
+	_data->m_rttVariance = m_rttVariance;
+	_data->m_retryTimeout = m_retryTimeout;
 	_data->m_quality = m_quality;
 	memcpy( _data->m_lastReceivedMessage, m_lastReceivedMessage, sizeof(m_lastReceivedMessage) );
 	for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
@@ -3421,64 +3518,6 @@ Node::DeviceClass* Node::GenericDeviceClass::GetSpecificDeviceClass
 	return NULL;
 }
 
-//-----------------------------------------------------------------------------
-// <Node::GenerateNonceKey>
-// Generate a NONCE key for this node
-//-----------------------------------------------------------------------------
-uint8 *Node::GenerateNonceKey() {
-	uint8 idx = this->m_lastnonce;
-
-	/* The first byte must be unique and non-zero.  The others are random.
-	   Per Numerical Recipes in C its best to use the high-order byte.  The
-	   floating point calculation here doesn't assume the size of the random
-	   integer, otherwise we could just shift the high byte over.
-	*/
-	uint8 match = 0;
-	do {
-		this->m_nonces[idx][0] = 1 + (uint8) (255.0 * rand() / (RAND_MAX + 1.0));
-		match = 0;
-		for (int i = 0; i < 8; i++) {
-			if (i == idx) {
-				continue;
-			}
-			if (this->m_nonces[idx][0] == this->m_nonces[i][0]) {
-				match = 1;
-			}
-		}
-	} while (match);
-
-	/* The other bytes have no restrictions. */
-	for (int i = 1; i < 8; i++) {
-		this->m_nonces[idx][i] = (int) (256.0 * rand() / (RAND_MAX + 1.0));
-	}
-
-	this->m_lastnonce++;
-	if (this->m_lastnonce >= 8)
-		this->m_lastnonce = 0;
-	for (uint8 i = 0; i < 8; i++) {
-		PrintHex("NONCES", (const uint8_t*)this->m_nonces[i], 8);
-	}
-	return &this->m_nonces[idx][0];
-}
-//-----------------------------------------------------------------------------
-// <Node::GetNonceKey>
-// Get a NONCE key for this node that matches the nonceid.
-//-----------------------------------------------------------------------------
-
-uint8 *Node::GetNonceKey(uint32 nonceid) {
-	for (uint8 i = 0; i < 8; i++) {
-		/* make sure the nonceid matches the first byte of our stored Nonce */
-		if (nonceid == this->m_nonces[i][0]) {
-			return &this->m_nonces[i][0];
-		}
-	}
-	Log::Write(LogLevel_Warning, m_nodeId, "A Nonce with id %x does not exist", nonceid);
-	for (uint8 i = 0; i < 8; i++) {
-		PrintHex("NONCES", (const uint8_t*)this->m_nonces[i], 8);
-	}
-	return NULL;
-}
-
 //-----------------------------------------------------------------------------
 // <Node::GetDeviceTypeString>
 // Get the ZWave+ DeviceType as a String
@@ -65,6 +65,7 @@ namespace OpenZWave
 	{
 			friend class Manager;
 			friend class Driver;
+			friend class HealScheduler;
 			friend class Group;
 			friend class Value;
 			friend class ValueButton;
@@ -199,6 +200,22 @@ namespace OpenZWave
 			 */
 			void SetQueryStage( QueryStage const _stage, bool const _advance = true );
 
+			/**
+			 * Mark a node restored from the zwcfg_*.xml file as fully queried, so it can be used
+			 * straight away from the cached state.  Only nodes whose saved query stage was
+			 * QueryStage_Complete can be warm started.
+			 * \return True if the node was moved to QueryStage_Complete.
+			 * \see Driver::HandleSerialAPIGetInitDataResponse
+			 */
+			bool WarmStart();
+
+			/**
+			 * Returns true if the node was restored from the cache by WarmStart, and the
+			 * background refresh has yet to request or receive some of its values.
+			 * \see Manager::IsNodeWarmStarted
+			 */
+			bool IsWarmStarted()const{ return m_warmStarted; }
+
 			/**
 			 * Returns the current query stage enum.
 			 * \return Enum value with the current query stage.
@@ -266,6 +283,8 @@ namespace OpenZWave
 			bool		m_queryPending;
 			bool		m_queryConfiguration;
 			uint8		m_queryRetries;
+			bool		m_queryCompleteCached;		// True if the saved query stage in the zwcfg_*.xml file was Complete
+			bool		m_warmStarted;				// True if the node was restored from the cache without being re-queried
 			bool		m_protocolInfoReceived;
 			bool		m_basicprotocolInfoReceived;
 			bool		m_nodeInfoReceived;
@@ -590,6 +609,11 @@ namespace OpenZWave
 					uint8 m_quality;					// Node quality measure
 					uint8 m_lastReceivedMessage[254];
 					list<CommandClassData> m_ccData;
+					// Added after 1.4, which made the struct larger: code that calls
+					// Manager::GetNodeStatistics must be rebuilt against this header
+					uint32 m_smoothedRTT;					// ms, when AdaptiveRetryTimeout is enabled
+					uint32 m_rttVariance;					// ms
+					uint32 m_retryTimeout;					// ms, or zero until the first timeout has been estimated
 			};
 
 			private:
@@ -599,7 +623,7 @@ namespace OpenZWave
 			uint32 m_sentFailed;				// Number of sent messages failed
 			uint32 m_retries;				// Number of message retries
 			uint32 m_receivedCnt;				// Number of messages received from this node.
-			uint32 m_receivedDups;				// Number of duplicated messages received;
+			uint32 m_receivedDups;				// Number of duplicate messages received, and dropped;
 			uint32 m_receivedUnsolicited;			// Number of messages received unsolicited
 			uint32 m_lastRequestRTT;			// Last message request RTT
 			uint32 m_lastResponseRTT;			// Last message response RTT
@@ -607,21 +631,26 @@ namespace OpenZWave
 			TimeStamp m_receivedTS;				// Last message received time
 			uint32 m_averageRequestRTT;			// Average Request round trip time.
 			uint32 m_averageResponseRTT;			// Average Response round trip time.
+			int32 m_smoothedRTT;				// Smoothed transaction round trip time, as in TCP's SRTT
+			int32 m_rttVariance;				// Round trip time variation, as in TCP's RTTVAR
+			int32 m_retryTimeout;				// Current retry timeout, or zero to use the RetryTimeout option
+			uint8 m_retryBackoff;				// Number of times the retry timeout has been doubled since the last round trip
 			uint8 m_quality;				// Node quality measure
 			uint8 m_lastReceivedMessage[254];		// Place to hold last received message
 			uint8 m_errors;					// Count errors for dead node detection
 
-			//-----------------------------------------------------------------------------
-			//	Encryption Related
-			//-----------------------------------------------------------------------------
-			public:
-
-			uint8 *GenerateNonceKey();
-			uint8 *GetNonceKey(uint32 nonceid);
+			// Recently received frames, to spot the copies a device retransmits or the
+			// network delivers by more than one route
+			struct RecentFrame
+			{
+				uint32 m_hash;					// Hash of the command and its payload
+				uint64 m_time;					// When it was received, in microseconds
+			};
+			enum { c_numRecentFrames = 8 };
+			RecentFrame m_recentFrames[c_numRecentFrames];
+			uint8 m_nextRecentFrame;			// Slot of m_recentFrames to overwrite next
 
-			private:
-			uint8 m_lastnonce;
-			uint8 m_nonces[8][8];
+			bool IsDuplicateFrame( uint8 const* _data, bool const _encrypted, uint32 const _window );
 	};
 
 
@@ -141,6 +141,9 @@ string Notification::GetAsString() const {
 				case Code_Alive:
 					str = "Notification - Node Alive";
 					break;
+				case Code_Dropped:
+					str = "Notification - Message Dropped";
+					break;
 			}
 			break;
 		case Type_DriverRemoved:
@@ -223,9 +226,31 @@ string Notification::GetAsString() const {
 					break;
 			}
 			break;
-			case Type_NodeReset:
-				str = "Node Reset";
-				break;
+		case Type_NodeReset:
+			str = "Node Reset";
+			break;
+		case Type_HealProgress:
+			switch (m_event) {
+				case Driver::HealEvent_NodeHealed:
+					str = "HealProgress - NodeHealed";
+					break;
+				case Driver::HealEvent_NodeFailed:
+					str = "HealProgress - NodeFailed";
+					break;
+				case Driver::HealEvent_NodeTimedOut:
+					str = "HealProgress - NodeTimedOut";
+					break;
+				case Driver::HealEvent_NodeSkipped:
+					str = "HealProgress - NodeSkipped";
+					break;
+				case Driver::HealEvent_Completed:
+					str = "HealProgress - Completed";
+					break;
+			}
+			break;
+		case Type_ConfigBatchComplete:
+			str = "ConfigBatchComplete";
+			break;
 	}
 	return str;
 
@@ -44,7 +44,9 @@ namespace OpenZWave
 		friend class Manager;
 		friend class Driver;
 		friend class Node;
+		friend class ConfigScheduler;
 		friend class Group;
+		friend class HealScheduler;
 		friend class Value;
 		friend class ValueStore;
 		friend class Basic;
@@ -94,7 +96,9 @@ namespace OpenZWave
 			Type_DriverRemoved,					/**< The Driver is being removed. (either due to Error or by request) Do Not Call Any Driver Related Methods after receiving this call */
 			Type_ControllerCommand,				/**< When Controller Commands are executed, Notifications of Success/Failure etc are communicated via this Notification
 												  * Notification::GetEvent returns Driver::ControllerState and Notification::GetNotification returns Driver::ControllerError if there was a error */
-			Type_NodeReset						/**< The Device has been reset and thus removed from the NodeList in OZW */
+			Type_NodeReset,						/**< The Device has been reset and thus removed from the NodeList in OZW */
+			Type_HealProgress,					/**< A node has been dealt with by Manager::HealNetwork, or the heal has finished.  Notification::GetEvent returns Driver::HealEvent */
+			Type_ConfigBatchComplete			/**< A batch started by Manager::ConfigureParams has finished.  Notification::GetBatchId returns its ID, to pass to Manager::GetConfigParamsResults */
 		};
 
 		/**
@@ -110,7 +114,8 @@ namespace OpenZWave
 			Code_Awake,						/**< Report when a sleeping node wakes up */
 			Code_Sleep,						/**< Report when a node goes to sleep */
 			Code_Dead,						/**< Report when a node is presumed dead */
-			Code_Alive						/**< Report when a node is revived */
+			Code_Alive,						/**< Report when a node is revived */
+			Code_Dropped					/**< Report, once each time a node is presumed dead, that messages such as Sets are being failed without being sent until it responds */
 		};
 
 		/**
@@ -145,10 +150,10 @@ namespace OpenZWave
 		uint8 GetGroupIdx()const{ assert(Type_Group==m_type); return m_byte; }
 
 		/**
-		 * Get the event value of a notification.  Only valid in Notification::Type_NodeEvent and Notification::Type_ControllerCommand notifications.
+		 * Get the event value of a notification.  Only valid in Notification::Type_NodeEvent, Notification::Type_ControllerCommand and Notification::Type_HealProgress notifications.
 		 * \return the event value.
 		 */
-		uint8 GetEvent()const{ assert((Type_NodeEvent==m_type) || (Type_ControllerCommand == m_type)); return m_event; }
+		uint8 GetEvent()const{ assert((Type_NodeEvent==m_type) || (Type_ControllerCommand == m_type) || (Type_HealProgress == m_type)); return m_event; }
 
 		/**
 		 * Get the button id of a notification.  Only valid in Notification::Type_CreateButton, Notification::Type_DeleteButton,
@@ -163,6 +168,12 @@ namespace OpenZWave
 		 */
 		uint8 GetSceneId()const{ assert(Type_SceneEvent==m_type); return m_byte; }
 
+		/**
+		 * Get the ID of a batch of configuration parameter reads and writes.  Only valid in Notification::Type_ConfigBatchComplete notifications.
+		 * \see Manager::ConfigureParams
+		 */
+		uint8 GetBatchId()const{ assert(Type_ConfigBatchComplete==m_type); return m_byte; }
+
 		/**
 		 * Get the notification code from a notification. Only valid for Notification::Type_Notification or Notification::Type_ControllerCommand notifications.
 		 * \return the notification code.
@@ -190,8 +201,9 @@ namespace OpenZWave
 		void SetHomeNodeIdAndInstance ( uint32 const _homeId, uint8 const _nodeId, uint32 const _instance ){ m_valueId = ValueID( _homeId, _nodeId, _instance ); }
 		void SetValueId( ValueID const& _valueId ){ m_valueId = _valueId; }
 		void SetGroupIdx( uint8 const _groupIdx ){ assert(Type_Group==m_type); m_byte = _groupIdx; }
-		void SetEvent( uint8 const _event ){ assert(Type_NodeEvent==m_type || Type_ControllerCommand == m_type); m_event = _event; }
+		void SetEvent( uint8 const _event ){ assert(Type_NodeEvent==m_type || Type_ControllerCommand == m_type || Type_HealProgress == m_type); m_event = _event; }
 		void SetSceneId( uint8 const _sceneId ){ assert(Type_SceneEvent==m_type); m_byte = _sceneId; }
+		void SetBatchId( uint8 const _batchId ){ assert(Type_ConfigBatchComplete==m_type); m_byte = _batchId; }
 		void SetButtonId( uint8 const _buttonId ){ assert(Type_CreateButton==m_type||Type_DeleteButton==m_type||Type_ButtonOn==m_type||Type_ButtonOff==m_type); m_byte = _buttonId; }
 		void SetNotification( uint8 const _noteId ){ assert((Type_Notification==m_type) || (Type_ControllerCommand == m_type)); m_byte = _noteId; }
 
@@ -129,10 +129,36 @@ Options* Options::Create
 		s_instance->AddOptionString(	"SecurityStrategy", 		"SUPPORTED", 	false);		// Should we encrypt CC's that are available via both clear text and Security CC?
 		s_instance->AddOptionString(	"CustomSecuredCC", 			"0x62,0x4c,0x63", 	false);	// What List of Custom CC should we always encrypt if SecurityStrategy is CUSTOM
 		s_instance->AddOptionBool(		"EnforceSecureReception",	true);						// if we recieve a clear text message for a CC that is Secured, should we drop the message
-
-#if defined WINRT
-		s_instance->AddOptionInt(       "ThreadTerminateTimeout",   -1);						// Since threads cannot be terminated in WinRT, Thread::Terminate will simply wait for them to exit on there own
-#endif
+		s_instance->AddOptionBool(		"ParallelNotifications",	false);						// if true, each driver calls the watchers from its own thread (watchers must then be thread safe)
+		s_instance->AddOptionBool(		"WarmStart",				false);						// Use completely queried nodes straight from the zwcfg_*.xml cache, and verify their values in the background
+		s_instance->AddOptionInt(		"WarmStartRefreshInterval",	1000);						// Minimum time in ms between the background value refreshes of warm started nodes
+		s_instance->AddOptionString(	"CaptureFile",				string(""),		false );	// Record the serial traffic of each controller in a binary capture file, named after this and the controller
+		s_instance->AddOptionInt(		"MaxPendingReports",		0);							// How many nodes may owe us a report while requests are sent to other nodes. 0 waits for each report before sending anything else
+		s_instance->AddOptionBool(		"AdaptiveRetryTimeout",		false);						// Estimate the retry timeout of each node from its round trip times, rather than always using RetryTimeout
+		s_instance->AddOptionInt(		"RetryTimeoutMin",			1000);						// Shortest retry timeout estimated for a node, in ms
+		s_instance->AddOptionInt(		"RetryTimeoutMax",			RETRY_TIMEOUT);				// Longest retry timeout a node can reach by backing off after failures, in ms
+		s_instance->AddOptionBool(		"SerialDirectRead",			false);						// Read serial controllers from the driver thread instead of a thread of their own (unix only)
+		s_instance->AddOptionInt(		"HealConcurrency",			1);							// Number of nodes a network heal works on at once
+		s_instance->AddOptionInt(		"HealNodeTimeout",			60000);						// Time allowed to heal each node, in ms
+		s_instance->AddOptionInt(		"HealTimeBudget",			0);							// Time allowed for a whole network heal, in ms, or 0 for no limit
+		s_instance->AddOptionInt(		"DeadNodeProbeInterval",	10000);						// Time before a node presumed dead is first probed, in ms, or 0 to wait for it to be heard from
+		s_instance->AddOptionInt(		"DeadNodeProbeIntervalMax",	600000);					// Longest time between probes of a node presumed dead, in ms
+		s_instance->AddOptionInt(		"ConfigBatchTimeout",		30000);						// Time allowed for a node to report the parameters of each step of a configuration batch, in ms
+		s_instance->AddOptionBool(		"ReportThread",				false);						// if true, the reports of interviewed nodes are decoded on a thread of their own rather than on the driver thread
+		s_instance->AddOptionInt(		"DuplicateWindow",			500);						// Time in ms within which a node's repeat of a command is dropped, or 0 to decode every copy
+		s_instance->AddOptionString(	"DuplicateWindows",			string(""),		false );	// Per command class overrides of DuplicateWindow, such as "0x31=0,0x71=2000"
+		s_instance->AddOptionInt(		"SetValueTimeout",			10000);						// Time allowed for a Manager::SetValueAsync change to be sent, and then to be reported back, in ms
+		s_instance->AddOptionBool(		"MultiCmdRequests",			true);						// Combine a node's state requests, and the changes made by Manager::SetValues, in MultiCmd frames when it supports them
+		s_instance->AddOptionBool(		"AdaptivePolling",			false);						// Poll each value more or less often, according to how it changes and whether it reports changes itself
+		s_instance->AddOptionInt(		"PollAirtimeBudget",		10);						// Percentage of the time adaptive polling may keep the network busy
+		s_instance->AddOptionString(	"ValueHistory",				string(""),		false );	// Samples kept of each reported value, per genre or hex command class ID, such as "user=256,0x31=1024".  Empty for no history
+		s_instance->AddOptionString(	"ValueHistoryTiers",		string("60,3600"),	false );	// Periods in seconds summarized by the coarser tiers of the value history
+		s_instance->AddOptionInt(		"ValueHistoryMemory",		4096);						// Most memory the value history may use, in KB
+		s_instance->AddOptionInt(		"SecurityWorkers",			0);							// Threads that decrypt secured frames, or 0 to decrypt them on the driver thread
+
+#if defined WINRT
+		s_instance->AddOptionInt(       "ThreadTerminateTimeout",   -1);						// Since threads cannot be terminated in WinRT, Thread::Terminate will simply wait for them to exit on there own
+#endif
 	}
 
 	return s_instance;
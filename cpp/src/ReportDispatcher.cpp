@@ -0,0 +1,252 @@
+//-----------------------------------------------------------------------------
+//
+//	ReportDispatcher.cpp
+//
+//	Decodes the command class reports of nodes on a thread of their own, away from
+//	the driver thread
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "Node.h"
+#include "Utils.h"
+#include "ReportDispatcher.h"
+#include "platform/Event.h"
+#include "platform/Mutex.h"
+#include "platform/Thread.h"
+#include "platform/Log.h"
+
+#include "command_classes/Association.h"
+#include "command_classes/CRC16Encap.h"
+#include "command_classes/DeviceResetLocally.h"
+#include "command_classes/ManufacturerSpecific.h"
+#include "command_classes/MultiChannelAssociation.h"
+#include "command_classes/Security.h"
+#include "command_classes/Version.h"
+#include "command_classes/WakeUp.h"
+#include "command_classes/ZWavePlusInfo.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::ReportDispatcher>
+//	Constructor
+//-----------------------------------------------------------------------------
+ReportDispatcher::ReportDispatcher
+(
+	Driver* _driver
+):
+	m_driver( _driver ),
+	m_thread( new Thread( "report" ) ),
+	m_mutex( new Mutex() ),
+	m_queueEvent( new Event() ),
+	m_doneEvent( new Event() ),
+	m_decoded( 0 )
+{
+	memset( m_pending, 0, sizeof(m_pending) );
+	m_thread->Start( ReportDispatcher::ReportThreadEntryPoint, this );
+
+	Log::Write( LogLevel_Info, "Decoding the reports of interviewed nodes on the report thread" );
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::~ReportDispatcher>
+//	Destructor
+//-----------------------------------------------------------------------------
+ReportDispatcher::~ReportDispatcher
+(
+)
+{
+	m_thread->Stop();
+	m_thread->Release();
+
+	// Frames still queued are dropped
+	while( !m_frames.empty() )
+	{
+		delete m_frames.front();
+		m_frames.pop_front();
+	}
+
+	m_doneEvent->Release();
+	m_queueEvent->Release();
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::Dispatch>
+//	Queue a frame for the report thread
+//-----------------------------------------------------------------------------
+bool ReportDispatcher::Dispatch
+(
+	uint8 const* _data,
+	bool const _encrypted
+)
+{
+	uint8 nodeId = _data[3];
+	Node* node = m_driver->GetNodeUnsafe( nodeId );
+	if( node == NULL || node->GetCurrentQueryStage() != Node::QueryStage_Complete || IsDriverThreadClass( _data[5] ) )
+	{
+		// The caller decodes this one, after the reports that came before it
+		Flush( nodeId );
+		return false;
+	}
+
+	Frame* frame = new Frame();
+	uint32 length = _data[4] + 6;
+	if( length > c_maxFrame )
+	{
+		length = c_maxFrame;
+	}
+	memcpy( frame->m_data, _data, length );
+	frame->m_encrypted = _encrypted;
+
+	LockGuard LG( m_mutex );
+	m_frames.push_back( frame );
+	++m_pending[nodeId];
+	m_queueEvent->Set();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::Flush>
+//	Wait until the frames queued for a node have been decoded
+//-----------------------------------------------------------------------------
+void ReportDispatcher::Flush
+(
+	uint8 const _nodeId
+)
+{
+	while( true )
+	{
+		m_mutex->Lock();
+		if( m_pending[_nodeId] == 0 )
+		{
+			m_mutex->Unlock();
+			return;
+		}
+		m_doneEvent->Reset();
+		m_mutex->Unlock();
+
+		Wait::Single( m_doneEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::GetDecodedCount>
+//	Number of frames decoded by the report thread
+//-----------------------------------------------------------------------------
+uint32 ReportDispatcher::GetDecodedCount
+(
+)
+{
+	LockGuard LG( m_mutex );
+	return m_decoded;
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::IsDriverThreadClass>
+//	Whether a command class's reports are always decoded on the driver thread.
+//	These drive the interview, the node's security, or the node's removal, and
+//	the driver thread acts on them straight away.
+//-----------------------------------------------------------------------------
+bool ReportDispatcher::IsDriverThreadClass
+(
+	uint8 const _commandClassId
+)
+{
+	return( _commandClassId == Association::StaticGetCommandClassId()
+		|| _commandClassId == CRC16Encap::StaticGetCommandClassId()
+		|| _commandClassId == DeviceResetLocally::StaticGetCommandClassId()
+		|| _commandClassId == ManufacturerSpecific::StaticGetCommandClassId()
+		|| _commandClassId == MultiChannelAssociation::StaticGetCommandClassId()
+		|| _commandClassId == Security::StaticGetCommandClassId()
+		|| _commandClassId == Version::StaticGetCommandClassId()
+		|| _commandClassId == WakeUp::StaticGetCommandClassId()
+		|| _commandClassId == ZWavePlusInfo::StaticGetCommandClassId() );
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::ReportThreadEntryPoint>
+//	Entry point of the report thread
+//-----------------------------------------------------------------------------
+void ReportDispatcher::ReportThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	ReportDispatcher* dispatcher = (ReportDispatcher*)_context;
+	dispatcher->ReportThreadProc( _exitEvent );
+}
+
+//-----------------------------------------------------------------------------
+//	<ReportDispatcher::ReportThreadProc>
+//	Decode the queued frames in the order they were queued
+//-----------------------------------------------------------------------------
+void ReportDispatcher::ReportThreadProc
+(
+	Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;
+	waitObjects[1] = m_queueEvent;
+
+	while( true )
+	{
+		if( Wait::Multiple( waitObjects, 2 ) == 0 )
+		{
+			// Exit has been signalled
+			return;
+		}
+
+		m_mutex->Lock();
+		while( !m_frames.empty() )
+		{
+			Frame* frame = m_frames.front();
+			m_frames.pop_front();
+			m_mutex->Unlock();
+
+			uint8 nodeId = frame->m_data[3];
+			{
+				// The node may have been removed since the frame was queued
+				LockGuard LG( m_driver->m_nodeMutex );
+				if( Node* node = m_driver->GetNode( nodeId ) )
+				{
+					node->ApplicationCommandHandler( frame->m_data, frame->m_encrypted );
+				}
+			}
+			delete frame;
+
+			m_mutex->Lock();
+			--m_pending[nodeId];
+			++m_decoded;
+			m_doneEvent->Set();
+		}
+		m_queueEvent->Reset();
+		m_mutex->Unlock();
+	}
+}
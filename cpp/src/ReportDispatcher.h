@@ -0,0 +1,120 @@
+//-----------------------------------------------------------------------------
+//
+//	ReportDispatcher.h
+//
+//	Decodes the command class reports of nodes on a thread of their own, away from
+//	the driver thread
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ReportDispatcher_H
+#define _ReportDispatcher_H
+
+#include <deque>
+
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Event;
+	class Mutex;
+	class Thread;
+
+	/** \brief Hands the command class reports of nodes to a thread of their own, so
+	 * that the driver thread can go back to reading and acknowledging frames while
+	 * they are decoded.
+	 *
+	 * The driver thread still frames, checksums and acknowledges every message, decrypts
+	 * secured ones, and matches reports to the requests that are waiting for them.  Only
+	 * the call to Node::ApplicationCommandHandler moves to the report thread.
+	 *
+	 * The report thread decodes frames in the order they arrived, holding the driver's
+	 * node mutex as the poll thread and the Manager methods do while they touch a node.
+	 * Since decoding needs that mutex, more than one report thread would not decode any
+	 * faster, so there is only one.
+	 *
+	 * Reports from nodes that are still being interviewed, and from the command classes
+	 * that take part in the interview or in security, are decoded on the driver thread
+	 * as before.  Before it does so, the driver thread waits for the report thread to
+	 * finish the frames it holds for that node.
+	 */
+	class ReportDispatcher
+	{
+	public:
+		ReportDispatcher( Driver* _driver );
+		~ReportDispatcher();
+
+		/**
+		 * Queue an application command handler frame to be decoded by the report thread.
+		 * @param _data The frame, from the message type byte onwards.
+		 * @param _encrypted Whether the frame arrived inside a security encapsulation.
+		 * @return False if the frame must be decoded on the calling thread instead, in
+		 * which case the node's queued frames have all been decoded by the time it returns.
+		 */
+		bool Dispatch( uint8 const* _data, bool const _encrypted );
+
+		/**
+		 * Wait until the frames queued for a node have been decoded.
+		 */
+		void Flush( uint8 const _nodeId );
+
+		/**
+		 * Number of frames decoded by the report thread.
+		 */
+		uint32 GetDecodedCount();
+
+	private:
+		ReportDispatcher( ReportDispatcher const& );					// prevent copy
+		ReportDispatcher& operator = ( ReportDispatcher const& );		// prevent assignment
+
+		enum
+		{
+			c_maxFrame = 262											// Header, and the longest command a frame can carry
+		};
+
+		struct Frame
+		{
+			uint8				m_data[c_maxFrame];
+			bool				m_encrypted;
+		};
+
+		bool IsDriverThreadClass( uint8 const _commandClassId );
+		void ReportThreadProc( Event* _exitEvent );
+
+		static void ReportThreadEntryPoint( Event* _exitEvent, void* _context );
+
+		Driver*				m_driver;
+		Thread*				m_thread;
+		Mutex*				m_mutex;									// Guards the frames, the pending counts and the decoded count
+		Event*				m_queueEvent;								// Set while there are frames to decode
+		Event*				m_doneEvent;								// Set each time a frame has been decoded
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		deque<Frame*>		m_frames;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32				m_decoded;
+		uint32				m_pending[256];								// Frames queued or being decoded, per node
+	};
+
+} // namespace OpenZWave
+
+#endif //_ReportDispatcher_H
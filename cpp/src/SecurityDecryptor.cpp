@@ -0,0 +1,292 @@
+//-----------------------------------------------------------------------------
+//
+//	SecurityDecryptor.cpp
+//
+//	Decrypts and authenticates the secured frames of nodes on worker threads,
+//	away from the driver thread
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "Utils.h"
+#include "SecurityDecryptor.h"
+#include "ZWSecurity.h"
+#include "platform/Event.h"
+#include "platform/Mutex.h"
+#include "platform/Thread.h"
+#include "platform/Log.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::SecurityDecryptor>
+//	Constructor
+//-----------------------------------------------------------------------------
+SecurityDecryptor::SecurityDecryptor
+(
+	Driver* _driver,
+	uint32 const _numWorkers
+):
+	m_driver( _driver ),
+	m_numWorkers( _numWorkers ),
+	m_workers( new Worker[_numWorkers] ),
+	m_jobPool( new Job[c_numJobs] ),
+	m_resultMutex( new Mutex() ),
+	m_resultEvent( new Event() )
+{
+	memset( m_pending, 0, sizeof(m_pending) );
+
+	m_freeJobs.reserve( c_numJobs );
+	for( uint32 i=0; i<c_numJobs; ++i )
+	{
+		m_freeJobs.push_back( &m_jobPool[i] );
+	}
+
+	for( uint32 i=0; i<m_numWorkers; ++i )
+	{
+		char name[32];
+		snprintf( name, sizeof(name), "secworker%d", i );
+
+		Worker& worker = m_workers[i];
+		worker.m_owner = this;
+		worker.m_thread = new Thread( name );
+		worker.m_mutex = new Mutex();
+		worker.m_queueEvent = new Event();
+		worker.m_thread->Start( SecurityDecryptor::WorkerThreadEntryPoint, &worker );
+	}
+
+	Log::Write( LogLevel_Info, "Decrypting secured frames on %d worker threads", m_numWorkers );
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::~SecurityDecryptor>
+//	Destructor
+//-----------------------------------------------------------------------------
+SecurityDecryptor::~SecurityDecryptor
+(
+)
+{
+	// Frames still queued are dropped along with the jobs
+	for( uint32 i=0; i<m_numWorkers; ++i )
+	{
+		Worker& worker = m_workers[i];
+		worker.m_thread->Stop();
+		worker.m_thread->Release();
+		worker.m_queueEvent->Release();
+		worker.m_mutex->Release();
+	}
+
+	delete [] m_workers;
+	delete [] m_jobPool;
+	m_resultEvent->Release();
+	m_resultMutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::Decrypt>
+//	Queue a secured frame for the worker that handles its node
+//-----------------------------------------------------------------------------
+bool SecurityDecryptor::Decrypt
+(
+	uint8 const* _data,
+	uint8 const _length,
+	uint8 const* _nonce,
+	uint8 const _receivingNode,
+	aes_encrypt_ctx const* _encKey,
+	aes_encrypt_ctx const* _authKey
+)
+{
+	if( m_freeJobs.empty() )
+	{
+		return false;
+	}
+
+	Job* job = m_freeJobs.back();
+	m_freeJobs.pop_back();
+
+	memcpy( job->m_nonce, _nonce, sizeof(job->m_nonce) );
+	job->m_receivingNode = _receivingNode;
+	memcpy( &job->m_encKey, _encKey, sizeof(aes_encrypt_ctx) );
+	memcpy( &job->m_authKey, _authKey, sizeof(aes_encrypt_ctx) );
+	Queue( job, _data, _length, Result_Decrypted );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::Forward>
+//	Queue a plain frame behind the secured frames of its node
+//-----------------------------------------------------------------------------
+bool SecurityDecryptor::Forward
+(
+	uint8 const* _data,
+	uint8 const _length
+)
+{
+	if( m_pending[_data[3]] == 0 || m_freeJobs.empty() )
+	{
+		return false;
+	}
+
+	Job* job = m_freeJobs.back();
+	m_freeJobs.pop_back();
+	Queue( job, _data, _length, Result_Plain );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::TakeResult>
+//	Take the next frame that is ready to be processed
+//-----------------------------------------------------------------------------
+bool SecurityDecryptor::TakeResult
+(
+	uint8* o_data,
+	uint8* o_length,
+	Result* o_result
+)
+{
+	Job* job;
+	{
+		LockGuard LG( m_resultMutex );
+		if( m_results.empty() )
+		{
+			m_resultEvent->Reset();
+			return false;
+		}
+		job = m_results.front();
+		m_results.pop_front();
+	}
+
+	memcpy( o_data, job->m_data, 256 );
+	*o_length = job->m_length;
+	*o_result = job->m_result;
+
+	--m_pending[job->m_data[3]];
+	m_freeJobs.push_back( job );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::Queue>
+//	Copy a frame into a job, and queue it for the worker that handles its node
+//-----------------------------------------------------------------------------
+void SecurityDecryptor::Queue
+(
+	Job* _job,
+	uint8 const* _data,
+	uint8 const _length,
+	Result const _result
+)
+{
+	uint32 length = _data[4] + 6;
+	if( length > c_maxFrame )
+	{
+		length = c_maxFrame;
+	}
+	memcpy( _job->m_data, _data, length );
+	_job->m_length = _length;
+	_job->m_result = _result;
+
+	uint8 nodeId = _data[3];
+	++m_pending[nodeId];
+
+	Worker& worker = m_workers[nodeId % m_numWorkers];
+	LockGuard LG( worker.m_mutex );
+	worker.m_jobs.push_back( _job );
+	worker.m_queueEvent->Set();
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::WorkerThreadEntryPoint>
+//	Entry point of a worker thread
+//-----------------------------------------------------------------------------
+void SecurityDecryptor::WorkerThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	Worker* worker = (Worker*)_context;
+	worker->m_owner->WorkerProc( worker, _exitEvent );
+}
+
+//-----------------------------------------------------------------------------
+//	<SecurityDecryptor::WorkerProc>
+//	Decrypt a worker's frames in the order they were queued
+//-----------------------------------------------------------------------------
+void SecurityDecryptor::WorkerProc
+(
+	Worker* _worker,
+	Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;
+	waitObjects[1] = _worker->m_queueEvent;
+
+	while( true )
+	{
+		if( Wait::Multiple( waitObjects, 2 ) == 0 )
+		{
+			// Exit has been signalled
+			return;
+		}
+
+		_worker->m_mutex->Lock();
+		while( !_worker->m_jobs.empty() )
+		{
+			Job* job = _worker->m_jobs.front();
+			_worker->m_jobs.pop_front();
+			_worker->m_mutex->Unlock();
+
+			if( job->m_result == Result_Decrypted )
+			{
+				uint8* data = job->m_data;
+				uint8 plain[256];
+				if( DecryptBuffer( &data[5], data[4]+1, &job->m_encKey, &job->m_authKey, data[3], job->m_receivingNode, job->m_nonce, plain ) )
+				{
+					// Replace the encapsulation with the command it carried.  See
+					// DecryptBuffer for the layout of the encapsulated frame.
+					data[4] = data[4] - 8 - 8 - 2 - 2;
+					memcpy( &data[5], &plain[1], data[4] );
+				}
+				else
+				{
+					job->m_result = Result_Failed;
+				}
+			}
+
+			{
+				LockGuard LG( m_resultMutex );
+				m_results.push_back( job );
+				m_resultEvent->Set();
+			}
+
+			_worker->m_mutex->Lock();
+		}
+		_worker->m_queueEvent->Reset();
+		_worker->m_mutex->Unlock();
+	}
+}
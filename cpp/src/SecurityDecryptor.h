@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+//
+//	SecurityDecryptor.h
+//
+//	Decrypts and authenticates the secured frames of nodes on worker threads,
+//	away from the driver thread
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _SecurityDecryptor_H
+#define _SecurityDecryptor_H
+
+#include <deque>
+#include <vector>
+
+#include "Defs.h"
+#include "aes/aescpp.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Event;
+	class Mutex;
+	class Thread;
+
+	/** \brief Hands the security encapsulated frames of nodes to a pool of worker
+	 * threads, which decrypt them and check their MACs while the driver thread goes
+	 * back to reading and acknowledging frames.
+	 *
+	 * The driver thread looks up the nonce each frame was encrypted with, answers any
+	 * request for a new one, and queues the frame with copies of the nonce and of the
+	 * network keys.  The workers share nothing else with the driver or with each other.
+	 * Frames are copied into jobs that are allocated with the pool, each with its own
+	 * AES contexts, and when every job is taken the driver thread processes the node's
+	 * queued frames and then decrypts the frame itself as before.
+	 *
+	 * The jobs are handed back to the driver thread, which goes on to process each frame
+	 * as if it had decrypted it.  Nodes are shared out between the workers by node ID,
+	 * so a node's frames come back in the order they arrived, and a plain frame from a
+	 * node whose secured frames are still being decrypted is queued behind them.
+	 *
+	 * Only the driver thread takes and returns jobs, so the free jobs and the counts of
+	 * each node's queued frames need no lock.
+	 */
+	class SecurityDecryptor
+	{
+	public:
+		SecurityDecryptor( Driver* _driver, uint32 const _numWorkers );
+		~SecurityDecryptor();
+
+		enum Result
+		{
+			Result_Plain = 0,											// The frame was queued by Forward
+			Result_Decrypted,											// The frame has been decrypted in place
+			Result_Failed												// The frame could not be decrypted or authenticated
+		};
+
+		/**
+		 * Queue a SecurityCmd_MessageEncap frame to be decrypted by a worker.
+		 * @param _data The frame, from the message type byte onwards.
+		 * @param _length Length of the frame, as passed to Driver::ProcessMsg.
+		 * @param _nonce The nonce that the frame's nonce ID refers to.
+		 * @param _receivingNode Node ID of the controller.
+		 * @param _encKey, _authKey The network keys to decrypt and authenticate the frame with.
+		 * @return False if every job is taken, in which case the caller decrypts the frame.
+		 */
+		bool Decrypt( uint8 const* _data, uint8 const _length, uint8 const* _nonce, uint8 const _receivingNode, aes_encrypt_ctx const* _encKey, aes_encrypt_ctx const* _authKey );
+
+		/**
+		 * Queue a plain frame behind its node's secured frames.
+		 * @return False if the node has no frames queued, or every job is taken, in
+		 * which case the caller processes the frame straight away.
+		 */
+		bool Forward( uint8 const* _data, uint8 const _length );
+
+		/**
+		 * Whether a node has frames queued, being decrypted, or waiting to be taken.
+		 */
+		bool IsPending( uint8 const _nodeId )const{ return m_pending[_nodeId] != 0; }
+
+		/**
+		 * Take the next frame that is ready to be processed.
+		 * @param o_data Buffer of 256 bytes for the frame.
+		 * @return False if no frame is ready.
+		 */
+		bool TakeResult( uint8* o_data, uint8* o_length, Result* o_result );
+
+		/**
+		 * Set while there are frames ready to be processed.
+		 */
+		Event* GetResultEvent()const{ return m_resultEvent; }
+
+	private:
+		SecurityDecryptor( SecurityDecryptor const& );					// prevent copy
+		SecurityDecryptor& operator = ( SecurityDecryptor const& );	// prevent assignment
+
+		enum
+		{
+			c_numJobs = 32,												// Frames that may be queued or being decrypted at once
+			c_maxFrame = 262											// Header, and the longest command a frame can carry
+		};
+
+		struct Job
+		{
+			uint8				m_data[c_maxFrame];
+			uint8				m_length;
+			Result				m_result;
+			uint8				m_nonce[8];
+			uint8				m_receivingNode;
+			aes_encrypt_ctx		m_encKey;
+			aes_encrypt_ctx		m_authKey;
+		};
+
+		struct Worker
+		{
+			SecurityDecryptor*	m_owner;
+			Thread*				m_thread;
+			Mutex*				m_mutex;								// Guards the jobs
+			Event*				m_queueEvent;							// Set while there are jobs to decrypt
+OPENZWAVE_EXPORT_WARNINGS_OFF
+			deque<Job*>			m_jobs;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		};
+
+		void Queue( Job* _job, uint8 const* _data, uint8 const _length, Result const _result );
+		void WorkerProc( Worker* _worker, Event* _exitEvent );
+
+		static void WorkerThreadEntryPoint( Event* _exitEvent, void* _context );
+
+		Driver*				m_driver;
+		uint32				m_numWorkers;
+		Worker*				m_workers;
+		Job*				m_jobPool;
+		Mutex*				m_resultMutex;								// Guards m_results
+		Event*				m_resultEvent;
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		vector<Job*>		m_freeJobs;
+		deque<Job*>			m_results;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32				m_pending[256];								// Frames queued or being decrypted, per node
+	};
+
+} // namespace OpenZWave
+
+#endif //_SecurityDecryptor_H
@@ -0,0 +1,477 @@
+//-----------------------------------------------------------------------------
+//
+//	SetValueTracker.cpp
+//
+//	Follows value changes from the request to the device's report
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "Node.h"
+#include "Options.h"
+#include "SetValueTracker.h"
+#include "Utils.h"
+#include "platform/Mutex.h"
+#include "platform/Log.h"
+#include "platform/TimeStamp.h"
+#include "value_classes/Value.h"
+
+using namespace OpenZWave;
+
+static char const* c_setValueResultNames[] =
+{
+	"confirmed",
+	"sent",
+	"mismatch",
+	"timed out",
+	"failed"
+};
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::SetValueTracker>
+//	Constructor
+//-----------------------------------------------------------------------------
+SetValueTracker::SetValueTracker
+(
+	Driver* _driver
+):
+	m_driver( _driver ),
+	m_mutex( new Mutex() ),
+	m_lastRequestId( 0 ),
+	m_timeout( 10000 )
+{
+	Options::Get()->GetOptionAsInt( "SetValueTimeout", &m_timeout );
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::~SetValueTracker>
+//	Destructor.  The driver thread must have stopped.  Requests still in
+//	progress are dropped without calling their callbacks.
+//-----------------------------------------------------------------------------
+SetValueTracker::~SetValueTracker
+(
+)
+{
+	m_driver->m_timers->Cancel( &m_checkTimer );
+	m_driver->m_timers->Cancel( &m_notifyTimer );
+
+	for( map<uint32,Request*>::iterator it = m_requests.begin(); it != m_requests.end(); ++it )
+	{
+		m_driver->m_timers->Cancel( &it->second->m_timer );
+		delete it->second;
+	}
+	for( vector<Request*>::iterator it = m_completed.begin(); it != m_completed.end(); ++it )
+	{
+		delete *it;
+	}
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::Begin>
+//	Start a request, and have the next message queued carry its ID
+//-----------------------------------------------------------------------------
+uint32 SetValueTracker::Begin
+(
+	ValueID const& _id,
+	Driver::pfnOnSetValueComplete_t _callback,
+	void* _context
+)
+{
+	Request* request = new Request( _id );
+	request->m_callback = _callback;
+	request->m_context = _context;
+	request->m_state = State_Starting;
+	request->m_acknowledged = Ack_None;
+	request->m_writeOnly = false;
+	request->m_decimal = ( _id.GetType() == ValueID::ValueType_Decimal );
+	request->m_timed = false;
+	request->m_start = TimeStamp::GetMicroseconds();
+
+	LockGuard LG( m_mutex );
+	do
+	{
+		++m_lastRequestId;
+	}
+	while( m_lastRequestId == 0 || m_requests.find( m_lastRequestId ) != m_requests.end() );
+
+	request->m_status.m_requestId = m_lastRequestId;
+	m_requests[m_lastRequestId] = request;
+	m_driver->m_setValueCapture = m_lastRequestId;
+	return m_lastRequestId;
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::OnSet>
+//	Record the value requested
+//-----------------------------------------------------------------------------
+void SetValueTracker::OnSet
+(
+	uint32 const _requestId,
+	Value const* _value
+)
+{
+	LockGuard LG( m_mutex );
+	map<uint32,Request*>::iterator it = m_requests.find( _requestId );
+	if( it != m_requests.end() )
+	{
+		it->second->m_status.m_requested = _value->GetAsString();
+		it->second->m_writeOnly = _value->IsWriteOnly();
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::End>
+//	Finish starting a request, once its value has been set
+//-----------------------------------------------------------------------------
+uint32 SetValueTracker::End
+(
+	uint32 const _requestId,
+	bool const _set
+)
+{
+	// SendMsg clears the capture when it tags a message
+	bool queued = ( m_driver->m_setValueCapture == 0 );
+	m_driver->m_setValueCapture = 0;
+
+	LockGuard LG( m_mutex );
+	map<uint32,Request*>::iterator it = m_requests.find( _requestId );
+	if( it == m_requests.end() )
+	{
+		return 0;
+	}
+
+	Request* request = it->second;
+	if( !_set || !queued )
+	{
+		if( _set )
+		{
+			Log::Write( LogLevel_Warning, request->m_status.m_id.GetNodeId(), "SetValueAsync: no message was queued for the value, so the change cannot be followed" );
+		}
+		m_requests.erase( it );
+		delete request;
+		return 0;
+	}
+
+	request->m_state = State_Queued;
+	if( request->m_acknowledged != Ack_None )
+	{
+		// The driver thread has already heard back from the device
+		Acknowledge( request, request->m_acknowledged == Ack_Ok );
+	}
+	else if( Node* node = m_driver->GetNodeUnsafe( request->m_status.m_id.GetNodeId() ) )
+	{
+		if( node->IsListeningDevice() || node->IsFrequentListeningDevice() )
+		{
+			StartTimer( request );
+		}
+	}
+	return _requestId;
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::OnTransmitted>
+//	The device has, or has not, acknowledged a request's message
+//-----------------------------------------------------------------------------
+void SetValueTracker::OnTransmitted
+(
+	uint32 const _requestId,
+	bool const _acknowledged
+)
+{
+	LockGuard LG( m_mutex );
+	map<uint32,Request*>::iterator it = m_requests.find( _requestId );
+	if( it == m_requests.end() )
+	{
+		return;
+	}
+
+	Request* request = it->second;
+	if( request->m_state == State_Starting )
+	{
+		// Left for End, so that the caller has the ID before the callback is made
+		request->m_acknowledged = _acknowledged ? Ack_Ok : Ack_Failed;
+	}
+	else if( request->m_state == State_Queued )
+	{
+		Acknowledge( request, _acknowledged );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::OnValueReported>
+//	Have the value checked against any request waiting for it, once the
+//	report has been stored
+//-----------------------------------------------------------------------------
+void SetValueTracker::OnValueReported
+(
+	ValueID const& _id
+)
+{
+	LockGuard LG( m_mutex );
+	for( map<uint32,Request*>::iterator it = m_requests.begin(); it != m_requests.end(); ++it )
+	{
+		Request* request = it->second;
+		if( request->m_state == State_Transmitted && request->m_status.m_id == _id )
+		{
+			request->m_state = State_Reported;
+			if( !m_checkTimer.IsArmed() )
+			{
+				m_driver->m_timers->Arm( &m_checkTimer, 0, CheckTimerCallback, this );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::CancelNode>
+//	Fail the requests for a node
+//-----------------------------------------------------------------------------
+void SetValueTracker::CancelNode
+(
+	uint8 const _nodeId
+)
+{
+	LockGuard LG( m_mutex );
+	map<uint32,Request*>::iterator it = m_requests.begin();
+	while( it != m_requests.end() )
+	{
+		Request* request = it->second;
+		++it;
+		if( request->m_status.m_id.GetNodeId() == _nodeId && request->m_state != State_Starting )
+		{
+			Complete( request, Driver::SetValueResult_Failed );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::Acknowledge>
+//	Move a queued request on, now that the device has answered its message.
+//	The caller must hold the lock.
+//-----------------------------------------------------------------------------
+void SetValueTracker::Acknowledge
+(
+	Request* _request,
+	bool const _acknowledged
+)
+{
+	if( !_acknowledged )
+	{
+		Complete( _request, Driver::SetValueResult_Failed );
+		return;
+	}
+
+	_request->m_status.m_transmitTime = GetElapsed( _request );
+	if( _request->m_writeOnly )
+	{
+		Complete( _request, Driver::SetValueResult_Sent );
+		return;
+	}
+
+	_request->m_state = State_Transmitted;
+	StartTimer( _request );
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::StartTimer>
+//	(Re)start the timeout of a request.  The caller must hold the lock.
+//-----------------------------------------------------------------------------
+void SetValueTracker::StartTimer
+(
+	Request* _request
+)
+{
+	_request->m_timed = true;
+	m_driver->m_timers->Arm( &_request->m_timer, m_timeout, RequestTimerCallback, this );
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::Matches>
+//	Whether a reported value is the one requested.  Decimals are compared as
+//	numbers, as a device may report them with a different precision.
+//-----------------------------------------------------------------------------
+bool SetValueTracker::Matches
+(
+	Request const* _request,
+	string const& _reported
+)const
+{
+	if( _request->m_decimal )
+	{
+		return( fabs( atof( _reported.c_str() ) - atof( _request->m_status.m_requested.c_str() ) ) < 0.0005 );
+	}
+	return( _reported == _request->m_status.m_requested );
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::Complete>
+//	Record the outcome of a request, and have its callback made.  The caller
+//	must hold the lock.
+//-----------------------------------------------------------------------------
+void SetValueTracker::Complete
+(
+	Request* _request,
+	Driver::SetValueResult const _result
+)
+{
+	m_driver->m_timers->Cancel( &_request->m_timer );
+	_request->m_status.m_result = _result;
+	_request->m_status.m_completeTime = GetElapsed( _request );
+	m_requests.erase( _request->m_status.m_requestId );
+
+	Log::Write( LogLevel_Info, _request->m_status.m_id.GetNodeId(), "SetValueAsync %d: %s after %dms (value %s, reported %s)", _request->m_status.m_requestId, c_setValueResultNames[_result], _request->m_status.m_completeTime, _request->m_status.m_requested.c_str(), _request->m_status.m_reported.empty() ? "nothing" : _request->m_status.m_reported.c_str() );
+
+	m_completed.push_back( _request );
+	if( !m_notifyTimer.IsArmed() )
+	{
+		m_driver->m_timers->Arm( &m_notifyTimer, 0, NotifyTimerCallback, this );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::GetElapsed>
+//	Milliseconds since a request was started
+//-----------------------------------------------------------------------------
+uint32 SetValueTracker::GetElapsed
+(
+	Request const* _request
+)const
+{
+	return (uint32)( ( TimeStamp::GetMicroseconds() - _request->m_start ) / 1000 );
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::RequestTimerCallback>
+//	A request has not been sent or answered in time
+//-----------------------------------------------------------------------------
+void SetValueTracker::RequestTimerCallback
+(
+	void* _context
+)
+{
+	((SetValueTracker*)_context)->ExpireRequests();
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::ExpireRequests>
+//	Time out the requests whose timers have fired.  The timer wheel makes its
+//	callbacks without holding our lock, so a request may have been completed
+//	in the meantime; only those still in m_requests are considered.
+//-----------------------------------------------------------------------------
+void SetValueTracker::ExpireRequests
+(
+)
+{
+	LockGuard LG( m_mutex );
+	map<uint32,Request*>::iterator it = m_requests.begin();
+	while( it != m_requests.end() )
+	{
+		// Complete erases the request from m_requests
+		Request* request = it->second;
+		++it;
+		if( !request->m_timed || request->m_timer.IsArmed() )
+		{
+			continue;
+		}
+
+		if( request->m_state == State_Queued || request->m_status.m_reported.empty() )
+		{
+			Complete( request, Driver::SetValueResult_TimedOut );
+		}
+		else
+		{
+			Complete( request, Driver::SetValueResult_Mismatch );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::CheckTimerCallback>
+//	Compare the values reported with the values requested
+//-----------------------------------------------------------------------------
+void SetValueTracker::CheckTimerCallback
+(
+	void* _context
+)
+{
+	SetValueTracker* svt = (SetValueTracker*)_context;
+
+	LockGuard LG( svt->m_driver->m_nodeMutex );
+	LockGuard LG2( svt->m_mutex );
+	map<uint32,Request*>::iterator it = svt->m_requests.begin();
+	while( it != svt->m_requests.end() )
+	{
+		Request* request = it->second;
+		++it;
+		if( request->m_state != State_Reported )
+		{
+			continue;
+		}
+
+		request->m_state = State_Transmitted;
+		if( Value* value = svt->m_driver->GetValue( request->m_status.m_id ) )
+		{
+			request->m_status.m_reported = value->GetAsString();
+			value->Release();
+			if( svt->Matches( request, request->m_status.m_reported ) )
+			{
+				svt->Complete( request, Driver::SetValueResult_Confirmed );
+			}
+		}
+		else
+		{
+			// The value has gone, with its node's command class
+			svt->Complete( request, Driver::SetValueResult_Failed );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SetValueTracker::NotifyTimerCallback>
+//	Make the callbacks of the finished requests
+//-----------------------------------------------------------------------------
+void SetValueTracker::NotifyTimerCallback
+(
+	void* _context
+)
+{
+	SetValueTracker* svt = (SetValueTracker*)_context;
+	svt->m_mutex->Lock();
+	vector<Request*> completed;
+	completed.swap( svt->m_completed );
+	svt->m_mutex->Unlock();
+
+	for( vector<Request*>::iterator it = completed.begin(); it != completed.end(); ++it )
+	{
+		Request* request = *it;
+		if( request->m_callback != NULL )
+		{
+			request->m_callback( request->m_status, request->m_context );
+		}
+		delete request;
+	}
+}
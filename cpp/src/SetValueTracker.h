@@ -0,0 +1,169 @@
+//-----------------------------------------------------------------------------
+//
+//	SetValueTracker.h
+//
+//	Follows value changes from the request to the device's report
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _SetValueTracker_H
+#define _SetValueTracker_H
+
+#include <map>
+#include <vector>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "platform/TimerWheel.h"
+
+namespace OpenZWave
+{
+	class Mutex;
+	class Value;
+
+	/** \brief Follows the value changes started by Manager::SetValueAsync, and tells
+	 * the caller how each one ended.
+	 *
+	 * The first message queued by the value's command class is tagged with the ID of
+	 * the request.  When the controller reports that the device acknowledged it, the
+	 * request waits for the device to report the value, which Value::Set has already
+	 * asked for.  Reports are compared with the value requested once they have been
+	 * stored, from a timer on the driver thread.  A matching report completes the
+	 * request straight away.  Write-only values complete when the message is
+	 * acknowledged.
+	 *
+	 * A request that is not answered in time ends as timed out, or as a mismatch if the
+	 * device reported some other value.  Messages for sleeping devices wait for the
+	 * device to wake up, so their timeout only starts once the message has been sent.
+	 *
+	 * The completion callbacks are made on the driver thread, as controller command
+	 * callbacks are.
+	 *
+	 * The tracker's lock is taken after the node mutex, and no other lock is taken
+	 * while it is held, so the driver may report on messages with its send mutex held.
+	 */
+	class SetValueTracker
+	{
+	public:
+		SetValueTracker( Driver* _driver );
+		~SetValueTracker();
+
+		/**
+		 * Start a request.  The caller holds the node mutex, and sets the value
+		 * before calling End.
+		 * @return The ID of the request.
+		 */
+		uint32 Begin( ValueID const& _id, Driver::pfnOnSetValueComplete_t _callback, void* _context );
+
+		/**
+		 * Called by Value::Set, on the copy holding the new value, while a request
+		 * is being started.
+		 */
+		void OnSet( uint32 const _requestId, Value const* _value );
+
+		/**
+		 * Finish starting a request.
+		 * @param _set Whether the value was set.
+		 * @return The ID of the request, or 0 if the value was not set or no message
+		 * was queued for it, in which case the request is forgotten.
+		 */
+		uint32 End( uint32 const _requestId, bool const _set );
+
+		/**
+		 * Called when the controller reports whether a tagged message reached its
+		 * device, or when the message is dropped or replaced by a later copy.
+		 */
+		void OnTransmitted( uint32 const _requestId, bool const _acknowledged );
+
+		/**
+		 * Called whenever a node reports a value.
+		 */
+		void OnValueReported( ValueID const& _id );
+
+		/**
+		 * Fail the requests for a node that is being removed.
+		 */
+		void CancelNode( uint8 const _nodeId );
+
+	private:
+		SetValueTracker( SetValueTracker const& );					// prevent copy
+		SetValueTracker& operator = ( SetValueTracker const& );	// prevent assignment
+
+		enum State
+		{
+			State_Starting = 0,										// Being set by Manager::SetValueAsync
+			State_Queued,											// Waiting to be sent
+			State_Transmitted,										// Acknowledged, and waiting for a report
+			State_Reported											// A report is waiting to be checked
+		};
+
+		enum Ack
+		{
+			Ack_None = 0,
+			Ack_Ok,
+			Ack_Failed
+		};
+
+		struct Request
+		{
+			Request( ValueID const& _id ): m_status( _id ){}
+
+			Driver::SetValueStatus				m_status;
+			Driver::pfnOnSetValueComplete_t		m_callback;
+			void*								m_context;
+			State								m_state;
+			Ack									m_acknowledged;		// Answer that arrived while in State_Starting
+			bool								m_writeOnly;
+			bool								m_decimal;
+			bool								m_timed;			// m_timer has been armed
+			uint64								m_start;			// Microseconds
+			TimerWheel::Timer					m_timer;
+		};
+
+		void Acknowledge( Request* _request, bool const _acknowledged );
+		void StartTimer( Request* _request );
+		void ExpireRequests();
+		bool Matches( Request const* _request, string const& _reported )const;
+		void Complete( Request* _request, Driver::SetValueResult const _result );
+		uint32 GetElapsed( Request const* _request )const;
+
+		static void RequestTimerCallback( void* _context );
+		static void CheckTimerCallback( void* _context );
+		static void NotifyTimerCallback( void* _context );
+
+		Driver*				m_driver;
+		Mutex*				m_mutex;
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		map<uint32,Request*>	m_requests;
+		vector<Request*>	m_completed;							// Finished requests waiting for their callbacks
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32				m_lastRequestId;
+		TimerWheel::Timer	m_checkTimer;
+		TimerWheel::Timer	m_notifyTimer;
+
+		// Options
+		int32				m_timeout;
+	};
+
+} // namespace OpenZWave
+
+#endif //_SetValueTracker_H
@@ -0,0 +1,515 @@
+//-----------------------------------------------------------------------------
+//
+//	ValueHistory.cpp
+//
+//	Keeps a bounded history of the values reported by devices
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Defs.h"
+#include "Utils.h"
+#include "ValueHistory.h"
+#include "platform/Log.h"
+#include "platform/Mutex.h"
+#include "value_classes/Value.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<FindFirst>
+//	Index, counting from the oldest, of the first entry of a ring at or after a time
+//-----------------------------------------------------------------------------
+template <class T>
+static uint32 FindFirst
+(
+	T const* _ring,
+	uint32 const _capacity,
+	uint32 const _start,
+	uint32 const _count,
+	uint32 const _since
+)
+{
+	uint32 low = 0;
+	uint32 high = _count;
+	while( low < high )
+	{
+		uint32 mid = ( low + high ) / 2;
+		if( _ring[( _start + mid ) % _capacity].m_time < _since )
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+//-----------------------------------------------------------------------------
+//	<CopyRing>
+//	Copy the entries of a ring from the one at _first onwards.  They wrap
+//	around the end of the ring at most once.
+//-----------------------------------------------------------------------------
+template <class T>
+static void CopyRing
+(
+	T const* _ring,
+	uint32 const _capacity,
+	uint32 const _start,
+	uint32 const _first,
+	uint32 const _count,
+	T* o_copy
+)
+{
+	uint32 begin = ( _start + _first ) % _capacity;
+	uint32 length = _count - _first;
+	uint32 tail = ( begin + length > _capacity ) ? _capacity - begin : length;
+	memcpy( o_copy, &_ring[begin], tail * sizeof(T) );
+	memcpy( o_copy + tail, _ring, ( length - tail ) * sizeof(T) );
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::ValueHistory>
+//	Constructor
+//-----------------------------------------------------------------------------
+ValueHistory::ValueHistory
+(
+	string const& _sizes,
+	string const& _tiers,
+	uint32 const _maxMemory
+):
+	m_mutex( new Mutex() ),
+	m_maxMemory( _maxMemory ),
+	m_memoryUsed( 0 ),
+	m_memoryWarned( false )
+{
+	memset( m_genreCapacity, 0, sizeof(m_genreCapacity) );
+	for( int32 i=0; i<256; ++i )
+	{
+		m_classCapacity[i] = -1;
+	}
+
+	// The sizes are a comma separated list of genre names or hex command class IDs
+	// and numbers of entries, such as "user=256,0x31=1024"
+	char* pos = const_cast<char*>( _sizes.c_str() );
+	while( *pos )
+	{
+		char* eq = strchr( pos, '=' );
+		if( eq == NULL )
+		{
+			Log::Write( LogLevel_Warning, "Ignoring the badly formed ValueHistory option \"%s\"", _sizes.c_str() );
+			break;
+		}
+		string key( pos, eq - pos );
+		int32 capacity = (int32)strtol( eq+1, &pos, 10 );
+		if( capacity < 0 )
+		{
+			capacity = 0;
+		}
+
+		if( key[0] >= '0' && key[0] <= '9' )
+		{
+			m_classCapacity[(uint8)strtol( key.c_str(), NULL, 16 )] = capacity;
+		}
+		else
+		{
+			int32 genre = 0;
+			while( genre < ValueID::ValueGenre_Count && key != Value::GetGenreNameFromEnum( (ValueID::ValueGenre)genre ) )
+			{
+				++genre;
+			}
+			if( genre < ValueID::ValueGenre_Count )
+			{
+				m_genreCapacity[genre] = capacity;
+			}
+			else
+			{
+				Log::Write( LogLevel_Warning, "Ignoring the unknown genre \"%s\" in the ValueHistory option", key.c_str() );
+			}
+		}
+
+		if( *pos == ',' )
+		{
+			++pos;
+		}
+		else if( *pos )
+		{
+			Log::Write( LogLevel_Warning, "Ignoring the badly formed ValueHistory option \"%s\"", _sizes.c_str() );
+			break;
+		}
+	}
+
+	// The tiers are a comma separated list of periods in seconds, such as "60,3600"
+	pos = const_cast<char*>( _tiers.c_str() );
+	while( *pos )
+	{
+		int32 period = (int32)strtol( pos, &pos, 10 );
+		if( period > 0 )
+		{
+			m_periods.push_back( (uint32)period );
+		}
+		if( *pos == ',' )
+		{
+			++pos;
+		}
+		else if( *pos )
+		{
+			Log::Write( LogLevel_Warning, "Ignoring the badly formed ValueHistoryTiers option \"%s\"", _tiers.c_str() );
+			break;
+		}
+	}
+
+	Log::Write( LogLevel_Info, "Keeping the history of reported values in up to %d bytes, with %d summary tiers", m_maxMemory, (int)m_periods.size() );
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::~ValueHistory>
+//	Destructor
+//-----------------------------------------------------------------------------
+ValueHistory::~ValueHistory
+(
+)
+{
+	for( map<uint64,History*>::iterator it = m_histories.begin(); it != m_histories.end(); ++it )
+	{
+		DeleteHistory( it->second );
+	}
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::Record>
+//	Record a report of a value
+//-----------------------------------------------------------------------------
+void ValueHistory::Record
+(
+	ValueID const& _id,
+	double const _value,
+	uint32 const _time
+)
+{
+	LockGuard LG( m_mutex );
+	History* history = GetHistory( _id );
+	if( history == NULL )
+	{
+		return;
+	}
+
+	// Once the ring is full, the oldest sample is overwritten
+	Driver::ValueHistorySample& sample = history->m_samples[( history->m_start + history->m_count ) % history->m_capacity];
+	sample.m_time = _time;
+	sample.m_value = _value;
+	if( history->m_count < history->m_capacity )
+	{
+		++history->m_count;
+	}
+	else
+	{
+		history->m_start = ( history->m_start + 1 ) % history->m_capacity;
+	}
+
+	for( uint32 i=0; i<m_periods.size(); ++i )
+	{
+		Summarize( history->m_tiers[i], m_periods[i], history->m_capacity, _value, _time );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::GetSamples>
+//	Copy the samples of a value reported at or after a time
+//-----------------------------------------------------------------------------
+uint32 ValueHistory::GetSamples
+(
+	ValueID const& _id,
+	uint32 const _since,
+	Driver::ValueHistorySample** o_samples
+)
+{
+	*o_samples = NULL;
+
+	LockGuard LG( m_mutex );
+	map<uint64,History*>::iterator it = m_histories.find( _id.GetId() );
+	if( it == m_histories.end() || it->second == NULL )
+	{
+		return 0;
+	}
+
+	History* history = it->second;
+	uint32 first = FindFirst( history->m_samples, history->m_capacity, history->m_start, history->m_count, _since );
+	uint32 count = history->m_count - first;
+	if( count == 0 )
+	{
+		return 0;
+	}
+
+	*o_samples = new Driver::ValueHistorySample[count];
+	CopyRing( history->m_samples, history->m_capacity, history->m_start, first, history->m_count, *o_samples );
+	return count;
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::GetSummaries>
+//	Copy the summaries of a tier for the periods that end after a time
+//-----------------------------------------------------------------------------
+uint32 ValueHistory::GetSummaries
+(
+	ValueID const& _id,
+	uint8 const _tier,
+	uint32 const _since,
+	Driver::ValueHistorySummary** o_summaries
+)
+{
+	*o_summaries = NULL;
+	if( _tier >= m_periods.size() )
+	{
+		return 0;
+	}
+
+	LockGuard LG( m_mutex );
+	map<uint64,History*>::iterator it = m_histories.find( _id.GetId() );
+	if( it == m_histories.end() || it->second == NULL )
+	{
+		return 0;
+	}
+
+	// A summary is kept for a period that started up to a period before the time
+	History* history = it->second;
+	Tier& tier = history->m_tiers[_tier];
+	uint32 period = m_periods[_tier];
+	uint32 since = ( _since >= period ) ? _since - period + 1 : 0;
+	uint32 first = FindFirst( tier.m_summaries, history->m_capacity, tier.m_start, tier.m_count, since );
+	uint32 count = tier.m_count - first;
+	bool current = ( tier.m_current.m_count != 0 && tier.m_current.m_time >= since );
+	if( count == 0 && !current )
+	{
+		return 0;
+	}
+
+	*o_summaries = new Driver::ValueHistorySummary[count + ( current ? 1 : 0 )];
+	if( count != 0 )
+	{
+		CopyRing( tier.m_summaries, history->m_capacity, tier.m_start, first, tier.m_count, *o_summaries );
+	}
+	if( current )
+	{
+		(*o_summaries)[count++] = tier.m_current;
+	}
+	return count;
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::GetTierPeriod>
+//	Length of the periods of a tier
+//-----------------------------------------------------------------------------
+uint32 ValueHistory::GetTierPeriod
+(
+	uint8 const _tier
+)const
+{
+	return ( _tier < m_periods.size() ) ? m_periods[_tier] : 0;
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::RemoveNode>
+//	Forget the values of a node that has been removed
+//-----------------------------------------------------------------------------
+void ValueHistory::RemoveNode
+(
+	uint8 const _nodeId
+)
+{
+	LockGuard LG( m_mutex );
+	map<uint64,History*>::iterator it = m_histories.begin();
+	while( it != m_histories.end() )
+	{
+		// The node ID is in the top byte of the value ID
+		if( (uint8)( it->first >> 24 ) == _nodeId )
+		{
+			if( it->second != NULL )
+			{
+				m_memoryUsed -= GetSize( it->second->m_capacity );
+				DeleteHistory( it->second );
+			}
+			m_histories.erase( it++ );
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::GetHistory>
+//	Find the history of a value, creating it on its first report
+//-----------------------------------------------------------------------------
+ValueHistory::History* ValueHistory::GetHistory
+(
+	ValueID const& _id
+)
+{
+	map<uint64,History*>::iterator it = m_histories.find( _id.GetId() );
+	if( it != m_histories.end() )
+	{
+		return it->second;
+	}
+
+	History* history = NULL;
+	uint32 capacity = GetCapacity( _id );
+	if( capacity != 0 )
+	{
+		uint32 size = GetSize( capacity );
+		if( m_memoryUsed + size <= m_maxMemory )
+		{
+			history = new History();
+			history->m_capacity = capacity;
+			history->m_start = 0;
+			history->m_count = 0;
+			history->m_samples = new Driver::ValueHistorySample[capacity];
+			history->m_tiers = new Tier[m_periods.size()];
+			for( uint32 i=0; i<m_periods.size(); ++i )
+			{
+				Tier& tier = history->m_tiers[i];
+				tier.m_start = 0;
+				tier.m_count = 0;
+				tier.m_summaries = new Driver::ValueHistorySummary[capacity];
+				tier.m_current.m_count = 0;
+				tier.m_sum = 0.0;
+			}
+			m_memoryUsed += size;
+		}
+		else if( !m_memoryWarned )
+		{
+			Log::Write( LogLevel_Warning, _id.GetNodeId(), "The value history has used its %d bytes, so no more values are recorded", m_maxMemory );
+			m_memoryWarned = true;
+		}
+	}
+
+	m_histories[_id.GetId()] = history;
+	return history;
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::GetCapacity>
+//	Number of entries in each ring of a value
+//-----------------------------------------------------------------------------
+uint32 ValueHistory::GetCapacity
+(
+	ValueID const& _id
+)const
+{
+	int32 capacity = m_classCapacity[_id.GetCommandClassId()];
+	if( capacity >= 0 )
+	{
+		return (uint32)capacity;
+	}
+	return( ( _id.GetGenre() < ValueID::ValueGenre_Count ) ? m_genreCapacity[_id.GetGenre()] : 0 );
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::GetSize>
+//	Memory taken by the history of a value
+//-----------------------------------------------------------------------------
+uint32 ValueHistory::GetSize
+(
+	uint32 const _capacity
+)const
+{
+	return (uint32)( sizeof(History) + _capacity * sizeof(Driver::ValueHistorySample)
+		+ m_periods.size() * ( sizeof(Tier) + _capacity * sizeof(Driver::ValueHistorySummary) ) );
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::Summarize>
+//	Add a sample to the summary of its period, storing the summary of the
+//	previous period once it has ended
+//-----------------------------------------------------------------------------
+void ValueHistory::Summarize
+(
+	Tier& _tier,
+	uint32 const _period,
+	uint32 const _capacity,
+	double const _value,
+	uint32 const _time
+)
+{
+	uint32 start = _time - ( _time % _period );
+	if( _tier.m_current.m_count != 0 && _tier.m_current.m_time != start )
+	{
+		_tier.m_summaries[( _tier.m_start + _tier.m_count ) % _capacity] = _tier.m_current;
+		if( _tier.m_count < _capacity )
+		{
+			++_tier.m_count;
+		}
+		else
+		{
+			_tier.m_start = ( _tier.m_start + 1 ) % _capacity;
+		}
+		_tier.m_current.m_count = 0;
+	}
+
+	Driver::ValueHistorySummary& current = _tier.m_current;
+	if( current.m_count == 0 )
+	{
+		current.m_time = start;
+		current.m_min = _value;
+		current.m_max = _value;
+		_tier.m_sum = 0.0;
+	}
+	else if( _value < current.m_min )
+	{
+		current.m_min = _value;
+	}
+	else if( _value > current.m_max )
+	{
+		current.m_max = _value;
+	}
+	_tier.m_sum += _value;
+	++current.m_count;
+	current.m_avg = _tier.m_sum / current.m_count;
+}
+
+//-----------------------------------------------------------------------------
+//	<ValueHistory::DeleteHistory>
+//	Free the rings of a value
+//-----------------------------------------------------------------------------
+void ValueHistory::DeleteHistory
+(
+	History* _history
+)
+{
+	if( _history == NULL )
+	{
+		return;
+	}
+	for( uint32 i=0; i<m_periods.size(); ++i )
+	{
+		delete [] _history->m_tiers[i].m_summaries;
+	}
+	delete [] _history->m_tiers;
+	delete [] _history->m_samples;
+	delete _history;
+}
@@ -0,0 +1,138 @@
+//-----------------------------------------------------------------------------
+//
+//	ValueHistory.h
+//
+//	Keeps a bounded history of the values reported by devices
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ValueHistory_H
+#define _ValueHistory_H
+
+#include <map>
+#include <vector>
+
+#include "Defs.h"
+#include "Driver.h"
+#include "value_classes/ValueID.h"
+
+namespace OpenZWave
+{
+	class Mutex;
+
+	/** \brief Keeps the values reported by devices, so that applications can show
+	 * their trends without storing every notification themselves.
+	 *
+	 * Each recorded value has a ring of its latest samples, and a ring of summaries
+	 * for each of the tiers given by the ValueHistoryTiers option.  A summary holds
+	 * the minimum, maximum and average of the samples reported in one period of its
+	 * tier, such as a minute or an hour, so the coarser tiers reach further back in
+	 * the same space.  Every ring of a value has the same number of entries, which
+	 * the ValueHistory option sets for each genre or command class.  A value gets its
+	 * rings when it is first reported, unless that would take the memory used by the
+	 * history past the ValueHistoryMemory option.
+	 *
+	 * Only numeric values are recorded.  Bools are recorded as 0 or 1, and lists as
+	 * the index of their selection.  Samples are kept as doubles, which hold every
+	 * integer value, such as a meter total, exactly.
+	 */
+	class ValueHistory
+	{
+	public:
+		ValueHistory( string const& _sizes, string const& _tiers, uint32 const _maxMemory );
+		~ValueHistory();
+
+		/**
+		 * Record a report of a value.
+		 * @param _time Time of the report, in seconds since the epoch.
+		 */
+		void Record( ValueID const& _id, double const _value, uint32 const _time );
+
+		/**
+		 * Copy the samples of a value reported at or after a time.
+		 * @param o_samples Set to an array of the samples, oldest first, which the
+		 * caller must delete with delete [].  Set to NULL if there are none.
+		 * @return The number of samples.
+		 */
+		uint32 GetSamples( ValueID const& _id, uint32 const _since, Driver::ValueHistorySample** o_samples );
+
+		/**
+		 * Copy the summaries of a tier for the periods that end after a time.
+		 * The last summary is for the current period, and grows until it ends.
+		 * @param o_summaries As for GetSamples.
+		 * @return The number of summaries.
+		 */
+		uint32 GetSummaries( ValueID const& _id, uint8 const _tier, uint32 const _since, Driver::ValueHistorySummary** o_summaries );
+
+		/**
+		 * Length of the periods of a tier, in seconds, or 0 if there is no such tier.
+		 */
+		uint32 GetTierPeriod( uint8 const _tier )const;
+
+		/**
+		 * Forget the values of a node that has been removed.
+		 */
+		void RemoveNode( uint8 const _nodeId );
+
+	private:
+		ValueHistory( ValueHistory const& );					// prevent copy
+		ValueHistory& operator = ( ValueHistory const& );		// prevent assignment
+
+		struct Tier
+		{
+			uint32							m_start;			// Index of the oldest summary
+			uint32							m_count;
+			Driver::ValueHistorySummary*	m_summaries;
+			Driver::ValueHistorySummary		m_current;			// The period being summarized, if m_current.m_count is not 0
+			double							m_sum;
+		};
+
+		struct History
+		{
+			uint32							m_capacity;			// Entries in each ring
+			uint32							m_start;			// Index of the oldest sample
+			uint32							m_count;
+			Driver::ValueHistorySample*		m_samples;
+			Tier*							m_tiers;
+		};
+
+		History* GetHistory( ValueID const& _id );
+		uint32 GetCapacity( ValueID const& _id )const;
+		uint32 GetSize( uint32 const _capacity )const;
+		void Summarize( Tier& _tier, uint32 const _period, uint32 const _capacity, double const _value, uint32 const _time );
+		void DeleteHistory( History* _history );
+
+		Mutex*				m_mutex;
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		map<uint64,History*>	m_histories;					// NULL for the values that are not recorded
+		vector<uint32>		m_periods;							// Seconds per summary, for each tier
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32				m_genreCapacity[ValueID::ValueGenre_Count];
+		int32				m_classCapacity[256];				// Overrides m_genreCapacity unless -1
+		uint32				m_maxMemory;						// Bytes
+		uint32				m_memoryUsed;
+		bool				m_memoryWarned;
+	};
+
+} // namespace OpenZWave
+
+#endif //_ValueHistory_H
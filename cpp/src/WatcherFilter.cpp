@@ -0,0 +1,197 @@
+//-----------------------------------------------------------------------------
+//
+//	WatcherFilter.cpp
+//
+//	Selects the notifications passed to a watcher
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "Defs.h"
+#include "WatcherFilter.h"
+
+using namespace OpenZWave;
+
+#define TYPE_BIT( _type )	( ((uint64)1) << Notification::_type )
+
+uint64 const WatcherFilter::c_driverTypes =
+	TYPE_BIT( Type_DriverReady ) | TYPE_BIT( Type_DriverFailed ) | TYPE_BIT( Type_DriverReset ) | TYPE_BIT( Type_DriverRemoved ) |
+	TYPE_BIT( Type_AwakeNodesQueried ) | TYPE_BIT( Type_AllNodesQueriedSomeDead ) | TYPE_BIT( Type_AllNodesQueried ) |
+	TYPE_BIT( Type_ControllerCommand ) | TYPE_BIT( Type_ConfigBatchComplete );
+
+uint64 const WatcherFilter::c_valueTypes =
+	TYPE_BIT( Type_ValueAdded ) | TYPE_BIT( Type_ValueRemoved ) | TYPE_BIT( Type_ValueChanged ) | TYPE_BIT( Type_ValueRefreshed ) |
+	TYPE_BIT( Type_PollingDisabled ) | TYPE_BIT( Type_PollingEnabled );
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::WatcherFilter>
+//	Constructor
+//-----------------------------------------------------------------------------
+WatcherFilter::WatcherFilter
+(
+):
+	m_types( ~(uint64)0 ),
+	m_genres( ~(uint32)0 ),
+	m_anyNode( true ),
+	m_anyCommandClass( true ),
+	m_anyType( true ),
+	m_anyGenre( true )
+{
+	memset( m_nodes, 0xff, sizeof(m_nodes) );
+	memset( m_commandClasses, 0xff, sizeof(m_commandClasses) );
+}
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::AddHomeId>
+//	Pass the notifications of a network
+//-----------------------------------------------------------------------------
+void WatcherFilter::AddHomeId
+(
+	uint32 const _homeId
+)
+{
+	m_homeIds.push_back( _homeId );
+}
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::AddNode>
+//	Pass the notifications about a node
+//-----------------------------------------------------------------------------
+void WatcherFilter::AddNode
+(
+	uint8 const _nodeId
+)
+{
+	if( m_anyNode )
+	{
+		memset( m_nodes, 0, sizeof(m_nodes) );
+		m_anyNode = false;
+	}
+	m_nodes[_nodeId>>5] |= 1u << ( _nodeId & 0x1f );
+}
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::AddCommandClass>
+//	Pass the notifications about the values of a command class
+//-----------------------------------------------------------------------------
+void WatcherFilter::AddCommandClass
+(
+	uint8 const _commandClassId
+)
+{
+	if( m_anyCommandClass )
+	{
+		memset( m_commandClasses, 0, sizeof(m_commandClasses) );
+		m_anyCommandClass = false;
+	}
+	m_commandClasses[_commandClassId>>5] |= 1u << ( _commandClassId & 0x1f );
+}
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::AddNotificationType>
+//	Pass the notifications of a type
+//-----------------------------------------------------------------------------
+void WatcherFilter::AddNotificationType
+(
+	Notification::NotificationType const _type
+)
+{
+	if( m_anyType )
+	{
+		m_types = 0;
+		m_anyType = false;
+	}
+	m_types |= ((uint64)1) << _type;
+}
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::AddValueGenre>
+//	Pass the notifications about the values of a genre
+//-----------------------------------------------------------------------------
+void WatcherFilter::AddValueGenre
+(
+	ValueID::ValueGenre const _genre
+)
+{
+	if( m_anyGenre )
+	{
+		m_genres = 0;
+		m_anyGenre = false;
+	}
+	m_genres |= 1u << _genre;
+}
+
+//-----------------------------------------------------------------------------
+//	<WatcherFilter::Matches>
+//	Whether the filter passes a notification
+//-----------------------------------------------------------------------------
+bool WatcherFilter::Matches
+(
+	Notification const* _notification
+)const
+{
+	uint64 typeBit = ((uint64)1) << _notification->GetType();
+	if( ( m_types & typeBit ) == 0 )
+	{
+		return false;
+	}
+
+	ValueID const& valueId = _notification->GetValueID();
+	if( !m_homeIds.empty() )
+	{
+		uint32 homeId = valueId.GetHomeId();
+		vector<uint32>::const_iterator it = m_homeIds.begin();
+		while( it != m_homeIds.end() && *it != homeId )
+		{
+			++it;
+		}
+		if( it == m_homeIds.end() )
+		{
+			return false;
+		}
+	}
+
+	uint8 nodeId = valueId.GetNodeId();
+	if( ( c_driverTypes & typeBit ) == 0 && nodeId != 0 )
+	{
+		if( ( m_nodes[nodeId>>5] & ( 1u << ( nodeId & 0x1f ) ) ) == 0 )
+		{
+			return false;
+		}
+	}
+
+	if( ( c_valueTypes & typeBit ) != 0 )
+	{
+		uint8 commandClassId = valueId.GetCommandClassId();
+		if( ( m_commandClasses[commandClassId>>5] & ( 1u << ( commandClassId & 0x1f ) ) ) == 0 )
+		{
+			return false;
+		}
+		if( ( m_genres & ( 1u << valueId.GetGenre() ) ) == 0 )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
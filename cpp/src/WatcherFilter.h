@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+//
+//	WatcherFilter.h
+//
+//	Selects the notifications passed to a watcher
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _WatcherFilter_H
+#define _WatcherFilter_H
+
+#include <vector>
+
+#include "Defs.h"
+#include "Notification.h"
+#include "value_classes/ValueID.h"
+
+namespace OpenZWave
+{
+	/** \brief Selects the notifications passed to a watcher added with
+	 *  Manager::AddWatcher, so that the watcher is not called for the ones
+	 *  it would ignore.
+	 *
+	 *  A new filter passes everything.  Each of the Add methods restricts one
+	 *  property to the values added for it, so a filter with two home IDs and
+	 *  the ValueChanged type passes the value changes of either network.
+	 *  - Home IDs and notification types apply to every notification.
+	 *  - Node IDs apply to notifications about a node, but not to those about a
+	 *    whole driver (such as DriverReady or AllNodesQueried) or with no node ID.
+	 *  - Command classes and value genres apply to notifications about a value
+	 *    (ValueAdded, ValueRemoved, ValueChanged, ValueRefreshed, PollingEnabled
+	 *    and PollingDisabled).
+	 *
+	 *  The properties are held as bit masks, so a notification is matched with a
+	 *  few tests and no locking.
+	 */
+	class OPENZWAVE_EXPORT WatcherFilter
+	{
+	public:
+		WatcherFilter();
+
+		void AddHomeId( uint32 const _homeId );
+		void AddNode( uint8 const _nodeId );
+		void AddCommandClass( uint8 const _commandClassId );
+		void AddNotificationType( Notification::NotificationType const _type );
+		void AddValueGenre( ValueID::ValueGenre const _genre );
+
+		/**
+		 * Whether the filter passes a notification.
+		 */
+		bool Matches( Notification const* _notification )const;
+
+	private:
+		static uint64 const c_driverTypes;						// Notifications about a whole driver
+		static uint64 const c_valueTypes;						// Notifications about a value
+
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		vector<uint32>	m_homeIds;								// Empty to pass every home ID
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32			m_nodes[8];								// Bit per node ID
+		uint32			m_commandClasses[8];					// Bit per command class ID
+		uint64			m_types;								// Bit per Notification::NotificationType
+		uint32			m_genres;								// Bit per ValueID::ValueGenre
+		bool			m_anyNode;								// No nodes have been added, so m_nodes has every bit set
+		bool			m_anyCommandClass;
+		bool			m_anyType;
+		bool			m_anyGenre;
+	};
+
+} // namespace OpenZWave
+
+#endif //_WatcherFilter_H
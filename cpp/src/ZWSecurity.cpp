@@ -55,6 +55,25 @@ namespace OpenZWave {
 			uint8 *iv,
 			uint8* _authentication			// 8-byte buffer that will be filled with the authentication data
 	)
+	{
+		return GenerateAuthentication( _data, _length, driver->GetAuthKey(), _sendingNode, _receivingNode, iv, _authentication );
+	}
+
+	//-----------------------------------------------------------------------------
+	// <GenerateAuthentication>
+	// Generate authentication data with the given key, which may be a copy of the
+	// driver's so that it can be used on another thread
+	//-----------------------------------------------------------------------------
+	bool GenerateAuthentication
+	(
+			uint8 const* _data,				// Starting from the command class command
+			uint32 const _length,
+			aes_encrypt_ctx *authKey,
+			uint8 const _sendingNode,
+			uint8 const _receivingNode,
+			uint8 *iv,
+			uint8* _authentication			// 8-byte buffer that will be filled with the authentication data
+	)
 	{
 		// Build a buffer containing a 4-byte header and the encrypted
 		// message data, padded with zeros to a 16-byte boundary.
@@ -74,9 +93,9 @@ namespace OpenZWave {
 		Log::Write(LogLevel_Debug, _receivingNode, "Raw Auth (Minus IV) Size: %d (%d)", bufsize, bufsize+16);
 #endif
 
-		aes_mode_reset(driver->GetAuthKey());
+		aes_mode_reset(authKey);
 		/* encrypt the IV with ecb */
-		if (aes_ecb_encrypt(iv, tmpauth, 16, driver->GetAuthKey()) == EXIT_FAILURE) {
+		if (aes_ecb_encrypt(iv, tmpauth, 16, authKey) == EXIT_FAILURE) {
 			Log::Write(LogLevel_Warning, _receivingNode, "Failed Initial ECB Encrypt of Auth Packet");
 			return false;
 		}
@@ -101,8 +120,8 @@ namespace OpenZWave {
 				}
 				/* reset our block counter back to 0 */
 				block = 0;
-				aes_mode_reset(driver->GetAuthKey());
-				if (aes_ecb_encrypt(tmpauth, tmpauth, 16, driver->GetAuthKey()) == EXIT_FAILURE) {
+				aes_mode_reset(authKey);
+				if (aes_ecb_encrypt(tmpauth, tmpauth, 16, authKey) == EXIT_FAILURE) {
 					Log::Write(LogLevel_Warning, _receivingNode, "Failed Subsequent (%d) ECB Encrypt of Auth Packet", i);
 					return false;
 				}
@@ -115,8 +134,8 @@ namespace OpenZWave {
 				 * so its safe to xor it with out tmpmac */
 				tmpauth[i] = encpck[i] ^ tmpauth[i];
 			}
-			aes_mode_reset(driver->GetAuthKey());
-			if (aes_ecb_encrypt(tmpauth, tmpauth, 16, driver->GetAuthKey()) == EXIT_FAILURE) {
+			aes_mode_reset(authKey);
+			if (aes_ecb_encrypt(tmpauth, tmpauth, 16, authKey) == EXIT_FAILURE) {
 				Log::Write(LogLevel_Warning, _receivingNode, "Failed Final ECB Encrypt of Auth Packet");
 				return false;
 			}
@@ -274,6 +293,24 @@ namespace OpenZWave {
 			uint8 const m_nonce[8],
 			uint8* m_buffer
 	)
+	{
+		return DecryptBuffer( e_buffer, e_length, driver->GetEncKey(), driver->GetAuthKey(), _sendingNode, _receivingNode, m_nonce, m_buffer );
+	}
+
+	/* The keys are passed in so that a worker thread can decrypt with its own copies
+	 * of them, as the AES contexts hold the state of the mode they are used in.
+	 */
+	bool DecryptBuffer
+	(
+			uint8 *e_buffer,
+			uint8 e_length,
+			aes_encrypt_ctx *encKey,
+			aes_encrypt_ctx *authKey,
+			uint8 const _sendingNode,
+			uint8 const _receivingNode,
+			uint8 const m_nonce[8],
+			uint8* m_buffer
+	)
 	{
 		PrintHex("Raw", e_buffer, e_length);
 
@@ -298,6 +335,10 @@ namespace OpenZWave {
 
 
 		uint8 encyptedpacket[32];
+		if (encryptedpacketsize > sizeof(encyptedpacket)) {
+			Log::Write(LogLevel_Warning, _sendingNode, "Encrypted Packet Size is More than %d Bytes. Dropping", (int)sizeof(encyptedpacket));
+			return false;
+		}
 
 		for (uint32 i = 0; i < 32; i++) {
 			if (i >= encryptedpacketsize) {
@@ -316,7 +357,7 @@ namespace OpenZWave {
 		/* Mac Starts after Encrypted Packet. */
 		PrintHex("Auth", &e_buffer[11+encryptedpacketsize], 8);
 #endif
-		aes_mode_reset(driver->GetEncKey());
+		aes_mode_reset(encKey);
 #if 0
 		uint8_t iv[16] = {  0x81, 0x42, 0xd1, 0x51, 0xf1, 0x59, 0x3d, 0x70, 0xd5, 0xe3, 0x6c, 0xcb, 0x02, 0xd0, 0x3f, 0x5c,  /* */  };
 		uint8_t pck[] = {  0x25, 0x68, 0x06, 0xc5, 0xb3, 0xee, 0x2c, 0x17, 0x26, 0x7e, 0xf0, 0x84, 0xd4, 0xc3, 0xba, 0xed, 0xe5, 0xb9, 0x55};
@@ -326,7 +367,7 @@ namespace OpenZWave {
 		}
 		PrintHex("Pck", decryptpacket, 19);
 #else
-		if (aes_ofb_decrypt(encyptedpacket, m_buffer, encryptedpacketsize, iv, driver->GetEncKey()) == EXIT_FAILURE) {
+		if (aes_ofb_decrypt(encyptedpacket, m_buffer, encryptedpacketsize, iv, encKey) == EXIT_FAILURE) {
 			Log::Write(LogLevel_Warning, _sendingNode, "Failed to Decrypt Packet");
 			return false;
 		}
@@ -336,7 +377,7 @@ namespace OpenZWave {
 		/* we have to regenerate the IV as the ofb decryption routine will alter it. */
 		createIVFromPacket_inbound(&e_buffer[2], m_nonce, iv);
 
-		GenerateAuthentication(&e_buffer[1], e_length-1, driver, _sendingNode, _receivingNode, iv, mac);
+		GenerateAuthentication(&e_buffer[1], e_length-1, authKey, _sendingNode, _receivingNode, iv, mac);
 		if (memcmp(&e_buffer[11+encryptedpacketsize], mac, 8) != 0) {
 			Log::Write(LogLevel_Warning, _sendingNode, "MAC Authentication of Packet Failed. Dropping");
 			return false;
@@ -19,7 +19,9 @@ namespace OpenZWave
 {
 bool EncyrptBuffer( uint8 *m_buffer, uint8 m_length, Driver *driver, uint8 const _sendingNode, uint8 const _receivingNode, uint8 const m_nonce[8], uint8* e_buffer);
 bool DecryptBuffer( uint8 *e_buffer, uint8 e_length, Driver *driver, uint8 const _sendingNode, uint8 const _receivingNode, uint8 const m_nonce[8], uint8* m_buffer );
+bool DecryptBuffer( uint8 *e_buffer, uint8 e_length, aes_encrypt_ctx *encKey, aes_encrypt_ctx *authKey, uint8 const _sendingNode, uint8 const _receivingNode, uint8 const m_nonce[8], uint8* m_buffer );
 bool GenerateAuthentication( uint8 const* _data, uint32 const _length, Driver *driver, uint8 const _sendingNode, uint8 const _receivingNode, uint8 *iv, uint8* _authentication);
+bool GenerateAuthentication( uint8 const* _data, uint32 const _length, aes_encrypt_ctx *authKey, uint8 const _sendingNode, uint8 const _receivingNode, uint8 *iv, uint8* _authentication);
 enum SecurityStrategy
 {
 	SecurityStrategy_Essential = 0,
@@ -27,6 +27,7 @@
 
 #include "command_classes/CommandClasses.h"
 #include "command_classes/Configuration.h"
+#include "ConfigScheduler.h"
 #include "Defs.h"
 #include "Msg.h"
 #include "Driver.h"
@@ -45,7 +46,10 @@ enum ConfigurationCmd
 {
 	ConfigurationCmd_Set	= 0x04,
 	ConfigurationCmd_Get	= 0x05,
-	ConfigurationCmd_Report	= 0x06
+	ConfigurationCmd_Report		= 0x06,
+	ConfigurationCmd_BulkSet	= 0x07,		// Version 2
+	ConfigurationCmd_BulkGet	= 0x08,
+	ConfigurationCmd_BulkReport	= 0x09
 };
 
 //-----------------------------------------------------------------------------
@@ -71,85 +75,130 @@ bool Configuration::HandleMsg
 			paramValue |= (int32)_data[i+3];
 		}
 
-		if ( Value* value = GetValue( 1, parameter ) )
+		UpdateParam( _instance, parameter, size, paramValue );
+		Log::Write( LogLevel_Info, GetNodeId(), "Received Configuration report: Parameter=%d, Value=%d", parameter, paramValue );
+		GetDriver()->m_configScheduler->OnReport( GetNodeId(), parameter, paramValue, size );
+		return true;
+	}
+
+	if (ConfigurationCmd_BulkReport == (ConfigurationCmd)_data[0])
+	{
+		// Parameter offset, number of parameters, reports to follow, size, then the values
+		if( _length < 7 )
+		{
+			return false;
+		}
+		uint16 first = ( (uint16)_data[1] << 8 ) | (uint16)_data[2];
+		uint8 count = _data[3];
+		uint8 size = _data[5] & 0x07;
+		Log::Write( LogLevel_Info, GetNodeId(), "Received Configuration bulk report: Parameters=%d-%d, Size=%d, %d reports to follow", first, first + count - 1, size, _data[4] );
+
+		uint32 pos = 6;
+		for( uint8 j=0; j<count && first + j <= 0xff && pos + size <= _length - 1; ++j )
 		{
-			switch ( value->GetID().GetType() )
+			int32 paramValue = 0;
+			for( uint8 i=0; i<size; ++i )
 			{
-				case ValueID::ValueType_Bool:
-				{
-					ValueBool* valueBool = static_cast<ValueBool*>( value );
-					valueBool->OnValueRefreshed( paramValue != 0 );
-					break;
-				}
-				case ValueID::ValueType_Byte:
-				{
-					ValueByte* valueByte = static_cast<ValueByte*>( value );
-					valueByte->OnValueRefreshed( (uint8)paramValue );
-					break;
-				}
-				case ValueID::ValueType_Short:
+				paramValue <<= 8;
+				paramValue |= (int32)_data[pos++];
+			}
+
+			uint8 parameter = (uint8)( first + j );
+			UpdateParam( _instance, parameter, size, paramValue );
+			Log::Write( LogLevel_Detail, GetNodeId(), "  Parameter=%d, Value=%d", parameter, paramValue );
+			GetDriver()->m_configScheduler->OnReport( GetNodeId(), parameter, paramValue, size );
+		}
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Configuration::UpdateParam>
+// Store a parameter value reported by the device
+//-----------------------------------------------------------------------------
+void Configuration::UpdateParam
+(
+	uint32 const _instance,
+	uint8 const _parameter,
+	uint8 const _size,
+	int32 const _paramValue
+)
+{
+	if ( Value* value = GetValue( 1, _parameter ) )
+	{
+		switch ( value->GetID().GetType() )
+		{
+			case ValueID::ValueType_Bool:
+			{
+				ValueBool* valueBool = static_cast<ValueBool*>( value );
+				valueBool->OnValueRefreshed( _paramValue != 0 );
+				break;
+			}
+			case ValueID::ValueType_Byte:
+			{
+				ValueByte* valueByte = static_cast<ValueByte*>( value );
+				valueByte->OnValueRefreshed( (uint8)_paramValue );
+				break;
+			}
+			case ValueID::ValueType_Short:
+			{
+				ValueShort* valueShort = static_cast<ValueShort*>( value );
+				valueShort->OnValueRefreshed( (int16)_paramValue );
+				break;
+			}
+			case ValueID::ValueType_Int:
+			{
+				ValueInt* valueInt = static_cast<ValueInt*>( value );
+				valueInt->OnValueRefreshed( _paramValue );
+				break;
+			}
+			case ValueID::ValueType_List:
+			{
+				ValueList* valueList = static_cast<ValueList*>( value );
+				valueList->OnValueRefreshed( _paramValue );
+				break;
+			}
+			default:
+			{
+				Log::Write( LogLevel_Info, GetNodeId(), "Invalid type (%d) for configuration parameter %d", value->GetID().GetType(), _parameter );
+			}
+		}
+		value->Release();
+	}
+	else
+	{
+		char label[16];
+		snprintf( label, 16, "Parameter #%d", _parameter );
+
+		// Create a new value
+		if( Node* node = GetNodeUnsafe() )
+		{
+			switch( _size )
+			{
+				case 1:
 				{
-					ValueShort* valueShort = static_cast<ValueShort*>( value );
-					valueShort->OnValueRefreshed( (int16)paramValue );
+				  	node->CreateValueByte( ValueID::ValueGenre_Config, GetCommandClassId(), _instance, _parameter, label, "", false, false, (uint8)_paramValue, 0 );
 					break;
 				}
-				case ValueID::ValueType_Int:
+				case 2:
 				{
-					ValueInt* valueInt = static_cast<ValueInt*>( value );
-					valueInt->OnValueRefreshed( paramValue );
+				  	node->CreateValueShort( ValueID::ValueGenre_Config, GetCommandClassId(), _instance, _parameter, label, "", false, false, (int16)_paramValue, 0 );
 					break;
 				}
-				case ValueID::ValueType_List:
+				case 4:
 				{
-					ValueList* valueList = static_cast<ValueList*>( value );
-					valueList->OnValueRefreshed( paramValue );
+				  	node->CreateValueInt( ValueID::ValueGenre_Config, GetCommandClassId(), _instance, _parameter, label, "", false, false, (int32)_paramValue, 0 );
 					break;
 				}
 				default:
 				{
-					Log::Write( LogLevel_Info, GetNodeId(), "Invalid type (%d) for configuration parameter %d", value->GetID().GetType(), parameter );
-				}
-			}
-			value->Release();
-		}
-		else
-		{
-			char label[16];
-			snprintf( label, 16, "Parameter #%d", parameter );
-
-			// Create a new value
-			if( Node* node = GetNodeUnsafe() )
-			{
-				switch( size )
-				{
-					case 1:
-					{
-					  	node->CreateValueByte( ValueID::ValueGenre_Config, GetCommandClassId(), _instance, parameter, label, "", false, false, (uint8)paramValue, 0 );
-						break;
-					}
-					case 2:
-					{
-					  	node->CreateValueShort( ValueID::ValueGenre_Config, GetCommandClassId(), _instance, parameter, label, "", false, false, (int16)paramValue, 0 );
-						break;
-					}
-					case 4:
-					{
-					  	node->CreateValueInt( ValueID::ValueGenre_Config, GetCommandClassId(), _instance, parameter, label, "", false, false, (int32)paramValue, 0 );
-						break;
-					}
-					default:
-					{
-						Log::Write( LogLevel_Info, GetNodeId(), "Invalid size of %d bytes for configuration parameter %d", size, parameter );
-					}
+					Log::Write( LogLevel_Info, GetNodeId(), "Invalid size of %d bytes for configuration parameter %d", _size, _parameter );
 				}
 			}
 		}
-
-		Log::Write( LogLevel_Info, GetNodeId(), "Received Configuration report: Parameter=%d, Value=%d", parameter, paramValue );
-		return true;
 	}
-
-	return false;
 }
 
 //-----------------------------------------------------------------------------
@@ -276,3 +325,72 @@ void Configuration::Set
 	msg->Append( GetDriver()->GetTransmitOptions() );
 	GetDriver()->SendMsg( msg, Driver::MsgQueue_Send );
 }
+
+//-----------------------------------------------------------------------------
+// <Configuration::BulkSet>
+// Set a run of parameters of the same size in one message.  The device is
+// asked to report them back once it has stored them.
+//-----------------------------------------------------------------------------
+bool Configuration::BulkSet
+(
+	uint8 const _first,
+	uint8 const _count,
+	uint8 const _size,
+	int32 const* _values
+)
+{
+	if( GetVersion() < 2 )
+	{
+		return false;
+	}
+
+	Log::Write( LogLevel_Info, GetNodeId(), "Configuration::BulkSet - Parameters=%d-%d, Size=%d", _first, _first + _count - 1, _size );
+
+	Msg* msg = new Msg( "ConfigurationCmd_BulkSet", GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
+	msg->Append( GetNodeId() );
+	msg->Append( 6 + _count * _size );
+	msg->Append( GetCommandClassId() );
+	msg->Append( ConfigurationCmd_BulkSet );
+	msg->Append( 0 );
+	msg->Append( _first );
+	msg->Append( _count );
+	msg->Append( 0x40 | _size );			// Handshake
+	for( uint8 i=0; i<_count; ++i )
+	{
+		for( int32 shift = ( _size - 1 ) * 8; shift >= 0; shift -= 8 )
+		{
+			msg->Append( (uint8)( ( _values[i] >> shift ) & 0xff ) );
+		}
+	}
+	msg->Append( GetDriver()->GetTransmitOptions() );
+	GetDriver()->SendMsg( msg, Driver::MsgQueue_Send );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Configuration::BulkGet>
+// Request a run of parameters in one message
+//-----------------------------------------------------------------------------
+bool Configuration::BulkGet
+(
+	uint8 const _first,
+	uint8 const _count
+)
+{
+	if( GetVersion() < 2 || !IsGetSupported() )
+	{
+		return false;
+	}
+
+	Msg* msg = new Msg( "ConfigurationCmd_BulkGet", GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
+	msg->Append( GetNodeId() );
+	msg->Append( 5 );
+	msg->Append( GetCommandClassId() );
+	msg->Append( ConfigurationCmd_BulkGet );
+	msg->Append( 0 );
+	msg->Append( _first );
+	msg->Append( _count );
+	msg->Append( GetDriver()->GetTransmitOptions() );
+	GetDriver()->SendMsg( msg, Driver::MsgQueue_Send );
+	return true;
+}
@@ -50,15 +50,20 @@ namespace OpenZWave
 
 		virtual bool RequestValue( uint32 const _requestFlags, uint8 const _parameter, uint8 const _index, Driver::MsgQueue const _queue );
 		void Set( uint8 const _parameter, int32 const _value, uint8 const _size );
+		bool BulkSet( uint8 const _first, uint8 const _count, uint8 const _size, int32 const* _values );
+		bool BulkGet( uint8 const _first, uint8 const _count );
 
 		// From CommandClass
 		virtual uint8 const GetCommandClassId()const{ return StaticGetCommandClassId(); }
 		virtual string const GetCommandClassName()const{ return StaticGetCommandClassName(); }
+		virtual uint8 GetMaxVersion(){ return 2; }
 		virtual bool HandleMsg( uint8 const* _data, uint32 const _length, uint32 const _instance = 1 );
 		virtual bool SetValue( Value const& _value );
 
 	private:
 		Configuration( uint32 const _homeId, uint8 const _nodeId ): CommandClass( _homeId, _nodeId ){}
+
+		void UpdateParam( uint32 const _instance, uint8 const _parameter, uint8 const _size, int32 const _paramValue );
 	};
 
 } // namespace OpenZWave
@@ -34,6 +34,7 @@
 #include "Node.h"
 #include "Notification.h"
 #include "Options.h"
+#include "SetValueTracker.h"
 #include "platform/Log.h"
 #include "platform/Mutex.h"
 #include "value_classes/ValueInt.h"
@@ -394,6 +395,11 @@ void WakeUp::QueueMsg
 			// Duplicate found
 			if( Driver::MsgQueueCmd_SendMsg == item.m_command )
 			{
+				if( item.m_msg->GetSetValueRequest() != 0 )
+				{
+					// The request is superseded by the copy
+					GetDriver()->m_setValueTracker->OnTransmitted( item.m_msg->GetSetValueRequest(), false );
+				}
 				delete item.m_msg;
 			}
 			else if( Driver::MsgQueueCmd_Controller == item.m_command )
@@ -0,0 +1,215 @@
+//-----------------------------------------------------------------------------
+//
+//	Capture.cpp
+//
+//	Binary capture of the traffic between the driver and a controller
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "Defs.h"
+#include "platform/Mutex.h"
+#include "platform/Log.h"
+#include "platform/TimeStamp.h"
+#include "platform/Capture.h"
+
+using namespace OpenZWave;
+
+static uint8 const c_header[] = { 'O', 'Z', 'W', 'C', 'A', 'P', 0x01, 0x00 };
+
+//-----------------------------------------------------------------------------
+//	<Capture::Capture>
+//	Constructor
+//-----------------------------------------------------------------------------
+Capture::Capture
+(
+):
+	m_file( NULL ),
+	m_mutex( new Mutex() ),
+	m_start( 0 )
+{
+}
+
+//-----------------------------------------------------------------------------
+//	<Capture::~Capture>
+//	Destructor
+//-----------------------------------------------------------------------------
+Capture::~Capture
+(
+)
+{
+	Close();
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<Capture::Create>
+//	Create a new capture file
+//-----------------------------------------------------------------------------
+bool Capture::Create
+(
+	string const& _filename
+)
+{
+	Close();
+
+	FILE* file = fopen( _filename.c_str(), "wb" );
+	if( !file )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: Unable to create capture file %s", _filename.c_str() );
+		return false;
+	}
+
+	fwrite( c_header, 1, sizeof(c_header), file );
+	fflush( file );
+
+	m_mutex->Lock();
+	m_file = file;
+	m_start = TimeStamp::GetMicroseconds();
+	m_mutex->Unlock();
+
+	Log::Write( LogLevel_Info, "  Capturing serial traffic to %s", _filename.c_str() );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<Capture::Open>
+//	Open an existing capture file
+//-----------------------------------------------------------------------------
+bool Capture::Open
+(
+	string const& _filename
+)
+{
+	Close();
+
+	m_file = fopen( _filename.c_str(), "rb" );
+	if( !m_file )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: Unable to open capture file %s", _filename.c_str() );
+		return false;
+	}
+
+	uint8 header[sizeof(c_header)];
+	if( fread( header, 1, sizeof(header), m_file ) != sizeof(header) || memcmp( header, c_header, sizeof(c_header) - 2 ) )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: %s is not a capture file", _filename.c_str() );
+		Close();
+		return false;
+	}
+
+	if( header[6] != c_header[6] )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: Capture file %s is version %d, only version %d is supported", _filename.c_str(), header[6], c_header[6] );
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<Capture::Close>
+//	Close the capture file
+//-----------------------------------------------------------------------------
+void Capture::Close
+(
+)
+{
+	m_mutex->Lock();
+	if( m_file )
+	{
+		fclose( m_file );
+		m_file = NULL;
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<Capture::Write>
+//	Append a record to the capture file
+//-----------------------------------------------------------------------------
+void Capture::Write
+(
+	Direction const _direction,
+	uint8 const* _data,
+	uint32 _length
+)
+{
+	m_mutex->Lock();
+	if( m_file )
+	{
+		uint64 time = TimeStamp::GetMicroseconds() - m_start;
+		uint8 header[11];
+		for( int i=0; i<8; ++i )
+		{
+			header[i] = (uint8)( time >> ( i * 8 ) );
+		}
+		header[8] = (uint8)_direction;
+		header[9] = (uint8)( _length & 0xff );
+		header[10] = (uint8)( _length >> 8 );
+
+		fwrite( header, 1, sizeof(header), m_file );
+		fwrite( _data, 1, _length, m_file );
+
+		// Flush every record, so that a crash does not lose the traffic leading up to it
+		fflush( m_file );
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<Capture::Read>
+//	Read the next record from the capture file
+//-----------------------------------------------------------------------------
+bool Capture::Read
+(
+	Record* _record
+)
+{
+	if( !m_file )
+	{
+		return false;
+	}
+
+	uint8 header[11];
+	if( fread( header, 1, sizeof(header), m_file ) != sizeof(header) )
+	{
+		return false;
+	}
+
+	_record->m_time = 0;
+	for( int i=7; i>=0; --i )
+	{
+		_record->m_time = ( _record->m_time << 8 ) | header[i];
+	}
+	_record->m_direction = header[8] ? Direction_Sent : Direction_Received;
+	_record->m_length = (uint32)header[9] | ( (uint32)header[10] << 8 );
+
+	if( _record->m_length > sizeof(_record->m_data) )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: Capture record of %d bytes is too long", _record->m_length );
+		return false;
+	}
+
+	return( fread( _record->m_data, 1, _record->m_length, m_file ) == _record->m_length );
+}
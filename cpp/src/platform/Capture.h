@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+//
+//	Capture.h
+//
+//	Binary capture of the traffic between the driver and a controller
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _Capture_H
+#define _Capture_H
+
+#include <stdio.h>
+#include <string>
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	class Mutex;
+
+	/** \brief Reads and writes capture files of serial traffic.
+	 *
+	 * A capture file starts with the eight byte header "OZWCAP" followed by a version byte
+	 * and a reserved byte.  Each record that follows is made up of:
+	 *  - the time in microseconds since the capture started (8 bytes, little endian)
+	 *  - the direction: 0 for data received from the controller, 1 for data sent to it
+	 *  - the length of the data (2 bytes, little endian)
+	 *  - the data itself
+	 * Records are written in the order the data crossed the Controller layer, so replaying
+	 * them reproduces the original byte stream and timing.
+	 * \see Controller::StartCapture, ReplayController
+	 */
+	class Capture
+	{
+	public:
+		enum Direction
+		{
+			Direction_Received = 0,				// Data from the controller to the driver
+			Direction_Sent						// Data from the driver to the controller
+		};
+
+		struct Record
+		{
+			uint64		m_time;					// Microseconds since the capture started
+			Direction	m_direction;
+			uint32		m_length;
+			uint8		m_data[2048];
+		};
+
+		Capture();
+		~Capture();
+
+		/**
+		 * Create a capture file, replacing any existing file of the same name.
+		 * @param _filename Path of the file.
+		 * @return True if the file was created.
+		 */
+		bool Create( string const& _filename );
+
+		/**
+		 * Open an existing capture file for reading.
+		 * @param _filename Path of the file.
+		 * @return True if the file was opened and has a valid header.
+		 */
+		bool Open( string const& _filename );
+
+		/**
+		 * Close the capture file.
+		 */
+		void Close();
+
+		bool IsOpen()const{ return m_file != NULL; }
+
+		/**
+		 * Append a record to the capture, and flush it to the file.  Thread safe.
+		 * @param _direction Whether the data was received from or sent to the controller.
+		 * @param _data Pointer to the data.
+		 * @param _length Length in bytes of the data.
+		 */
+		void Write( Direction const _direction, uint8 const* _data, uint32 _length );
+
+		/**
+		 * Read the next record from the capture.
+		 * @param _record Filled in with the record.
+		 * @return False at the end of the file.
+		 */
+		bool Read( Record* _record );
+
+	private:
+		Capture( Capture const& );				// prevent copy
+		Capture& operator = ( Capture const& );	// prevent assignment
+
+		FILE*		m_file;
+		Mutex*		m_mutex;					// Serializes writes from the driver and controller threads
+		uint64		m_start;					// Time the capture was created
+	};
+
+} // namespace OpenZWave
+
+#endif //_Capture_H
@@ -27,9 +27,36 @@
 #include "Defs.h"
 #include "Driver.h"
 #include "platform/Controller.h"
+#include "platform/Capture.h"
+#include "platform/Mutex.h"
 
 using namespace OpenZWave;
 
+//-----------------------------------------------------------------------------
+// <Controller::Controller>
+// Constructor
+//-----------------------------------------------------------------------------
+Controller::Controller
+(
+):
+	Stream( 2048 ),
+	m_capture( NULL ),
+	m_captureMutex( new Mutex() )
+{
+}
+
+//-----------------------------------------------------------------------------
+// <Controller::~Controller>
+// Destructor
+//-----------------------------------------------------------------------------
+Controller::~Controller
+(
+)
+{
+	delete m_capture;
+	m_captureMutex->Release();
+}
+
 //-----------------------------------------------------------------------------
 // <Controller::PlayInitSequence>
 //  Queues up the controller's initialization commands.
@@ -66,3 +93,131 @@ uint32 Controller::Read
 	return 0;
 }
 
+//-----------------------------------------------------------------------------
+//	<Controller::Send>
+//	Write to a controller, and record the data in any capture
+//-----------------------------------------------------------------------------
+uint32 Controller::Send
+(
+	uint8* _buffer,
+	uint32 _length
+)
+{
+	m_captureMutex->Lock();
+	if( m_capture )
+	{
+		m_capture->Write( Capture::Direction_Sent, _buffer, _length );
+	}
+	m_captureMutex->Unlock();
+	return Write( _buffer, _length );
+}
+
+//-----------------------------------------------------------------------------
+//	<Controller::Put>
+//	Pass data from the controller to the driver, and record it in any capture
+//-----------------------------------------------------------------------------
+bool Controller::Put
+(
+	uint8* _buffer,
+	uint32 _size
+)
+{
+	// Record first, so that the capture never shows the driver's answer
+	// ahead of the data it is answering
+	m_captureMutex->Lock();
+	if( m_capture )
+	{
+		m_capture->Write( Capture::Direction_Received, _buffer, _size );
+	}
+	m_captureMutex->Unlock();
+	return Stream::Put( _buffer, _size );
+}
+
+//-----------------------------------------------------------------------------
+//	<Controller::Commit>
+//	Pass data read straight into the buffer to the driver, and record it in
+//	any capture
+//-----------------------------------------------------------------------------
+void Controller::Commit
+(
+	uint32 _size
+)
+{
+	m_captureMutex->Lock();
+	if( m_capture )
+	{
+		// The data has not been added yet, so it starts at the free space
+		uint8* block1;
+		uint8* block2;
+		uint32 size1;
+		uint32 size2;
+		GetFreeBlocks( &block1, &size1, &block2, &size2 );
+		if( _size > size1 )
+		{
+			m_capture->Write( Capture::Direction_Received, block1, size1 );
+			m_capture->Write( Capture::Direction_Received, block2, _size - size1 );
+		}
+		else
+		{
+			m_capture->Write( Capture::Direction_Received, block1, _size );
+		}
+	}
+	m_captureMutex->Unlock();
+	Stream::Commit( _size );
+}
+
+//-----------------------------------------------------------------------------
+//	<Controller::StartCapture>
+//	Start recording the controller traffic
+//-----------------------------------------------------------------------------
+bool Controller::StartCapture
+(
+	string const& _filename
+)
+{
+	Capture* capture = new Capture();
+	if( !capture->Create( _filename ) )
+	{
+		delete capture;
+		return false;
+	}
+
+	// Replace any capture that is already running
+	m_captureMutex->Lock();
+	Capture* old = m_capture;
+	m_capture = capture;
+	m_captureMutex->Unlock();
+
+	delete old;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<Controller::StopCapture>
+//	Stop recording the controller traffic
+//-----------------------------------------------------------------------------
+void Controller::StopCapture
+(
+)
+{
+	m_captureMutex->Lock();
+	Capture* capture = m_capture;
+	m_capture = NULL;
+	m_captureMutex->Unlock();
+
+	delete capture;
+}
+
+//-----------------------------------------------------------------------------
+//	<Controller::IsCapturing>
+//	Whether the controller traffic is being recorded
+//-----------------------------------------------------------------------------
+bool Controller::IsCapturing
+(
+)
+{
+	m_captureMutex->Lock();
+	bool res = ( m_capture != NULL );
+	m_captureMutex->Unlock();
+	return res;
+}
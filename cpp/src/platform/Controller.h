@@ -37,6 +37,8 @@
 namespace OpenZWave
 {
 	class Driver;
+	class Capture;
+	class Mutex;
 
 	class Controller: public Stream
 	{
@@ -49,13 +51,13 @@ namespace OpenZWave
 		 * Consructor.
 		 * Creates the controller object.
 		 */
-		Controller():Stream( 2048 ){}
+		Controller();
 
 		/**
 		 * Destructor.
 		 * Destroys the controller object.
 		 */
-		virtual ~Controller(){}
+		virtual ~Controller();
 
 		/**
 		 * Queues a set of Z-Wave messages in the correct order needed to initialize the Controller implementation.
@@ -99,6 +101,74 @@ namespace OpenZWave
 		 * @see Write, Open, Close
 		 */
 		uint32 Read( uint8* _buffer, uint32 _length );
+
+		/**
+		 * Write to a controller, recording the data if a capture is running.
+		 * The driver uses this rather than calling Write directly.
+		 * @param _buffer Pointer to a block of memory containing the data to be written.
+		 * @param _length Length in bytes of the data.
+		 * @return The number of bytes written.
+		 * @see Write, StartCapture
+		 */
+		uint32 Send( uint8* _buffer, uint32 _length );
+
+		/**
+		 * Record all data passing through the controller in a binary capture file.
+		 * @param _filename Path of the capture file, which is replaced if it exists.
+		 * @return True if the capture file was created.
+		 * @see StopCapture, Capture, ReplayController
+		 */
+		bool StartCapture( string const& _filename );
+
+		/**
+		 * Stop recording and close the capture file.
+		 * @see StartCapture
+		 */
+		void StopCapture();
+
+		bool IsCapturing();
+
+		/**
+		 * Wait for one of the driver's wait objects, which include this controller, to become
+		 * signalled.  The driver thread waits through its controller, so that a controller
+		 * can read from its device on that thread instead of running one of its own.
+		 * @param _objects Array of pointers to objects to wait on.
+		 * @param _numObjects Number of objects in the array.
+		 * @param _timeout Maximum time to wait in milliseconds, or Wait::Timeout_Infinite.
+		 * @return Index into the array of the object that was signalled, -1 if the wait timed out.
+		 * @see Wait::Multiple
+		 */
+		virtual int32 WaitMultiple( Wait** _objects, uint32 _numObjects, int32 _timeout ){ return Wait::Multiple( _objects, _numObjects, _timeout ); }
+
+		/**
+		 * Wait until the controller holds at least as much data as its signal threshold.
+		 * @param _timeout Maximum time to wait in milliseconds.
+		 * @return Zero if the data is available, -1 if the wait timed out.
+		 * @see SetSignalThreshold, WaitMultiple
+		 */
+		int32 WaitForData( int32 _timeout ){ Wait* self = this; return WaitMultiple( &self, 1, _timeout ); }
+
+	protected:
+		/**
+		 * Pass data received from the controller hardware to the driver.
+		 * Hides Stream::Put so that implementations record the data when a capture is running.
+		 * @param _buffer Pointer to the received data.
+		 * @param _size Length in bytes of the data.
+		 * @return True if the data fitted in the buffer.
+		 */
+		bool Put( uint8* _buffer, uint32 _size );
+
+		/**
+		 * Pass data that was read straight into the stream buffer to the driver.
+		 * Hides Stream::Commit so that implementations record the data when a capture is running.
+		 * @param _size Length in bytes of the data.
+		 * @see GetFreeBlocks
+		 */
+		void Commit( uint32 _size );
+
+	private:
+		Capture*			m_capture;
+		Mutex*				m_captureMutex;			// Guards m_capture, which the driver and read threads write to
 	};
 
 } // namespace OpenZWave
@@ -42,6 +42,10 @@
 #define INPUT_REPORT_LENGTH 0x5
 #define OUTPUT_REPORT_LENGTH 0x0
 
+// Longest time the read thread blocks on the device before checking whether it
+// has been asked to exit
+static int const c_readTimeout = 250;
+
 using namespace OpenZWave;
 
 //-----------------------------------------------------------------------------
@@ -214,7 +218,7 @@ void HidController::ThreadProc
 		{
 			// Enter read loop.  Call will only return if
 			// an exit is requested or an error occurs
-			Read();
+			Read( _exitEvent );
 
 			// Reset the attempts, so we get a rapid retry for temporary errors
 			attempts = 0;
@@ -350,8 +354,8 @@ bool HidController::Init
 	CHECK_HIDAPI_RESULT(hidApiResult, HidOpenFailure);
 
 	// Ensure that reads for input reports are blocked.
-	// Input report data is polled in Wait() to check if there are feature
-	// reports waiting to be retrieved that contain ZWave rx packets.
+	// The read thread waits for input reports, which say whether there are
+	// feature reports waiting to be retrieved that contain ZWave rx packets.
 	hidApiResult = hid_set_nonblocking(m_hHidController, 0);
 	CHECK_HIDAPI_RESULT(hidApiResult, HidOpenFailure);
 
@@ -374,26 +378,30 @@ HidOpenFailure:
 //-----------------------------------------------------------------------------
 void HidController::Read
 (
+	Event* _exitEvent
 )
 {
 	uint8 buffer[FEATURE_REPORT_LENGTH];
 	int bytesRead = 0;
 	uint8 inputReport[INPUT_REPORT_LENGTH];
-	TimeStamp readTimer;
 
- 	while( true )
+	while( true )
 	{
 		// Rx feature report buffer should contain
 		// [0]      - 0x05 (rx feature report ID)
 		// [1]      - length of rx data (or 0x00 and no further bytes if no rx data waiting)
 		// [2]...   - rx data
-	  	// We poll this waiting for data.
-		bytesRead = GetFeatureReport(FEATURE_REPORT_LENGTH, 0x5, buffer);
-		CHECK_HIDAPI_RESULT(bytesRead, HidPortError);
-		if( bytesRead >= 2 )
+		// Retrieve every report that is waiting before blocking again.
+		while( true )
 		{
+			bytesRead = GetFeatureReport(FEATURE_REPORT_LENGTH, 0x5, buffer);
+			CHECK_HIDAPI_RESULT(bytesRead, HidPortError);
+			if( bytesRead < 2 || buffer[1] == 0 )
+			{
+				break;
+			}
 
-			if( buffer[1] > 0 )
+			if( Log::IsLevelEnabled( LogLevel_Detail ) )
 			{
 				string tmp = "";
 				for (int i = 0; i < buffer[1]; i++)
@@ -405,43 +413,35 @@ void HidController::Read
 				Log::Write( LogLevel_Detail, "hid report read=%d ID=%d len=%d %s", bytesRead, buffer[0], buffer[1], tmp.c_str() );
 			}
 
-			if( buffer[1] > 0 )
-			{
-				Put( &buffer[2], buffer[1] );
-			}
+			Put( &buffer[2], buffer[1] );
 		}
-		if( readTimer.TimeRemaining() <= 0 )
+
+		if( Wait::Single( _exitEvent, 0 ) >= 0 )
 		{
-			// Hang a hid_read to acknowledge receipt. Seems the response is conveying
-			// transaction status.
-			// Wayne-Dalton input report data is structured as follows (best guess):
-			// [0] 0x03      - input report ID
-			// [1] 0x01      - ??? never changes
-			// [2] 0xNN      - if 0x01, no feature reports waiting
-			//                 if 0x02, feature report ID 0x05 is waiting to be retrieved
-			// [3,4] 0xNNNN  - Number of ZWave messages?
-
-			int hidApiResult = hid_read( m_hHidController, inputReport, INPUT_REPORT_LENGTH );
-			//if( hidApiResult != 0 )
-			//{
-			//	string tmp = "";
-			//	for( int i = 0; i < INPUT_REPORT_LENGTH; i++ )
-			//	{
-			//		char bstr[16];
-			//		snprintf(bstr, sizeof(bstr), "%02x ", inputReport[i] );
-			//		tmp += bstr;
-			//	}
-			//	Log::Write( LogLevel_Detail, "hid read %d %s", hidApiResult, tmp.c_str() );
-			//}
-
-			if( hidApiResult == -1 )
-			{
-				const wchar_t* errString = hid_error(m_hHidController);
-				Log::Write( LogLevel_Warning, "Error: HID port returned error reading input bytes: 0x%08hx, HIDAPI error string: %ls", hidApiResult, errString );
-			}
-			readTimer.SetTime( 100 );
+			// Exit signalled
+			return;
+		}
+
+		// Block until the controller sends an input report, which also acknowledges
+		// the receipt of the previous one.  Seems the report is conveying transaction
+		// status.
+		// Wayne-Dalton input report data is structured as follows (best guess):
+		// [0] 0x03      - input report ID
+		// [1] 0x01      - ??? never changes
+		// [2] 0xNN      - if 0x01, no feature reports waiting
+		//                 if 0x02, feature report ID 0x05 is waiting to be retrieved
+		// [3,4] 0xNNNN  - Number of ZWave messages?
+		// As that layout is a guess, the feature reports are checked after every input
+		// report whatever it says, and after every timeout in case one was missed.
+		// hidapi cannot wait on anything but the device, so the wait is bounded to
+		// notice the exit event.  See the class comment.
+		int hidApiResult = hid_read_timeout( m_hHidController, inputReport, INPUT_REPORT_LENGTH, c_readTimeout );
+		if( hidApiResult == -1 )
+		{
+			const wchar_t* errString = hid_error(m_hHidController);
+			Log::Write( LogLevel_Warning, "Error: HID port returned error reading input bytes: 0x%08hx, HIDAPI error string: %ls", hidApiResult, errString );
+			return;
 		}
-		m_thread->Sleep(10);
 	}
 
 HidPortError:
@@ -44,6 +44,14 @@ namespace OpenZWave
 	class Thread;
 	class Event;
 
+	/** \brief A Z-Wave controller on a USB HID stick, such as the ControlThink ThinkStick.
+	 *
+	 * The read thread blocks on the stick's input reports, and drains the rx feature
+	 * reports after each one.  hidapi can only wait on the device, and closing it while
+	 * another thread reads from it is not safe, so the wait is limited to 250ms to let
+	 * the thread notice Close.  An idle stick therefore still wakes the thread four times
+	 * a second, rather than a hundred times as when the feature report was polled.
+	 */
 	class HidController: public Controller
 	{
 	public:
@@ -112,7 +120,7 @@ namespace OpenZWave
 
 	private:
 		bool Init( uint32 const _attempts );
-		void Read();
+		void Read( Event* _exitEvent );
 
         // helpers for internal use only
 
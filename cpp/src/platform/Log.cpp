@@ -64,6 +64,7 @@ char const *OpenZWave::LogLevelString[] =
 Log* Log::s_instance = NULL;
 i_LogImpl* Log::m_pImpl = NULL;
 static bool s_dologging;
+static LogLevel s_level = LogLevel_Internal;		// Highest level that is saved or queued
 
 //-----------------------------------------------------------------------------
 //	<Log::Create>
@@ -88,6 +89,7 @@ Log* Log::Create
 		s_instance = new Log( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger );
 		s_dologging = true; // default logging to true so no change to what people experience now
 	}
+	s_level = ( _saveLevel > _queueLevel ) ? _saveLevel : _queueLevel;
 
 	return s_instance;
 }
@@ -136,6 +138,7 @@ bool Log::SetLoggingClass
 {
 	delete m_pImpl;
 	m_pImpl = LogClass;
+	s_level = LogLevel_Internal;		// We cannot tell what the new class will keep
 	return true;
 }
 
@@ -197,6 +200,7 @@ void Log::SetLoggingState
 		s_instance->m_pImpl->SetLoggingState( _saveLevel, _queueLevel, _dumpTrigger );
 		s_instance->m_logMutex->Unlock();
 	}
+	s_level = ( _saveLevel > _queueLevel ) ? _saveLevel : _queueLevel;
 
 	if (!prevLogging && s_dologging) Log::Write(LogLevel_Always, "Logging started\n\n");
 }
@@ -212,6 +216,18 @@ bool Log::GetLoggingState
 	return s_dologging;
 }
 
+//-----------------------------------------------------------------------------
+//	<Log::IsLevelEnabled>
+//	Return a flag to indicate whether messages of a level are kept
+//-----------------------------------------------------------------------------
+bool Log::IsLevelEnabled
+(
+	LogLevel const _level
+)
+{
+	return( s_instance && s_dologging && s_instance->m_pImpl && _level <= s_level );
+}
+
 //-----------------------------------------------------------------------------
 //	<Log::Write>
 //	Write to the log
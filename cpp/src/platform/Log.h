@@ -136,6 +136,14 @@ namespace OpenZWave
 		*/
 		static void GetLoggingState( LogLevel* _saveLevel, LogLevel* _queueLevel, LogLevel* _dumpTrigger );
 
+		/**
+		 * \brief Determine whether messages of a level would be written or queued.  Callers can use
+		 * this to skip building expensive arguments for messages that would be thrown away.
+		 * \param _level	LogLevel of the message
+		 * \return True if the message would be saved or queued
+		*/
+		static bool IsLevelEnabled( LogLevel const _level );
+
 		/**
 		 * \brief Change the log file name.  This will start a new log file (or potentially start appending
 		 * information to an existing one.  Developers might want to use this function, together with a timer
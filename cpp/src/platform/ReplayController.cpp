@@ -0,0 +1,328 @@
+//-----------------------------------------------------------------------------
+//
+//	ReplayController.cpp
+//
+//	Controller that plays back a capture of serial traffic
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+
+#include "Defs.h"
+#include "platform/Thread.h"
+#include "platform/Event.h"
+#include "platform/Log.h"
+#include "platform/TimeStamp.h"
+#include "platform/ReplayController.h"
+
+using namespace OpenZWave;
+
+// Size of the stream buffer allocated by the Controller base class
+static uint32 const c_streamBufferSize = 2048;
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::ReplayController>
+//	Constructor
+//-----------------------------------------------------------------------------
+ReplayController::ReplayController
+(
+):
+	m_thread( NULL ),
+	m_writeEvent( new Event() ),
+	m_bOpen( false ),
+	m_speed( 100 ),
+	m_lockstep( 2000 ),
+	m_framesWritten( 0 ),
+	m_framesExpected( 0 ),
+	m_recordsReplayed( 0 ),
+	m_lockstepTimeouts( 0 ),
+	m_finished( false )
+{
+}
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::~ReplayController>
+//	Destructor
+//-----------------------------------------------------------------------------
+ReplayController::~ReplayController
+(
+)
+{
+	Close();
+	m_writeEvent->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::Open>
+//	Open the capture file and start the replay thread
+//-----------------------------------------------------------------------------
+bool ReplayController::Open
+(
+	string const& _controllerName
+)
+{
+	if( m_bOpen )
+	{
+		return false;
+	}
+
+	ParseSettings( _controllerName );
+	if( !m_capture.Open( m_filename ) )
+	{
+		return false;
+	}
+
+	Log::Write( LogLevel_Info, "    Replaying capture %s at %d%% speed", m_filename.c_str(), m_speed );
+
+	m_framesWritten = 0;
+	m_framesExpected = 0;
+	m_recordsReplayed = 0;
+	m_lockstepTimeouts = 0;
+	m_finished = false;
+	m_bOpen = true;
+
+	m_thread = new Thread( "ReplayController" );
+	m_thread->Start( ThreadEntryPoint, this );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::Close>
+//	Stop the replay
+//-----------------------------------------------------------------------------
+bool ReplayController::Close
+(
+)
+{
+	if( !m_bOpen )
+	{
+		return false;
+	}
+
+	if( m_thread )
+	{
+		m_thread->Stop();
+		m_thread->Release();
+		m_thread = NULL;
+	}
+
+	m_capture.Close();
+	m_bOpen = false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::ParseSettings>
+//	Read the replay settings from the controller path
+//-----------------------------------------------------------------------------
+void ReplayController::ParseSettings
+(
+	string const& _settings
+)
+{
+	if( _settings.find( '=' ) == string::npos )
+	{
+		// Just a file name
+		m_filename = _settings;
+		return;
+	}
+
+	size_t pos = 0;
+	while( pos < _settings.size() )
+	{
+		size_t end = _settings.find( ',', pos );
+		if( end == string::npos )
+		{
+			end = _settings.size();
+		}
+
+		string setting = _settings.substr( pos, end - pos );
+		pos = end + 1;
+
+		size_t eq = setting.find( '=' );
+		if( eq == string::npos )
+		{
+			continue;
+		}
+
+		string key = setting.substr( 0, eq );
+		string value = setting.substr( eq + 1 );
+		if( key == "file" )
+		{
+			m_filename = value;
+		}
+		else if( key == "speed" )
+		{
+			m_speed = (uint32)atoi( value.c_str() );
+		}
+		else if( key == "lockstep" )
+		{
+			m_lockstep = atoi( value.c_str() );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::Write>
+//	Count the frames sent by the driver
+//-----------------------------------------------------------------------------
+uint32 ReplayController::Write
+(
+	uint8* _buffer,
+	uint32 _length
+)
+{
+	if( !m_bOpen )
+	{
+		return 0;
+	}
+
+	if( _length > 1 && _buffer[0] == SOF )
+	{
+		++m_framesWritten;
+		m_writeEvent->Set();
+	}
+	return _length;
+}
+
+//-----------------------------------------------------------------------------
+//	<ReplayController::WaitForDriver>
+//	Wait for the driver to send as many frames as the original driver had.
+//	Returns false if the thread is exiting.
+//-----------------------------------------------------------------------------
+bool ReplayController::WaitForDriver
+(
+	Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;
+	waitObjects[1] = m_writeEvent;
+
+	TimeStamp timeout;
+	timeout.SetTime( m_lockstep );
+	while( true )
+	{
+		m_writeEvent->Reset();
+		if( m_framesWritten >= m_framesExpected )
+		{
+			return true;
+		}
+
+		int32 remaining = timeout.TimeRemaining();
+		if( remaining <= 0 )
+		{
+			// The driver has taken a different path from the original run, so
+			// stop waiting for this frame rather than stalling the replay.
+			++m_lockstepTimeouts;
+			Log::Write( LogLevel_Warning, "Replay: driver did not send frame %d within %dms, continuing without it", m_framesExpected, m_lockstep );
+			m_framesExpected = m_framesWritten;
+			return true;
+		}
+
+		if( Wait::Multiple( waitObjects, 2, remaining ) == 0 )
+		{
+			return false;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <ReplayController::ThreadEntryPoint>
+// Entry point of the replay thread
+//-----------------------------------------------------------------------------
+void ReplayController::ThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	ReplayController* rc = (ReplayController*)_context;
+	if( rc )
+	{
+		rc->ThreadProc( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <ReplayController::ThreadProc>
+// Pass the captured data to the driver
+//-----------------------------------------------------------------------------
+void ReplayController::ThreadProc
+(
+	Event* _exitEvent
+)
+{
+	uint64 previous = 0;
+	bool first = true;
+
+	while( m_capture.Read( &m_record ) )
+	{
+		if( first )
+		{
+			previous = m_record.m_time;
+			first = false;
+		}
+
+		if( m_record.m_direction == Capture::Direction_Sent )
+		{
+			// ACK, NAK and CAN bytes from the driver are not waited for
+			if( m_record.m_length > 1 && m_record.m_data[0] == SOF )
+			{
+				++m_framesExpected;
+				if( !WaitForDriver( _exitEvent ) )
+				{
+					return;
+				}
+				previous = m_record.m_time;
+			}
+			continue;
+		}
+
+		if( m_speed )
+		{
+			// Reproduce the gap since the previous event, scaled by the speed
+			int32 delay = (int32)( ( m_record.m_time - previous ) / 10 / m_speed );
+			if( delay > 0 && Wait::Single( _exitEvent, delay ) == 0 )
+			{
+				return;
+			}
+		}
+		previous = m_record.m_time;
+
+		while( GetDataSize() + m_record.m_length > c_streamBufferSize )
+		{
+			// Give the driver time to catch up
+			if( Wait::Single( _exitEvent, 1 ) == 0 )
+			{
+				return;
+			}
+		}
+
+		Put( m_record.m_data, m_record.m_length );
+		++m_recordsReplayed;
+	}
+
+	Log::Write( LogLevel_Info, "Replay of %s complete: %d records replayed, %d lockstep timeouts", m_filename.c_str(), m_recordsReplayed, m_lockstepTimeouts );
+	m_finished = true;
+	Wait::Single( _exitEvent, -1 );
+}
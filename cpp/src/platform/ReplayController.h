@@ -0,0 +1,130 @@
+//-----------------------------------------------------------------------------
+//
+//	ReplayController.h
+//
+//	Controller that plays back a capture of serial traffic
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ReplayController_H
+#define _ReplayController_H
+
+#include <string>
+#include "Defs.h"
+#include "platform/Controller.h"
+#include "platform/Capture.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Thread;
+	class Event;
+
+	/** \brief Feeds a capture file written through the CaptureFile option back to the driver,
+	 * so that recorded production traffic can be profiled without the original network.
+	 *
+	 * The data received from the controller is replayed in its original order.  Before
+	 * continuing past each frame the original driver sent, the replay waits for the driver
+	 * to send a frame of its own, so that responses and callbacks still follow the requests
+	 * they answer.  The driver should start from the same zwcfg_*.xml file as the original
+	 * run, otherwise it may send a different sequence of requests.
+	 *
+	 * The controller path passed to Manager::AddDriver is either the capture file name, or a
+	 * comma separated list of settings:
+	 *  - file:		capture file to replay
+	 *  - speed:	percentage of the original speed, or 0 to replay as fast as the driver
+	 *				reads the data (default 100)
+	 *  - lockstep:	milliseconds to wait for the driver to send a frame before carrying on
+	 *				without it (default 2000)
+	 */
+	class ReplayController: public Controller
+	{
+	public:
+		/**
+		 * Constructor.
+		 * Creates an object that replays a capture file.
+		 */
+		ReplayController();
+
+		/**
+		 * Destructor.
+		 * Destroys the replay controller object.
+		 */
+		virtual ~ReplayController();
+
+		/**
+		 * Open the capture file and start the replay.
+		 * @param _controllerName The capture file name, or a list of settings.
+		 * @return True if the capture file was opened.
+		 * @see Close, Read, Write
+		 */
+		bool Open( string const& _controllerName );
+
+		/**
+		 * Stop the replay.
+		 * @return True if the replay was stopped, or false if it was not running.
+		 * @see Open
+		 */
+		bool Close();
+
+		/**
+		 * Write to the replay controller.  The data is discarded, but each frame
+		 * allows the replay to move past the next frame sent in the original run.
+		 * @param _buffer Pointer to a block of memory containing the data to be written.
+		 * @param _length Length in bytes of the data.
+		 * @return The number of bytes written.
+		 * @see Read, Open, Close
+		 */
+		uint32 Write( uint8* _buffer, uint32 _length );
+
+		// Statistics
+		uint32 GetRecordsReplayed()const{ return m_recordsReplayed; }
+		uint32 GetLockstepTimeouts()const{ return m_lockstepTimeouts; }
+		bool IsFinished()const{ return m_finished; }
+
+	private:
+		void ParseSettings( string const& _settings );
+		bool WaitForDriver( Event* _exitEvent );
+
+		static void ThreadEntryPoint( Event* _exitEvent, void* _context );
+		void ThreadProc( Event* _exitEvent );
+
+		Thread*				m_thread;
+		Event*				m_writeEvent;				// Signalled when the driver sends a frame
+		Capture				m_capture;
+		Capture::Record		m_record;
+		bool				m_bOpen;
+
+		string				m_filename;
+		uint32				m_speed;
+		int32				m_lockstep;
+
+		uint32 volatile		m_framesWritten;			// Frames sent by the driver
+		uint32				m_framesExpected;			// Frames sent by the original driver so far
+		uint32				m_recordsReplayed;
+		uint32				m_lockstepTimeouts;
+		bool volatile		m_finished;
+	};
+
+} // namespace OpenZWave
+
+#endif //_ReplayController_H
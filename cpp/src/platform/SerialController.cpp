@@ -52,7 +52,8 @@ SerialController::SerialController
 	m_baud ( 115200 ),
 	m_parity ( SerialController::Parity_None ),
 	m_stopBits ( SerialController::StopBits_One ),
-	m_bOpen( false )
+	m_bOpen( false ),
+	m_directRead( false )
 {
 	m_pImpl = new SerialControllerImpl( this );
 }
@@ -125,6 +126,33 @@ bool SerialController::SetStopBits
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+//  <SerialController::SetDirectRead>
+//  Read the serial port from the driver thread.
+//  The serial port must be closed for the setting to be accepted.
+//-----------------------------------------------------------------------------
+bool SerialController::SetDirectRead
+(
+	bool const _directRead
+)
+{
+	if( m_bOpen )
+	{
+		return false;
+	}
+
+#if defined WIN32 || defined WINRT
+	if( _directRead )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: Direct serial reads are not supported on this platform" );
+		return false;
+	}
+#endif
+
+	m_directRead = _directRead;
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 //	<SerialController::Open>
 //	Open and configure a serial port
@@ -183,5 +211,22 @@ uint32 SerialController::Write
 	return( m_pImpl->Write( _buffer, _length ) );
 }
 
-
-
+//-----------------------------------------------------------------------------
+//	<SerialController::WaitMultiple>
+//	Wait for one of the driver's wait objects to become signalled
+//-----------------------------------------------------------------------------
+int32 SerialController::WaitMultiple
+(
+	Wait** _objects,
+	uint32 _numObjects,
+	int32 _timeout
+)
+{
+#if !defined WIN32 && !defined WINRT
+	if( m_bOpen && m_directRead )
+	{
+		return m_pImpl->WaitMultiple( _objects, _numObjects, _timeout );
+	}
+#endif
+	return Controller::WaitMultiple( _objects, _numObjects, _timeout );
+}
@@ -95,6 +95,17 @@ namespace OpenZWave
 		 */
 		bool SetStopBits( StopBits const _stopBits );
 
+		/**
+		 * Read the serial port from the driver thread, rather than from a thread of its own.
+		 * The driver's wait includes the port, and received data is read straight into the
+		 * stream buffer.  Only supported on unix platforms.  The serial port must be closed
+		 * for the setting to be accepted.
+		 * @param _directRead True to read from the driver thread.
+		 * @return True if the setting was accepted.
+		 * @see Open, WaitMultiple
+		 */
+		bool SetDirectRead( bool const _directRead );
+
 		/**
 		 * Open a serial port.
 		 * Attempts to open a serial port and initialize it with the specified parameters.
@@ -122,6 +133,13 @@ namespace OpenZWave
 		 */
 		uint32 Write( uint8* _buffer, uint32 _length );
 
+		/**
+		 * Wait for one of the driver's wait objects to become signalled, reading the
+		 * serial port while waiting if direct reads are enabled.
+		 * @see Controller::WaitMultiple, SetDirectRead
+		 */
+		int32 WaitMultiple( Wait** _objects, uint32 _numObjects, int32 _timeout );
+
    	private:
         uint32                      m_baud;
         SerialController::Parity    m_parity;
@@ -130,6 +148,7 @@ namespace OpenZWave
 
 		SerialControllerImpl*	    m_pImpl;	// Pointer to an object that encapsulates the platform-specific implementation of the serial port.
 		bool			            m_bOpen;
+		bool						m_directRead;
 	};
 
 } // namespace OpenZWave
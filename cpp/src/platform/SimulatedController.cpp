@@ -0,0 +1,1274 @@
+//-----------------------------------------------------------------------------
+//
+//	SimulatedController.cpp
+//
+//	In-process emulation of a Z-Wave Serial API controller and network
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Defs.h"
+#include "platform/Thread.h"
+#include "platform/Event.h"
+#include "platform/Mutex.h"
+#include "platform/Log.h"
+#include "platform/SimulatedController.h"
+
+using namespace OpenZWave;
+
+// Size of the stream buffer allocated by the Controller base class
+static uint32 const c_streamBufferSize = 2048;
+
+// Command classes implemented by the virtual nodes
+static uint8 const c_nodeCommandClasses[] = { 0x25, 0x27, 0x31, 0x70, 0x72, 0x86 };
+
+// Serial API functions answered by the simulated controller
+static uint8 const c_supportedFunctions[] =
+{
+	FUNC_ID_SERIAL_API_GET_INIT_DATA,
+	FUNC_ID_SERIAL_API_APPL_NODE_INFORMATION,
+	FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES,
+	FUNC_ID_SERIAL_API_SET_TIMEOUTS,
+	FUNC_ID_SERIAL_API_GET_CAPABILITIES,
+	FUNC_ID_ZW_SEND_DATA,
+	FUNC_ID_ZW_GET_VERSION,
+	FUNC_ID_ZW_MEMORY_GET_ID,
+	FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO,
+	FUNC_ID_ZW_GET_SUC_NODE_ID,
+	FUNC_ID_ZW_REQUEST_NODE_INFO,
+	FUNC_ID_ZW_IS_FAILED_NODE_ID,
+	FUNC_ID_ZW_GET_ROUTING_INFO,
+	FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE,
+	FUNC_ID_ZW_ASSIGN_RETURN_ROUTE,
+	FUNC_ID_ZW_DELETE_RETURN_ROUTE
+};
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::SimulatedController>
+//	Constructor
+//-----------------------------------------------------------------------------
+SimulatedController::SimulatedController
+(
+):
+	m_thread( NULL ),
+	m_wakeEvent( new Event() ),
+	m_mutex( new Mutex() ),
+	m_bOpen( false ),
+	m_rxLength( 0 ),
+	m_homeId( 0xc0ffee00 ),
+	m_numNodes( 5 ),
+	m_latency( 20 ),
+	m_jitter( 0 ),
+	m_lossRate( 0 ),
+	m_nakRate( 0 ),
+	m_canRate( 0 ),
+	m_dupRate( 0 ),
+	m_reportInterval( 0 ),
+	m_random( 1 ),
+	m_downNode( 0 ),
+	m_downAt( 0 ),
+	m_downFor( 0 ),
+	m_configVersion( 2 ),
+	m_multiCmd( false ),
+	m_collectReports( false ),
+	m_collectedCount( 0 ),
+	m_collectedLength( 0 ),
+	m_traceLoops( 1 ),
+	m_traceIdle( 1000 ),
+	m_tracePosition( 0 ),
+	m_traceLoop( 0 ),
+	m_traceStarted( false ),
+	m_lastHostFrame( 0 ),
+	m_framesReceived( 0 ),
+	m_framesSent( 0 ),
+	m_callbacksSent( 0 ),
+	m_reportsSent( 0 ),
+	m_ACKsReceived( 0 ),
+	m_NAKsSent( 0 ),
+	m_CANsSent( 0 ),
+	m_framesLost( 0 ),
+	m_overruns( 0 ),
+	m_traceFramesSent( 0 )
+{
+	memset( m_nodes, 0, sizeof(m_nodes) );
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::~SimulatedController>
+//	Destructor
+//-----------------------------------------------------------------------------
+SimulatedController::~SimulatedController
+(
+)
+{
+	Close();
+	m_wakeEvent->Release();
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::Open>
+//	Build the virtual network and start delivering frames
+//-----------------------------------------------------------------------------
+bool SimulatedController::Open
+(
+	string const& _controllerName
+)
+{
+	if( m_bOpen )
+	{
+		return false;
+	}
+
+	ParseSettings( _controllerName );
+
+	memset( m_nodes, 0, sizeof(m_nodes) );
+	m_nodes[1].m_present = true;			// The controller itself
+	for( uint32 i=0; i<m_numNodes; ++i )
+	{
+		SimNode& node = m_nodes[i+2];
+		node.m_present = true;
+		node.m_temperature = 200 + (int16)( Random() % 50 );
+		node.m_nextReport = m_reportInterval ? (int32)( Random() % (uint32)m_reportInterval ) : 0;
+	}
+
+	Log::Write( LogLevel_Info, "    Simulated controller: home ID 0x%.8x, %d nodes, latency %dms (+%dms jitter), loss %d%%, NAK %d%%, CAN %d%%, reports every %dms",
+			m_homeId, m_numNodes, m_latency, m_jitter, m_lossRate, m_nakRate, m_canRate, m_reportInterval );
+
+	m_trace.clear();
+	if( !m_traceFile.empty() )
+	{
+		LoadTrace( m_traceFile );
+	}
+
+	m_startTime.SetTime();
+	m_rxLength = 0;
+	m_tracePosition = 0;
+	m_traceLoop = 0;
+	m_traceStarted = false;
+	m_lastHostFrame = 0;
+	m_bOpen = true;
+
+	m_thread = new Thread( "SimulatedController" );
+	m_thread->Start( ThreadEntryPoint, this );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::Close>
+//	Stop delivering frames
+//-----------------------------------------------------------------------------
+bool SimulatedController::Close
+(
+)
+{
+	if( !m_bOpen )
+	{
+		return false;
+	}
+
+	if( m_thread )
+	{
+		m_thread->Stop();
+		m_thread->Release();
+		m_thread = NULL;
+	}
+
+	m_mutex->Lock();
+	while( !m_pending.empty() )
+	{
+		delete m_pending.front();
+		m_pending.pop_front();
+	}
+	m_mutex->Unlock();
+
+	m_bOpen = false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::ParseSettings>
+//	Read the network settings from the controller path
+//-----------------------------------------------------------------------------
+void SimulatedController::ParseSettings
+(
+	string const& _settings
+)
+{
+	size_t pos = 0;
+	while( pos < _settings.size() )
+	{
+		size_t end = _settings.find( ',', pos );
+		if( end == string::npos )
+		{
+			end = _settings.size();
+		}
+
+		string setting = _settings.substr( pos, end - pos );
+		pos = end + 1;
+
+		size_t eq = setting.find( '=' );
+		if( eq == string::npos )
+		{
+			continue;
+		}
+
+		string key = setting.substr( 0, eq );
+		uint32 value = (uint32)strtoul( setting.substr( eq + 1 ).c_str(), NULL, 0 );
+
+		if( key == "nodes" )
+		{
+			// Node IDs 2 to 232 are available to the virtual nodes
+			m_numNodes = ( value > 231 ) ? 231 : value;
+		}
+		else if( key == "homeid" )
+		{
+			m_homeId = value;
+		}
+		else if( key == "latency" )
+		{
+			m_latency = (int32)value;
+		}
+		else if( key == "jitter" )
+		{
+			m_jitter = (int32)value;
+		}
+		else if( key == "loss" )
+		{
+			m_lossRate = value;
+		}
+		else if( key == "nak" )
+		{
+			m_nakRate = value;
+		}
+		else if( key == "can" )
+		{
+			m_canRate = value;
+		}
+		else if( key == "dups" )
+		{
+			m_dupRate = value;
+		}
+		else if( key == "reports" )
+		{
+			m_reportInterval = (int32)value;
+		}
+		else if( key == "seed" )
+		{
+			m_random = value;
+		}
+		else if( key == "down" )
+		{
+			m_downNode = (uint8)value;
+		}
+		else if( key == "downat" )
+		{
+			m_downAt = (int32)value;
+		}
+		else if( key == "downfor" )
+		{
+			m_downFor = (int32)value;
+		}
+		else if( key == "configversion" )
+		{
+			m_configVersion = value;
+		}
+		else if( key == "multicmd" )
+		{
+			m_multiCmd = ( value != 0 );
+		}
+		else if( key == "trace" )
+		{
+			m_traceFile = setting.substr( eq + 1 );
+		}
+		else if( key == "traceloops" )
+		{
+			m_traceLoops = value;
+		}
+		else if( key == "traceidle" )
+		{
+			m_traceIdle = (int32)value;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::LoadTrace>
+//	Read the request frames to be replayed to the driver
+//-----------------------------------------------------------------------------
+void SimulatedController::LoadTrace
+(
+	string const& _filename
+)
+{
+	FILE* file = fopen( _filename.c_str(), "r" );
+	if( !file )
+	{
+		Log::Write( LogLevel_Warning, "Simulated controller: unable to open trace file %s", _filename.c_str() );
+		return;
+	}
+
+	char line[1024];
+	while( fgets( line, sizeof(line), file ) )
+	{
+		// Gather every hex byte on the line
+		SimFrame frame;
+		frame.m_due = 0;
+		frame.m_length = 0;
+		char* pos = strstr( line, "0x" );
+		while( pos && frame.m_length < sizeof(frame.m_buffer) )
+		{
+			char* end;
+			frame.m_buffer[frame.m_length++] = (uint8)strtoul( pos, &end, 16 );
+			pos = strstr( end, "0x" );
+		}
+
+		// Only complete, valid request frames are replayed.  Responses would
+		// not match anything the driver has sent.
+		if( frame.m_length < 5 || frame.m_buffer[0] != SOF || frame.m_buffer[2] != REQUEST
+			|| frame.m_length != (uint32)frame.m_buffer[1] + 2 )
+		{
+			continue;
+		}
+
+		uint8 checksum = 0xff;
+		for( uint32 i=1; i<frame.m_length-1; ++i )
+		{
+			checksum ^= frame.m_buffer[i];
+		}
+		if( checksum == frame.m_buffer[frame.m_length-1] )
+		{
+			m_trace.push_back( frame );
+		}
+	}
+	fclose( file );
+
+	Log::Write( LogLevel_Info, "    Simulated controller: loaded %d frames from trace file %s", (int)m_trace.size(), _filename.c_str() );
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::Write>
+//	Receive data from the driver
+//-----------------------------------------------------------------------------
+uint32 SimulatedController::Write
+(
+	uint8* _buffer,
+	uint32 _length
+)
+{
+	if( !m_bOpen )
+	{
+		return 0;
+	}
+
+	m_mutex->Lock();
+	for( uint32 i=0; i<_length; ++i )
+	{
+		uint8 byte = _buffer[i];
+		if( m_rxLength == 0 )
+		{
+			switch( byte )
+			{
+				case SOF:
+				{
+					m_rxBuffer[m_rxLength++] = byte;
+					break;
+				}
+				case ACK:
+				{
+					++m_ACKsReceived;
+					break;
+				}
+				case NAK:
+				case CAN:
+				{
+					Log::Write( LogLevel_Detail, "Simulated controller: driver rejected a frame (0x%.2x)", byte );
+					break;
+				}
+				default:
+				{
+					// Out of frame
+					break;
+				}
+			}
+			continue;
+		}
+
+		m_rxBuffer[m_rxLength++] = byte;
+		if( m_rxLength == (uint32)m_rxBuffer[1] + 2 )
+		{
+			m_lastHostFrame = Now();
+			HandleFrame( m_rxBuffer, m_rxLength );
+			m_rxLength = 0;
+		}
+	}
+	m_mutex->Unlock();
+
+	return _length;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::HandleFrame>
+//	Check and answer a complete frame from the driver
+//-----------------------------------------------------------------------------
+void SimulatedController::HandleFrame
+(
+	uint8 const* _frame,
+	uint32 _length
+)
+{
+	uint8 checksum = 0xff;
+	for( uint32 i=1; i<_length-1; ++i )
+	{
+		checksum ^= _frame[i];
+	}
+
+	if( _length < 5 || checksum != _frame[_length-1] )
+	{
+		++m_NAKsSent;
+		SendByte( NAK );
+		return;
+	}
+
+	// Inject transmission problems
+	if( Chance( m_nakRate ) )
+	{
+		++m_NAKsSent;
+		SendByte( NAK );
+		return;
+	}
+	if( Chance( m_canRate ) )
+	{
+		++m_CANsSent;
+		SendByte( CAN );
+		return;
+	}
+
+	++m_framesReceived;
+	SendByte( ACK );
+
+	uint8 function = _frame[3];
+	uint8 const* data = &_frame[4];
+	uint32 length = _length - 5;
+	uint8 response[64];
+	memset( response, 0, sizeof(response) );
+
+	switch( function )
+	{
+		case FUNC_ID_ZW_GET_VERSION:
+		{
+			static char const c_version[] = "Z-Wave 3.95";
+			memcpy( response, c_version, sizeof(c_version) );
+			response[sizeof(c_version)] = 0x01;		// Static controller library
+			QueueFrame( 0, RESPONSE, function, response, sizeof(c_version) + 1 );
+			break;
+		}
+		case FUNC_ID_ZW_MEMORY_GET_ID:
+		{
+			response[0] = (uint8)( m_homeId >> 24 );
+			response[1] = (uint8)( m_homeId >> 16 );
+			response[2] = (uint8)( m_homeId >> 8 );
+			response[3] = (uint8)( m_homeId );
+			response[4] = 1;						// Our node ID
+			QueueFrame( 0, RESPONSE, function, response, 5 );
+			break;
+		}
+		case FUNC_ID_ZW_GET_CONTROLLER_CAPABILITIES:
+		{
+			response[0] = 0x1c;						// Real primary, SIS and SUC
+			QueueFrame( 0, RESPONSE, function, response, 1 );
+			break;
+		}
+		case FUNC_ID_SERIAL_API_GET_CAPABILITIES:
+		{
+			response[0] = 1;						// Serial API version
+			response[1] = 0;
+			response[2] = 0x7f;						// Manufacturer ID
+			response[3] = 0xff;
+			response[4] = 0x00;						// Product type
+			response[5] = 0x01;
+			response[6] = 0x00;						// Product ID
+			response[7] = 0x01;
+			for( uint32 i=0; i<sizeof(c_supportedFunctions); ++i )
+			{
+				uint8 bit = c_supportedFunctions[i] - 1;
+				response[8+(bit>>3)] |= (uint8)( 0x01 << ( bit & 0x07 ) );
+			}
+			QueueFrame( 0, RESPONSE, function, response, 40 );
+			break;
+		}
+		case FUNC_ID_ZW_GET_SUC_NODE_ID:
+		{
+			response[0] = 1;						// We are the SUC
+			QueueFrame( 0, RESPONSE, function, response, 1 );
+			break;
+		}
+		case FUNC_ID_SERIAL_API_GET_INIT_DATA:
+		{
+			response[0] = 0x05;						// Serial API version
+			response[1] = 0x08;						// SIS
+			response[2] = NUM_NODE_BITFIELD_BYTES;
+			for( uint32 nodeId=1; nodeId<=NUM_NODE_BITFIELD_BYTES*8; ++nodeId )
+			{
+				if( m_nodes[nodeId].m_present )
+				{
+					response[3+((nodeId-1)>>3)] |= (uint8)( 0x01 << ( (nodeId-1) & 0x07 ) );
+				}
+			}
+			response[3+NUM_NODE_BITFIELD_BYTES] = 0x05;	// Chip type
+			response[4+NUM_NODE_BITFIELD_BYTES] = 0x00;	// Chip version
+			QueueFrame( 0, RESPONSE, function, response, 5 + NUM_NODE_BITFIELD_BYTES );
+			break;
+		}
+		case FUNC_ID_SERIAL_API_SET_TIMEOUTS:
+		{
+			response[0] = ACK_TIMEOUT / 10;
+			response[1] = BYTE_TIMEOUT / 10;
+			QueueFrame( 0, RESPONSE, function, response, 2 );
+			break;
+		}
+		case FUNC_ID_SERIAL_API_APPL_NODE_INFORMATION:
+		{
+			// No response
+			break;
+		}
+		case FUNC_ID_ZW_GET_NODE_PROTOCOL_INFO:
+		{
+			uint8 nodeId = length ? data[0] : 0;
+			if( m_nodes[nodeId].m_present )
+			{
+				response[0] = 0xd3;					// Listening, routing, 40k, version 4
+				response[1] = 0x80;					// Optional functionality
+				response[3] = ( nodeId == 1 ) ? 0x02 : 0x04;	// Static controller or routing slave
+				response[4] = ( nodeId == 1 ) ? 0x02 : 0x10;	// Static controller or binary switch
+				response[5] = 0x01;
+			}
+			QueueFrame( 0, RESPONSE, function, response, 6 );
+			break;
+		}
+		case FUNC_ID_ZW_REQUEST_NODE_INFO:
+		{
+			uint8 nodeId = length ? data[0] : 0;
+			response[0] = 1;
+			QueueFrame( 0, RESPONSE, function, response, 1 );
+
+			if( !IsReachable( nodeId ) || Chance( m_lossRate ) )
+			{
+				++m_framesLost;
+				response[0] = UPDATE_STATE_NODE_INFO_REQ_FAILED;
+				response[1] = 0;
+				response[2] = 0;
+				QueueFrame( GetLatency(), REQUEST, FUNC_ID_ZW_APPLICATION_UPDATE, response, 3 );
+				break;
+			}
+
+			response[0] = UPDATE_STATE_NODE_INFO_RECEIVED;
+			response[1] = nodeId;
+			if( nodeId == 1 )
+			{
+				response[2] = 3;
+				response[3] = 0x02;
+				response[4] = 0x02;
+				response[5] = 0x01;
+			}
+			else
+			{
+				response[2] = 3 + sizeof(c_nodeCommandClasses);
+				response[3] = 0x04;
+				response[4] = 0x10;
+				response[5] = 0x01;
+				memcpy( &response[6], c_nodeCommandClasses, sizeof(c_nodeCommandClasses) );
+				if( m_multiCmd )
+				{
+					response[6+sizeof(c_nodeCommandClasses)] = 0x8f;
+					++response[2];
+				}
+			}
+			QueueFrame( GetLatency(), REQUEST, FUNC_ID_ZW_APPLICATION_UPDATE, response, 3 + response[2] );
+			break;
+		}
+		case FUNC_ID_ZW_IS_FAILED_NODE_ID:
+		{
+			response[0] = 0;						// Not failed
+			QueueFrame( 0, RESPONSE, function, response, 1 );
+			break;
+		}
+		case FUNC_ID_ZW_GET_ROUTING_INFO:
+		{
+			// The nodes form a chain where each node can hear the two nodes on either
+			// side, and the controller can hear the first four nodes.
+			uint8 nodeId = length ? data[0] : 0;
+			for( uint32 neighbor=1; neighbor<=NUM_NODE_BITFIELD_BYTES*8; ++neighbor )
+			{
+				if( neighbor == nodeId || !m_nodes[neighbor].m_present || !m_nodes[nodeId].m_present )
+				{
+					continue;
+				}
+
+				bool inRange;
+				if( nodeId == 1 || neighbor == 1 )
+				{
+					inRange = ( nodeId + neighbor ) <= 1 + 5;
+				}
+				else
+				{
+					inRange = abs( (int)nodeId - (int)neighbor ) <= 2;
+				}
+
+				if( inRange )
+				{
+					response[(neighbor-1)>>3] |= (uint8)( 0x01 << ( (neighbor-1) & 0x07 ) );
+				}
+			}
+			QueueFrame( 0, RESPONSE, function, response, NUM_NODE_BITFIELD_BYTES );
+			break;
+		}
+		case FUNC_ID_ZW_REQUEST_NODE_NEIGHBOR_UPDATE:
+		{
+			// Node ID, callback ID.  The neighbors themselves never change.
+			uint8 nodeId = length ? data[0] : 0;
+			uint8 callbackId = ( length > 1 ) ? data[1] : 0;
+			int32 latency = GetLatency();
+			response[0] = callbackId;
+			response[1] = REQUEST_NEIGHBOR_UPDATE_STARTED;
+			QueueFrame( latency, REQUEST, function, response, 2 );
+
+			bool done = IsReachable( nodeId ) && !Chance( m_lossRate );
+			if( !done )
+			{
+				++m_framesLost;
+			}
+			response[1] = done ? REQUEST_NEIGHBOR_UPDATE_DONE : REQUEST_NEIGHBOR_UPDATE_FAILED;
+			QueueFrame( latency + 4 * GetLatency(), REQUEST, function, response, 2 );
+			break;
+		}
+		case FUNC_ID_ZW_ASSIGN_RETURN_ROUTE:
+		case FUNC_ID_ZW_DELETE_RETURN_ROUTE:
+		{
+			// Node ID, destination node ID (assign only), callback ID
+			uint32 callbackIndex = ( function == FUNC_ID_ZW_ASSIGN_RETURN_ROUTE ) ? 2 : 1;
+			uint8 nodeId = length ? data[0] : 0;
+			uint8 callbackId = ( length > callbackIndex ) ? data[callbackIndex] : 0;
+			response[0] = 1;						// In progress
+			QueueFrame( 0, RESPONSE, function, response, 1 );
+
+			bool delivered = IsReachable( nodeId ) && !Chance( m_lossRate );
+			if( !delivered )
+			{
+				++m_framesLost;
+			}
+			response[0] = callbackId;
+			response[1] = delivered ? TRANSMIT_COMPLETE_OK : TRANSMIT_COMPLETE_NO_ACK;
+			QueueFrame( GetLatency(), REQUEST, function, response, 2 );
+			break;
+		}
+		case FUNC_ID_ZW_SEND_DATA:
+		{
+			HandleSendData( data, length );
+			break;
+		}
+		default:
+		{
+			Log::Write( LogLevel_Warning, "Simulated controller: function 0x%.2x is not supported", function );
+			break;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::HandleSendData>
+//	Transmit a command to a virtual node
+//-----------------------------------------------------------------------------
+void SimulatedController::HandleSendData
+(
+	uint8 const* _data,
+	uint32 _length
+)
+{
+	// Node ID, data length, data, transmit options, callback ID
+	if( _length < 3 || _length < (uint32)_data[1] + 3 )
+	{
+		return;
+	}
+
+	uint8 nodeId = _data[0];
+	uint8 dataLength = _data[1];
+	uint8 callbackId = ( _length > (uint32)dataLength + 3 ) ? _data[dataLength+3] : 0;
+
+	uint8 response[4];
+	response[0] = 1;
+	QueueFrame( 0, RESPONSE, FUNC_ID_ZW_SEND_DATA, response, 1 );
+
+	int32 latency = GetLatency();
+	bool delivered = true;
+	if( nodeId != 0xff )
+	{
+		delivered = IsReachable( nodeId ) && ( nodeId != 1 ) && !Chance( m_lossRate );
+		if( !delivered )
+		{
+			++m_framesLost;
+		}
+	}
+
+	if( callbackId )
+	{
+		response[0] = callbackId;
+		response[1] = delivered ? TRANSMIT_COMPLETE_OK : TRANSMIT_COMPLETE_NO_ACK;
+		response[2] = (uint8)( ( latency / 10 ) >> 8 );	// Transmit time in 10ms ticks
+		response[3] = (uint8)( latency / 10 );
+		QueueFrame( latency, REQUEST, FUNC_ID_ZW_SEND_DATA, response, 4 );
+		++m_callbacksSent;
+	}
+
+	if( delivered && nodeId != 0xff && dataLength >= 1 )
+	{
+		HandleCommand( nodeId, &_data[2], dataLength, latency + GetLatency() );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::HandleCommand>
+//	Apply a command to a virtual node, and queue any report it generates
+//-----------------------------------------------------------------------------
+void SimulatedController::HandleCommand
+(
+	uint8 const _nodeId,
+	uint8 const* _data,
+	uint32 _length,
+	int32 const _delay
+)
+{
+	SimNode& node = m_nodes[_nodeId];
+	uint8 cc = _data[0];
+	uint8 cmd = ( _length > 1 ) ? _data[1] : 0;
+	uint8 report[32];
+
+	switch( cc )
+	{
+		case 0x20:		// Basic
+		case 0x25:		// Switch Binary
+		{
+			if( cmd == 0x01 && _length > 2 )
+			{
+				node.m_switch = ( _data[2] != 0 );
+			}
+			else if( cmd == 0x02 )
+			{
+				report[0] = cc;
+				report[1] = 0x03;
+				report[2] = node.m_switch ? 0xff : 0x00;
+				QueueReport( _delay, _nodeId, report, 3 );
+			}
+			break;
+		}
+		case 0x27:		// Switch All
+		{
+			if( cmd == 0x02 )
+			{
+				report[0] = cc;
+				report[1] = 0x03;
+				report[2] = 0xff;					// Included in all on and all off
+				QueueReport( _delay, _nodeId, report, 3 );
+			}
+			break;
+		}
+		case 0x31:		// Sensor Multilevel
+		{
+			if( cmd == 0x04 )
+			{
+				report[0] = cc;
+				report[1] = 0x05;
+				report[2] = 0x01;					// Temperature
+				report[3] = 0x22;					// Precision 1, Celsius, 2 bytes
+				report[4] = (uint8)( node.m_temperature >> 8 );
+				report[5] = (uint8)( node.m_temperature );
+				QueueReport( _delay, _nodeId, report, 6 );
+			}
+			break;
+		}
+		case 0x70:		// Configuration
+		{
+			if( cmd == 0x04 && _length > 4 )
+			{
+				// Set: parameter, size, value (the low byte is stored)
+				uint8 param = _data[2];
+				uint8 size = _data[3] & 0x07;
+				if( param >= 1 && param <= c_configParams && size >= 1 && _length >= 4u + size )
+				{
+					node.m_config[param] = _data[3+size];
+				}
+			}
+			else if( cmd == 0x05 && _length > 2 )
+			{
+				// Get: parameter
+				uint8 param = _data[2];
+				report[0] = cc;
+				report[1] = 0x06;
+				report[2] = param;
+				report[3] = 1;
+				report[4] = ( param >= 1 && param <= c_configParams ) ? node.m_config[param] : 0;
+				QueueReport( _delay, _nodeId, report, 5 );
+			}
+			else if( ( cmd == 0x07 || cmd == 0x08 ) && _length > 4 && m_configVersion >= 2 )
+			{
+				// Bulk Set: offset, count, flags, values.  Bulk Get: offset, count.
+				uint32 first = ( (uint32)_data[2] << 8 ) | _data[3];
+				uint8 count = _data[4];
+				if( count > c_configParams )
+				{
+					count = c_configParams;
+				}
+				if( cmd == 0x07 )
+				{
+					uint8 size = ( _length > 5 ) ? ( _data[5] & 0x07 ) : 0;
+					for( uint8 i=0; i<count && size && _length >= 6u + ( i + 1 ) * size; ++i )
+					{
+						if( first + i >= 1 && first + i <= c_configParams )
+						{
+							node.m_config[first+i] = _data[6+(i+1)*size-1];
+						}
+					}
+					if( _length < 6 || ( _data[5] & 0x40 ) == 0 )
+					{
+						break;					// No handshake requested
+					}
+				}
+
+				report[0] = cc;
+				report[1] = 0x09;
+				report[2] = (uint8)( first >> 8 );
+				report[3] = (uint8)first;
+				report[4] = count;
+				report[5] = 0;					// Reports to follow
+				report[6] = ( cmd == 0x07 ) ? 0x41 : 0x01;
+				for( uint8 i=0; i<count; ++i )
+				{
+					report[7+i] = ( first + i >= 1 && first + i <= c_configParams ) ? node.m_config[first+i] : 0;
+				}
+				QueueReport( _delay, _nodeId, report, 7 + count );
+			}
+			break;
+		}
+		case 0x72:		// Manufacturer Specific
+		{
+			if( cmd == 0x04 )
+			{
+				report[0] = cc;
+				report[1] = 0x05;
+				report[2] = 0x7f;
+				report[3] = 0xff;
+				report[4] = 0x00;
+				report[5] = 0x01;
+				report[6] = 0x00;
+				report[7] = _nodeId;
+				QueueReport( _delay, _nodeId, report, 8 );
+			}
+			break;
+		}
+		case 0x86:		// Version
+		{
+			if( cmd == 0x11 )
+			{
+				report[0] = cc;
+				report[1] = 0x12;
+				report[2] = 0x03;					// Library type
+				report[3] = 0x04;					// Protocol version
+				report[4] = 0x05;
+				report[5] = 0x01;					// Application version
+				report[6] = 0x00;
+				QueueReport( _delay, _nodeId, report, 7 );
+			}
+			else if( cmd == 0x13 && _length > 2 )
+			{
+				report[0] = cc;
+				report[1] = 0x14;
+				report[2] = _data[2];
+				report[3] = ( memchr( c_nodeCommandClasses, _data[2], sizeof(c_nodeCommandClasses) ) != NULL ) ? 1 : 0;
+				if( _data[2] == 0x70 )
+				{
+					report[3] = (uint8)m_configVersion;
+				}
+				else if( _data[2] == 0x8f && m_multiCmd )
+				{
+					report[3] = 1;
+				}
+				QueueReport( _delay, _nodeId, report, 4 );
+			}
+			break;
+		}
+		case 0x8f:		// Multi Command
+		{
+			if( !m_multiCmd || cmd != 0x01 || _length < 3 )
+			{
+				break;
+			}
+
+			// Apply each command in turn, collecting the reports they generate
+			m_collectReports = true;
+			m_collectedCount = 0;
+			m_collectedLength = 3;
+			uint32 base = 3;
+			for( uint8 i=0; i<_data[2] && base < _length && base + 1 + _data[base] <= _length; ++i )
+			{
+				HandleCommand( _nodeId, &_data[base+1], _data[base], _delay );
+				base += 1 + _data[base];
+			}
+			m_collectReports = false;
+
+			if( m_collectedCount != 0 )
+			{
+				m_collected[0] = cc;
+				m_collected[1] = 0x01;
+				m_collected[2] = m_collectedCount;
+				QueueReport( _delay, _nodeId, m_collected, m_collectedLength );
+			}
+			break;
+		}
+		default:
+		{
+			// NoOperation and anything the virtual nodes do not implement
+			break;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::QueueReport>
+//	Queue a command class report from a virtual node
+//-----------------------------------------------------------------------------
+void SimulatedController::QueueReport
+(
+	int32 const _delay,
+	uint8 const _nodeId,
+	uint8 const* _data,
+	uint32 _length
+)
+{
+	if( m_collectReports && m_collectedLength + 1 + _length <= sizeof(m_collected) )
+	{
+		m_collected[m_collectedLength++] = (uint8)_length;
+		memcpy( &m_collected[m_collectedLength], _data, _length );
+		m_collectedLength += _length;
+		++m_collectedCount;
+		return;
+	}
+
+	uint8 buffer[48];
+	buffer[0] = 0;							// Status
+	buffer[1] = _nodeId;
+	buffer[2] = (uint8)_length;
+	memcpy( &buffer[3], _data, _length );
+	QueueFrame( _delay, REQUEST, FUNC_ID_APPLICATION_COMMAND_HANDLER, buffer, _length + 3 );
+	++m_reportsSent;
+
+	if( m_dupRate && Random() % 100 < m_dupRate )
+	{
+		// The copy takes a longer route
+		QueueFrame( _delay + m_latency, REQUEST, FUNC_ID_APPLICATION_COMMAND_HANDLER, buffer, _length + 3 );
+		++m_reportsSent;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::QueueFrame>
+//	Build a frame and queue it for delivery after the specified delay
+//-----------------------------------------------------------------------------
+void SimulatedController::QueueFrame
+(
+	int32 const _delay,
+	uint8 const _type,
+	uint8 const _function,
+	uint8 const* _data,
+	uint32 _length
+)
+{
+	SimFrame* frame = new SimFrame();
+	frame->m_due = Now() + _delay;
+	frame->m_buffer[0] = SOF;
+	frame->m_buffer[1] = (uint8)( _length + 3 );
+	frame->m_buffer[2] = _type;
+	frame->m_buffer[3] = _function;
+	memcpy( &frame->m_buffer[4], _data, _length );
+
+	uint8 checksum = 0xff;
+	for( uint32 i=1; i<_length+4; ++i )
+	{
+		checksum ^= frame->m_buffer[i];
+	}
+	frame->m_buffer[_length+4] = checksum;
+	frame->m_length = _length + 5;
+
+	// Keep the list in order of delivery, preserving the order of frames due at the same time
+	list<SimFrame*>::iterator it = m_pending.end();
+	while( it != m_pending.begin() )
+	{
+		list<SimFrame*>::iterator prev = it;
+		--prev;
+		if( (*prev)->m_due <= frame->m_due )
+		{
+			break;
+		}
+		it = prev;
+	}
+	m_pending.insert( it, frame );
+	m_wakeEvent->Set();
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::SendByte>
+//	Pass a single ACK, NAK or CAN to the driver
+//-----------------------------------------------------------------------------
+void SimulatedController::SendByte
+(
+	uint8 const _byte
+)
+{
+	uint8 byte = _byte;
+	if( !Put( &byte, 1 ) )
+	{
+		++m_overruns;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::DeliverFrames>
+//	Pass the frames that are due to the driver, and generate unsolicited
+//	reports.  Returns the time in ms until the next frame is due, or -1.
+//-----------------------------------------------------------------------------
+int32 SimulatedController::DeliverFrames
+(
+)
+{
+	m_mutex->Lock();
+	int32 now = Now();
+
+	if( m_reportInterval > 0 )
+	{
+		for( uint32 nodeId=2; nodeId<m_numNodes+2; ++nodeId )
+		{
+			SimNode& node = m_nodes[nodeId];
+			if( node.m_nextReport <= now && IsReachable( (uint8)nodeId ) )
+			{
+				// The temperature drifts by up to half a degree each time
+				node.m_temperature += (int16)( Random() % 11 ) - 5;
+				uint8 report[6];
+				report[0] = 0x31;
+				report[1] = 0x05;
+				report[2] = 0x01;
+				report[3] = 0x22;
+				report[4] = (uint8)( node.m_temperature >> 8 );
+				report[5] = (uint8)( node.m_temperature );
+				QueueReport( 0, (uint8)nodeId, report, 6 );
+				node.m_nextReport = now + m_reportInterval + ( m_jitter ? (int32)( Random() % (uint32)m_jitter ) : 0 );
+			}
+		}
+	}
+
+	while( !m_pending.empty() && m_pending.front()->m_due <= now )
+	{
+		SimFrame* frame = m_pending.front();
+		m_pending.pop_front();
+		if( Put( frame->m_buffer, frame->m_length ) )
+		{
+			++m_framesSent;
+		}
+		else
+		{
+			++m_overruns;
+		}
+		delete frame;
+	}
+
+	int32 timeout = -1;
+	if( !m_pending.empty() )
+	{
+		timeout = m_pending.front()->m_due - now;
+	}
+	else if( m_traceLoop < m_traceLoops && !m_trace.empty() )
+	{
+		timeout = ReplayTrace( now ) ? 1 : ( m_lastHostFrame + m_traceIdle - now );
+		if( timeout < 1 )
+		{
+			timeout = 1;
+		}
+	}
+	if( m_reportInterval > 0 )
+	{
+		for( uint32 nodeId=2; nodeId<m_numNodes+2; ++nodeId )
+		{
+			int32 remaining = m_nodes[nodeId].m_nextReport - now;
+			if( timeout < 0 || remaining < timeout )
+			{
+				timeout = remaining;
+			}
+		}
+	}
+	m_mutex->Unlock();
+
+	return ( timeout < 0 && !m_pending.empty() ) ? 0 : timeout;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::ReplayTrace>
+//	Pass as many trace frames to the driver as the stream buffer will hold.
+//	Returns true if the replay is under way.
+//-----------------------------------------------------------------------------
+bool SimulatedController::ReplayTrace
+(
+	int32 const _now
+)
+{
+	if( !m_traceStarted )
+	{
+		// Wait for the driver to finish its own work first
+		if( _now - m_lastHostFrame < m_traceIdle )
+		{
+			return false;
+		}
+		Log::Write( LogLevel_Info, "Simulated controller: replaying %d trace frames %d time(s)", (int)m_trace.size(), m_traceLoops );
+		m_traceStarted = true;
+	}
+
+	while( m_traceLoop < m_traceLoops )
+	{
+		SimFrame& frame = m_trace[m_tracePosition];
+		if( GetDataSize() + frame.m_length > c_streamBufferSize )
+		{
+			// The driver has not caught up yet
+			break;
+		}
+
+		Put( frame.m_buffer, frame.m_length );
+		++m_framesSent;
+		++m_traceFramesSent;
+
+		if( ++m_tracePosition >= m_trace.size() )
+		{
+			m_tracePosition = 0;
+			++m_traceLoop;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::GetLatency>
+//	Time taken for a frame to reach a node and be acknowledged
+//-----------------------------------------------------------------------------
+int32 SimulatedController::GetLatency
+(
+)
+{
+	return m_latency + ( m_jitter ? (int32)( Random() % (uint32)( m_jitter + 1 ) ) : 0 );
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::Chance>
+//	Returns true with the specified probability
+//-----------------------------------------------------------------------------
+bool SimulatedController::Chance
+(
+	uint32 const _percent
+)
+{
+	return _percent && ( Random() % 100 ) < _percent;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::IsReachable>
+//	Whether a node is present and answering.  The caller must hold the lock.
+//-----------------------------------------------------------------------------
+bool SimulatedController::IsReachable
+(
+	uint8 const _nodeId
+)
+{
+	if( !m_nodes[_nodeId].m_present )
+	{
+		return false;
+	}
+	if( _nodeId == m_downNode )
+	{
+		int32 now = Now();
+		if( now >= m_downAt && ( m_downFor == 0 || now < m_downAt + m_downFor ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<SimulatedController::Random>
+//	Pseudo random generator, so that a given seed always gives the same run
+//-----------------------------------------------------------------------------
+uint32 SimulatedController::Random
+(
+)
+{
+	m_random = m_random * 1103515245 + 12345;
+	return ( m_random >> 16 ) & 0x7fff;
+}
+
+//-----------------------------------------------------------------------------
+// <SimulatedController::ThreadEntryPoint>
+// Entry point of the thread that delivers frames to the driver
+//-----------------------------------------------------------------------------
+void SimulatedController::ThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	SimulatedController* sc = (SimulatedController*)_context;
+	if( sc )
+	{
+		sc->ThreadProc( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <SimulatedController::ThreadProc>
+// Deliver each queued frame when it falls due
+//-----------------------------------------------------------------------------
+void SimulatedController::ThreadProc
+(
+	Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;
+	waitObjects[1] = m_wakeEvent;
+
+	while( true )
+	{
+		m_wakeEvent->Reset();
+		int32 timeout = DeliverFrames();
+		if( Wait::Multiple( waitObjects, 2, timeout ) == 0 )
+		{
+			// Exit signalled.
+			break;
+		}
+	}
+}
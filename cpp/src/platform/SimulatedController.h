@@ -0,0 +1,240 @@
+//-----------------------------------------------------------------------------
+//
+//	SimulatedController.h
+//
+//	In-process emulation of a Z-Wave Serial API controller and network
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _SimulatedController_H
+#define _SimulatedController_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include "Defs.h"
+#include "platform/Controller.h"
+#include "platform/TimeStamp.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Thread;
+	class Event;
+	class Mutex;
+
+	/** \brief Emulates a Z-Wave PC interface and a virtual network of nodes, so that the
+	 * Driver can be exercised without hardware.
+	 *
+	 * The controller speaks the Serial API framing (SOF/ACK/NAK/CAN, checksums, responses
+	 * and callbacks) and answers the initialization sequence, protocol info, node info,
+	 * routing info and ZW_SEND_DATA requests.  Each virtual node is a listening binary
+	 * switch with a temperature sensor, supporting the Basic, Switch Binary, Switch All,
+	 * Sensor Multilevel, Configuration, Manufacturer Specific and Version command classes.
+	 * Each node has sixteen one byte configuration parameters.
+	 *
+	 * The network is configured through the controller path passed to Manager::AddDriver,
+	 * as a comma separated list of settings, for example "nodes=50,latency=30,loss=2":
+	 *  - nodes:	number of virtual nodes (node IDs 2 upwards, default 5)
+	 *  - homeid:	home ID of the network (default 0xc0ffee00)
+	 *  - latency:	milliseconds before a ZW_SEND_DATA callback (default 20).  Reports follow one latency later.
+	 *  - jitter:	random extra milliseconds added to each latency (default 0)
+	 *  - loss:		percentage of frames to nodes that fail with TRANSMIT_COMPLETE_NO_ACK (default 0)
+	 *  - nak:		percentage of host frames answered with a NAK (default 0)
+	 *  - can:		percentage of host frames answered with a CAN (default 0)
+	 *  - dups:		percentage of reports delivered a second time, as if by another route (default 0)
+	 *  - reports:	milliseconds between unsolicited sensor reports from each node, 0 to disable (default 0)
+	 *  - seed:		seed for the pseudo random generator, so that runs are reproducible (default 1)
+	 *  - down:		node ID of a node that stops answering for a while (default 0, none)
+	 *  - downat:	milliseconds after opening that the node stops answering (default 0)
+	 *  - downfor:	milliseconds that the node does not answer for, 0 for ever (default 0)
+	 *  - configversion:	version of the Configuration command class; bulk commands need 2 (default 2)
+	 *  - multicmd:	1 for the nodes to support the Multi Command command class, answering the
+	 *				requests of an encapsulated frame with one encapsulated report (default 0)
+	 *  - trace:	file of recorded frames to replay to the driver.  Each line holding a complete
+	 *				request frame written as hex bytes (such as the "Received:" lines of a log file)
+	 *				is replayed, as fast as the driver reads them.
+	 *  - traceloops:	number of times to replay the trace (default 1)
+	 *  - traceidle:	milliseconds the driver must have been silent before the replay starts (default 1000)
+	 * Any other setting (such as "name=...") is ignored, which allows several simulated
+	 * controllers with the same network settings to be added to one Manager.
+	 */
+	class SimulatedController: public Controller
+	{
+	public:
+		/**
+		 * Constructor.
+		 * Creates an object that represents a simulated controller.
+		 */
+		SimulatedController();
+
+		/**
+		 * Destructor.
+		 * Destroys the simulated controller object.
+		 */
+		virtual ~SimulatedController();
+
+		/**
+		 * Open the simulated controller.
+		 * Builds the virtual network and starts the thread that delivers frames to the driver.
+		 * @param _controllerName Comma separated list of network settings.
+		 * @return True if the controller was started.
+		 * @see Close, Read, Write
+		 */
+		bool Open( string const& _controllerName );
+
+		/**
+		 * Close the simulated controller.
+		 * @return True if the controller was closed successfully, or false if it was already closed.
+		 * @see Open
+		 */
+		bool Close();
+
+		/**
+		 * Write to the simulated controller.
+		 * Frames are parsed and answered as a real controller would.
+		 * @param _buffer Pointer to a block of memory containing the data to be written.
+		 * @param _length Length in bytes of the data.
+		 * @return The number of bytes written.
+		 * @see Read, Open, Close
+		 */
+		uint32 Write( uint8* _buffer, uint32 _length );
+
+		// Statistics
+		uint32 GetFramesReceived()const{ return m_framesReceived; }
+		uint32 GetFramesSent()const{ return m_framesSent; }
+		uint32 GetCallbacksSent()const{ return m_callbacksSent; }
+		uint32 GetReportsSent()const{ return m_reportsSent; }
+		uint32 GetACKsReceived()const{ return m_ACKsReceived; }
+		uint32 GetNAKsSent()const{ return m_NAKsSent; }
+		uint32 GetCANsSent()const{ return m_CANsSent; }
+		uint32 GetFramesLost()const{ return m_framesLost; }
+		uint32 GetOverruns()const{ return m_overruns; }
+		uint32 GetTraceFramesSent()const{ return m_traceFramesSent; }
+
+	private:
+		enum
+		{
+			c_configParams = 16
+		};
+
+		struct SimNode
+		{
+			bool		m_present;
+			bool		m_switch;						// Current state of the binary switch
+			int16		m_temperature;					// Current sensor reading, in tenths of a degree
+			int32		m_nextReport;					// Time of the next unsolicited report
+			uint8		m_config[c_configParams+1];		// One byte configuration parameters, from 1
+		};
+
+		struct SimFrame
+		{
+			int32		m_due;							// Time at which the frame is passed to the driver
+			uint32		m_length;
+			uint8		m_buffer[256];
+		};
+
+		void ParseSettings( string const& _settings );
+		void LoadTrace( string const& _filename );
+		bool ReplayTrace( int32 const _now );
+		void HandleFrame( uint8 const* _frame, uint32 _length );
+		void HandleSendData( uint8 const* _data, uint32 _length );
+		void HandleCommand( uint8 const _nodeId, uint8 const* _data, uint32 _length, int32 const _delay );
+		void QueueFrame( int32 const _delay, uint8 const _type, uint8 const _function, uint8 const* _data, uint32 _length );
+		void QueueReport( int32 const _delay, uint8 const _nodeId, uint8 const* _data, uint32 _length );
+		int32 DeliverFrames();
+		void SendByte( uint8 const _byte );
+
+		int32 GetLatency();
+		bool Chance( uint32 const _percent );
+		bool IsReachable( uint8 const _nodeId );
+		uint32 Random();
+		int32 Now(){ return -m_startTime.TimeRemaining(); }
+
+		static void ThreadEntryPoint( Event* _exitEvent, void* _context );
+		void ThreadProc( Event* _exitEvent );
+
+		Thread*			m_thread;
+		Event*			m_wakeEvent;					// Signalled when a frame is queued for delivery
+		Mutex*			m_mutex;						// Serializes access to the pending frames, nodes and random generator
+		TimeStamp		m_startTime;
+		bool			m_bOpen;
+
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		list<SimFrame*>	m_pending;						// Frames waiting to be delivered, in order of delivery time
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint8			m_rxBuffer[257];				// Partially received frame from the driver: SOF, length byte, and up to 255 more bytes
+		uint32			m_rxLength;
+
+		// Network settings
+		uint32			m_homeId;
+		uint32			m_numNodes;
+		int32			m_latency;
+		int32			m_jitter;
+		uint32			m_lossRate;
+		uint32			m_nakRate;
+		uint32			m_canRate;
+		uint32			m_dupRate;
+		int32			m_reportInterval;
+		uint32			m_random;
+		uint8			m_downNode;
+		int32			m_downAt;
+		int32			m_downFor;
+		uint32			m_configVersion;
+		bool			m_multiCmd;
+
+		// Reports collected while answering a Multi Command frame
+		bool			m_collectReports;
+		uint8			m_collectedCount;
+		uint32			m_collectedLength;
+		uint8			m_collected[45];
+
+		SimNode			m_nodes[256];
+
+		// Trace replay
+		string			m_traceFile;
+		uint32			m_traceLoops;
+		int32			m_traceIdle;
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		vector<SimFrame>	m_trace;
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint32			m_tracePosition;
+		uint32			m_traceLoop;
+		bool			m_traceStarted;
+		int32			m_lastHostFrame;				// Time the last frame was received from the driver
+
+		// Statistics
+		uint32			m_framesReceived;
+		uint32			m_framesSent;
+		uint32			m_callbacksSent;
+		uint32			m_reportsSent;
+		uint32			m_ACKsReceived;
+		uint32			m_NAKsSent;
+		uint32			m_CANsSent;
+		uint32			m_framesLost;
+		uint32			m_overruns;
+		uint32			m_traceFramesSent;
+	};
+
+} // namespace OpenZWave
+
+#endif //_SimulatedController_H
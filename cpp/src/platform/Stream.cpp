@@ -174,6 +174,64 @@ bool Stream::Put
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+//	<Stream::GetFreeBlocks>
+//	Get the free space in the buffer
+//-----------------------------------------------------------------------------
+uint32 Stream::GetFreeBlocks
+(
+	uint8** _block1,
+	uint32* _size1,
+	uint8** _block2,
+	uint32* _size2
+)
+{
+	uint32 free = m_bufferSize - m_dataSize;
+	uint32 block1 = m_bufferSize - m_head;
+	if( block1 > free )
+	{
+		block1 = free;
+	}
+
+	*_block1 = &m_buffer[m_head];
+	*_size1 = block1;
+	*_block2 = m_buffer;
+	*_size2 = free - block1;
+	return free;
+}
+
+//-----------------------------------------------------------------------------
+//	<Stream::Commit>
+//	Add data that was written straight into the buffer
+//-----------------------------------------------------------------------------
+void Stream::Commit
+(
+	uint32 _size
+)
+{
+	// The caller owns both ends of the stream, so no lock is needed
+	if( (m_head + _size) >= m_bufferSize )
+	{
+		uint32 block1 = m_bufferSize - m_head;
+		LogData( &m_buffer[m_head], block1, "      Read (controller->buffer):  ");
+		LogData( m_buffer, _size - block1, "      Read (controller->buffer):  ");
+		m_head = _size - block1;
+	}
+	else
+	{
+		LogData( &m_buffer[m_head], _size, "      Read (controller->buffer):  ");
+		m_head += _size;
+	}
+
+	m_dataSize += _size;
+
+	if( IsSignalled() )
+	{
+		// We now have more data than we are waiting for, so notify the watchers
+		Notify();
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	<Stream::Purge>
 //	Empty the data buffer
@@ -209,7 +267,7 @@ void Stream::LogData
 	const string &_function
 )
 {
-	if( !_length ) return;
+	if( !_length || !Log::IsLevelEnabled( LogLevel_StreamDetail ) ) return;
 
 	string str = "";
 	for( uint32 i=0; i<_length; ++i ) 
@@ -82,6 +82,28 @@ namespace OpenZWave
 		 */
 		bool Put( uint8* _buffer, uint32 _size );
 
+		/**
+		 * Gets the free space in the circular buffer, so that data can be read into it
+		 * directly rather than through Put.  The space is split in two where it wraps
+		 * around the end of the buffer.  Only for use when the thread that adds data is
+		 * also the one that removes it.
+		 * \param _block1 set to the start of the free space.
+		 * \param _size1 set to the size of the first block.
+		 * \param _block2 set to the start of the buffer, if the free space wraps around.
+		 * \param _size2 set to the size of the second block, or zero.
+		 * \return the total free space in bytes.
+		 * \see Commit
+		 */
+		uint32 GetFreeBlocks( uint8** _block1, uint32* _size1, uint8** _block2, uint32* _size2 );
+
+		/**
+		 * Adds data that has been written into the free space returned by GetFreeBlocks
+		 * to the stream.
+		 * \param _size the amount of data in bytes that was written.
+		 * \see GetFreeBlocks
+		 */
+		void Commit( uint32 _size );
+
  		/**
 		 * Returns the amount of data in bytes that is stored in the stream.
 		 * \return the number of bytes of data in the stream.
@@ -84,6 +84,17 @@ int32 TimeStamp::TimeRemaining
 	return m_pImpl->TimeRemaining();
 }
 
+//-----------------------------------------------------------------------------
+//	<TimeStamp::TimeRemainingMicroseconds>
+//	Gets the difference between now and the timestamp time in microseconds
+//-----------------------------------------------------------------------------
+int64 TimeStamp::TimeRemainingMicroseconds
+(
+)
+{
+	return m_pImpl->TimeRemainingMicroseconds();
+}
+
 //-----------------------------------------------------------------------------
 //	<TimeStamp::GetAsString>
 //	Return object as a string
@@ -104,5 +115,16 @@ int32 TimeStamp::operator-
 	TimeStamp const& _other
 )
 {
-	return (int32)(m_pImpl - _other.m_pImpl);
+	return *m_pImpl - *_other.m_pImpl;
+}
+
+//-----------------------------------------------------------------------------
+//	<TimeStamp::GetMicroseconds>
+//	Monotonic time in microseconds
+//-----------------------------------------------------------------------------
+uint64 TimeStamp::GetMicroseconds
+(
+)
+{
+	return TimeStampImpl::GetMicroseconds();
 }
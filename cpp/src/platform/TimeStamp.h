@@ -66,6 +66,14 @@ namespace OpenZWave
 		 */
 		int32 TimeRemaining();
 
+		/**
+		 * TimeRemainingMicroseconds.  Gets the difference between now and the
+		 * timestamp time in microseconds.
+		 * \return microseconds remaining until we reach the timestamp.  The
+		 * return value is negative if the timestamp is in the past.
+		 */
+		int64 TimeRemainingMicroseconds();
+
 		/**
 		 * Return as a string for output.
 		 * \return string
@@ -78,6 +86,12 @@ namespace OpenZWave
 		 */
 		int32 operator- ( TimeStamp const& _other );
 
+		/**
+		 * Microseconds from an arbitrary starting point.  TimeStamps are taken from
+		 * this monotonic clock, so they are not affected by changes to the system time.
+		 */
+		static uint64 GetMicroseconds();
+
 	private:
 		TimeStamp( TimeStamp const& );				// prevent copy
 		TimeStamp& operator = ( TimeStamp const& );	// prevent assignment
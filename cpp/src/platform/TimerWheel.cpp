@@ -0,0 +1,379 @@
+//-----------------------------------------------------------------------------
+//
+//	TimerWheel.cpp
+//
+//	Hierarchical timing wheel for the driver's timeouts
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "Defs.h"
+#include "platform/Mutex.h"
+#include "platform/Event.h"
+#include "platform/Wait.h"
+#include "platform/TimeStamp.h"
+#include "platform/TimerWheel.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::TimerWheel>
+//	Constructor
+//-----------------------------------------------------------------------------
+TimerWheel::TimerWheel
+(
+):
+	m_mutex( new Mutex() ),
+	m_event( new Event() ),
+	m_origin( TimeStamp::GetMicroseconds() ),
+	m_currentTick( 0 ),
+	m_count( 0 ),
+	m_expired( NULL ),
+	m_expiredCount( 0 ),
+	m_totalSlack( 0 ),
+	m_maxSlack( 0 )
+{
+	memset( m_wheel, 0, sizeof(m_wheel) );
+	memset( m_occupied, 0, sizeof(m_occupied) );
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::~TimerWheel>
+//	Destructor
+//-----------------------------------------------------------------------------
+TimerWheel::~TimerWheel
+(
+)
+{
+	m_event->Release();
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::Arm>
+//	Arm a timer, moving it if it is already armed
+//-----------------------------------------------------------------------------
+void TimerWheel::Arm
+(
+	Timer* _timer,
+	int32 _milliseconds,
+	pfnTimerCallback_t _callback,
+	void* _context
+)
+{
+	if( _milliseconds < 0 )
+	{
+		_milliseconds = 0;
+	}
+
+	uint64 now = TimeStamp::GetMicroseconds();
+
+	m_mutex->Lock();
+	if( _timer->m_armed )
+	{
+		Unlink( _timer );
+	}
+
+	if( m_count == 0 && m_expired == NULL )
+	{
+		// Nothing to cascade, so catch up with the time without walking the wheel
+		uint64 nowTick = GetTick( now );
+		if( nowTick > m_currentTick )
+		{
+			m_currentTick = nowTick;
+		}
+	}
+
+	_timer->m_callback = _callback;
+	_timer->m_context = _context;
+	_timer->m_deadline = now + (uint64)_milliseconds * 1000;
+
+	// Round up, so that the timer never expires early
+	_timer->m_tick = ( _timer->m_deadline - m_origin + 999 ) / 1000;
+	if( _timer->m_tick < m_currentTick )
+	{
+		_timer->m_tick = m_currentTick;
+	}
+
+	Insert( _timer );
+	_timer->m_armed = true;
+	m_mutex->Unlock();
+
+	m_event->Set();
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::Cancel>
+//	Cancel a timer
+//-----------------------------------------------------------------------------
+void TimerWheel::Cancel
+(
+	Timer* _timer
+)
+{
+	m_mutex->Lock();
+	if( _timer->m_armed )
+	{
+		Unlink( _timer );
+		_timer->m_armed = false;
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::Advance>
+//	Call the callbacks of the timers that have expired
+//-----------------------------------------------------------------------------
+void TimerWheel::Advance
+(
+)
+{
+	uint64 nowTick = GetTick( TimeStamp::GetMicroseconds() );
+
+	m_mutex->Lock();
+	while( m_count )
+	{
+		// Jump straight to the next tick with any work, rather than walking
+		// every slot in between.
+		uint64 tick = GetNextTick();
+		if( tick > nowTick )
+		{
+			break;
+		}
+		m_currentTick = tick;
+
+		// Move the timers of any coarser slots that start on this tick down
+		// the wheel, highest level first.
+		for( int32 level = c_levels - 1; level > 0; --level )
+		{
+			uint32 shift = level * c_slotBits;
+			if( tick & ( ( (uint64)1 << shift ) - 1 ) )
+			{
+				continue;
+			}
+
+			uint32 slot = (uint32)( tick >> shift ) & ( c_slots - 1 );
+			Timer* timer = m_wheel[level][slot];
+			m_wheel[level][slot] = NULL;
+			m_occupied[level] &= ~( (uint64)1 << slot );
+			while( timer )
+			{
+				Timer* next = timer->m_next;
+				--m_count;
+				Insert( timer );
+				timer = next;
+			}
+		}
+
+		// Everything in this tick's slot has expired
+		uint32 slot = (uint32)tick & ( c_slots - 1 );
+		while( Timer* timer = m_wheel[0][slot] )
+		{
+			Unlink( timer );
+			timer->m_level = -1;
+			timer->m_prev = NULL;
+			timer->m_next = m_expired;
+			if( m_expired )
+			{
+				m_expired->m_prev = timer;
+			}
+			m_expired = timer;
+		}
+
+		m_currentTick = tick + 1;
+	}
+
+	if( m_currentTick <= nowTick )
+	{
+		m_currentTick = nowTick + 1;
+	}
+
+	// Call the callbacks without the lock held, so that they are free to
+	// take other locks and to arm or cancel timers.
+	while( Timer* timer = m_expired )
+	{
+		Unlink( timer );
+		timer->m_armed = false;
+
+		uint64 now = TimeStamp::GetMicroseconds();
+		uint32 slack = ( now > timer->m_deadline ) ? (uint32)( now - timer->m_deadline ) : 0;
+		++m_expiredCount;
+		m_totalSlack += slack;
+		if( slack > m_maxSlack )
+		{
+			m_maxSlack = slack;
+		}
+
+		pfnTimerCallback_t callback = timer->m_callback;
+		void* context = timer->m_context;
+		m_mutex->Unlock();
+		callback( context );
+		m_mutex->Lock();
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::GetNextTimeout>
+//	Milliseconds until Advance next has work to do
+//-----------------------------------------------------------------------------
+int32 TimerWheel::GetNextTimeout
+(
+)
+{
+	int32 timeout = Wait::Timeout_Infinite;
+
+	m_mutex->Lock();
+	if( m_expired )
+	{
+		timeout = 0;
+	}
+	else if( m_count )
+	{
+		uint64 due = m_origin + GetNextTick() * 1000;
+		uint64 now = TimeStamp::GetMicroseconds();
+		timeout = 0;
+		if( due > now )
+		{
+			uint64 remaining = ( due - now + 999 ) / 1000;
+			timeout = ( remaining > 0x7fffffff ) ? 0x7fffffff : (int32)remaining;
+		}
+	}
+	m_mutex->Unlock();
+	return timeout;
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::GetNextTick>
+//	First tick at which a timer expires or a slot must be cascaded.  The
+//	caller must hold the lock.
+//-----------------------------------------------------------------------------
+uint64 TimerWheel::GetNextTick
+(
+)const
+{
+	uint64 next = (uint64)-1;
+	for( int32 level = 0; level < c_levels; ++level )
+	{
+		if( !m_occupied[level] )
+		{
+			continue;
+		}
+
+		// A coarser slot is cascaded on the first tick of its block, so look
+		// from the next block boundary onwards.
+		uint32 shift = level * c_slotBits;
+		uint64 block = ( m_currentTick + ( (uint64)1 << shift ) - 1 ) >> shift;
+		for( uint32 i = 0; i < c_slots; ++i )
+		{
+			uint32 slot = (uint32)( block + i ) & ( c_slots - 1 );
+			if( m_occupied[level] & ( (uint64)1 << slot ) )
+			{
+				uint64 tick = ( block + i ) << shift;
+				if( tick < next )
+				{
+					next = tick;
+				}
+				break;
+			}
+		}
+	}
+	return next;
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::Insert>
+//	Add a timer to the slot that covers its expiry tick.  The caller must
+//	hold the lock.
+//-----------------------------------------------------------------------------
+void TimerWheel::Insert
+(
+	Timer* _timer
+)
+{
+	uint64 tick = _timer->m_tick;
+	uint64 delta = ( tick > m_currentTick ) ? tick - m_currentTick : 0;
+
+	int32 level = 0;
+	while( level < c_levels - 1 && delta >= ( (uint64)1 << ( ( level + 1 ) * c_slotBits ) ) )
+	{
+		++level;
+	}
+
+	uint64 range = (uint64)1 << ( c_levels * c_slotBits );
+	if( delta >= range )
+	{
+		// Beyond the end of the wheel.  Park the timer in the last slot it can
+		// reach; it is placed again each time that slot is cascaded.
+		tick = m_currentTick + range - 1;
+	}
+
+	uint32 slot = (uint32)( tick >> ( level * c_slotBits ) ) & ( c_slots - 1 );
+	_timer->m_level = level;
+	_timer->m_slot = slot;
+	_timer->m_prev = NULL;
+	_timer->m_next = m_wheel[level][slot];
+	if( _timer->m_next )
+	{
+		_timer->m_next->m_prev = _timer;
+	}
+	m_wheel[level][slot] = _timer;
+	m_occupied[level] |= ( (uint64)1 << slot );
+	++m_count;
+}
+
+//-----------------------------------------------------------------------------
+//	<TimerWheel::Unlink>
+//	Remove a timer from its slot, or from the expired list.  The caller must
+//	hold the lock.
+//-----------------------------------------------------------------------------
+void TimerWheel::Unlink
+(
+	Timer* _timer
+)
+{
+	Timer** list = GetList( _timer->m_level, _timer->m_slot );
+	if( _timer->m_prev )
+	{
+		_timer->m_prev->m_next = _timer->m_next;
+	}
+	else
+	{
+		*list = _timer->m_next;
+	}
+	if( _timer->m_next )
+	{
+		_timer->m_next->m_prev = _timer->m_prev;
+	}
+	_timer->m_prev = NULL;
+	_timer->m_next = NULL;
+
+	if( _timer->m_level >= 0 )
+	{
+		--m_count;
+		if( *list == NULL )
+		{
+			m_occupied[_timer->m_level] &= ~( (uint64)1 << _timer->m_slot );
+		}
+	}
+}
@@ -0,0 +1,156 @@
+//-----------------------------------------------------------------------------
+//
+//	TimerWheel.h
+//
+//	Hierarchical timing wheel for the driver's timeouts
+//
+//	Copyright (c) 2016
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _TimerWheel_H
+#define _TimerWheel_H
+
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	class Mutex;
+	class Event;
+
+	/** \brief A hierarchical timing wheel, so that any number of timeouts can be armed
+	 * and cancelled in constant time, and a thread can find out how long it may sleep
+	 * without walking a list of deadlines.
+	 *
+	 * The wheel ticks once a millisecond, and has four levels of 64 slots, covering
+	 * about four and a half hours.  Timers due within 64ms sit in a slot of the first
+	 * level.  Later timers sit in a coarser level, and are moved down as their time
+	 * approaches.  Times are read from TimeStamp::GetMicroseconds, so changes to the
+	 * system time do not affect them.
+	 *
+	 * Callbacks are made from Advance, by the thread that owns the wheel, without the
+	 * wheel's lock held.  Timers may be armed and cancelled from any thread.  The owning
+	 * thread should include the wheel's event in its waits, so that it wakes to work out
+	 * a new timeout when another thread arms a timer.
+	 */
+	class TimerWheel
+	{
+	public:
+		typedef void (*pfnTimerCallback_t)( void* _context );
+
+		/** \brief A timer that can be armed on a TimerWheel.  The timer is embedded in the
+		 * object that owns the timeout, and must be cancelled before it is destroyed.
+		 */
+		class Timer
+		{
+			friend class TimerWheel;
+
+		public:
+			Timer(): m_prev( NULL ), m_next( NULL ), m_callback( NULL ), m_context( NULL ), m_tick( 0 ), m_deadline( 0 ), m_level( 0 ), m_slot( 0 ), m_armed( false ){}
+
+			bool IsArmed()const{ return m_armed; }
+
+		private:
+			Timer*				m_prev;
+			Timer*				m_next;
+			pfnTimerCallback_t	m_callback;
+			void*				m_context;
+			uint64				m_tick;							// Tick on which the timer expires
+			uint64				m_deadline;						// Time at which the timer expires, in microseconds
+			int32				m_level;						// Level of the wheel holding the timer, or -1 once it has expired
+			uint32				m_slot;
+			bool				m_armed;
+		};
+
+		TimerWheel();
+		~TimerWheel();
+
+		/**
+		 * Arm a timer, moving it if it is already armed.
+		 * @param _timer The timer.
+		 * @param _milliseconds Time from now at which the timer expires.
+		 * @param _callback Function to call when the timer expires.
+		 * @param _context Passed to the callback.
+		 */
+		void Arm( Timer* _timer, int32 _milliseconds, pfnTimerCallback_t _callback, void* _context );
+
+		/**
+		 * Cancel a timer.  Does nothing if the timer is not armed.
+		 * @param _timer The timer.
+		 */
+		void Cancel( Timer* _timer );
+
+		/**
+		 * Call the callbacks of the timers that have expired.
+		 */
+		void Advance();
+
+		/**
+		 * Milliseconds until Advance next has work to do.
+		 * @return The timeout to pass to Wait, or Wait::Timeout_Infinite if no timers are armed.
+		 */
+		int32 GetNextTimeout();
+
+		/**
+		 * Event that is signalled whenever a timer is armed.  The owning thread resets it
+		 * before calling GetNextTimeout.
+		 * @return The event.
+		 */
+		Event* GetEvent()const{ return m_event; }
+
+		// Statistics
+		uint32 GetExpiredCount()const{ return m_expiredCount; }
+		uint32 GetAverageSlack()const{ return m_expiredCount ? (uint32)( m_totalSlack / m_expiredCount ) : 0; }	// Microseconds between expiry and callback
+		uint32 GetMaxSlack()const{ return m_maxSlack; }
+
+	private:
+		TimerWheel( TimerWheel const& );					// prevent copy
+		TimerWheel& operator = ( TimerWheel const& );		// prevent assignment
+
+		enum
+		{
+			c_levels = 4,
+			c_slotBits = 6,
+			c_slots = 1 << c_slotBits
+		};
+
+		uint64 GetTick( uint64 const _microseconds )const{ return ( _microseconds - m_origin ) / 1000; }
+		uint64 GetNextTick()const;							// First tick at which a timer expires or a slot must be cascaded
+		void Insert( Timer* _timer );
+		void Unlink( Timer* _timer );
+		Timer** GetList( int32 const _level, uint32 const _slot ){ return ( _level < 0 ) ? &m_expired : &m_wheel[_level][_slot]; }
+
+		Mutex*		m_mutex;
+		Event*		m_event;								// Signalled when a timer is armed
+		uint64		m_origin;								// Time of tick zero, in microseconds
+		uint64		m_currentTick;							// Next tick to be processed
+		uint32		m_count;								// Number of timers on the wheel
+		Timer*		m_wheel[c_levels][c_slots];
+		uint64		m_occupied[c_levels];					// Bit for each slot that holds a timer
+		Timer*		m_expired;								// Timers waiting for their callback
+
+		uint32		m_expiredCount;
+		uint64		m_totalSlack;
+		uint32		m_maxSlack;
+	};
+
+} // namespace OpenZWave
+
+#endif //_TimerWheel_H
@@ -169,6 +169,27 @@ int32 Wait::Multiple
 }
 
 
+//-----------------------------------------------------------------------------
+//	<Wait::FirstSignalled>
+//	Find the first of multiple objects that is signalled
+//-----------------------------------------------------------------------------
+int32 Wait::FirstSignalled
+(
+	Wait** _objects,
+	uint32 _numObjects
+)
+{
+	for( uint32 i=0; i<_numObjects; ++i )
+	{
+		if( _objects[i]->IsSignalled() )
+		{
+			return (int32)i;
+		}
+	}
+	return -1;
+}
+
+
 //-----------------------------------------------------------------------------
 //	<WaitMultipleCallback>
 //	Callback handler for the watchers added during WaitImpl::Multiple
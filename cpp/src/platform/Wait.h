@@ -86,6 +86,14 @@ namespace OpenZWave
 		 */												 
 		static int32 Multiple( Wait** _objects, uint32 _numObjects, int32 _timeout = -1 );
 
+		/**
+		 * Find the first of multiple objects that is signalled, without waiting.
+		 * \param _objects array of pointers to objects to test.
+		 * \param _numObjects number of objects in the array.
+		 * \return index into the array of the first signalled object, or -1 if none is signalled.
+		 */
+		static int32 FirstSignalled( Wait** _objects, uint32 _numObjects );
+
 	protected:
 		Wait();
 		virtual ~Wait();
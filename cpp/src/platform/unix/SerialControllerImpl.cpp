@@ -26,6 +26,8 @@
 //
 //-----------------------------------------------------------------------------
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <unistd.h>
 #include <pthread.h>
 #include "Defs.h"
@@ -49,8 +51,12 @@ SerialControllerImpl::SerialControllerImpl
 	SerialController* _owner
 ):
 	m_owner( _owner ),
-	m_hSerialController( -1 )
+	m_hSerialController( -1 ),
+	m_pThread( NULL ),
+	m_attempts( 0 )
 {
+	m_wakeup[0] = -1;
+	m_wakeup[1] = -1;
 }
 
 //-----------------------------------------------------------------------------
@@ -82,6 +88,25 @@ bool SerialControllerImpl::Open
 		return false;
 	}
 
+	if( m_owner->m_directRead )
+	{
+		// The driver thread reads the port while it waits, and the pipe
+		// wakes it when anything else needs its attention.
+		if( pipe( m_wakeup ) == -1 )
+		{
+			Log::Write( LogLevel_Error, "ERROR: Cannot create wakeup pipe for serial port. Error code %d", errno );
+			Close();
+			return false;
+		}
+		for( int i=0; i<2; ++i )
+		{
+			fcntl( m_wakeup[i], F_SETFL, fcntl( m_wakeup[i], F_GETFL ) | O_NONBLOCK );
+		}
+		m_attempts = 0;
+		Log::Write( LogLevel_Info, "Reading serial port from the driver thread" );
+		return true;
+	}
+
 	// Start the read thread
 	m_pThread = new Thread( "SerialController" );
 	m_pThread->Start( SerialReadThreadEntryPoint, this );
@@ -105,6 +130,15 @@ void SerialControllerImpl::Close
 	}
 	close( m_hSerialController );
 	m_hSerialController = -1;
+
+	for( int i=0; i<2; ++i )
+	{
+		if( m_wakeup[i] >= 0 )
+		{
+			close( m_wakeup[i] );
+			m_wakeup[i] = -1;
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -291,6 +325,12 @@ bool SerialControllerImpl::Init
 
 	tcflush( m_hSerialController, TCIOFLUSH );
 
+	if( m_owner->m_directRead )
+	{
+		// Reads must not block the driver thread
+		fcntl( m_hSerialController, F_SETFL, fcntl( m_hSerialController, F_GETFL ) | O_NONBLOCK );
+	}
+
 	// Open successful
  	Log::Write( LogLevel_Info, "Serial port %s opened (attempt %d)", device.c_str(), _attempts );
 	return true;
@@ -365,6 +405,221 @@ uint32 SerialControllerImpl::Write
 
 	// Write the data
 	uint32 bytesWritten;
-	bytesWritten = write( m_hSerialController, _buffer, _length);
+	if( !m_owner->m_directRead )
+	{
+		bytesWritten = write( m_hSerialController, _buffer, _length);
+		return bytesWritten;
+	}
+
+	// The port is non-blocking, so wait for room rather than drop data
+	bytesWritten = 0;
+	while( bytesWritten < _length )
+	{
+		ssize_t res = write( m_hSerialController, &_buffer[bytesWritten], _length - bytesWritten );
+		if( res > 0 )
+		{
+			bytesWritten += (uint32)res;
+		}
+		else if( res < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) )
+		{
+			struct pollfd pfd;
+			pfd.fd = m_hSerialController;
+			pfd.events = POLLOUT;
+			pfd.revents = 0;
+			if( poll( &pfd, 1, 1000 ) <= 0 )
+			{
+				Log::Write( LogLevel_Error, "ERROR: Timed out writing to serial port" );
+				break;
+			}
+		}
+		else
+		{
+			Log::Write( LogLevel_Error, "ERROR: Failed to write to serial port. Error code %d", errno );
+			break;
+		}
+	}
 	return bytesWritten;
 }
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::WaitMultiple>
+// Wait for one of the driver's wait objects to become signalled, reading
+// any data that arrives at the serial port in the meantime
+//-----------------------------------------------------------------------------
+int32 SerialControllerImpl::WaitMultiple
+(
+	Wait** _objects,
+	uint32 _numObjects,
+	int32 _timeout
+)
+{
+	TimeStamp deadline;
+	deadline.SetTime( _timeout );
+
+	// A signalled object writes to the pipe, which ends the poll
+	for( uint32 i=0; i<_numObjects; ++i )
+	{
+		_objects[i]->AddWatcher( WakeupCallback, this );
+	}
+
+	int32 res;
+	while( ( res = Wait::FirstSignalled( _objects, _numObjects ) ) < 0 )
+	{
+		int32 remaining = _timeout;
+		if( _timeout > 0 )
+		{
+			remaining = deadline.TimeRemaining();
+			if( remaining < 0 )
+			{
+				remaining = 0;
+			}
+		}
+
+		struct pollfd fds[2];
+		nfds_t count = 1;
+		fds[0].fd = m_wakeup[0];
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		if( -1 != m_hSerialController )
+		{
+			fds[1].fd = m_hSerialController;
+			fds[1].events = POLLIN;
+			fds[1].revents = 0;
+			count = 2;
+		}
+		else
+		{
+			// Wake up in time to try the port again
+			int32 reopen = m_reopenTime.TimeRemaining();
+			if( reopen <= 0 )
+			{
+				Reopen();
+				continue;
+			}
+			if( remaining < 0 || reopen < remaining )
+			{
+				remaining = reopen;
+			}
+		}
+
+		int err = poll( fds, count, remaining );
+		if( err > 0 )
+		{
+			if( fds[0].revents )
+			{
+				uint8 drain[16];
+				while( read( m_wakeup[0], drain, sizeof(drain) ) > 0 );
+			}
+			if( count > 1 && fds[1].revents )
+			{
+				ReadDirect( ( fds[1].revents & ( POLLERR | POLLHUP | POLLNVAL ) ) != 0 );
+			}
+		}
+		else if( err == 0 && _timeout >= 0 && deadline.TimeRemaining() <= 0 )
+		{
+			// Timed out, unless the poll was cut short to reopen the port
+			break;
+		}
+	}
+
+	for( uint32 i=0; i<_numObjects; ++i )
+	{
+		_objects[i]->RemoveWatcher( WakeupCallback, this );
+	}
+	return res;
+}
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::ReadDirect>
+// Read the data waiting at the serial port straight into the stream buffer
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::ReadDirect
+(
+	bool const _hangup
+)
+{
+	while( true )
+	{
+		// One readv fills both ends of the circular buffer when it wraps
+		struct iovec iov[2];
+		uint8* block1;
+		uint8* block2;
+		uint32 size1;
+		uint32 size2;
+		uint32 free = m_owner->GetFreeBlocks( &block1, &size1, &block2, &size2 );
+		if( !free )
+		{
+			Log::Write( LogLevel_Error, "ERROR: Not enough space in stream buffer");
+			return;
+		}
+		iov[0].iov_base = block1;
+		iov[0].iov_len = size1;
+		iov[1].iov_base = block2;
+		iov[1].iov_len = size2;
+
+		ssize_t bytesRead = readv( m_hSerialController, iov, size2 ? 2 : 1 );
+		if( bytesRead > 0 )
+		{
+			m_owner->Commit( (uint32)bytesRead );
+			if( (uint32)bytesRead < free )
+			{
+				// That was everything the port had
+				return;
+			}
+			continue;
+		}
+
+		if( bytesRead < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) )
+		{
+			return;
+		}
+		if( bytesRead == 0 && !_hangup )
+		{
+			return;
+		}
+
+		// The port has gone away.  Close it, and try again later.
+		Log::Write( LogLevel_Error, "ERROR: Serial port %s read failed. Error code %d", m_owner->m_serialControllerName.c_str(), errno );
+		flock( m_hSerialController, LOCK_UN );
+		close( m_hSerialController );
+		m_hSerialController = -1;
+		m_attempts = 0;
+		m_reopenTime.SetTime( 5000 );
+		return;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::Reopen>
+// Try to open the serial port again after an error
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::Reopen
+(
+)
+{
+	if( Init( ++m_attempts ) )
+	{
+		m_attempts = 0;
+		return;
+	}
+
+	// Retry every 5 seconds for the first two minutes, then every 30 seconds
+	m_reopenTime.SetTime( ( m_attempts < 25 ) ? 5000 : 30000 );
+}
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::WakeupCallback>
+// A wait object has been signalled, so wake the driver thread
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::WakeupCallback
+(
+	void* _context
+)
+{
+	SerialControllerImpl* impl = (SerialControllerImpl*)_context;
+	uint8 wakeup = 1;
+
+	// If the pipe is full, the driver thread is already going to wake
+	ssize_t res = write( impl->m_wakeup[1], &wakeup, 1 );
+	(void)res;
+}
@@ -39,6 +39,7 @@
 
 #include "Defs.h"
 #include "platform/SerialController.h"
+#include "platform/TimeStamp.h"
 
 namespace OpenZWave
 {
@@ -61,10 +62,20 @@ namespace OpenZWave
 		bool Init( uint32 const _attempts );
 		void Read();
 
+		// Reading from the driver thread
+		int32 WaitMultiple( Wait** _objects, uint32 _numObjects, int32 _timeout );
+		void ReadDirect( bool const _hangup );
+		void Reopen();
+		static void WakeupCallback( void* _context );
+
 		SerialController*	m_owner;
 		int			m_hSerialController;
 		Thread*			m_pThread;
 
+		int			m_wakeup[2];			// Pipe that wakes the driver thread from poll() when a wait object is signalled
+		uint32			m_attempts;			// Attempts to reopen the port after an error
+		TimeStamp		m_reopenTime;
+
 		static void SerialReadThreadEntryPoint( Event* _exitEvent, void* _content );
 	};
 
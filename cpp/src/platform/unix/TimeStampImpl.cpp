@@ -62,23 +62,7 @@ void TimeStampImpl::SetTime
 	int32 _milliseconds	// = 0
 )
 {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    
-    m_stamp.tv_sec = now.tv_sec + (_milliseconds / 1000);
-    
-    // Now add the remainder of our timeout to the microseconds part of 'now'
-    now.tv_usec += ((_milliseconds % 1000) * 1000);
-    
-    // Careful now! Did it wrap?
-    if(now.tv_usec >= 1000000)
-    {
-        // Yes it did so bump our seconds and modulo
-        now.tv_usec %= 1000000;
-        m_stamp.tv_sec++;
-    }
-    
-    m_stamp.tv_nsec = now.tv_usec * 1000;
+	m_stamp = (int64)GetMicroseconds() + ( (int64)_milliseconds * 1000 );
 }
 
 //-----------------------------------------------------------------------------
@@ -89,18 +73,18 @@ int32 TimeStampImpl::TimeRemaining
 (
 )
 {
-    int32 diff;
-    
-    struct timeval now;   
-    gettimeofday(&now, NULL);
-    
-    // Seconds
-    diff = (int32)((m_stamp.tv_sec - now.tv_sec)*1000);
-    
-    // Milliseconds
-    diff += (((m_stamp.tv_nsec/1000)-now.tv_usec)/1000);
-    
-    return diff;
+	return (int32)( TimeRemainingMicroseconds() / 1000 );
+}
+
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::TimeRemainingMicroseconds>
+//	Gets the difference between now and the timestamp time in microseconds
+//-----------------------------------------------------------------------------
+int64 TimeStampImpl::TimeRemainingMicroseconds
+(
+)
+{
+	return m_stamp - (int64)GetMicroseconds();
 }
 
 //-----------------------------------------------------------------------------
@@ -111,13 +95,20 @@ string TimeStampImpl::GetAsString
 (
 )
 {
+	// The stamp is on the monotonic clock, so work out the wall clock time
+	// from its distance to now.
+	struct timeval now;
+	gettimeofday( &now, NULL );
+	int64 wall = (int64)now.tv_sec * 1000000 + now.tv_usec - TimeRemainingMicroseconds();
+
+	time_t seconds = (time_t)( wall / 1000000 );
 	char str[100];
 	struct tm *tm;
-	tm = localtime( &m_stamp.tv_sec );
+	tm = localtime( &seconds );
 
 	snprintf( str, sizeof(str), "%04d-%02d-%02d %02d:%02d:%02d:%03d ", 
 		  tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
-		  tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(m_stamp.tv_nsec / (1000*1000)) );
+		  tm->tm_hour, tm->tm_min, tm->tm_sec, (int)( ( wall % 1000000 ) / 1000 ) );
 	return str;
 }
 
@@ -131,11 +122,25 @@ int32 TimeStampImpl::operator-
 	TimeStampImpl const& _other
 )
 {
-    // Seconds
-    int32 diff = (int32)((m_stamp.tv_sec-_other.m_stamp.tv_sec)*1000);
-    
-    // Milliseconds
-    diff += ((m_stamp.tv_nsec - _other.m_stamp.tv_nsec)/1000000);
-    
-    return diff;  
+	return (int32)( ( m_stamp - _other.m_stamp ) / 1000 );
+}
+
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::GetMicroseconds>
+//	Monotonic time in microseconds
+//-----------------------------------------------------------------------------
+uint64 TimeStampImpl::GetMicroseconds
+(
+)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	if( clock_gettime( CLOCK_MONOTONIC, &ts ) == 0 )
+	{
+		return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+#endif
+	struct timeval now;
+	gettimeofday( &now, NULL );
+	return (uint64)now.tv_sec * 1000000 + now.tv_usec;
 }
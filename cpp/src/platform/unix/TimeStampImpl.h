@@ -67,6 +67,12 @@ namespace OpenZWave
 		 */
 		int32 TimeRemaining();
 
+		/**
+		 * TimeRemainingMicroseconds.  Gets the difference between now and the
+		 * timestamp time in microseconds.
+		 */
+		int64 TimeRemainingMicroseconds();
+
 		/**
 		 * Return as as string
 		 */
@@ -78,11 +84,17 @@ namespace OpenZWave
 		 */
 		int32 operator- ( TimeStampImpl const& _other );
 
+		/**
+		 * Microseconds from an arbitrary starting point, read from a clock that
+		 * is not affected by changes to the system time.
+		 */
+		static uint64 GetMicroseconds();
+
 	private:
 		TimeStampImpl( TimeStampImpl const& );					// prevent copy
 		TimeStampImpl& operator = ( TimeStampImpl const& );			// prevent assignment
 
-		struct timespec m_stamp;
+		int64	m_stamp;										// Microseconds, as returned by GetMicroseconds
 	};
 
 } // namespace OpenZWave
@@ -62,10 +62,7 @@ void TimeStampImpl::SetTime
 	int32 _milliseconds	// = 0
 )
 {
-	int64 offset = ((int64)_milliseconds) * 10000LL;	// Timestamp is stored in 100ns steps.
-
-	GetSystemTimeAsFileTime( (FILETIME*)&m_stamp );
-	m_stamp += offset;
+	m_stamp = (int64)GetMicroseconds() + ( (int64)_milliseconds * 1000LL );
 }
 
 //-----------------------------------------------------------------------------
@@ -76,10 +73,18 @@ int32 TimeStampImpl::TimeRemaining
 (
 )
 {
-	int64 now;
-	GetSystemTimeAsFileTime( (FILETIME*)&now );
+	return (int32)( TimeRemainingMicroseconds() / 1000LL );
+}
 
-	return (int32)( ( m_stamp - now ) / 10000LL );
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::TimeRemainingMicroseconds>
+//	Gets the difference between now and the timestamp time in microseconds
+//-----------------------------------------------------------------------------
+int64 TimeStampImpl::TimeRemainingMicroseconds
+(
+)
+{
+	return m_stamp - (int64)GetMicroseconds();
 }
 
 //-----------------------------------------------------------------------------
@@ -90,9 +95,15 @@ string TimeStampImpl::GetAsString
 (
 )
 {
-	// Convert m_stamp (FILETIME) to SYSTEMTIME for ease of use
+	// The stamp is on the performance counter, so work out the wall clock
+	// time from its distance to now (FILETIME is in 100ns steps).
+	int64 wall;
+	GetSystemTimeAsFileTime( (FILETIME*)&wall );
+	wall -= TimeRemainingMicroseconds() * 10LL;
+
+	// Convert to SYSTEMTIME for ease of use
 	SYSTEMTIME time;
-	::FileTimeToSystemTime( (FILETIME*)&m_stamp, &time );
+	::FileTimeToSystemTime( (FILETIME*)&wall, &time );
 
 	char buf[100];
 	sprintf_s( buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d:%03d ", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond, time.wMilliseconds );
@@ -110,5 +121,25 @@ int32 TimeStampImpl::operator-
 	TimeStampImpl const& _other
 )
 {
-	return (int32)( ( m_stamp - _other.m_stamp ) / 10000LL );
+	return (int32)( ( m_stamp - _other.m_stamp ) / 1000LL );
+}
+
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::GetMicroseconds>
+//	Monotonic time in microseconds
+//-----------------------------------------------------------------------------
+uint64 TimeStampImpl::GetMicroseconds
+(
+)
+{
+	static LARGE_INTEGER s_frequency = { 0 };
+	if( !s_frequency.QuadPart )
+	{
+		QueryPerformanceFrequency( &s_frequency );
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter( &counter );
+	return (uint64)( counter.QuadPart / s_frequency.QuadPart ) * 1000000
+		+ (uint64)( counter.QuadPart % s_frequency.QuadPart ) * 1000000 / s_frequency.QuadPart;
 }
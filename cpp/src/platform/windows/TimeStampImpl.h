@@ -64,6 +64,12 @@ namespace OpenZWave
 		 */
 		int32 TimeRemaining();
 
+		/**
+		 * TimeRemainingMicroseconds.  Gets the difference between now and the
+		 * timestamp time in microseconds.
+		 */
+		int64 TimeRemainingMicroseconds();
+
 		/**
 		 * Return as as string
 		 */
@@ -75,11 +81,17 @@ namespace OpenZWave
 		 */
 		int32 operator- ( TimeStampImpl const& _other );
 
+		/**
+		 * Microseconds from an arbitrary starting point, read from the
+		 * performance counter so that changes to the system time have no effect.
+		 */
+		static uint64 GetMicroseconds();
+
 	private:
 		TimeStampImpl( TimeStampImpl const& );			// prevent copy
 		TimeStampImpl& operator = ( TimeStampImpl const& );	// prevent assignment
 
-		int64	m_stamp;
+		int64	m_stamp;									// Microseconds, as returned by GetMicroseconds
 	};
 
 } // namespace OpenZWave
@@ -28,11 +28,14 @@
 #include "tinyxml.h"
 #include "Manager.h"
 #include "Driver.h"
+#include "SetValueTracker.h"
+#include "ValueHistory.h"
 #include "Node.h"
 #include "Notification.h"
 #include "Msg.h"
 #include "value_classes/Value.h"
 #include "platform/Log.h"
+#include "platform/TimeStamp.h"
 #include "command_classes/CommandClass.h"
 #include <ctime>
 #include "Options.h"
@@ -87,6 +90,10 @@ Value::Value
 	m_max( 0 ),
 	m_refreshTime(0),
 	m_verifyChanges( false ),
+	m_reportCount( 0 ),
+	m_changeCount( 0 ),
+	m_reportTime( 0 ),
+	m_history( NULL ),
 	m_id( _homeId, _nodeId, _genre, _commandClassId, _instance, _index, _type ),
 	m_label( _label ),
 	m_units( _units ),
@@ -113,6 +120,10 @@ Value::Value
 	m_max( 0 ),
 	m_refreshTime(0),
 	m_verifyChanges( false ),
+	m_reportCount( 0 ),
+	m_changeCount( 0 ),
+	m_reportTime( 0 ),
+	m_history( NULL ),
 	m_readOnly( false ),
 	m_writeOnly( false ),
 	m_isSet( false ),
@@ -367,6 +378,12 @@ bool Value::Set
 			if( CommandClass* cc = node->GetCommandClass( m_id.GetCommandClassId() ) )
 			{
 				Log::Write(LogLevel_Info, m_id.GetNodeId(), "Value::Set - %s - %s - %d - %d - %s", cc->GetCommandClassName().c_str(), this->GetLabel().c_str(), m_id.GetIndex(), m_id.GetInstance(), this->GetAsString().c_str());
+				if( driver->m_setValueCapture != 0 )
+				{
+					// Manager::SetValueAsync is following this change
+					driver->m_setValueTracker->OnSet( driver->m_setValueCapture, this );
+				}
+
 				// flag value as set and queue a "Set Value" message for transmission to the device
 				res = cc->SetValue( *this );
 
@@ -420,6 +437,7 @@ void Value::OnValueRefreshed
 	if( Driver* driver = Manager::Get()->GetDriver( m_id.GetHomeId() ) )
 	{
 		m_isSet = true;
+		driver->m_setValueTracker->OnValueReported( m_id );
 
 		bool bSuppress;
 		Options::Get()->GetOptionAsBool( "SuppressValueRefresh", &bSuppress );
@@ -450,6 +468,7 @@ void Value::OnValueChanged
 	if( Driver* driver = Manager::Get()->GetDriver( m_id.GetHomeId() ) )
 	{
 		m_isSet = true;
+		driver->m_setValueTracker->OnValueReported( m_id );
 
 		// Notify the watchers
 		Notification* notification = new Notification( Notification::Type_ValueChanged );
@@ -554,6 +573,58 @@ char const* Value::GetTypeNameFromEnum
 	return c_typeName[_type];
 }
 
+//-----------------------------------------------------------------------------
+// <Value::RecordHistory>
+// Add a report of a numeric value to the driver's value history
+//-----------------------------------------------------------------------------
+void Value::RecordHistory
+(
+	void* _newValue,
+	ValueID::ValueType _type
+)
+{
+	if( m_history == NULL )
+	{
+		return;
+	}
+
+	double sample;
+	switch( _type )
+	{
+		case ValueID::ValueType_Bool:
+		{
+			sample = *((bool*)_newValue) ? 1.0 : 0.0;
+			break;
+		}
+		case ValueID::ValueType_Byte:
+		{
+			sample = (double)*((uint8*)_newValue);
+			break;
+		}
+		case ValueID::ValueType_Short:
+		{
+			sample = (double)*((short*)_newValue);
+			break;
+		}
+		case ValueID::ValueType_List:			// The index of the selection
+		case ValueID::ValueType_Int:
+		{
+			sample = (double)*((int32*)_newValue);
+			break;
+		}
+		case ValueID::ValueType_Decimal:
+		{
+			sample = atof( ((string*)_newValue)->c_str() );
+			break;
+		}
+		default:
+		{
+			return;
+		}
+	}
+	m_history->Record( m_id, sample, (uint32)time( NULL ) );
+}
+
 //-----------------------------------------------------------------------------
 // <Value::VerifyRefreshedValue>
 // Check a refreshed value
@@ -573,10 +644,17 @@ int Value::VerifyRefreshedValue
 	// to be setting these values after the refesh or notification is sent.  With some
 	// focus on the actual variable storage, we should be able to accomplish this with
 	// memory functions.  It's really the strings that make things complicated(?).
+
+	// Count the reports and changes for adaptive polling
+	++m_reportCount;
+	m_reportTime = TimeStamp::GetMicroseconds();
+	RecordHistory( _newValue, _type );
+
 	// if this is the first read of a value, assume it is valid (and notify as a change)
 	if( !IsSet() )
 	{
 		Log::Write( LogLevel_Detail, m_id.GetNodeId(), "Initial read of value" );
+		++m_changeCount;
 		Value::OnValueChanged();
 		return 2;		// confirmed change of value
 	}
@@ -628,17 +706,6 @@ int Value::VerifyRefreshedValue
 	}
 	m_refreshTime = time( NULL );	// update value refresh time
 
-	// check whether changes in this value should be verified (since some devices will report values that always
-	// change, where confirming changes is difficult or impossible)
-	Log::Write( LogLevel_Detail, m_id.GetNodeId(), "Changes to this value are %sverified", m_verifyChanges ? "" : "not " );
-
-	if( !m_verifyChanges )
-	{
-		// since we're not checking changes in this value, notify ValueChanged (to be on the safe side)
-		Value::OnValueChanged();
-		return 2;				// confirmed change of value
-	}
-
 	// see if the value has changed (result is used whether checking change or not)
 	bool bOriginalEqual = false;
 	switch( _type )
@@ -669,6 +736,22 @@ int Value::VerifyRefreshedValue
 		break;
 	}
 
+	if( !bOriginalEqual )
+	{
+		++m_changeCount;
+	}
+
+	// check whether changes in this value should be verified (since some devices will report values that always
+	// change, where confirming changes is difficult or impossible)
+	Log::Write( LogLevel_Detail, m_id.GetNodeId(), "Changes to this value are %sverified", m_verifyChanges ? "" : "not " );
+
+	if( !m_verifyChanges )
+	{
+		// since we're not checking changes in this value, notify ValueChanged (to be on the safe side)
+		Value::OnValueChanged();
+		return 2;				// confirmed change of value
+	}
+
 		// if this is the first refresh of the value, test to see if the value has changed
 	if( !IsCheckingChange() )
 	{
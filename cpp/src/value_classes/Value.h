@@ -41,6 +41,7 @@ class TiXmlElement;
 namespace OpenZWave
 {
 	class Node;
+	class ValueHistory;
 
 	/** \brief Base class for values associated with a node.
 	 */
@@ -100,12 +101,17 @@ namespace OpenZWave
 		void OnValueRefreshed();			// A value in a device has been refreshed
 		void OnValueChanged();				// The refreshed value actually changed
 		int VerifyRefreshedValue( void* _originalValue, void* _checkValue, void* _newValue, ValueID::ValueType _type, int _length = 0 );
+		void RecordHistory( void* _newValue, ValueID::ValueType _type );
 
 		int32		m_min;
 		int32		m_max;
 
 		time_t		m_refreshTime;			// time_t identifying when this value was last refreshed
 		bool		m_verifyChanges;		// if true, apparent changes are verified; otherwise, they're not
+		uint32		m_reportCount;			// Reports of the value, counted for adaptive polling
+		uint32		m_changeCount;			// Reports that changed the value
+		uint64		m_reportTime;			// TimeStamp::GetMicroseconds at the last report, or 0
+		ValueHistory*	m_history;			// The driver's value history, or NULL.  Set when the value is added to a store.
 
 	private:
 		ValueID		m_id;
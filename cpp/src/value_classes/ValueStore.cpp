@@ -78,6 +78,9 @@ bool ValueStore::AddValue
 	// Notify the watchers of the new value
 	if( Driver* driver = Manager::Get()->GetDriver( _value->GetID().GetHomeId() ) )
 	{
+		// Saves looking the driver up for every report of the value
+		_value->m_history = driver->m_valueHistory;
+
 		Notification* notification = new Notification( Notification::Type_ValueAdded );
 		notification->SetValueId( _value->GetID() );
 		driver->QueueNotification( notification );
@@ -450,6 +450,9 @@ DISTFILES =	.gitignore \
 	config/zwave.me/zweather.xml \
 	config/zwcfg.xsd \
 	config/zwscene.xsd \
+	cpp/benchmarks/Benchmarks.cpp \
+	cpp/benchmarks/Benchmarks.in \
+	cpp/benchmarks/Makefile \
 	cpp/build/Makefile \
 	cpp/build/OZW_RunTests.sh \
 	cpp/build/libopenzwave.pc.in \
@@ -525,16 +528,22 @@ DISTFILES =	.gitignore \
 	cpp/hidapi/windows/hidapi.vcproj \
 	cpp/hidapi/windows/hidtest.vcproj \
 	cpp/src/Bitfield.h \
+	cpp/src/ConfigScheduler.cpp \
+	cpp/src/ConfigScheduler.h \
 	cpp/src/Defs.h \
 	cpp/src/DoxygenMain.h \
 	cpp/src/Driver.cpp \
 	cpp/src/Driver.h \
 	cpp/src/Group.cpp \
 	cpp/src/Group.h \
+	cpp/src/HealScheduler.cpp \
+	cpp/src/HealScheduler.h \
 	cpp/src/Manager.cpp \
 	cpp/src/Manager.h \
 	cpp/src/Msg.cpp \
 	cpp/src/Msg.h \
+	cpp/src/NetworkGraph.cpp \
+	cpp/src/NetworkGraph.h \
 	cpp/src/Node.cpp \
 	cpp/src/Node.h \
 	cpp/src/Notification.cpp \
@@ -542,10 +551,20 @@ DISTFILES =	.gitignore \
 	cpp/src/OZWException.h \
 	cpp/src/Options.cpp \
 	cpp/src/Options.h \
+	cpp/src/ReportDispatcher.cpp \
+	cpp/src/ReportDispatcher.h \
 	cpp/src/Scene.cpp \
 	cpp/src/Scene.h \
+	cpp/src/SecurityDecryptor.cpp \
+	cpp/src/SecurityDecryptor.h \
+	cpp/src/SetValueTracker.cpp \
+	cpp/src/SetValueTracker.h \
 	cpp/src/Utils.cpp \
 	cpp/src/Utils.h \
+	cpp/src/ValueHistory.cpp \
+	cpp/src/ValueHistory.h \
+	cpp/src/WatcherFilter.cpp \
+	cpp/src/WatcherFilter.h \
 	cpp/src/ZWSecurity.cpp \
 	cpp/src/ZWSecurity.h \
 	cpp/src/aes/aes.h \
@@ -669,6 +688,8 @@ DISTFILES =	.gitignore \
 	cpp/src/command_classes/WakeUp.h \
 	cpp/src/command_classes/ZWavePlusInfo.cpp \
 	cpp/src/command_classes/ZWavePlusInfo.h \
+	cpp/src/platform/Capture.cpp \
+	cpp/src/platform/Capture.h \
 	cpp/src/platform/Controller.cpp \
 	cpp/src/platform/Controller.h \
 	cpp/src/platform/Event.cpp \
@@ -682,14 +703,20 @@ DISTFILES =	.gitignore \
 	cpp/src/platform/Mutex.cpp \
 	cpp/src/platform/Mutex.h \
 	cpp/src/platform/Ref.h \
+	cpp/src/platform/ReplayController.cpp \
+	cpp/src/platform/ReplayController.h \
 	cpp/src/platform/SerialController.cpp \
 	cpp/src/platform/SerialController.h \
+	cpp/src/platform/SimulatedController.cpp \
+	cpp/src/platform/SimulatedController.h \
 	cpp/src/platform/Stream.cpp \
 	cpp/src/platform/Stream.h \
 	cpp/src/platform/Thread.cpp \
 	cpp/src/platform/Thread.h \
 	cpp/src/platform/TimeStamp.cpp \
 	cpp/src/platform/TimeStamp.h \
+	cpp/src/platform/TimerWheel.cpp \
+	cpp/src/platform/TimerWheel.h \
 	cpp/src/platform/Wait.cpp \
 	cpp/src/platform/Wait.h \
 	cpp/src/platform/unix/EventImpl.cpp \
@@ -86,7 +86,9 @@ namespace OpenZWaveDotNet
 			AllNodesQueried					= Notification::Type_AllNodesQueried,
 			Notification					= Notification::Type_Notification,
 			DriverRemoved					= Notification::Type_DriverRemoved,
-			ControllerCommand				= Notification::Type_ControllerCommand
+			ControllerCommand				= Notification::Type_ControllerCommand,
+			HealProgress					= Notification::Type_HealProgress,
+			ConfigBatchComplete				= Notification::Type_ConfigBatchComplete
 		};
 
 	public:
@@ -98,7 +100,8 @@ namespace OpenZWaveDotNet
 			Awake = Notification::Code_Awake,
 			Sleep = Notification::Code_Sleep,
 			Dead = Notification::Code_Dead,
-			Alive = Notification::Code_Alive
+			Alive = Notification::Code_Alive,
+			Dropped = Notification::Code_Dropped
 		};
 
 		ZWNotification( Notification* notification )
@@ -106,8 +109,8 @@ namespace OpenZWaveDotNet
 			m_type = (Type)Enum::ToObject( Type::typeid, notification->GetType() );
 			m_byte = notification->GetByte();
 
-			//Check if notification is either NodeEvent or ControllerCommand, otherwise GetEvent() will fail
-			if ((m_type == Type::NodeEvent) || (m_type == Type::ControllerCommand))
+			//Check if notification is either NodeEvent, ControllerCommand or HealProgress, otherwise GetEvent() will fail
+			if ((m_type == Type::NodeEvent) || (m_type == Type::ControllerCommand) || (m_type == Type::HealProgress))
 			{
 				m_event = notification->GetEvent();
 			}			